@@ -0,0 +1,829 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014-2017 by Ullrich Koethe                  */
+/*                                                                      */
+/*    This file is part of the VIGRA2 computer vision library.          */
+/*    The VIGRA2 Website is                                             */
+/*        http://ukoethe.github.io/vigra2                               */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#pragma once
+
+#ifndef VIGRA2_ACCUMULATOR_HXX
+#define VIGRA2_ACCUMULATOR_HXX
+
+#include "config.hxx"
+#include "error.hxx"
+#include "numeric_traits.hxx"
+#include "tinyarray.hxx"
+#include "box.hxx"
+#include "array_nd.hxx"
+#include "parallel.hxx"
+#include <tuple>
+#include <vector>
+#include <string>
+#include <cmath>
+
+namespace vigra {
+
+    /** \brief Statistics over arrays and regions.
+
+        Features are selected by tag classes such as <tt>acc::Mean</tt> and combined
+        into an accumulator chain via <tt>acc::Select<...></tt>. Dependencies between
+        features (e.g. <tt>Mean</tt> requires <tt>Count</tt> and <tt>Sum</tt>) are
+        resolved at compile time, so that every feature is computed only once.
+        All features support <tt>merge()</tt>, which allows partial results
+        from different threads or array parts to be combined.
+
+        <b>\#include</b> \<vigra2/accumulator.hxx\><br>
+        Namespace: vigra::acc
+    */
+namespace acc {
+
+template <class ... TAGS>
+struct Select
+{};
+
+/********************************************************/
+/*                                                      */
+/*             dependency resolution (internal)         */
+/*                                                      */
+/********************************************************/
+
+namespace acc_detail {
+
+template <class TAG, class LIST>
+struct Contains;
+
+template <class TAG>
+struct Contains<TAG, Select<>>
+: public std::false_type
+{};
+
+template <class TAG, class HEAD, class ... TAIL>
+struct Contains<TAG, Select<HEAD, TAIL...>>
+: public std::integral_constant<bool, std::is_same<TAG, HEAD>::value ||
+                                      Contains<TAG, Select<TAIL...>>::value>
+{};
+
+template <class LIST, class TAG>
+struct PushUnique;
+
+template <class ... TAGS, class TAG>
+struct PushUnique<Select<TAGS...>, TAG>
+{
+    typedef typename std::conditional<Contains<TAG, Select<TAGS...>>::value,
+                                      Select<TAGS...>,
+                                      Select<TAGS..., TAG>>::type type;
+};
+
+    // append each tag after its dependencies, omitting duplicates
+template <class RESULT, class TODO>
+struct ResolveImpl;
+
+template <class RESULT>
+struct ResolveImpl<RESULT, Select<>>
+{
+    typedef RESULT type;
+};
+
+template <class RESULT, class HEAD, class ... TAIL>
+struct ResolveImpl<RESULT, Select<HEAD, TAIL...>>
+{
+    typedef typename ResolveImpl<RESULT, typename HEAD::Dependencies>::type  WithDependencies;
+    typedef typename PushUnique<WithDependencies, HEAD>::type                WithHead;
+    typedef typename ResolveImpl<WithHead, Select<TAIL...>>::type            type;
+};
+
+template <class SELECTED>
+using ResolveDependencies = typename ResolveImpl<Select<>, SELECTED>::type;
+
+template <class TAG, class LIST>
+struct IndexOf;
+
+template <class TAG, class ... TAIL>
+struct IndexOf<TAG, Select<TAG, TAIL...>>
+{
+    static const int value = 0;
+};
+
+template <class TAG, class HEAD, class ... TAIL>
+struct IndexOf<TAG, Select<HEAD, TAIL...>>
+{
+    static const int value = IndexOf<TAG, Select<TAIL...>>::value + 1;
+};
+
+template <class T, int N, class LIST>
+struct ImplTuple;
+
+template <class T, int N, class ... TAGS>
+struct ImplTuple<T, N, Select<TAGS...>>
+{
+    typedef std::tuple<typename TAGS::template Impl<T, N>...> type;
+};
+
+template <int I, int SIZE>
+struct ChainLoop
+{
+    template <class TUPLE, class T, class SHAPE>
+    static void update(TUPLE & t, T const & v, SHAPE const & coord)
+    {
+        std::get<I>(t).update(v, coord);
+        ChainLoop<I+1, SIZE>::update(t, v, coord);
+    }
+
+    template <class TUPLE>
+    static void merge(TUPLE & t, TUPLE const & o)
+    {
+        std::get<I>(t).merge(std::get<I>(o));
+        ChainLoop<I+1, SIZE>::merge(t, o);
+    }
+};
+
+template <int SIZE>
+struct ChainLoop<SIZE, SIZE>
+{
+    template <class TUPLE, class T, class SHAPE>
+    static void update(TUPLE &, T const &, SHAPE const &)
+    {}
+
+    template <class TUPLE>
+    static void merge(TUPLE &, TUPLE const &)
+    {}
+};
+
+    // floating point type used for sums and moments
+template <class T>
+using RealType = PromoteType<RealPromoteType<T>, double>;
+
+} // namespace acc_detail
+
+/********************************************************/
+/*                                                      */
+/*                     feature tags                     */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Number of data items.
+    */
+struct Count
+{
+    typedef Select<> Dependencies;
+
+    template <class T, int N>
+    struct Impl
+    {
+        typedef ArrayIndex result_type;
+
+        void update(T const &, Shape<N> const &)
+        {
+            ++count_;
+        }
+
+        void merge(Impl const & o)
+        {
+            count_ += o.count_;
+        }
+
+        template <class CHAIN>
+        result_type get(CHAIN const &) const
+        {
+            return count_;
+        }
+
+        ArrayIndex count_ = 0;
+    };
+};
+
+    /** \brief Sum of the data values.
+    */
+struct Sum
+{
+    typedef Select<> Dependencies;
+
+    template <class T, int N>
+    struct Impl
+    {
+        typedef acc_detail::RealType<T> result_type;
+
+        void update(T const & v, Shape<N> const &)
+        {
+            if(first_)
+            {
+                sum_ = v;
+                first_ = false;
+            }
+            else
+            {
+                sum_ += v;
+            }
+        }
+
+        void merge(Impl const & o)
+        {
+            if(o.first_)
+                return;
+            if(first_)
+                *this = o;
+            else
+                sum_ += o.sum_;
+        }
+
+        template <class CHAIN>
+        result_type get(CHAIN const &) const
+        {
+            return sum_;
+        }
+
+        result_type sum_ = result_type();
+        bool first_ = true;
+    };
+};
+
+    /** \brief Arithmetic mean of the data values.
+    */
+struct Mean
+{
+    typedef Select<Count, Sum> Dependencies;
+
+    template <class T, int N>
+    struct Impl
+    {
+        typedef acc_detail::RealType<T> result_type;
+
+        void update(T const &, Shape<N> const &)
+        {}
+
+        void merge(Impl const &)
+        {}
+
+        template <class CHAIN>
+        result_type get(CHAIN const & chain) const
+        {
+            return chain.template get<Sum>() / (double)chain.template get<Count>();
+        }
+    };
+};
+
+    /** \brief Population variance of the data values.
+
+        Computed with Welford's update formula, partial results are combined
+        with the pairwise formula of Chan et al. This is numerically stable
+        even when the mean is large compared to the standard deviation.
+    */
+struct Variance
+{
+    typedef Select<> Dependencies;
+
+    template <class T, int N>
+    struct Impl
+    {
+        typedef acc_detail::RealType<T> result_type;
+
+        void update(T const & v, Shape<N> const &)
+        {
+            if(count_ == 0.0)
+            {
+                count_ = 1.0;
+                mean_ = v;
+                m2_ = mean_ - mean_;
+            }
+            else
+            {
+                count_ += 1.0;
+                result_type delta = v - mean_;
+                mean_ += delta / count_;
+                m2_ += delta * (v - mean_);
+            }
+        }
+
+        void merge(Impl const & o)
+        {
+            if(o.count_ == 0.0)
+                return;
+            if(count_ == 0.0)
+            {
+                *this = o;
+                return;
+            }
+            double n = count_ + o.count_;
+            result_type delta = o.mean_ - mean_;
+            mean_ += delta * (o.count_ / n);
+            m2_ += o.m2_ + delta * delta * (count_ * o.count_ / n);
+            count_ = n;
+        }
+
+        template <class CHAIN>
+        result_type get(CHAIN const &) const
+        {
+            return m2_ / count_;
+        }
+
+        double count_ = 0.0;
+        result_type mean_ = result_type(), m2_ = result_type();
+    };
+};
+
+    /** \brief Standard deviation of the data values (square root of <tt>Variance</tt>).
+    */
+struct StdDev
+{
+    typedef Select<Variance> Dependencies;
+
+    template <class T, int N>
+    struct Impl
+    {
+        typedef acc_detail::RealType<T> result_type;
+
+        void update(T const &, Shape<N> const &)
+        {}
+
+        void merge(Impl const &)
+        {}
+
+        template <class CHAIN>
+        result_type get(CHAIN const & chain) const
+        {
+            using std::sqrt;
+            return sqrt(chain.template get<Variance>());
+        }
+    };
+};
+
+    /** \brief Smallest data value.
+    */
+struct Minimum
+{
+    typedef Select<> Dependencies;
+
+    template <class T, int N>
+    struct Impl
+    {
+        typedef T result_type;
+
+        void update(T const & v, Shape<N> const &)
+        {
+            using std::min;
+            if(first_)
+            {
+                value_ = v;
+                first_ = false;
+            }
+            else
+            {
+                value_ = min(value_, v);
+            }
+        }
+
+        void merge(Impl const & o)
+        {
+            if(!o.first_)
+                update(o.value_, Shape<N>());
+        }
+
+        template <class CHAIN>
+        result_type get(CHAIN const &) const
+        {
+            return value_;
+        }
+
+        T value_ = T();
+        bool first_ = true;
+    };
+};
+
+    /** \brief Largest data value.
+    */
+struct Maximum
+{
+    typedef Select<> Dependencies;
+
+    template <class T, int N>
+    struct Impl
+    {
+        typedef T result_type;
+
+        void update(T const & v, Shape<N> const &)
+        {
+            using std::max;
+            if(first_)
+            {
+                value_ = v;
+                first_ = false;
+            }
+            else
+            {
+                value_ = max(value_, v);
+            }
+        }
+
+        void merge(Impl const & o)
+        {
+            if(!o.first_)
+                update(o.value_, Shape<N>());
+        }
+
+        template <class CHAIN>
+        result_type get(CHAIN const &) const
+        {
+            return value_;
+        }
+
+        T value_ = T();
+        bool first_ = true;
+    };
+};
+
+    /** \brief Bounding box of the data coordinates.
+
+        The result is a <tt>Box<N></tt>, whose <tt>upper()</tt> corner lies
+        outside the region as usual for integer coordinates.
+    */
+struct BoundingBox
+{
+    typedef Select<> Dependencies;
+
+    template <class T, int N>
+    struct Impl
+    {
+        typedef Box<N> result_type;
+
+        void update(T const &, Shape<N> const & coord)
+        {
+            box_ |= coord;
+        }
+
+        void merge(Impl const & o)
+        {
+            box_ |= o.box_;
+        }
+
+        template <class CHAIN>
+        result_type const & get(CHAIN const &) const
+        {
+            return box_;
+        }
+
+        result_type box_;
+    };
+};
+
+    /** \brief Center of mass of the data coordinates (unweighted).
+    */
+struct Centroid
+{
+    typedef Select<Count> Dependencies;
+
+    template <class T, int N>
+    struct Impl
+    {
+        typedef TinyArray<double, N> result_type;
+
+        void update(T const &, Shape<N> const & coord)
+        {
+            if(first_)
+            {
+                sum_ = coord;
+                first_ = false;
+            }
+            else
+            {
+                sum_ += coord;
+            }
+        }
+
+        void merge(Impl const & o)
+        {
+            if(o.first_)
+                return;
+            if(first_)
+                *this = o;
+            else
+                sum_ += o.sum_;
+        }
+
+        template <class CHAIN>
+        result_type get(CHAIN const & chain) const
+        {
+            return sum_ / (double)chain.template get<Count>();
+        }
+
+        result_type sum_;
+        bool first_ = true;
+    };
+};
+
+/********************************************************/
+/*                                                      */
+/*                   AccumulatorChain                   */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Compute several features of a data set in a single pass.
+
+        <tt>T</tt> is the data type, <tt>N</tt> the dimension of the coordinates
+        passed to <tt>update()</tt>, and <tt>SELECTED</tt> an <tt>acc::Select<...></tt>
+        list of the desired features. Features needed by the selected ones are
+        added automatically.
+
+        \code
+        acc::AccumulatorChain<float, 2, acc::Select<acc::Mean, acc::Variance>> a;
+        for(...)
+            a.update(value, coord);
+        double mean = acc::get<acc::Mean>(a);
+        \endcode
+    */
+template <class T, int N, class SELECTED>
+class AccumulatorChain
+{
+  public:
+    typedef acc_detail::ResolveDependencies<SELECTED>        Tags;
+    typedef typename acc_detail::ImplTuple<T, N, Tags>::type impl_tuple;
+    typedef T                                                value_type;
+    typedef Shape<N>                                         shape_type;
+
+    static const int size = std::tuple_size<impl_tuple>::value;
+
+    template <class TAG>
+    struct Accessor
+    {
+        static_assert(acc_detail::Contains<TAG, Tags>::value,
+            "AccumulatorChain::get(): feature was not selected.");
+
+        static const int index = acc_detail::IndexOf<TAG, Tags>::value;
+        typedef typename std::tuple_element<index, impl_tuple>::type impl_type;
+        typedef typename impl_type::result_type result_type;
+    };
+
+    void update(T const & v, shape_type const & coord)
+    {
+        acc_detail::ChainLoop<0, size>::update(impls_, v, coord);
+    }
+
+    void merge(AccumulatorChain const & o)
+    {
+        acc_detail::ChainLoop<0, size>::merge(impls_, o.impls_);
+    }
+
+    template <class TAG>
+    typename Accessor<TAG>::result_type
+    get() const
+    {
+        return std::get<Accessor<TAG>::index>(impls_).get(*this);
+    }
+
+    impl_tuple impls_;
+};
+
+    /** \brief Access a feature of an accumulator chain.
+    */
+template <class TAG, class T, int N, class SELECTED>
+inline auto
+get(AccumulatorChain<T, N, SELECTED> const & a)
+-> decltype(a.template get<TAG>())
+{
+    return a.template get<TAG>();
+}
+
+/********************************************************/
+/*                                                      */
+/*                 AccumulatorChainArray                */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Compute features for every region of a label array.
+
+        Regions are stored densely in a <tt>std::vector</tt> indexed by label,
+        so that lookup is a single array access even for millions of labels.
+        Accordingly, labels should be reasonably compact (e.g. the result of
+        a connected components labeling). The storage grows automatically
+        to the largest label seen.
+    */
+template <class T, int N, class SELECTED>
+class AccumulatorChainArray
+{
+  public:
+    typedef AccumulatorChain<T, N, SELECTED> chain_type;
+    typedef typename chain_type::Tags        Tags;
+    typedef T                                value_type;
+    typedef Shape<N>                         shape_type;
+
+    AccumulatorChainArray()
+    : ignore_label_(-1)
+    {}
+
+        /** Do not collect statistics for the given label (pass -1 to
+            include all labels again).
+        */
+    void ignoreLabel(ArrayIndex label)
+    {
+        ignore_label_ = label;
+    }
+
+    ArrayIndex ignoredLabel() const
+    {
+        return ignore_label_;
+    }
+
+        /** Number of region slots (i.e. largest label plus one).
+        */
+    ArrayIndex regionCount() const
+    {
+        return (ArrayIndex)regions_.size();
+    }
+
+    ArrayIndex maxRegionLabel() const
+    {
+        return regionCount() - 1;
+    }
+
+    void setMaxRegionLabel(ArrayIndex label)
+    {
+        regions_.resize(label + 1);
+    }
+
+    chain_type & getAccumulator(ArrayIndex label)
+    {
+        vigra_precondition(0 <= label && label < regionCount(),
+            "AccumulatorChainArray::getAccumulator(): label out of range.");
+        return regions_[label];
+    }
+
+    chain_type const & getAccumulator(ArrayIndex label) const
+    {
+        vigra_precondition(0 <= label && label < regionCount(),
+            "AccumulatorChainArray::getAccumulator(): label out of range.");
+        return regions_[label];
+    }
+
+    template <class TAG>
+    typename chain_type::template Accessor<TAG>::result_type
+    get(ArrayIndex label) const
+    {
+        return getAccumulator(label).template get<TAG>();
+    }
+
+    void update(T const & v, shape_type const & coord, ArrayIndex label)
+    {
+        if(label == ignore_label_)
+            return;
+        vigra_precondition(label >= 0,
+            "AccumulatorChainArray::update(): labels must be non-negative.");
+        if(label >= regionCount())
+            regions_.resize(label + 1);
+        regions_[label].update(v, coord);
+    }
+
+    void merge(AccumulatorChainArray const & o)
+    {
+        if(o.regionCount() > regionCount())
+            regions_.resize(o.regions_.size());
+        for(ArrayIndex k=0; k<o.regionCount(); ++k)
+            regions_[k].merge(o.regions_[k]);
+    }
+
+    std::vector<chain_type> regions_;
+    ArrayIndex ignore_label_;
+};
+
+    /** \brief Access a feature of a given region.
+    */
+template <class TAG, class T, int N, class SELECTED>
+inline auto
+get(AccumulatorChainArray<T, N, SELECTED> const & a, ArrayIndex label)
+-> decltype(a.template get<TAG>(label))
+{
+    return a.template get<TAG>(label);
+}
+
+/********************************************************/
+/*                                                      */
+/*                    extractFeatures                   */
+/*                                                      */
+/********************************************************/
+
+namespace acc_detail {
+
+template <class POINTERS, class SHAPE, class ACCUMULATOR>
+void
+extractFeaturesImpl(POINTERS & h, SHAPE const & shape, SHAPE const & order,
+                    ACCUMULATOR & a, int dim)
+{
+    int axis = order[dim];
+    if(dim == 0)
+    {
+        for(ArrayIndex k=0; k<shape[axis]; ++k, h.inc(axis))
+            a.update(vigra::get<1>(h), h.coord(), (ArrayIndex)vigra::get<2>(h));
+    }
+    else
+    {
+        for(ArrayIndex k=0; k<shape[axis]; ++k, h.inc(axis))
+            extractFeaturesImpl(h, shape, order, a, dim-1);
+    }
+    h.move(axis, -shape[axis]);
+}
+
+} // namespace acc_detail
+
+    /** \brief Compute region features of \a data for all regions in \a labels.
+
+        The arrays are traversed once in memory order. The outermost loop is split into
+        chunks according to \a options, and each chunk collects its own partial
+        results, which are merged in chunk order at the end (so that results do
+        not depend on thread scheduling). Results are merged into \a a, which may
+        already contain statistics from a previous call.
+
+        \code
+        ArrayND<3, float>    data(shape);
+        ArrayND<3, uint32_t> labels(shape);
+        ...
+        acc::AccumulatorChainArray<float, 3,
+                acc::Select<acc::Mean, acc::Variance, acc::BoundingBox>> a;
+        a.ignoreLabel(0);     // background
+        acc::extractFeatures(data, labels, a);
+        for(int k=1; k<a.regionCount(); ++k)
+            std::cout << acc::get<acc::Mean>(a, k) << "\n";
+        \endcode
+    */
+template <int N, class T, class L, class SELECTED>
+void
+extractFeatures(ArrayViewND<N, T> const & data, ArrayViewND<N, L> const & labels,
+                AccumulatorChainArray<T, N, SELECTED> & a,
+                ParallelOptions const & options = ParallelOptions())
+{
+    static_assert(std::is_integral<L>::value,
+        "extractFeatures(): labels must have an integral type.");
+    vigra_precondition(data.shape() == labels.shape(),
+        "extractFeatures(): shape mismatch between data and labels.");
+    if(data.size() == 0)
+        return;
+
+    const int ndim = data.ndim();
+    Shape<N> order  = reversed(detail::permutationToOrder(data.byte_strides(), C_ORDER));
+    int      outer  = order[ndim-1];
+    ArrayIndex rows = data.shape(outer),
+               minRows = std::max<ArrayIndex>(1, (1 << 16) / (data.size() / rows));
+
+    typedef AccumulatorChainArray<T, N, SELECTED> Partial;
+    int chunkCount = parallelChunkCount(rows, options, minRows);
+    std::vector<Partial> partials(chunkCount);
+
+    parallelForeachChunk(rows, chunkCount,
+        [&](int chunk, ArrayIndex begin, ArrayIndex end)
+        {
+            Partial & p = partials[chunk];
+            p.ignoreLabel(a.ignoredLabel());
+            auto h = makePointerNDCoupled(data, labels);
+            h.move(outer, begin);
+            Shape<N> shape = data.shape();
+            shape[outer] = end - begin;
+            acc_detail::extractFeaturesImpl(h, shape, order, p, ndim-1);
+        });
+
+    ArrayIndex regionCount = a.regionCount();
+    for(auto const & p : partials)
+        regionCount = std::max(regionCount, p.regionCount());
+    if(regionCount > a.regionCount())
+        a.setMaxRegionLabel(regionCount - 1);
+
+    // merge partial results region by region, in chunk order
+    parallelForeachChunk(regionCount, options,
+        [&](int, ArrayIndex begin, ArrayIndex end)
+        {
+            for(auto const & p : partials)
+                for(ArrayIndex k=begin; k<std::min(end, p.regionCount()); ++k)
+                    a.regions_[k].merge(p.regions_[k]);
+        }, 1 << 12);
+}
+
+} // namespace acc
+
+} // namespace vigra
+
+#endif // VIGRA2_ACCUMULATOR_HXX
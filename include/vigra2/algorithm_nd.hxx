@@ -39,6 +39,7 @@
 #define VIGRA2_ALGORITHM_ND_HXX
 
 #include "array_nd.hxx"
+#include "parallel.hxx"
 
 namespace vigra {
 
@@ -165,6 +166,68 @@ transformND(ARRAY1 const & src1, ARRAY2 const & src2, ARRAY3 & target, FCT && f)
     );
 }
 
+/**********************************************************/
+/*                                                        */
+/*                 parallelForeachChunk                   */
+/*                                                        */
+/**********************************************************/
+
+namespace array_detail {
+
+    // the axis with the largest stride among the non-singleton axes,
+    // i.e. the outermost loop of a memory-order traversal
+template <int N, class T>
+int
+parallelSplitAxis(ArrayViewND<N, T> const & a)
+{
+    int res = 0;
+    ArrayIndex stride = -1;
+    for(int k=0; k<a.ndim(); ++k)
+    {
+        if(a.shape(k) > 1 && std::abs(a.byte_strides()[k]) > stride)
+        {
+            res = k;
+            stride = std::abs(a.byte_strides()[k]);
+        }
+    }
+    return res;
+}
+
+} // namespace array_detail
+
+    /** \brief Split an array into contiguous blocks and process them concurrently.
+
+        The array is split along its outermost axis in memory order. The blocks
+        are formed by \ref parallelForeachChunk(ArrayIndex, int, FCT &&), so that the
+        partitioning is reproducible. The functor is called as
+        <tt>f(chunk_index, subarray)</tt>, where <tt>subarray</tt> is an
+        <tt>ArrayViewND<N, T></tt>. Each chunk contains at least \a minChunkSize
+        elements (unless the array is smaller), and the number of chunks is returned.
+        Algorithms typically allocate <tt>options.getActualNumThreads()</tt>
+        partial results and combine the first (returned) number of them
+        in chunk order.
+    */
+template <int N, class T, class FCT>
+int
+parallelForeachChunk(ArrayViewND<N, T> const & a, ParallelOptions const & options,
+                     FCT && f, ArrayIndex minChunkSize = 1 << 16)
+{
+    if(a.size() == 0)
+        return 0;
+    int axis = array_detail::parallelSplitAxis(a);
+    ArrayIndex rows = a.shape(axis),
+               rowSize = a.size() / rows;
+    return parallelForeachChunk(rows, options,
+        [&a, &f, axis](int chunk, ArrayIndex begin, ArrayIndex end)
+        {
+            Shape<N> start(tags::size = a.ndim(), 0),
+                     stop(a.shape());
+            start[axis] = begin;
+            stop[axis]  = end;
+            f(chunk, a.subarray(start, stop));
+        }, (minChunkSize + rowSize - 1) / rowSize);
+}
+
 } // namespace vigra
 
 #endif // VIGRA2_ALGORITHM_ND_HXX
@@ -0,0 +1,766 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014-2017 by Ullrich Koethe                  */
+/*                                                                      */
+/*    This file is part of the VIGRA2 computer vision library.          */
+/*    The VIGRA2 Website is                                             */
+/*        http://ukoethe.github.io/vigra2                               */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#pragma once
+
+#ifndef VIGRA2_ARRAY_FILE_HXX
+#define VIGRA2_ARRAY_FILE_HXX
+
+#include "config.hxx"
+#include "error.hxx"
+#include "numeric_traits.hxx"
+#include "axistags.hxx"
+#include "array_nd.hxx"
+#include "algorithm.hxx"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__unix) || defined(__APPLE__)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#else
+    #error "array_file.hxx requires POSIX file I/O (pread/pwrite/mmap)."
+#endif
+
+namespace vigra {
+
+/********************************************************/
+/*                                                      */
+/*                    ArrayFileInfo                     */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Contents of the header of a native array file.
+
+        See <tt>writeArray()</tt> for a description of the format.
+    */
+struct ArrayFileInfo
+{
+        /** Element type code (see <tt>ElementTypeCode</tt>).
+        */
+    char kind;
+    int itemsize, channels;
+
+        /** Shape and byte strides of the stored data. The strides are
+            positive and describe consecutive memory in some axis order.
+        */
+    Shape<runtime_size> shape, byte_strides;
+
+    AxisTags<runtime_size> axistags;
+
+        /** Key, type, resolution, and description of each axis.
+        */
+    std::vector<AxisInfo> axisinfo;
+
+        /** CRC-32 of the data (see <tt>checksum()</tt>).
+        */
+    std::uint32_t checksum;
+
+        /** Position and size of the data in the file. The offset is
+            a multiple of the page size.
+        */
+    std::size_t dataOffset, dataSize;
+
+    int ndim() const
+    {
+        return (int)shape.size();
+    }
+
+        /** Check if the file's elements are of type \a T.
+        */
+    template <class T>
+    bool hasElementType() const
+    {
+        typedef ElementTypeCode<T> Code;
+        return kind == Code::kind && itemsize == Code::itemsize && channels == Code::channels;
+    }
+};
+
+namespace array_file_detail {
+
+static const char magic[8] = { 'V', 'I', 'G', 'R', 'A', '2', 'N', 'D' };
+static const std::uint32_t formatVersion = 1;
+static const std::uint32_t byteOrderMark = 0x01020304;
+static const std::size_t dataAlignment = 4096;
+static const std::size_t blockSize = 1 << 22;
+    // magic, version, byte order, header size, data offset
+static const std::size_t headerPrefixSize = 8 + 4 + 4 + 8 + 8;
+
+    // file descriptor with error handling by exceptions
+class File
+{
+  public:
+    File(std::string const & filename, int flags, std::string const & function)
+    : fd_(::open(filename.c_str(), flags, 0644))
+    , filename_(filename)
+    , function_(function)
+    {
+        if(fd_ < 0)
+            vigra_fail(function_ + ": unable to open '" + filename_ + "'.");
+    }
+
+    File(File const &) = delete;
+    File & operator=(File const &) = delete;
+
+    ~File()
+    {
+        ::close(fd_);
+    }
+
+    void write(char const * data, std::size_t size, std::size_t offset)
+    {
+        while(size > 0)
+        {
+            ssize_t n = ::pwrite(fd_, data, size, (off_t)offset);
+            if(n < 0 && errno == EINTR)
+                continue;
+            if(n <= 0)
+                vigra_fail(function_ + ": write error in '" + filename_ + "'.");
+            data += n;
+            offset += n;
+            size -= n;
+        }
+    }
+
+    void read(char * data, std::size_t size, std::size_t offset)
+    {
+        while(size > 0)
+        {
+            ssize_t n = ::pread(fd_, data, size, (off_t)offset);
+            if(n < 0 && errno == EINTR)
+                continue;
+            if(n < 0)
+                vigra_fail(function_ + ": read error in '" + filename_ + "'.");
+            if(n == 0)
+                vigra_fail(function_ + ": unexpected end of file '" + filename_ + "'.");
+            data += n;
+            offset += n;
+            size -= n;
+        }
+    }
+
+    std::size_t size() const
+    {
+        struct stat s;
+        if(::fstat(fd_, &s) != 0)
+            vigra_fail(function_ + ": unable to stat '" + filename_ + "'.");
+        return (std::size_t)s.st_size;
+    }
+
+    int descriptor() const
+    {
+        return fd_;
+    }
+
+  private:
+    int fd_;
+    std::string filename_, function_;
+};
+
+class HeaderWriter
+{
+  public:
+    template <class V>
+    void put(V v)
+    {
+        bytes.append(reinterpret_cast<char const *>(&v), sizeof(V));
+    }
+
+    void putString(std::string const & s)
+    {
+        put((std::uint32_t)s.size());
+        bytes.append(s);
+    }
+
+    std::string bytes;
+};
+
+class HeaderReader
+{
+  public:
+    HeaderReader(char const * begin, char const * end)
+    : p_(begin)
+    , end_(end)
+    {}
+
+    template <class V>
+    V get()
+    {
+        V v;
+        check(sizeof(V));
+        std::memcpy(&v, p_, sizeof(V));
+        p_ += sizeof(V);
+        return v;
+    }
+
+    std::string getString()
+    {
+        std::size_t size = get<std::uint32_t>();
+        check(size);
+        std::string res(p_, size);
+        p_ += size;
+        return res;
+    }
+
+    std::size_t remaining() const
+    {
+        return (std::size_t)(end_ - p_);
+    }
+
+  private:
+    void check(std::size_t size) const
+    {
+        if((std::size_t)(end_ - p_) < size)
+            vigra_fail("readArrayInfo(): corrupt header.");
+    }
+
+    char const * p_, * end_;
+};
+
+    // True if 'byte_strides' describe a gap-free layout of 'shape' with elements of
+    // 'elementSize' bytes in some axis order (the strides of singleton axes don't matter).
+    // Then, no element lies beyond prod(shape)*elementSize bytes.
+inline bool
+isConsecutiveLayout(Shape<runtime_size> const & shape, Shape<runtime_size> const & byte_strides,
+                    std::uint64_t elementSize)
+{
+    std::vector<int> axes;
+    for(int k=0; k<shape.size(); ++k)
+        if(shape[k] > 1)
+            axes.push_back(k);
+    std::sort(axes.begin(), axes.end(),
+              [&byte_strides](int l, int r) { return byte_strides[l] < byte_strides[r]; });
+    std::uint64_t expected = elementSize;
+    for(int k : axes)
+    {
+        if(byte_strides[k] < 0 || (std::uint64_t)byte_strides[k] != expected ||
+           (std::uint64_t)shape[k] > std::numeric_limits<std::uint64_t>::max() / expected)
+            return false;
+        expected *= (std::uint64_t)shape[k];
+    }
+    return true;
+}
+
+inline std::size_t
+alignedOffset(std::size_t size)
+{
+    return (size + dataAlignment - 1) / dataAlignment * dataAlignment;
+}
+
+    // header layout (native byte order):
+    //     magic[8], version, byte order mark (uint32),
+    //     header size, data offset, data size (uint64),
+    //     data checksum (uint32), kind (char), padding (3 bytes),
+    //     item size, channels, ndim (uint32),
+    //     shape[ndim], byte strides[ndim] (int64), axistags[ndim] (int32),
+    //     for each axis: key, type flags (uint32), resolution (double), description
+    //     (strings are stored as uint32 length and characters),
+    //     header checksum (uint32, over all preceding bytes)
+inline std::string
+encodeHeader(ArrayFileInfo const & info)
+{
+    HeaderWriter body;
+    body.put(info.dataSize);
+    body.put(info.checksum);
+    body.put(info.kind);
+    body.put('\0');
+    body.put((std::uint16_t)0);
+    body.put((std::uint32_t)info.itemsize);
+    body.put((std::uint32_t)info.channels);
+    body.put((std::uint32_t)info.ndim());
+    for(int k=0; k<info.ndim(); ++k)
+        body.put((std::int64_t)info.shape[k]);
+    for(int k=0; k<info.ndim(); ++k)
+        body.put((std::int64_t)info.byte_strides[k]);
+    for(int k=0; k<info.ndim(); ++k)
+        body.put((std::int32_t)info.axistags[k]);
+    for(auto const & a : info.axisinfo)
+    {
+        body.putString(a.key());
+        body.put((std::uint32_t)a.typeFlags());
+        body.put(a.resolution());
+        body.putString(a.description());
+    }
+
+    std::uint64_t headerSize = headerPrefixSize + body.bytes.size() + 4;
+    HeaderWriter res;
+    res.bytes.append(magic, 8);
+    res.put(formatVersion);
+    res.put(byteOrderMark);
+    res.put(headerSize);
+    res.put((std::uint64_t)info.dataOffset);
+    res.bytes += body.bytes;
+    res.put(vigra::checksum(res.bytes.data(), res.bytes.size()));
+    return res.bytes;
+}
+
+inline ArrayFileInfo
+readHeader(File & file)
+{
+    char prefix[headerPrefixSize];
+    file.read(prefix, headerPrefixSize, 0);
+    HeaderReader p(prefix, prefix + headerPrefixSize);
+    vigra_precondition(std::memcmp(prefix, magic, 8) == 0,
+        "readArrayInfo(): not a vigra array file.");
+    p.get<std::uint64_t>(); // skip magic
+    vigra_precondition(p.get<std::uint32_t>() == formatVersion,
+        "readArrayInfo(): unsupported format version.");
+    vigra_precondition(p.get<std::uint32_t>() == byteOrderMark,
+        "readArrayInfo(): file was written with a different byte order.");
+    std::size_t headerSize = p.get<std::uint64_t>();
+    ArrayFileInfo info;
+    info.dataOffset = p.get<std::uint64_t>();
+    if(headerSize < headerPrefixSize + 4 || headerSize > info.dataOffset || headerSize > (1u << 30))
+        vigra_fail("readArrayInfo(): corrupt header.");
+
+    std::string bytes(headerSize, '\0');
+    file.read(&bytes[0], headerSize, 0);
+    std::uint32_t crc;
+    std::memcpy(&crc, bytes.data() + headerSize - 4, 4);
+    if(crc != vigra::checksum(bytes.data(), headerSize - 4))
+        vigra_fail("readArrayInfo(): corrupt header.");
+
+    HeaderReader r(bytes.data() + headerPrefixSize, bytes.data() + headerSize - 4);
+    info.dataSize = r.get<std::uint64_t>();
+    info.checksum = r.get<std::uint32_t>();
+    info.kind = r.get<char>();
+    r.get<char>();
+    r.get<std::uint16_t>();
+    info.itemsize = r.get<std::uint32_t>();
+    info.channels = r.get<std::uint32_t>();
+    std::uint32_t ndim = r.get<std::uint32_t>();
+    // each axis occupies at least 40 header bytes
+    if(ndim > r.remaining() / 40)
+        vigra_fail("readArrayInfo(): corrupt header.");
+    info.shape = Shape<runtime_size>(ndim, DontInit);
+    info.byte_strides = Shape<runtime_size>(ndim, DontInit);
+    info.axistags = AxisTags<runtime_size>(tags::size = ndim, tags::axis_unknown);
+    for(std::uint32_t k=0; k<ndim; ++k)
+        info.shape[k] = r.get<std::int64_t>();
+    for(std::uint32_t k=0; k<ndim; ++k)
+        info.byte_strides[k] = r.get<std::int64_t>();
+    for(std::uint32_t k=0; k<ndim; ++k)
+        info.axistags[k] = (AxisTag)r.get<std::int32_t>();
+    for(std::uint32_t k=0; k<ndim; ++k)
+    {
+        std::string key = r.getString();
+        AxisType flags = (AxisType)r.get<std::uint32_t>();
+        double resolution = r.get<double>();
+        info.axisinfo.push_back(AxisInfo(key, flags, resolution, r.getString()));
+    }
+    // the data size must match the shape, and the strides must not point beyond the data
+    std::uint64_t elementSize = (std::uint64_t)info.itemsize * (std::uint64_t)info.channels,
+                  size = elementSize;
+    bool valid = elementSize > 0 && allGreaterEqual(info.shape, 0) &&
+                 isConsecutiveLayout(info.shape, info.byte_strides, elementSize);
+    for(std::uint32_t k=0; valid && size > 0 && k<ndim; ++k)
+    {
+        if((std::uint64_t)info.shape[k] > std::numeric_limits<std::uint64_t>::max() / size)
+            valid = false;
+        else
+            size *= (std::uint64_t)info.shape[k];
+    }
+    if(!valid || (std::uint64_t)info.dataSize != size)
+        vigra_fail("readArrayInfo(): corrupt header.");
+    return info;
+}
+
+    // read the data block-wise into 'dest', return the checksum
+inline std::uint32_t
+readData(File & file, ArrayFileInfo const & info, char * dest)
+{
+    std::uint32_t crc = 0;
+    for(std::size_t k = 0; k < info.dataSize; k += blockSize)
+    {
+        std::size_t n = std::min(blockSize, info.dataSize - k);
+        file.read(dest + k, n, info.dataOffset + k);
+        crc = concatenateChecksum(crc, dest + k, n);
+    }
+    return crc;
+}
+
+inline void
+verifyChecksum(ArrayFileInfo const & info, char const * data, std::string const & function)
+{
+    std::uint32_t crc = 0;
+    for(std::size_t k = 0; k < info.dataSize; k += blockSize)
+        crc = concatenateChecksum(crc, data + k, std::min(blockSize, info.dataSize - k));
+    if(crc != info.checksum)
+        vigra_fail(function + ": checksum mismatch.");
+}
+
+    // Write the elements of 'a' at 'offset' and, if 'crc' is not null, update
+    // the checksum. When 'direct' is true, the array's memory is written as is
+    // (it must be consecutive), otherwise the data are copied into a C-order
+    // buffer block by block.
+template <int N, class T>
+void
+writeData(File & file, ArrayViewND<N, T> const & a, std::size_t offset, bool direct,
+          std::uint32_t * crc = 0)
+{
+    std::size_t size = a.size()*sizeof(T);
+    if(direct)
+    {
+        char const * data = (char const *)a.data();
+        for(std::size_t k = 0; k < size; k += blockSize)
+        {
+            std::size_t n = std::min(blockSize, size - k);
+            if(crc)
+                *crc = concatenateChecksum(*crc, data + k, n);
+            file.write(data + k, n, offset + k);
+        }
+    }
+    else if(a.size() > 0)
+    {
+        // copy blocks of entire hyperplanes along axis 0 into a C-order buffer
+        ArrayIndex planeSize = a.size() / a.shape(0),
+                   planes = std::max<ArrayIndex>(1, blockSize / (planeSize*sizeof(T)));
+        planes = std::min(planes, a.shape(0));
+        typename ArrayViewND<N, T>::difference_type start(tags::size = a.ndim(), 0),
+                                                    stop(a.shape());
+        stop[0] = planes;
+        ArrayND<N, T> buffer(stop);
+        for(ArrayIndex k = 0; k < a.shape(0); k += planes)
+        {
+            start[0] = k;
+            stop[0] = std::min(k + planes, a.shape(0));
+            auto src = a.subarray(start, stop);
+            stop[0] -= k;
+            start[0] = 0;
+            auto b = buffer.subarray(start, stop);
+            b = src;
+            std::size_t n = b.size()*sizeof(T);
+            if(crc)
+                *crc = concatenateChecksum(*crc, (char const *)b.data(), n);
+            file.write((char const *)b.data(), n, offset);
+            offset += n;
+        }
+    }
+}
+
+    // read-write, copy-on-write mapping of the byte range [offset, offset+size)
+    // of a file (the mapping itself starts at a page boundary)
+class FileMapping
+{
+  public:
+    FileMapping()
+    : map_(0)
+    , mapSize_(0)
+    , data_(0)
+    {}
+
+    FileMapping(File & file, std::size_t offset, std::size_t size,
+                std::string const & function)
+    : FileMapping()
+    {
+        std::size_t pageSize = (std::size_t)::sysconf(_SC_PAGESIZE),
+                    start = offset / pageSize * pageSize;
+        if(size == 0)
+            return;
+        mapSize_ = offset + size - start;
+        map_ = ::mmap(0, mapSize_, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                      file.descriptor(), (off_t)start);
+        if(map_ == MAP_FAILED)
+        {
+            map_ = 0;
+            vigra_fail(function + ": mmap() failed.");
+        }
+        data_ = (char *)map_ + (offset - start);
+    }
+
+    FileMapping(FileMapping const &) = delete;
+    FileMapping & operator=(FileMapping const &) = delete;
+
+    FileMapping(FileMapping && rhs)
+    : map_(rhs.map_)
+    , mapSize_(rhs.mapSize_)
+    , data_(rhs.data_)
+    {
+        rhs.map_ = 0;
+        rhs.data_ = 0;
+    }
+
+    FileMapping & operator=(FileMapping && rhs)
+    {
+        std::swap(map_, rhs.map_);
+        std::swap(mapSize_, rhs.mapSize_);
+        std::swap(data_, rhs.data_);
+        return *this;
+    }
+
+    ~FileMapping()
+    {
+        if(map_ != 0)
+            ::munmap(map_, mapSize_);
+    }
+
+        // null when the range is empty
+    char * data() const
+    {
+        return data_;
+    }
+
+  private:
+    void * map_;
+    std::size_t mapSize_;
+    char * data_;
+};
+
+template <int N, class T>
+void
+checkElementType(ArrayFileInfo const & info, std::string const & function)
+{
+    vigra_precondition(info.hasElementType<T>(),
+        function + ": element type mismatch.");
+    vigra_precondition(N == runtime_size || N == info.ndim(),
+        function + ": dimension mismatch.");
+}
+
+} // namespace array_file_detail
+
+/********************************************************/
+/*                                                      */
+/*                     writeArray()                     */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Write an array to a file in vigra's native binary format.
+
+        The file consists of a self-describing header (element type code
+        from <tt>ElementTypeCode</tt>, shape, byte strides, axistags, axis
+        information, and the CRC-32 <tt>checksum()</tt> of the data), followed by
+        the raw data in native byte order, starting at a multiple of the page
+        size. Use <tt>readArray()</tt> to read the file into an <tt>ArrayND</tt>,
+        or <tt>MappedArrayND</tt> to access the data without copying.
+
+        Consecutive arrays (in any axis order) are written directly from memory,
+        and their strides are kept. Other arrays are copied into a buffer in
+        C-order block by block. The data are written with <tt>pwrite()</tt> in
+        blocks of 4 MB, and the header last.
+
+        \a axisinfo optionally provides resolution and description of each axis
+        (by default, the information is derived from the array's axistags).
+        \code
+        ArrayND<3, float> volume(Shape3(100, 200, 300));
+        writeArray("volume.v2a", volume);
+
+        ArrayND<3, float> copy = readArray<3, float>("volume.v2a");
+        MappedArrayND<3, float> mapped("volume.v2a");
+        \endcode
+    */
+template <int N, class T>
+void
+writeArray(std::string const & filename, ArrayViewND<N, T> const & a,
+           std::vector<AxisInfo> const & axisinfo = std::vector<AxisInfo>())
+{
+    using namespace array_file_detail;
+    typedef ElementTypeCode<T> Code;
+
+    static_assert(Code::kind != 0,
+        "writeArray(): unsupported element type.");
+    vigra_precondition(axisinfo.size() == 0 || (int)axisinfo.size() == a.ndim(),
+        "writeArray(): axisinfo.size() doesn't match ndim().");
+
+    ArrayFileInfo info;
+    info.kind = Code::kind;
+    info.itemsize = Code::itemsize;
+    info.channels = Code::channels;
+    info.shape = a.shape();
+    info.axistags = a.axistags();
+    info.checksum = 0;
+    info.dataSize = a.size()*sizeof(T);
+    bool consecutive = a.isConsecutive();
+    info.byte_strides = consecutive
+                          ? Shape<runtime_size>(a.byte_strides())
+                          : Shape<runtime_size>(shapeToStrides(a.shape())*sizeof(T));
+    for(int k=0; k<a.ndim(); ++k)
+        info.axisinfo.push_back(axisinfo.size() > 0
+                                    ? axisinfo[k]
+                                    : AxisInfo(a.axistags()[k]));
+    info.dataOffset = alignedOffset(encodeHeader(info).size());
+
+    File file(filename, O_WRONLY | O_CREAT | O_TRUNC, "writeArray()");
+    std::uint32_t crc = 0;
+    writeData(file, a, info.dataOffset, consecutive, &crc);
+    info.checksum = crc;
+
+    std::string header = encodeHeader(info);
+    header.resize(info.dataOffset, '\0');
+    file.write(header.data(), header.size(), 0);
+}
+
+/********************************************************/
+/*                                                      */
+/*               readArrayInfo() / readArray()          */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Read the header of a native array file.
+    */
+inline ArrayFileInfo
+readArrayInfo(std::string const & filename)
+{
+    array_file_detail::File file(filename, O_RDONLY, "readArrayInfo()");
+    return array_file_detail::readHeader(file);
+}
+
+    /** \brief Read a native array file into an <tt>ArrayND</tt>.
+
+        The element type \a T and dimension \a N must match the file
+        (<tt>N = runtime_size</tt> accepts any dimension). The result has the
+        memory order of the stored data when this was C- or F-order, and
+        C-order otherwise. When \a verify is <tt>true</tt>, the data's checksum
+        is compared with the one in the header.
+    */
+template <int N, class T>
+ArrayND<N, T>
+readArray(std::string const & filename, bool verify = true)
+{
+    using namespace array_file_detail;
+
+    File file(filename, O_RDONLY, "readArray()");
+    ArrayFileInfo info = readHeader(file);
+    checkElementType<N, T>(info, "readArray()");
+
+    typedef typename ArrayND<N, T>::difference_type Shp;
+    Shp shape(info.shape.begin(), info.shape.end()),
+        strides(info.byte_strides.begin(), info.byte_strides.end());
+    typename ArrayND<N, T>::axistags_type axistags(info.axistags.begin(), info.axistags.end());
+
+    // storage order of the file
+    Shp order = detail::permutationToOrder(strides, C_ORDER),
+        identity = Shp::range(order.size());
+    bool cOrder = order == identity,
+         fOrder = order == reversed(identity);
+    ArrayND<N, T> res(shape, axistags, cOrder ? C_ORDER : F_ORDER);
+    std::uint32_t crc;
+    if(cOrder || fOrder)
+    {
+        crc = readData(file, info, (char *)res.data());
+    }
+    else
+    {
+        // read in storage order and transpose
+        ArrayND<N, T> tmp(shape.transpose(order));
+        crc = readData(file, info, (char *)tmp.data());
+        Shp inverse(order);
+        for(int k=0; k<order.size(); ++k)
+            inverse[order[k]] = k;
+        res = tmp.transpose(inverse);
+    }
+    if(verify && crc != info.checksum)
+        vigra_fail("readArray(): checksum mismatch.");
+    return res;
+}
+
+/********************************************************/
+/*                                                      */
+/*                    MappedArrayND                     */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Zero-copy access to a native array file via <tt>mmap()</tt>.
+
+        <tt>MappedArrayND</tt> is an <tt>ArrayViewND</tt> with the shape,
+        strides, and axistags stored in the file, whose data are the mapped
+        pages. The pages are read lazily by the operating system. Modifications
+        are private to the process (copy-on-write) and are not written back to
+        the file. The mapping is released in the destructor.
+
+        The checksum is only verified when \a verify is <tt>true</tt>, because
+        this requires reading the entire file.
+    */
+template <int N, class T>
+class MappedArrayND
+: public ArrayViewND<N, T>
+{
+  public:
+    typedef ArrayViewND<N, T> view_type;
+
+    explicit
+    MappedArrayND(std::string const & filename, bool verify = false)
+    {
+        using namespace array_file_detail;
+
+        File file(filename, O_RDONLY, "MappedArrayND()");
+        info_ = readHeader(file);
+        checkElementType<N, T>(info_, "MappedArrayND()");
+        vigra_precondition(file.size() >= info_.dataOffset + info_.dataSize,
+            "MappedArrayND(): file is truncated.");
+
+        mapping_ = FileMapping(file, info_.dataOffset, info_.dataSize, "MappedArrayND()");
+        if(verify)
+            verifyChecksum(info_, mapping_.data(), "MappedArrayND()");
+
+        typedef typename view_type::difference_type Shp;
+        view_type v(Shp(info_.shape.begin(), info_.shape.end()),
+                    tags::byte_strides = Shp(info_.byte_strides.begin(), info_.byte_strides.end()),
+                    typename view_type::axistags_type(info_.axistags.begin(), info_.axistags.end()),
+                    (T *)mapping_.data());
+        this->swapImpl(v);
+    }
+
+    MappedArrayND(MappedArrayND const &) = delete;
+    MappedArrayND & operator=(MappedArrayND const &) = delete;
+
+    MappedArrayND(MappedArrayND && rhs)
+    : view_type(rhs)
+    , mapping_(std::move(rhs.mapping_))
+    , info_(std::move(rhs.info_))
+    {}
+
+        /** The file's header.
+        */
+    ArrayFileInfo const & info() const
+    {
+        return info_;
+    }
+
+  private:
+    array_file_detail::FileMapping mapping_;
+    ArrayFileInfo info_;
+};
+
+} // namespace vigra
+
+#endif // VIGRA2_ARRAY_FILE_HXX
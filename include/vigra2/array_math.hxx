@@ -44,6 +44,7 @@
 #include "tinyarray.hxx"
 #include "pointer_nd.hxx"
 #include <vector>
+#include <utility>
 #include <type_traits>
 
 namespace vigra {
@@ -195,6 +196,12 @@ struct ArrayMathExpression<PointerND<0, T>>
         return vigra::array_detail::NoMemoryOverlap;
     }
 
+    template <class SHAPE>
+    constexpr bool aliasesElementwise(TinyArray<char*, 2> const &, SHAPE const &) const
+    {
+        return true;
+    }
+
     template <class SHAPE>
     void principalStrides(SHAPE const &, ArrayIndex, int) const
     {}
@@ -252,9 +259,21 @@ struct ArrayMathExpression<PointerND<N, T>>
     , shape_(shape)
     {}
 
+        // lowest address and one byte beyond the highest element (strides may be negative)
     TinyArray<char *, 2> memoryRange() const
     {
-        return { this->data_, (char*)(1 + &(*this)[shape_ - 1]) };
+        if(prod(shape_) == 0)
+            return { this->data_, this->data_ };
+        char * low = this->data_, * high = this->data_;
+        for(int k=0; k<shape_.size(); ++k)
+        {
+            ArrayIndex extent = (shape_[k] - 1) * this->strides_[k];
+            if(extent < 0)
+                low += extent;
+            else
+                high += extent;
+        }
+        return { low, high + sizeof(T) };
     }
 
     MemoryOverlap checkMemoryOverlap(TinyArray<char*, 2> const & target) const
@@ -262,6 +281,15 @@ struct ArrayMathExpression<PointerND<N, T>>
         return vigra::array_detail::checkMemoryOverlap(target, memoryRange());
     }
 
+        // check that the array either doesn't overlap the memory of a target
+        // with the given 'range' and 'strides', or refers to the same elements
+    template <class SHAPE>
+    bool aliasesElementwise(TinyArray<char*, 2> const & range, SHAPE const & strides) const
+    {
+        return vigra::array_detail::checkMemoryOverlap(range, memoryRange()) == vigra::array_detail::NoMemoryOverlap ||
+               (memoryRange() == range && this->strides_ == strides);
+    }
+
     template <class SHAPE>
     void principalStrides(SHAPE & strides, ArrayIndex & minimalStride, int & singletonCount) const
     {
@@ -322,6 +350,21 @@ struct ArrayMathTypeChooser<ArrayND<N, T, A>>
     : public ArrayMathTypeChooser<ArrayViewND<N, T>>
 {};
 
+template <int N, class T>
+struct ArrayMathTypeChooser<SharedArrayND<N, T>>
+    : public ArrayMathTypeChooser<ArrayViewND<N, T>>
+{};
+
+template <int N, class T>
+struct ArrayMathTypeChooser<MappedArrayND<N, T>>
+    : public ArrayMathTypeChooser<ArrayViewND<N, T>>
+{};
+
+template <int N, class T>
+struct ArrayMathTypeChooser<MappedNpyArrayND<N, T>>
+    : public ArrayMathTypeChooser<ArrayViewND<N, T>>
+{};
+
 template <class ARG>
 using ArrayMathArgType = typename ArrayMathTypeChooser<ARG>::type;
 
@@ -359,12 +402,24 @@ struct ArrayMathUnaryOperator
         return arg_.checkMemoryOverlap(target);
     }
 
+    template <class SHAPE>
+    bool aliasesElementwise(TinyArray<char*, 2> const & range, SHAPE const & strides) const
+    {
+        return arg_.aliasesElementwise(range, strides);
+    }
+
     template <class SHAPE>
     bool compatibleStrides(SHAPE const & target) const
     {
         return arg_.compatibleStrides(target);
     }
 
+    template <class SHAPE>
+    bool isCConsecutive(SHAPE const & shape) const
+    {
+        return arg_.isCConsecutive(shape);
+    }
+
     template <class SHAPE>
     void principalStrides(SHAPE & strides, ArrayIndex & minimalStride, int & singletonCount) const
     {
@@ -572,12 +627,24 @@ struct ArrayMathBinaryOperator
         return (MemoryOverlap)(arg1_.checkMemoryOverlap(target) | arg2_.checkMemoryOverlap(target));
     }
 
+    template <class SHAPE>
+    bool aliasesElementwise(TinyArray<char*, 2> const & range, SHAPE const & strides) const
+    {
+        return arg1_.aliasesElementwise(range, strides) && arg2_.aliasesElementwise(range, strides);
+    }
+
     template <class SHAPE>
     bool compatibleStrides(SHAPE const & target) const
     {
         return arg1_.compatibleStrides(target) && arg2_.compatibleStrides(target);
     }
 
+    template <class SHAPE>
+    bool isCConsecutive(SHAPE const & shape) const
+    {
+        return arg1_.isCConsecutive(shape) && arg2_.isCConsecutive(shape);
+    }
+
     template <class SHAPE>
     void principalStrides(SHAPE & strides, ArrayIndex & minimalStride, int & singletonCount) const
     {
@@ -828,6 +895,289 @@ VIGRA_ARRAYMATH_MINMAX_FUNCTION(Max, max)
 
 #undef VIGRA_ARRAYMATH_MINMAX_FUNCTION
 
+/********************************************************/
+/*                                                      */
+/*               ArrayMathTernaryOperator               */
+/*                                                      */
+/********************************************************/
+
+    // Base class for ternary functions in array expressions.
+    // It implements the PointerND API so that we can later call
+    // universalPointerNDFunction() to do the actual computations.
+template <class ARG1, class ARG2, class ARG3>
+struct ArrayMathTernaryOperator
+: public ArrayMathTag
+{
+    typedef ArrayMathArgType<ARG1> arg1_type;
+    typedef ArrayMathArgType<ARG2> arg2_type;
+    typedef ArrayMathArgType<ARG3> arg3_type;
+    static const int dimension = ArrayMathUnifyDimension<arg1_type,
+                                     ArrayMathBinaryOperator<ARG2, ARG3>>::value;
+    typedef Shape<dimension> difference_type;
+
+    arg1_type arg1_;
+    arg2_type arg2_;
+    arg3_type arg3_;
+
+    ArrayMathTernaryOperator(ARG1 const & a1, ARG2 const & a2, ARG3 const & a3)
+    : arg1_(a1)
+    , arg2_(a2)
+    , arg3_(a3)
+    {}
+
+    bool hasData() const
+    {
+        return arg1_.hasData() && arg2_.hasData() && arg3_.hasData();
+    }
+
+    MemoryOverlap checkMemoryOverlap(TinyArray<char*, 2> const & target) const
+    {
+        return (MemoryOverlap)(arg1_.checkMemoryOverlap(target) |
+                               arg2_.checkMemoryOverlap(target) |
+                               arg3_.checkMemoryOverlap(target));
+    }
+
+    template <class SHAPE>
+    bool aliasesElementwise(TinyArray<char*, 2> const & range, SHAPE const & strides) const
+    {
+        return arg1_.aliasesElementwise(range, strides) &&
+               arg2_.aliasesElementwise(range, strides) &&
+               arg3_.aliasesElementwise(range, strides);
+    }
+
+    template <class SHAPE>
+    bool compatibleStrides(SHAPE const & target) const
+    {
+        return arg1_.compatibleStrides(target) &&
+               arg2_.compatibleStrides(target) &&
+               arg3_.compatibleStrides(target);
+    }
+
+    template <class SHAPE>
+    bool isCConsecutive(SHAPE const & shape) const
+    {
+        return arg1_.isCConsecutive(shape) &&
+               arg2_.isCConsecutive(shape) &&
+               arg3_.isCConsecutive(shape);
+    }
+
+    template <class SHAPE>
+    void principalStrides(SHAPE & strides, ArrayIndex & minimalStride, int & singletonCount) const
+    {
+        arg1_.principalStrides(strides, minimalStride, singletonCount);
+        arg2_.principalStrides(strides, minimalStride, singletonCount);
+        arg3_.principalStrides(strides, minimalStride, singletonCount);
+    }
+
+    template <class SHAPE>
+    void principalStrides(SHAPE & strides) const
+    {
+        ArrayIndex minimalStride = NumericTraits<ArrayIndex>::max();
+        int singletonCount = ndim();
+        principalStrides(strides, minimalStride, singletonCount);
+    }
+
+    template <class SHAPE>
+    void transpose_inplace(SHAPE const & permutation)
+    {
+        arg1_.transpose_inplace(permutation);
+        arg2_.transpose_inplace(permutation);
+        arg3_.transpose_inplace(permutation);
+    }
+
+    // increment the pointer of all RHS arrays along the given 'axis'
+    void inc(int axis)
+    {
+        arg1_.inc(axis);
+        arg2_.inc(axis);
+        arg3_.inc(axis);
+    }
+
+    // decrement the pointer of all RHS arrays along the given 'axis'
+    void dec(int axis)
+    {
+        arg1_.dec(axis);
+        arg2_.dec(axis);
+        arg3_.dec(axis);
+    }
+
+    // reset the pointer of all RHS arrays along the given 'axis'
+    void move(int axis, ArrayIndex diff)
+    {
+        arg1_.move(axis, diff);
+        arg2_.move(axis, diff);
+        arg3_.move(axis, diff);
+    }
+
+    difference_type shape() const
+    {
+        Shape<dimension> res(tags::size = ndim(), 1);
+        vigra_precondition(unifyShape(res),
+            "ArrayMathTernaryOperator(): shape mismatch.");
+        return res;
+    }
+
+    template <int M = dimension>
+    int ndim(enable_if_t<M == runtime_size, bool> = true) const
+    {
+        return max(arg1_.ndim(), max(arg2_.ndim(), arg3_.ndim()));
+    }
+
+    template <int M = dimension>
+    constexpr
+    int ndim(enable_if_t<M != runtime_size, bool> = true) const
+    {
+        return dimension;
+    }
+
+    template <class SHAPE>
+    bool unifyShape(SHAPE & target) const
+    {
+        return arg1_.unifyShape(target) && arg2_.unifyShape(target) && arg3_.unifyShape(target);
+    }
+};
+
+    // Create a ternary array expression when at least one argument is an array
+    // or array expression.
+template <class ARG1, class ARG2, class ARG3>
+struct ArrayMathTernaryTraits
+{
+    static const bool value = ArrayNDConcept<ARG1>::value || ArrayMathConcept<ARG1>::value ||
+                              ArrayNDConcept<ARG2>::value || ArrayMathConcept<ARG2>::value ||
+                              ArrayNDConcept<ARG3>::value || ArrayMathConcept<ARG3>::value;
+};
+
+/********************************************************/
+/*                                                      */
+/*                 where(), clip()                      */
+/*                                                      */
+/********************************************************/
+
+    // Select elements from 'arg2' where 'arg1' is true, and from 'arg3' otherwise.
+    // Both alternatives are evaluated, so that the compiler can use blend
+    // instructions instead of branches.
+template <class ARG1, class ARG2, class ARG3>
+struct ArrayMathWhere
+: public ArrayMathTernaryOperator<ARG1, ARG2, ARG3>
+{
+    typedef ArrayMathTernaryOperator<ARG1, ARG2, ARG3> base_type;
+    typedef typename base_type::arg2_type::value_type  value2_type;
+    typedef typename base_type::arg3_type::value_type  value3_type;
+    typedef BoolPromote<typename std::common_type<value2_type, value3_type>::type> value_type;
+    typedef value_type                                 result_type;
+
+    ArrayMathWhere(ARG1 const & a1, ARG2 const & a2, ARG3 const & a3)
+    : base_type(a1, a2, a3)
+    {}
+
+    value_type const * ptr() const { return 0; }
+
+    result_type operator*() const
+    {
+        value_type t = *this->arg2_,
+                   f = *this->arg3_;
+        return *this->arg1_ ? t : f;
+    }
+
+    template <class SHAPE>
+    result_type operator[](SHAPE const & s) const
+    {
+        value_type t = this->arg2_[s],
+                   f = this->arg3_[s];
+        return this->arg1_[s] ? t : f;
+    }
+};
+
+    /** Element-wise selection <tt>cond ? a : b</tt>. Each argument may be
+        an array, an array expression, or a scalar.
+    */
+template <class ARG1, class ARG2, class ARG3>
+enable_if_t<ArrayMathTernaryTraits<ARG1, ARG2, ARG3>::value,
+            ArrayMathExpression<ArrayMathWhere<ARG1, ARG2, ARG3>>>
+where(ARG1 const & cond, ARG2 const & a, ARG3 const & b)
+{
+    return {cond, a, b};
+}
+
+    // Clamp the elements of 'arg1' to the range ['arg2', 'arg3'], which
+    // compiles to min/max instructions.
+template <class ARG1, class ARG2, class ARG3>
+struct ArrayMathClip
+: public ArrayMathTernaryOperator<ARG1, ARG2, ARG3>
+{
+    typedef ArrayMathTernaryOperator<ARG1, ARG2, ARG3> base_type;
+    typedef typename base_type::arg1_type::value_type  value1_type;
+    typedef typename base_type::arg2_type::value_type  value2_type;
+    typedef typename base_type::arg3_type::value_type  value3_type;
+    typedef BoolPromote<typename std::common_type<value1_type, value2_type, value3_type>::type> value_type;
+    typedef value_type                                 result_type;
+
+    ArrayMathClip(ARG1 const & a1, ARG2 const & a2, ARG3 const & a3)
+    : base_type(a1, a2, a3)
+    {}
+
+    value_type const * ptr() const { return 0; }
+
+    static value_type clip(value_type v, value_type lower, value_type upper)
+    {
+        v = v < lower ? lower : v;
+        return upper < v ? upper : v;
+    }
+
+    result_type operator*() const
+    {
+        return clip(*this->arg1_, *this->arg2_, *this->arg3_);
+    }
+
+    template <class SHAPE>
+    result_type operator[](SHAPE const & s) const
+    {
+        return clip(this->arg1_[s], this->arg2_[s], this->arg3_[s]);
+    }
+};
+
+using vigra::clip;
+
+    /** Clamp the elements of \a a to the range <tt>[lower, upper]</tt>.
+        The bounds may be scalars, arrays, or array expressions.
+    */
+template <class ARG1, class ARG2, class ARG3>
+enable_if_t<ArrayNDConcept<ARG1>::value || ArrayMathConcept<ARG1>::value,
+            ArrayMathExpression<ArrayMathClip<ARG1, ARG2, ARG3>>>
+clip(ARG1 const & a, ARG2 const & lower, ARG3 const & upper)
+{
+    return {a, lower, upper};
+}
+
+    // Pair of mask and value, used to implement masked assignment
+    // (see MaskedArrayViewND).
+template <class ARG1, class ARG2>
+struct ArrayMathMaskedValue
+: public ArrayMathBinaryOperator<ARG1, ARG2>
+{
+    typedef ArrayMathBinaryOperator<ARG1, ARG2>       base_type;
+    typedef typename base_type::arg2_type::value_type value2_type;
+    typedef std::pair<bool, value2_type>              value_type;
+    typedef value_type                                result_type;
+
+    ArrayMathMaskedValue(ARG1 const & a1, ARG2 const & a2)
+    : base_type(a1, a2)
+    {}
+
+    value_type const * ptr() const { return 0; }
+
+    result_type operator*() const
+    {
+        return result_type(*this->arg1_ != 0, *this->arg2_);
+    }
+
+    template <class SHAPE>
+    result_type operator[](SHAPE const & s) const
+    {
+        return result_type(this->arg1_[s] != 0, this->arg2_[s]);
+    }
+};
+
 /********************************************************/
 /*                                                      */
 /*                     ArrayMathMGrid                   */
@@ -855,6 +1205,13 @@ public:
         return true;
     }
 
+        // coordinates cannot be traversed by a flat loop
+    template <class SHAPE>
+    constexpr bool isCConsecutive(SHAPE const &) const
+    {
+        return false;
+    }
+
     inline void inc(int dim)
     {
         base_type::inc(dim);
@@ -931,102 +1288,770 @@ struct ArrayMathCustomFunctor
     }
 };
 
-} // namespace array_math
-
-using array_math::ArrayMathExpression;
-using array_math::min;
-using array_math::max;
 
 /********************************************************/
 /*                                                      */
-/*                 reducing operations                  */
+/*                   fused evaluation                   */
 /*                                                      */
 /********************************************************/
 
-    // Functions to reduce an array or array expression to a single
-    // number: all, all_finite, any, sum, prod, ==, !=
+    /** \brief Per-element temporary for <tt>fuse()</tt>.
 
-template <class ARG,
-          VIGRA_REQUIRE<ArrayMathConcept<ARG>::value> >
-inline bool
-all(ARG && a)
+        A <tt>FusedTemporary</tt> can be the target of a statement in
+        <tt>fuse()</tt> and an operand of array expressions in subsequent
+        statements. It only holds the value of the element currently being
+        processed, so intermediate results that are not needed after the
+        fused loop are never written to memory.
+    */
+template <class T>
+class FusedTemporary
+: public ArrayMathTag
 {
-    typedef typename ARG::value_type value_type;
-    bool res = true;
-    value_type zero = value_type();
-    universalArrayNDFunction(std::forward<ARG>(a),
-        [zero, &res](value_type const & v)
-        {
-            if (v == zero)
-                res = false;
-        },
-        "all(ARRAY_EXPRESSION)"
-    );
-    return res;
-}
+  public:
+    typedef T value_type;
 
-template <class ARG,
-          VIGRA_REQUIRE<ArrayMathConcept<ARG>::value> >
-inline bool
-all_finite(ARG && a)
-{
-    typedef typename ARG::value_type value_type;
-    bool res = true;
-    universalArrayNDFunction(std::forward<ARG>(a),
-        [&res](value_type const & v)
-        {
-            if (!isfinite(v))
-                res = false;
-        },
-        "all_finite(ARRAY_EXPRESSION)"
-    );
-    return res;
-}
+    FusedTemporary()
+    : value_()
+    {}
 
-template <class ARG,
-          VIGRA_REQUIRE<ArrayMathConcept<ARG>::value> >
+    FusedTemporary(FusedTemporary const &) = delete;
+    FusedTemporary & operator=(FusedTemporary const &) = delete;
+
+        /** the value of the most recently processed element
+        */
+    T const & value() const
+    {
+        return value_;
+    }
+
+    T value_;
+};
+
+    // Class to represent a FusedTemporary in array expressions and statements.
+    // It behaves like a constant, but refers to the temporary's current value.
+template <class T>
+struct ArrayMathFusedTemporaryRef
+: public ArrayMathTag
+{
+    static const int dimension = 0;
+    typedef T                                     value_type;
+    typedef T                                   & reference;
+    typedef T const                             & const_reference;
+    typedef Shape<runtime_size>                   difference_type;
+    typedef const_reference                       result_type;
+
+    T * value_;
+
+    ArrayMathFusedTemporaryRef(FusedTemporary<T> const & t)
+    : value_(const_cast<T *>(&t.value_))
+    {}
+
+    constexpr bool hasData() const
+    {
+        return true;
+    }
+
+    void inc(int) const {}
+    void dec(int) const {}
+    void move(int, ArrayIndex) const {}
+
+    reference operator*()
+    {
+        return *value_;
+    }
+
+    const_reference operator*() const
+    {
+        return *value_;
+    }
+
+    template <class SHAPE>
+    const_reference operator[](SHAPE const &) const
+    {
+        return *value_;
+    }
+
+    T const * ptr() const
+    {
+        return value_;
+    }
+
+    constexpr int ndim() const
+    {
+        return 0;
+    }
+
+    template <class SHAPE>
+    constexpr bool compatibleStrides(SHAPE const &) const
+    {
+        return true;
+    }
+
+    template <class SHAPE>
+    constexpr bool isCConsecutive(SHAPE const &) const
+    {
+        return true;
+    }
+
+    constexpr MemoryOverlap checkMemoryOverlap(TinyArray<char*, 2> const &) const
+    {
+        return vigra::array_detail::NoMemoryOverlap;
+    }
+
+    template <class SHAPE>
+    constexpr bool aliasesElementwise(TinyArray<char*, 2> const &, SHAPE const &) const
+    {
+        return true;
+    }
+
+    template <class SHAPE>
+    void principalStrides(SHAPE const &, ArrayIndex, int) const
+    {}
+
+    template <class SHAPE>
+    void transpose_inplace(SHAPE const &)
+    {}
+
+    difference_type shape() const
+    {
+        return difference_type();
+    }
+
+    template <class SHAPE>
+    bool unifyShape(SHAPE &) const
+    {
+        return true;
+    }
+};
+
+template <class T>
+struct ArrayMathTypeChooser<FusedTemporary<T>>
+{
+    typedef ArrayMathExpression<ArrayMathFusedTemporaryRef<T>> type;
+};
+
+    // The assignment operators of fused statements.
+#define VIGRA_ARRAY_MATH_FUSED_OPERATOR(NAME, OP) \
+struct ArrayMathFused##NAME \
+{ \
+    template <class V, class U> \
+    static void exec(V & v, U const & u) \
+    { \
+        v OP vigra::detail::RequiresExplicitCast<V>::cast(u); \
+    } \
+};
+
+VIGRA_ARRAY_MATH_FUSED_OPERATOR(Assign, =)
+VIGRA_ARRAY_MATH_FUSED_OPERATOR(AddAssign, +=)
+VIGRA_ARRAY_MATH_FUSED_OPERATOR(SubtractAssign, -=)
+VIGRA_ARRAY_MATH_FUSED_OPERATOR(MultiplyAssign, *=)
+VIGRA_ARRAY_MATH_FUSED_OPERATOR(DivideAssign, /=)
+
+#undef VIGRA_ARRAY_MATH_FUSED_OPERATOR
+
+    // Targets of fused statements are arrays or temporaries. Only arrays
+    // determine the shape of the loop and must be checked for aliasing.
+template <int N, class T, class SHAPE>
+inline bool
+fusedTargetShape(ArrayMathExpression<PointerND<N, T>> const & target,
+                 SHAPE & shape, bool & initialized)
+{
+    if(initialized)
+        return shape == target.shape();
+    shape = target.shape();
+    initialized = true;
+    return true;
+}
+
+template <class T, class SHAPE>
+inline bool
+fusedTargetShape(ArrayMathExpression<ArrayMathFusedTemporaryRef<T>> const &,
+                 SHAPE &, bool &)
+{
+    return true;
+}
+
+template <int N, class T, class STATEMENTS>
+inline bool
+fusedTargetAliasing(ArrayMathExpression<PointerND<N, T>> const & target,
+                    STATEMENTS const & statements)
+{
+    return statements.aliasesElementwise(target.memoryRange(), target.byte_strides());
+}
+
+template <class T, class STATEMENTS>
+inline bool
+fusedTargetAliasing(ArrayMathExpression<ArrayMathFusedTemporaryRef<T>> const &,
+                    STATEMENTS const &)
+{
+    return true;
+}
+
+    // A statement 'target OP expression' recorded for fused evaluation.
+template <class OP, class TARGET, class EXPR>
+struct ArrayMathFusedStatement
+{
+    static const int dimension = ArrayMathUnifyDimension<TARGET, EXPR>::value;
+
+    TARGET target_;
+    EXPR expr_;
+
+    ArrayMathFusedStatement(TARGET const & target, EXPR const & expr)
+    : target_(target)
+    , expr_(expr)
+    {}
+
+    void execute()
+    {
+        OP::exec(*target_, *expr_);
+    }
+
+    void inc(int axis)
+    {
+        target_.inc(axis);
+        expr_.inc(axis);
+    }
+
+    void move(int axis, ArrayIndex diff)
+    {
+        target_.move(axis, diff);
+        expr_.move(axis, diff);
+    }
+
+    int ndim() const
+    {
+        return std::max<int>(target_.ndim(), expr_.ndim());
+    }
+
+    template <class SHAPE>
+    bool unifyTargetShape(SHAPE & shape, bool & initialized) const
+    {
+        return fusedTargetShape(target_, shape, initialized);
+    }
+
+    template <class SHAPE>
+    bool unifyShape(SHAPE & shape) const
+    {
+        return expr_.unifyShape(shape);
+    }
+
+    template <class STATEMENTS>
+    bool checkAliasing(STATEMENTS const & statements) const
+    {
+        return fusedTargetAliasing(target_, statements);
+    }
+
+    template <class SHAPE>
+    bool aliasesElementwise(TinyArray<char*, 2> const & range, SHAPE const & strides) const
+    {
+        return target_.aliasesElementwise(range, strides) &&
+               expr_.aliasesElementwise(range, strides);
+    }
+
+    template <class SHAPE>
+    bool isCConsecutive(SHAPE const & shape) const
+    {
+        return target_.isCConsecutive(shape) && expr_.isCConsecutive(shape);
+    }
+
+    template <class SHAPE>
+    void principalStrides(SHAPE & strides, ArrayIndex & minimalStride, int & singletonCount) const
+    {
+        target_.principalStrides(strides, minimalStride, singletonCount);
+        expr_.principalStrides(strides, minimalStride, singletonCount);
+    }
+
+    template <class SHAPE>
+    void transpose_inplace(SHAPE const & permutation)
+    {
+        target_.transpose_inplace(permutation);
+        expr_.transpose_inplace(permutation);
+    }
+};
+
+    // List of statements to be executed in a single loop.
+template <class ... STATEMENTS>
+struct ArrayMathFusedStatements;
+
+template <>
+struct ArrayMathFusedStatements<>
+{
+    static const int dimension = 0;
+
+    void execute() {}
+    void inc(int) {}
+    void move(int, ArrayIndex) {}
+
+    int ndim() const
+    {
+        return 0;
+    }
+
+    template <class SHAPE>
+    bool unifyTargetShape(SHAPE &, bool &) const
+    {
+        return true;
+    }
+
+    template <class SHAPE>
+    bool unifyShape(SHAPE &) const
+    {
+        return true;
+    }
+
+    template <class STATEMENTS>
+    bool checkAliasing(STATEMENTS const &) const
+    {
+        return true;
+    }
+
+    template <class SHAPE>
+    bool aliasesElementwise(TinyArray<char*, 2> const &, SHAPE const &) const
+    {
+        return true;
+    }
+
+    template <class SHAPE>
+    bool isCConsecutive(SHAPE const &) const
+    {
+        return true;
+    }
+
+    template <class SHAPE>
+    void principalStrides(SHAPE &, ArrayIndex &, int &) const
+    {}
+
+    template <class SHAPE>
+    void transpose_inplace(SHAPE const &)
+    {}
+};
+
+template <class FIRST, class ... REST>
+struct ArrayMathFusedStatements<FIRST, REST...>
+{
+    typedef ArrayMathFusedStatements<REST...> rest_type;
+
+    static const int dimension = ArrayMathUnifyDimension<FIRST, rest_type>::value;
+
+    FIRST first_;
+    rest_type rest_;
+
+    ArrayMathFusedStatements(FIRST const & first, REST const & ... rest)
+    : first_(first)
+    , rest_(rest...)
+    {}
+
+        // execute the statements in order for the current element
+    void execute()
+    {
+        first_.execute();
+        rest_.execute();
+    }
+
+    void inc(int axis)
+    {
+        first_.inc(axis);
+        rest_.inc(axis);
+    }
+
+    void move(int axis, ArrayIndex diff)
+    {
+        first_.move(axis, diff);
+        rest_.move(axis, diff);
+    }
+
+    int ndim() const
+    {
+        return std::max(first_.ndim(), rest_.ndim());
+    }
+
+    template <class SHAPE>
+    bool unifyTargetShape(SHAPE & shape, bool & initialized) const
+    {
+        return first_.unifyTargetShape(shape, initialized) &&
+               rest_.unifyTargetShape(shape, initialized);
+    }
+
+    template <class SHAPE>
+    bool unifyShape(SHAPE & shape) const
+    {
+        return first_.unifyShape(shape) && rest_.unifyShape(shape);
+    }
+
+    template <class STATEMENTS>
+    bool checkAliasing(STATEMENTS const & statements) const
+    {
+        return first_.checkAliasing(statements) && rest_.checkAliasing(statements);
+    }
+
+    template <class SHAPE>
+    bool aliasesElementwise(TinyArray<char*, 2> const & range, SHAPE const & strides) const
+    {
+        return first_.aliasesElementwise(range, strides) &&
+               rest_.aliasesElementwise(range, strides);
+    }
+
+    template <class SHAPE>
+    bool isCConsecutive(SHAPE const & shape) const
+    {
+        return first_.isCConsecutive(shape) && rest_.isCConsecutive(shape);
+    }
+
+    template <class SHAPE>
+    void principalStrides(SHAPE & strides, ArrayIndex & minimalStride, int & singletonCount) const
+    {
+        first_.principalStrides(strides, minimalStride, singletonCount);
+        rest_.principalStrides(strides, minimalStride, singletonCount);
+    }
+
+    template <class SHAPE>
+    void transpose_inplace(SHAPE const & permutation)
+    {
+        first_.transpose_inplace(permutation);
+        rest_.transpose_inplace(permutation);
+    }
+};
+
+    // Left-hand side of a fused statement, see defer().
+template <class TARGET>
+struct ArrayMathDeferredTarget
+{
+    TARGET target_;
+
+    explicit ArrayMathDeferredTarget(TARGET const & target)
+    : target_(target)
+    {}
+
+#define VIGRA_ARRAY_MATH_DEFERRED_ASSIGNMENT(NAME, OP) \
+    template <class ARG> \
+    ArrayMathFusedStatement<ArrayMathFused##NAME, TARGET, ArrayMathArgType<ARG>> \
+    operator OP(ARG const & rhs) const \
+    { \
+        return ArrayMathFusedStatement<ArrayMathFused##NAME, TARGET, ArrayMathArgType<ARG>>( \
+                   target_, ArrayMathArgType<ARG>(rhs)); \
+    }
+
+    VIGRA_ARRAY_MATH_DEFERRED_ASSIGNMENT(Assign, =)
+    VIGRA_ARRAY_MATH_DEFERRED_ASSIGNMENT(AddAssign, +=)
+    VIGRA_ARRAY_MATH_DEFERRED_ASSIGNMENT(SubtractAssign, -=)
+    VIGRA_ARRAY_MATH_DEFERRED_ASSIGNMENT(MultiplyAssign, *=)
+    VIGRA_ARRAY_MATH_DEFERRED_ASSIGNMENT(DivideAssign, /=)
+
+#undef VIGRA_ARRAY_MATH_DEFERRED_ASSIGNMENT
+};
+
+    /** \brief Create the left-hand side of a statement for <tt>fuse()</tt>.
+
+        <tt>defer(a) = expression</tt> (and likewise <tt>+=, -=, *=, /=</tt>)
+        records the assignment instead of executing it.
+    */
+template <int N, class T>
+inline ArrayMathDeferredTarget<ArrayMathExpression<PointerND<N, T>>>
+defer(ArrayViewND<N, T> const & target)
+{
+    return ArrayMathDeferredTarget<ArrayMathExpression<PointerND<N, T>>>(
+               ArrayMathExpression<PointerND<N, T>>(target));
+}
+
+template <class T>
+inline ArrayMathDeferredTarget<ArrayMathExpression<ArrayMathFusedTemporaryRef<T>>>
+defer(FusedTemporary<T> & target)
+{
+    return ArrayMathDeferredTarget<ArrayMathExpression<ArrayMathFusedTemporaryRef<T>>>(
+               ArrayMathExpression<ArrayMathFusedTemporaryRef<T>>(target));
+}
+
+template <class STATEMENTS, class SHAPE>
+void
+fusedLoop(STATEMENTS & statements, SHAPE const & shape, int dim)
+{
+    auto N = shape[dim];
+    if(dim == shape.size() - 1)
+    {
+        for(ArrayIndex k=0; k<N; ++k, statements.inc(dim))
+            statements.execute();
+    }
+    else
+    {
+        for(ArrayIndex k=0; k<N; ++k, statements.inc(dim))
+            fusedLoop(statements, shape, dim+1);
+    }
+    statements.move(dim, -N);
+}
+
+    /** \brief Evaluate several array statements in a single traversal.
+
+        Each statement is created by <tt>defer()</tt>. For every element, the
+        statements are executed in the given order, so that later statements
+        see the results of earlier ones:
+        \code
+        using namespace vigra::array_math;
+        FusedTemporary<double> t;     // intermediate result, never stored in memory
+        fuse(defer(t) = b*c,
+             defer(d) = t + e,
+             defer(f) = sqrt(d));
+        \endcode
+        is equivalent to <tt>ArrayND<3, double> t = b*c; d = t + e; f = sqrt(d);</tt>,
+        but traverses memory only once, with a single loop order optimized for
+        all arrays involved. This pays off for bandwidth-bound element-wise
+        arithmetic on large arrays.
+
+        All array targets must have the same shape, and the expressions
+        must be broadcastable to it. Statements may read a target of the same
+        or another statement only at the element currently being processed
+        (e.g. <tt>a</tt>, but not <tt>a.transpose()</tt> or a shifted subarray
+        of <tt>a</tt>), because the fused loop could otherwise see partially
+        updated data. Violations raise a <tt>PreconditionViolation</tt>.
+    */
+template <class ... STATEMENTS>
+void
+fuse(STATEMENTS const & ... statements)
+{
+    typedef ArrayMathFusedStatements<STATEMENTS...> Statements;
+    static const int dimension = Statements::dimension;
+
+    Statements s(statements...);
+
+    Shape<dimension> shape(tags::size = s.ndim());
+    bool initialized = false;
+    vigra_precondition(s.unifyTargetShape(shape, initialized),
+        "fuse(): shape mismatch between targets.");
+    vigra_precondition(initialized,
+        "fuse(): at least one statement must assign to an array.");
+    Shape<dimension> common(shape);
+    vigra_precondition(s.unifyShape(common) && common == shape,
+        "fuse(): shape mismatch.");
+    if(prod(shape) == 0)
+        return;
+    vigra_precondition(s.checkAliasing(s),
+        "fuse(): statements must only access the current element of a target.");
+
+    if(shape.size() == 0)
+    {
+        s.execute();
+    }
+    else if(s.isCConsecutive(shape))
+    {
+        // fast path: all arrays cover consecutive memory in C-order
+        int dim = array_detail::innermostAxis(shape);
+        for(ArrayIndex k=0, count=prod(shape); k<count; ++k, s.inc(dim))
+            s.execute();
+    }
+    else
+    {
+        if(shape.size() > 1)
+        {
+            // optimize loop order for all arrays together
+            Shape<dimension> strides(tags::size = shape.size());
+            ArrayIndex minimalStride = NumericTraits<ArrayIndex>::max();
+            int singletonCount       = shape.size();
+            s.principalStrides(strides, minimalStride, singletonCount);
+            auto p = vigra::detail::permutationToOrder(strides, C_ORDER);
+            s.transpose_inplace(p);
+            shape = shape.transpose(p);
+        }
+        fusedLoop(s, shape, 0);
+    }
+}
+
+} // namespace array_math
+
+using array_math::ArrayMathExpression;
+using array_math::FusedTemporary;
+using array_math::defer;
+using array_math::fuse;
+using array_math::min;
+using array_math::max;
+using array_math::where;
+using array_math::clip;
+
+/********************************************************/
+/*                                                      */
+/*                 reducing operations                  */
+/*                                                      */
+/********************************************************/
+
+    // Functions to reduce an array or array expression to a single
+    // number: all, all_finite, any, sum, prod, squaredNorm, norm, ==, !=
+    //
+    // Expressions are evaluated on the fly in a single pass, i.e. 'sum(a*b)'
+    // and 'norm(a-b)' don't create temporary arrays. Lvalue expressions are
+    // copied, so that they can be reused after the reduction.
+
+namespace array_detail {
+
+template <class EXPR, class SHAPE, class FCT>
+bool
+arrayMathLinesImpl(EXPR & e, SHAPE const & shape, int dim, FCT & f)
+{
+    if(dim == shape.size() - 1)
+        return f(e, shape[dim], dim);
+    auto N = shape[dim];
+    for(ArrayIndex k=0; k<N; ++k, e.inc(dim))
+        if(!arrayMathLinesImpl(e, shape, dim+1, f))
+            return false;
+    e.move(dim, -N);
+    return true;
+}
+
+    // Call 'f(e, n, dim)' for every line of the array expression 'e' along
+    // the innermost dimension of the optimized loop order. 'e' points to the
+    // first of the 'n' elements of the line, and 'f' must call 'e.inc(dim)'
+    // to visit the others and reset 'e' afterwards. When all arrays are
+    // consecutive in memory, the entire expression is a single line.
+    // Iteration stops early when 'f' returns false.
+template <class EXPR, class FCT>
+void
+arrayMathLines(EXPR & e, FCT && f, const char * func_name)
+{
+    Shape<EXPR::dimension> shape(tags::size = e.ndim());
+    vigra_precondition(e.unifyShape(shape), std::string(func_name) + ": shape mismatch.");
+    if(shape.size() == 0 || prod(shape) == 0)
+        return;
+
+    if(e.isCConsecutive(shape))
+    {
+        f(e, prod(shape), innermostAxis(shape));
+        return;
+    }
+    if(shape.size() > 1)
+    {
+        // optimize loop order
+        Shape<EXPR::dimension> strides(tags::size = shape.size());
+        e.principalStrides(strides);
+        auto p = detail::permutationToOrder(strides, C_ORDER);
+        e.transpose_inplace(p);
+        shape = shape.transpose(p);
+    }
+    arrayMathLinesImpl(e, shape, 0, f);
+}
+
+    // Sum of 'f(v)' over all elements of an array expression. The loop uses
+    // eight independent accumulators, so that consecutive additions don't
+    // have to wait for each other and the compiler can vectorize them.
+template <class R, class EXPR, class FCT>
+R
+sumArrayMath(EXPR e, FCT f, const char * func_name)
+{
+    R sums[8] = { R(), R(), R(), R(), R(), R(), R(), R() };
+    arrayMathLines(e,
+        [&sums, &f](EXPR & e, ArrayIndex n, int dim)
+        {
+            ArrayIndex k = 0;
+            for(; k + 8 <= n; k += 8)
+                for(int l=0; l<8; ++l, e.inc(dim))
+                    sums[l] += f(*e);
+            for(; k < n; ++k, e.inc(dim))
+                sums[0] += f(*e);
+            e.move(dim, -n);
+            return true;
+        },
+        func_name);
+    return ((sums[0] + sums[1]) + (sums[2] + sums[3])) + ((sums[4] + sums[5]) + (sums[6] + sums[7]));
+}
+
+    // Check if 'f(v)' is true for all elements, stopping at the first failure.
+template <class EXPR, class FCT>
+bool
+allOfArrayMath(EXPR e, FCT f, const char * func_name)
+{
+    bool res = true;
+    arrayMathLines(e,
+        [&res, &f](EXPR & e, ArrayIndex n, int dim)
+        {
+            for(ArrayIndex k = 0; k < n; ++k, e.inc(dim))
+            {
+                if(!f(*e))
+                {
+                    res = false;
+                    return false;
+                }
+            }
+            e.move(dim, -n);
+            return true;
+        },
+        func_name);
+    return res;
+}
+
+} // namespace array_detail
+
+template <class ARG,
+          VIGRA_REQUIRE<ArrayMathConcept<ARG>::value> >
+inline bool
+all(ARG && a)
+{
+    typedef typename std::decay<ARG>::type Expr;
+    typedef typename Expr::value_type value_type;
+    value_type zero = value_type();
+    return array_detail::allOfArrayMath(Expr(std::forward<ARG>(a)),
+        [zero](value_type const & v)
+        {
+            return v != zero;
+        },
+        "all(ARRAY_EXPRESSION)"
+    );
+}
+
+template <class ARG,
+          VIGRA_REQUIRE<ArrayMathConcept<ARG>::value> >
+inline bool
+all_finite(ARG && a)
+{
+    typedef typename std::decay<ARG>::type Expr;
+    typedef typename Expr::value_type value_type;
+    return array_detail::allOfArrayMath(Expr(std::forward<ARG>(a)),
+        [](value_type const & v)
+        {
+            return isfinite(v);
+        },
+        "all_finite(ARRAY_EXPRESSION)"
+    );
+}
+
+template <class ARG,
+          VIGRA_REQUIRE<ArrayMathConcept<ARG>::value> >
 inline bool
 any(ARG && a)
 {
-    typedef typename ARG::value_type value_type;
-    bool res = false;
+    typedef typename std::decay<ARG>::type Expr;
+    typedef typename Expr::value_type value_type;
     value_type zero = value_type();
-    universalArrayNDFunction(std::forward<ARG>(a),
-        [zero, &res](value_type const & v)
+    return !array_detail::allOfArrayMath(Expr(std::forward<ARG>(a)),
+        [zero](value_type const & v)
         {
-            if (v != zero)
-                res = true;
+            return v == zero;
         },
         "any(ARRAY_EXPRESSION)"
     );
-    return res;
 }
 
 template <class ARG,
-          class U = PromoteType<typename ARG::value_type>,
+          class U = PromoteType<typename std::decay<ARG>::type::value_type>,
           VIGRA_REQUIRE<ArrayMathConcept<ARG>::value> >
 inline U
 sum(ARG && a, U res = {})
 {
-    typedef typename ARG::value_type value_type;
-    universalArrayNDFunction(std::forward<ARG>(a),
-        [&res](value_type const & v)
+    typedef typename std::decay<ARG>::type Expr;
+    typedef typename Expr::value_type value_type;
+    return res + array_detail::sumArrayMath<U>(Expr(std::forward<ARG>(a)),
+        [](value_type const & v)
         {
-            res += v;
+            return v;
         },
         "sum(ARRAY_EXPRESSION)"
     );
-    return res;
 }
 
 template <class ARG,
-          class U = PromoteType<typename ARG::value_type>,
+          class U = PromoteType<typename std::decay<ARG>::type::value_type>,
           VIGRA_REQUIRE<ArrayMathConcept<ARG>::value> >
 inline U
 prod(ARG && a, U res = U{1})
 {
-    typedef typename ARG::value_type value_type;
-    universalArrayNDFunction(std::forward<ARG>(a),
+    typedef typename std::decay<ARG>::type Expr;
+    typedef typename Expr::value_type value_type;
+    universalArrayNDFunction(Expr(std::forward<ARG>(a)),
         [&res](value_type const & v)
         {
             res *= v;
@@ -1036,6 +2061,72 @@ prod(ARG && a, U res = U{1})
     return res;
 }
 
+template <class ARG,
+          VIGRA_REQUIRE<ArrayMathConcept<ARG>::value> >
+inline SquaredNormType<typename std::decay<ARG>::type::value_type>
+squaredNorm(ARG && a)
+{
+    typedef typename std::decay<ARG>::type Expr;
+    typedef typename Expr::value_type value_type;
+    typedef SquaredNormType<value_type> R;
+    return array_detail::sumArrayMath<R>(Expr(std::forward<ARG>(a)),
+        [](value_type const & v)
+        {
+            return R(v*v);
+        },
+        "squaredNorm(ARRAY_EXPRESSION)"
+    );
+}
+
+    /** Compute the norm of an array expression without creating a temporary
+        array, e.g. the residual <tt>norm(a - b)</tt>. Parameter \a type has the
+        same meaning as in <tt>norm(ArrayViewND, type)</tt>.
+     */
+template <class ARG,
+          VIGRA_REQUIRE<ArrayMathConcept<ARG>::value> >
+inline NormType<typename std::decay<ARG>::type::value_type>
+norm(ARG && a, int type = 2)
+{
+    typedef typename std::decay<ARG>::type Expr;
+    typedef typename Expr::value_type value_type;
+    typedef NormType<value_type> R;
+    switch(type)
+    {
+      case -1:
+      {
+        R res = R();
+        universalArrayNDFunction(Expr(std::forward<ARG>(a)),
+            [&res](value_type const & v)
+            {
+                if(res < abs(v))
+                    res = abs(v);
+            }, "norm(ARRAY_EXPRESSION)");
+        return res;
+      }
+      case 0:
+      {
+        value_type zero = value_type();
+        return array_detail::sumArrayMath<R>(Expr(std::forward<ARG>(a)),
+            [zero](value_type const & v)
+            {
+                return v != zero ? R(1) : R();
+            }, "norm(ARRAY_EXPRESSION)");
+      }
+      case 1:
+        return array_detail::sumArrayMath<R>(Expr(std::forward<ARG>(a)),
+            [](value_type const & v)
+            {
+                return R(abs(v));
+            }, "norm(ARRAY_EXPRESSION)");
+      case 2:
+        return sqrt(squaredNorm(std::forward<ARG>(a)));
+      default:
+        vigra_precondition(false,
+            "norm(ARRAY_EXPRESSION, type): type must be 0, 1, or 2.");
+        return R();
+    }
+}
+
 template <class ARG1, class ARG2>
 enable_if_t<array_math::ArrayMathBinaryTraits<ARG1, ARG2>::value,
             bool>
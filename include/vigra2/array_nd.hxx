@@ -38,6 +38,7 @@
 #ifndef VIGRA2_ARRAY_ND_HXX
 #define VIGRA2_ARRAY_ND_HXX
 
+#include <functional>
 #include <vector>
 #include <utility>
 #include "config.hxx"
@@ -49,6 +50,7 @@
 #include "iterator_nd.hxx"
 #include "array_math.hxx"
 #include "axistags.hxx"
+#include "parallel.hxx"
 
 // Bounds checking Macro used if VIGRA_CHECK_BOUNDS is defined.
 #ifdef VIGRA_CHECK_BOUNDS
@@ -62,6 +64,649 @@ namespace vigra {
 
 using std::swap;
 
+template <int N, class T, class MASK>
+class MaskedArrayViewND;
+
+/********************************************************/
+/*                                                      */
+/*                   pairwise summation                 */
+/*                                                      */
+/********************************************************/
+
+namespace array_detail {
+
+    // Lines of at most this many elements are summed with eight accumulators
+    // in a single loop, longer lines are split in the middle. The split points
+    // only depend on the shape, so that the summation tree (and thus the
+    // result) is the same for any number of threads.
+static const ArrayIndex pairwiseBlockSize = 128;
+
+    // subtrees computed by a single thread have at least this many elements
+static const ArrayIndex pairwiseParallelSize = 1 << 16;
+
+    // Subtrees of the summation tree that are computed concurrently. The tree
+    // is traversed twice: the first traversal records the subtrees at the
+    // given split depth (or smaller than pairwiseParallelSize), which are then
+    // distributed over the threads by a single call to parallelForeachChunk().
+    // The second traversal adds their results in the same order as the serial
+    // summation, so that the result is bit-identical.
+template <class R>
+struct PairwiseTasks
+{
+    std::vector<std::function<R()>> subtrees;
+    std::vector<R> results;
+    std::size_t next = 0;
+    bool combining = false;
+
+    template <class FCT>
+    R subtree(FCT const & compute)
+    {
+        if(combining)
+            return results[next++];
+        subtrees.push_back(compute);
+        return R();
+    }
+};
+
+    // evaluate 'sum(tasks, depth)' with the given number of threads
+template <class R, class SUM>
+R
+pairwiseParallel(int threads, SUM const & sum)
+{
+    if(threads <= 1)
+        return sum((PairwiseTasks<R> *)0, 0);
+
+    // about four subtrees per thread for load balancing
+    int depth = 2;
+    for(int t=1; t<threads; t*=2)
+        ++depth;
+    PairwiseTasks<R> tasks;
+    sum(&tasks, depth);
+    tasks.results.resize(tasks.subtrees.size());
+    parallelForeachChunk((ArrayIndex)tasks.subtrees.size(),
+                         (int)std::min<std::size_t>(threads, tasks.subtrees.size()),
+        [&tasks](int, ArrayIndex begin, ArrayIndex end)
+        {
+            for(ArrayIndex k=begin; k<end; ++k)
+                tasks.results[k] = tasks.subtrees[k]();
+        });
+    tasks.combining = true;
+    return sum(&tasks, depth);
+}
+
+template <class R, class T, class FCT>
+R
+pairwiseSumLine(char const * p, ArrayIndex n, ArrayIndex stride, FCT const & f,
+                PairwiseTasks<R> * tasks = 0, int depth = 0)
+{
+    if(tasks != 0 && (depth == 0 || n < pairwiseParallelSize))
+        return tasks->subtree([=, &f]() { return pairwiseSumLine<R, T>(p, n, stride, f); });
+    if(n < 8)
+    {
+        R res = R();
+        for(ArrayIndex k=0; k<n; ++k, p += stride)
+            res += f(*reinterpret_cast<T const *>(p));
+        return res;
+    }
+    if(n <= pairwiseBlockSize)
+    {
+        R r[8];
+        ArrayIndex k = 8;
+        if(stride == sizeof(T))
+        {
+            T const * q = reinterpret_cast<T const *>(p);
+            for(int l=0; l<8; ++l)
+                r[l] = f(q[l]);
+            for(; k + 8 <= n; k += 8)
+                for(int l=0; l<8; ++l)
+                    r[l] += f(q[k+l]);
+        }
+        else
+        {
+            for(int l=0; l<8; ++l)
+                r[l] = f(*reinterpret_cast<T const *>(p + l*stride));
+            for(; k + 8 <= n; k += 8)
+                for(int l=0; l<8; ++l)
+                    r[l] += f(*reinterpret_cast<T const *>(p + (k+l)*stride));
+        }
+        R res = ((r[0] + r[1]) + (r[2] + r[3])) + ((r[4] + r[5]) + (r[6] + r[7]));
+        for(; k<n; ++k)
+            res += f(*reinterpret_cast<T const *>(p + k*stride));
+        return res;
+    }
+    ArrayIndex n2 = n / 2;
+    n2 -= n2 % 8;
+    R left = pairwiseSumLine<R, T>(p, n2, stride, f, tasks, depth - 1);
+    return left + pairwiseSumLine<R, T>(p + n2*stride, n - n2, stride, f, tasks, depth - 1);
+}
+
+    // pairwise sum over the index range [begin, end) of axis 'dim' (and all
+    // elements of the subsequent axes), axes must be in C-order
+template <class R, class T, class SHAPE, class FCT>
+R
+pairwiseSumND(char const * p, SHAPE const & shape, SHAPE const & strides,
+              int dim, ArrayIndex begin, ArrayIndex end, FCT const & f,
+              PairwiseTasks<R> * tasks = 0, int depth = 0)
+{
+    if(dim == shape.size() - 1)
+        return pairwiseSumLine<R, T>(p + begin*strides[dim], end - begin, strides[dim], f, tasks, depth);
+    if(end - begin == 1)
+        return pairwiseSumND<R, T>(p + begin*strides[dim], shape, strides,
+                                   dim + 1, 0, shape[dim+1], f, tasks, depth);
+    ArrayIndex mid = begin + (end - begin) / 2,
+               size = (end - begin) * (strides[dim] != 0 ? std::abs(strides[dim]) / sizeof(T) : 1);
+    if(tasks != 0 && (depth == 0 || size < pairwiseParallelSize))
+        return tasks->subtree([=, &shape, &strides, &f]()
+        {
+            return pairwiseSumND<R, T>(p, shape, strides, dim, begin, end, f);
+        });
+    R left = pairwiseSumND<R, T>(p, shape, strides, dim, begin, mid, f, tasks, depth - 1);
+    return left + pairwiseSumND<R, T>(p, shape, strides, dim, mid, end, f, tasks, depth - 1);
+}
+
+    // pairwise sum of f(v) over all elements of an array in memory order
+template <class R, class ARRAY, class FCT>
+R
+pairwiseSum(ARRAY const & a, FCT const & f, int threads)
+{
+    typedef typename ARRAY::value_type T;
+    if(a.size() == 0)
+        return R();
+    char const * p = reinterpret_cast<char const *>(a.data());
+    if(a.isConsecutive())
+        return pairwiseParallel<R>(threads,
+            [&](PairwiseTasks<R> * tasks, int depth)
+            {
+                return pairwiseSumLine<R, T>(p, a.size(), sizeof(T), f, tasks, depth);
+            });
+    auto strides = a.byte_strides();
+    for(int k=0; k<a.ndim(); ++k)
+        if(a.shape(k) == 1)
+            strides[k] = 0;
+    auto perm = detail::permutationToOrder(strides, C_ORDER);
+    auto shape = a.shape().transpose(perm);
+    strides = a.byte_strides().transpose(perm);
+    return pairwiseParallel<R>(threads,
+        [&](PairwiseTasks<R> * tasks, int depth)
+        {
+            return pairwiseSumND<R, T>(p, shape, strides, 0, 0, shape[0], f, tasks, depth);
+        });
+}
+
+    // pairwise sums along axis 'd' of 'src', 'dest' must be singleton along 'd'
+template <class ARRAY, class DEST>
+void
+pairwiseSumAxis(ARRAY const & src, DEST dest, int d)
+{
+    typedef typename ARRAY::value_type T;
+    typedef typename DEST::value_type  R;
+
+    ArrayIndex n = src.shape(d);
+    auto strides = src.byte_strides();
+    bool innermost = true;
+    for(int k=0; k<src.ndim(); ++k)
+        if(k != d && src.shape(k) > 1 && std::abs(strides[k]) < std::abs(strides[d]))
+            innermost = false;
+
+    if(innermost)
+    {
+        // each result is the pairwise sum of a (nearly) contiguous line
+        auto identity = [](T const & v) { return v; };
+        ArrayIndex stride = strides[d];
+        auto start = src.shape() * 0, stop = src.shape();
+        stop[d] = 1;
+        universalArrayNDFunction(dest, src.subarray(start, stop),
+            [n, stride, &identity](R & r, T const & v)
+            {
+                r = pairwiseSumLine<R, T>(reinterpret_cast<char const *>(&v), n, stride, identity);
+            }, "ArrayViewND::sum(axis, PairwiseSummation)");
+    }
+    else if(n <= 8)
+    {
+        // add whole slices, which is vectorized across the slice
+        auto start = src.shape() * 0, stop = src.shape();
+        stop[d] = 1;
+        dest = src.subarray(start, stop);
+        for(ArrayIndex k=1; k<n; ++k)
+        {
+            start[d] = k;
+            stop[d] = k+1;
+            dest += src.subarray(start, stop);
+        }
+    }
+    else
+    {
+        ArrayIndex n2 = n / 2;
+        auto start = src.shape() * 0, stop = src.shape();
+        stop[d] = n2;
+        pairwiseSumAxis(src.subarray(start, stop), dest, d);
+        start[d] = n2;
+        stop[d] = n;
+        ScratchScope scope;
+        ArrayND<DEST::dimension, R, ScratchAllocator<R>> tmp(dest.shape());
+        pairwiseSumAxis(src.subarray(start, stop), tmp.view(), d);
+        dest += tmp;
+    }
+}
+
+/********************************************************/
+/*                                                      */
+/*               reductions over axis sets              */
+/*                                                      */
+/********************************************************/
+
+template <class AXES>
+struct AxesCount
+{
+    static const int value = 0;
+};
+
+template <int M>
+struct AxesCount<tags::AxesSelectionProxy<M>>
+{
+    static const int value = M;
+};
+
+template <>
+struct AxesCount<tags::AxisSelectionProxy>
+{
+    static const int value = 1;
+};
+
+template <int M>
+inline Shape<M> const &
+selectedAxes(tags::AxesSelectionProxy<M> const & a)
+{
+    return a.value;
+}
+
+inline Shape<1>
+selectedAxes(tags::AxisSelectionProxy const & a)
+{
+    return Shape<1>{a.value};
+}
+
+    // check the argument types of axis-wise reductions
+template <class AXES, class KEEP>
+struct IsAxesReduction
+{
+    static const bool value = (std::is_same<AXES, tags::AxisSelectionProxy>::value ||
+                               AxesCount<AXES>::value != 0) &&
+                              (std::is_same<KEEP, tags::KeepDimsTag>::value ||
+                               std::is_same<KEEP, tags::SqueezeTag>::value);
+};
+
+    // ndim of the result when an N-dimensional array is reduced over
+    // the axes in AXES (squeezed results keep at least one axis)
+template <int N, class AXES, class KEEP>
+struct ReducedNDim
+{
+    static const int M = AxesCount<AXES>::value;
+    static const int value = std::is_same<KEEP, tags::KeepDimsTag>::value
+                                 ? N
+                                 : (N == runtime_size || M == runtime_size)
+                                       ? runtime_size
+                                       : (N - M > 0 ? N - M : 1);
+};
+
+template <class R>
+struct AxesSumOp
+{
+    typedef R state_type;
+
+    template <class T>
+    void init(R & s, T const &) const
+    {
+        s = R();
+    }
+
+    template <class T>
+    void update(R & s, T const & v, ArrayIndex) const
+    {
+        s += v;
+    }
+};
+
+template <class R>
+struct AxesVarianceState
+{
+    R shift, sum, sum2;
+};
+
+    // accumulate sums of differences to the first element of each
+    // reduced subarray, which avoids the cancellation of the naive formula
+template <class R>
+struct AxesVarianceOp
+{
+    typedef AxesVarianceState<R> state_type;
+
+    double count;
+
+    template <class T>
+    void init(state_type & s, T const & v) const
+    {
+        s.shift = R(v);
+        s.sum = R();
+        s.sum2 = R();
+    }
+
+    template <class T>
+    void update(state_type & s, T const & v, ArrayIndex) const
+    {
+        R d = R(v) - s.shift;
+        s.sum += d;
+        s.sum2 += d*d;
+    }
+
+    R result(state_type const & s) const
+    {
+        return (s.sum2 - s.sum*s.sum / count) / count;
+    }
+};
+
+template <class T>
+struct AxesMinOp
+{
+    typedef T state_type;
+
+    void init(T & s, T const & v) const
+    {
+        s = v;
+    }
+
+    void update(T & s, T const & v, ArrayIndex) const
+    {
+        if(v < s)
+            s = v;
+    }
+};
+
+template <class T>
+struct AxesMaxOp
+{
+    typedef T state_type;
+
+    void init(T & s, T const & v) const
+    {
+        s = v;
+    }
+
+    void update(T & s, T const & v, ArrayIndex) const
+    {
+        if(s < v)
+            s = v;
+    }
+};
+
+template <class T>
+struct AxesArgState
+{
+    T value;
+    ArrayIndex index;
+};
+
+    // indices refer to the flattened (C-order) subarray spanned by the
+    // reduced axes, ties are resolved in favour of the smallest index
+template <class T>
+struct AxesArgMinOp
+{
+    typedef AxesArgState<T> state_type;
+
+    void init(state_type & s, T const & v) const
+    {
+        s.value = v;
+        s.index = 0;
+    }
+
+    void update(state_type & s, T const & v, ArrayIndex i) const
+    {
+        if(v < s.value || (i < s.index && !(s.value < v)))
+        {
+            s.value = v;
+            s.index = i;
+        }
+    }
+
+    ArrayIndex result(state_type const & s) const
+    {
+        return s.index;
+    }
+};
+
+template <class T>
+struct AxesArgMaxOp
+    : public AxesArgMinOp<T>
+{
+    typedef AxesArgState<T> state_type;
+
+    void update(state_type & s, T const & v, ArrayIndex i) const
+    {
+        if(s.value < v || (i < s.index && !(v < s.value)))
+        {
+            s.value = v;
+            s.index = i;
+        }
+    }
+};
+
+template <class T, class S, class OP>
+void
+reduceAxesLoop(OP const & op, char const * src, char * dest, ArrayIndex index,
+               ArrayIndex const * shape, ArrayIndex const * src_strides,
+               ArrayIndex const * dest_strides, ArrayIndex const * index_strides,
+               int dims)
+{
+    ArrayIndex n = shape[0], ss = src_strides[0], is = index_strides[0];
+    if(dims == 1)
+    {
+        if(dest_strides[0] == 0)
+        {
+            // reduced innermost axis: keep the accumulator in a register
+            S s = *reinterpret_cast<S *>(dest);
+            for(ArrayIndex k=0; k<n; ++k, src += ss, index += is)
+                op.update(s, *reinterpret_cast<T const *>(src), index);
+            *reinterpret_cast<S *>(dest) = s;
+        }
+        else
+        {
+            ArrayIndex ds = dest_strides[0];
+            for(ArrayIndex k=0; k<n; ++k, src += ss, dest += ds, index += is)
+                op.update(*reinterpret_cast<S *>(dest), *reinterpret_cast<T const *>(src), index);
+        }
+        return;
+    }
+    for(ArrayIndex k=0; k<n; ++k, src += ss, dest += dest_strides[0], index += is)
+        reduceAxesLoop<T, S>(op, src, dest, index, shape+1, src_strides+1,
+                             dest_strides+1, index_strides+1, dims-1);
+}
+
+    // Reduce 'src' over the axes where 'reduced' is non-zero into 'dest', which
+    // has the same ndim and is singleton along the reduced axes. All results are
+    // computed in a single pass over 'src'. The reduced axes become the inner
+    // loops when they include the innermost memory axis of 'src' (each result
+    // is accumulated in a register along contiguous lines), and the outer loops
+    // otherwise (entire lines of 'dest' are updated from contiguous lines of 'src').
+template <class OP, class ARRAY, class DEST, class SHAPE>
+void
+reduceAxes(ARRAY const & src, DEST dest, SHAPE const & reduced, OP const & op)
+{
+    typedef typename ARRAY::value_type T;
+    typedef typename DEST::value_type  S;
+
+    if(src.size() == 0)
+        return;
+
+    int ndim = src.ndim();
+    auto stop = src.shape();
+    for(int k=0; k<ndim; ++k)
+        if(reduced[k])
+            stop[k] = 1;
+    universalArrayNDFunction(dest, src.subarray(src.shape()*0, stop),
+        [&op](S & s, T const & v)
+        {
+            op.init(s, v);
+        }, "ArrayViewND::reduce(axes)");
+
+    auto src_strides = src.byte_strides(),
+         dest_strides = dest.byte_strides(),
+         index_strides = src.shape()*0,
+         memory_strides = src.shape()*0;
+    ArrayIndex index_stride = 1;
+    for(int k=ndim-1; k>=0; --k)
+    {
+        if(reduced[k])
+        {
+            dest_strides[k] = 0;
+            index_strides[k] = index_stride;
+            index_stride *= src.shape(k);
+        }
+        if(src.shape(k) > 1)
+            memory_strides[k] = std::abs(src_strides[k]);
+    }
+
+    auto order = detail::permutationToOrder(memory_strides, C_ORDER);
+    bool reduced_inside = reduced[order[ndim-1]] != 0;
+    std::stable_partition(order.begin(), order.end(),
+        [&reduced, reduced_inside](ArrayIndex k)
+        {
+            return (reduced[k] != 0) != reduced_inside;
+        });
+
+    auto shape = src.shape().transpose(order);
+    src_strides = src_strides.transpose(order);
+    dest_strides = dest_strides.transpose(order);
+    index_strides = index_strides.transpose(order);
+    reduceAxesLoop<T, S>(op, reinterpret_cast<char const *>(src.data()),
+                         reinterpret_cast<char *>(dest.data()), 0,
+                         &shape[0], &src_strides[0], &dest_strides[0],
+                         &index_strides[0], ndim);
+}
+
+    // number of elements that are reduced into each result (must be non-zero)
+template <class ARRAY, int M>
+ArrayIndex
+reducedCount(ARRAY const & src, Shape<M> const & axes, std::string const & name)
+{
+    ArrayIndex res = 1;
+    for(int k=0; k<axes.size(); ++k)
+    {
+        vigra_precondition(0 <= axes[k] && axes[k] < src.ndim(),
+            name + "(axes): axis out of range.");
+        res *= src.shape(axes[k]);
+    }
+    vigra_precondition(res > 0,
+        name + "(axes): reduced axes must not be empty.");
+    return res;
+}
+
+template <class OP, class ARRAY, class DEST, class SHAPE>
+void
+reduceAxesInto(ARRAY const & src, DEST dest, SHAPE const & reduced, OP const & op,
+               std::true_type /* state is result */)
+{
+    reduceAxes(src, dest, reduced, op);
+}
+
+template <class OP, class ARRAY, class DEST, class SHAPE>
+void
+reduceAxesInto(ARRAY const & src, DEST dest, SHAPE const & reduced, OP const & op,
+               std::false_type /* state is result */)
+{
+    typedef typename OP::state_type    S;
+    typedef typename DEST::value_type  R;
+
+    ScratchScope scope;
+    ArrayND<DEST::dimension, S, ScratchAllocator<S>> state(dest.shape());
+    reduceAxes(src, state.view(), reduced, op);
+    universalArrayNDFunction(dest, state,
+        [&op](R & r, S const & s)
+        {
+            r = op.result(s);
+        }, "ArrayViewND::reduce(axes)");
+}
+
+    // allocate the result of reducing 'src' over 'axes' (dropping these axes
+    // when 'squeeze' is true) and compute it with 'op'
+template <int K, class R, class OP, class ARRAY, int M>
+ArrayND<K, R>
+reduceAxesImpl(ARRAY const & src, Shape<M> const & axes, bool squeeze,
+               OP const & op, std::string const & name)
+{
+    typedef typename ARRAY::difference_type Shape_;
+    typedef typename ARRAY::axistags_type   AxisTags_;
+
+    int ndim = src.ndim();
+    Shape_ reduced = src.shape()*0,
+           keep = src.shape();
+    for(int k=0; k<axes.size(); ++k)
+    {
+        vigra_precondition(0 <= axes[k] && axes[k] < ndim,
+            name + "(axes): axis out of range.");
+        vigra_precondition(reduced[axes[k]] == 0,
+            name + "(axes): axes must be unique.");
+        reduced[axes[k]] = 1;
+        keep[axes[k]] = 1;
+    }
+
+    std::vector<ArrayIndex> result_shape;
+    std::vector<AxisTag>    result_axistags;
+    for(int k=0; k<ndim; ++k)
+    {
+        if(squeeze && reduced[k])
+            continue;
+        result_shape.push_back(keep[k]);
+        result_axistags.push_back(src.axistags()[k]);
+    }
+    if(result_shape.size() == 0)
+    {
+        result_shape.push_back(1);
+        result_axistags.push_back(tags::axis_unknown);
+    }
+
+    ArrayND<K, R> res(Shape<K>(result_shape.data(), result_shape.data() + result_shape.size()),
+                      AxisTags<K>(result_axistags.data(), result_axistags.data() + result_axistags.size()));
+    reduceAxesInto(src, res.reshape(keep, AxisTags_(src.axistags())), reduced, op,
+                   std::is_same<typename OP::state_type, R>());
+    return res;
+}
+
+    // Allocators can take over the initialization of newly allocated arrays
+    // (e.g. to touch the memory in parallel, see FirstTouchAllocator). They
+    // declare 'typedef std::true_type initializes_array' and provide
+    // 'initialize(ArrayViewND<N, T> a, T const & init)'. ArrayND then lets the
+    // allocator construct the elements without arguments before calling 'initialize()'.
+template <class T>
+struct AlwaysVoid
+{
+    typedef void type;
+};
+
+template <class ALLOC, class = void>
+struct AllocatorInitializesArray
+: public std::false_type
+{};
+
+template <class ALLOC>
+struct AllocatorInitializesArray<ALLOC, typename AlwaysVoid<typename ALLOC::initializes_array>::type>
+: public ALLOC::initializes_array
+{};
+
+    // check if 'a' is consecutive in the given order (singleton axes
+    // may have arbitrary strides)
+template <class ARRAY>
+bool
+isOrdered(ARRAY const & a, MemoryOrder order)
+{
+    typedef typename ARRAY::value_type T;
+    auto strides = shapeToStrides(a.shape(), order)*(ArrayIndex)sizeof(T);
+    for(int k=0; k<a.ndim(); ++k)
+        if(a.shape(k) > 1 && a.byte_strides(k) != strides[k])
+            return false;
+    return true;
+}
+
+} // namespace array_detail
+
 /********************************************************/
 /*                                                      */
 /*                      ArrayViewND                     */
@@ -225,11 +870,27 @@ class ArrayViewND
                 strides_[k] = 0;
     }
 
+        // the non-singleton axes must be a permutation of consecutive
+        // C-order axes (in particular, no reversed or broadcast axes)
     unsigned isConsecutiveImpl() const
     {
-        return (size() == 0 || (char*)&operator[](shape_ - 1) == data_ + (size()-1)*sizeof(T))
-                     ? ConsecutiveMemory
-                     : 0;
+        if(size() == 0)
+            return ConsecutiveMemory;
+        difference_type strides(strides_);
+        for(int k=0; k<ndim(); ++k)
+            if(shape_[k] == 1)
+                strides[k] = 0;
+        auto p = detail::permutationToOrder(strides, F_ORDER);
+        ArrayIndex stride = sizeof(T);
+        for(int k=0; k<ndim(); ++k)
+        {
+            if(shape_[p[k]] == 1)
+                continue;
+            if(strides[p[k]] != stride)
+                return 0;
+            stride *= shape_[p[k]];
+        }
+        return ConsecutiveMemory;
     }
 
     void swapImpl(ArrayViewND & rhs)
@@ -536,6 +1197,18 @@ public:
             "ArrayViewND::operator[](int) forbidden for strided multi-dimensional arrays.");
     }
 
+        /** Select the elements where \a mask is non-zero for masked assignment,
+            e.g. <tt>view[elementwiseEqual(labels, 3)] = 0</tt>. The mask can be an array or
+            an array expression whose shape matches the view (possibly
+            via singleton axes), see <tt>MaskedArrayViewND</tt>.
+         */
+    template <class MASK,
+              VIGRA_REQUIRE<ArrayLikeConcept<MASK>::value> >
+    MaskedArrayViewND<N, T, MASK> operator[](MASK const & mask)
+    {
+        return MaskedArrayViewND<N, T, MASK>(*this, mask);
+    }
+
         /** Get element.
          */
     const_reference operator[](difference_type const & d) const
@@ -942,6 +1615,102 @@ public:
         return ArrayViewND(q - p, tags::byte_strides = strides_, axistags_, (const_pointer)(data_ + offset));
     }
 
+        /** Create a strided subarray that takes every <tt>step[k]</tt>'th
+            element along axis <tt>k</tt> of the box between \a p and \a q
+            (negative \a p and \a q are interpreted as in the two-argument
+            version). A negative step traverses the box backwards, starting at
+            <tt>q[k]-1</tt>. The view shares the data with the original array,
+            so the function takes constant time.
+
+            <b>Usage:</b>
+            \code
+            ArrayND<2, double> image(Shape<2>(300, 400));
+
+            // decimate by a factor of 2 along both axes
+            ArrayViewND<2, double> half  = image.subarray(Shape<2>(0, 0), image.shape(), Shape<2>(2, 2));
+
+            // mirror the columns (i.e. flip horizontally)
+            ArrayViewND<2, double> mirrored = image.subarray(Shape<2>(0, 0), image.shape(), Shape<2>(1, -1));
+            \endcode
+        */
+    ArrayViewND
+    subarray(difference_type p, difference_type q, difference_type const & step) const
+    {
+        vigra_precondition(step.size() == ndim(),
+            "ArrayViewND::subarray(): size mismatch.");
+        ArrayViewND res = subarray(p, q);
+        difference_type shape(res.shape_), start(tags::size = ndim(), 0);
+        for(int k=0; k<ndim(); ++k)
+        {
+            vigra_precondition(step[k] != 0,
+                "ArrayViewND::subarray(): step must be non-zero.");
+            ArrayIndex s = step[k] > 0 ? step[k] : -step[k];
+            shape[k] = (shape[k] + s - 1) / s;
+            if(step[k] < 0 && shape[k] > 0)
+                start[k] = res.shape_[k] - 1;
+        }
+        return ArrayViewND(shape, tags::byte_strides = res.strides_ * step, axistags_,
+                           (const_pointer)(res.data_ + dot(res.strides_, start)));
+    }
+
+        /** Reverse the order of the elements along the given axis
+            (a constant-time view with negative stride).
+
+            <b>Usage:</b>
+            \code
+            ArrayND<2, double> image(Shape<2>(300, 400));
+            ArrayViewND<2, double> upside_down = image.flip(0);
+            assert(&upside_down[Shape<2>(0, 0)] == &image[Shape<2>(299, 0)]);
+            \endcode
+        */
+    ArrayViewND
+    flip(int axis) const
+    {
+        vigra_precondition(0 <= axis && axis < ndim(),
+            "ArrayViewND::flip(): axis out of range.");
+        difference_type step(tags::size = ndim(), 1);
+        step[axis] = -1;
+        return subarray(difference_type(tags::size = ndim(), 0), shape_, step);
+    }
+
+        /** Create a view of the given shape where singleton axes are
+            expanded by zero strides, i.e. all elements along these axes refer
+            to the same memory. \a shape may have more dimensions than the
+            array. Then the array's axes are aligned with the last axes of
+            \a shape, and the new leading axes are broadcast as well.
+            The function takes constant time, but the result should normally
+            be used read-only: writing to it assigns the same element repeatedly.
+
+            <b>Usage:</b>
+            \code
+            ArrayND<1, float> row(Shape<1>(400));
+
+            // 300 identical rows without copying
+            ArrayViewND<2, float> rows = row.broadcastTo(Shape<2>(300, 400));
+            \endcode
+        */
+    template <int M>
+    ArrayViewND<M, T>
+    broadcastTo(Shape<M> const & shape) const
+    {
+        static_assert(M == runtime_size || N == runtime_size || M >= N,
+            "ArrayViewND::broadcastTo(): shape must not have fewer dimensions than the array.");
+        vigra_precondition(shape.size() >= ndim(),
+            "ArrayViewND::broadcastTo(): shape must not have fewer dimensions than the array.");
+        int offset = shape.size() - ndim();
+        Shape<M> strides(tags::size = shape.size(), 0);
+        AxisTags<M> axistags(tags::size = shape.size(), tags::axis_unknown);
+        for(int k=0; k<ndim(); ++k)
+        {
+            vigra_precondition(shape_[k] == shape[k+offset] || shape_[k] == 1,
+                "ArrayViewND::broadcastTo(): shape mismatch.");
+            if(shape_[k] != 1)
+                strides[k+offset] = strides_[k];
+            axistags[k+offset] = axistags_[k];
+        }
+        return ArrayViewND<M, T>(shape, tags::byte_strides = strides, axistags, data());
+    }
+
         /** Transpose an array. If N==2, this implements the usual matrix transposition.
             For N > 2, it reverses the order of the indices.
 
@@ -1108,6 +1877,30 @@ public:
         return res;
     }
 
+        /** Compute the sum of the array elements with the given summation algorithm.
+
+            With <tt>PairwiseSummation</tt>, the rounding error grows only
+            logarithmically with the number of elements, and the inner loops
+            use several independent accumulators. The summation tree only
+            depends on the array's shape and memory layout, so the result is
+            bit-identical for any number of threads in \a options.
+            <tt>NaiveSummation</tt> is equivalent to <tt>sum()</tt>.
+            \code
+            ArrayND<3, float> A(shape);
+
+            double s = A.sum<double>(PairwiseSummation, ParallelOptions(4));
+            \endcode
+         */
+    template <typename U = T>
+    PromoteType<U> sum(SummationMode mode,
+                       ParallelOptions const & options = ParallelOptions(ParallelOptions::NoThreads)) const
+    {
+        if(mode == NaiveSummation)
+            return sum<U>();
+        return array_detail::pairwiseSum<PromoteType<U>>(*this,
+                   [](value_type const & v) { return v; }, options.getActualNumThreads());
+    }
+
         /** Compute the sum of the array elements over selected axes.
 
             \arg sums must have the same shape as this array, except for the
@@ -1148,10 +1941,41 @@ public:
         );
     }
 
+        /** Compute the sum of the array elements over one or more axes.
+
+            The axes are selected by <tt>tags::axis = d</tt> or <tt>tags::axes = {d1, d2, ...}</tt>.
+            By default, the reduced axes are kept as singletons in the result. Pass
+            <tt>tags::squeeze</tt> as second argument to drop them instead. The result is
+            accumulated in a single pass over the array, with a loop order that favours
+            the array's memory layout.
+            \code
+            ArrayND<3, UInt8> A(Shape3(depth, height, width));
+
+            ArrayND<3, int> s1 = A.sum(tags::axes = {0, 2});                // shape (1, height, 1)
+            ArrayND<runtime_size, int> s2 = A.sum(tags::axes = {0, 2},
+                                                  tags::squeeze);             // shape (height)
+            ArrayND<2, int> s3 = A.sum(tags::axes(0, 2), tags::squeeze);     // shape (height)
+            \endcode
+         */
+    template <class U=T, class AXES, class KEEP=tags::KeepDimsTag,
+              VIGRA_REQUIRE<array_detail::IsAxesReduction<AXES, KEEP>::value>>
+    ArrayND<array_detail::ReducedNDim<N, AXES, KEEP>::value, PromoteType<U>>
+    sum(AXES const & axes, KEEP = KEEP()) const
+    {
+        typedef PromoteType<U> R;
+        return array_detail::reduceAxesImpl<array_detail::ReducedNDim<N, AXES, KEEP>::value, R>(
+                   *this, array_detail::selectedAxes(axes),
+                   std::is_same<KEEP, tags::SqueezeTag>::value,
+                   array_detail::AxesSumOp<R>(), "ArrayViewND::sum");
+    }
+
     template <class U=T>
     ArrayND<N, PromoteType<U>>
-    sum(tags::AxisSelectionProxy axis) const
+    sum(tags::AxisSelectionProxy axis, SummationMode mode) const
     {
+        if(mode == NaiveSummation)
+            return sum<U>(axis);
+
         int d = axis.value;
         vigra_precondition(0 <= d && d < ndim(),
             "ArrayViewND::sum(axis): axis out of range.");
@@ -1159,26 +1983,144 @@ public:
         auto s = shape();
         s[d] = 1;
         ArrayND<N, PromoteType<U>> res(s);
-        sum(res);
+        array_detail::pairwiseSumAxis(*this, res.view(), d);
         return res;
     }
 
     template <class U=T>
     ArrayND<N, RealPromoteType<U>>
-    mean(tags::AxisSelectionProxy axis) const
+    mean(tags::AxisSelectionProxy axis, SummationMode mode) const
     {
+        if(mode == NaiveSummation)
+            return mean<U>(axis);
+
         int d = axis.value;
         vigra_precondition(0 <= d && d < ndim(),
             "ArrayViewND::mean(axis): axis out of range.");
 
         auto s = shape();
         s[d] = 1;
-        ArrayND<N, PromoteType<U>> res(s);
-        sum(res);
-        res /= shape(d);
+        ArrayND<N, RealPromoteType<U>> res(s);
+        array_detail::pairwiseSumAxis(*this, res.view(), d);
+        res /= RealPromoteType<U>(shape(d));
         return res;
     }
 
+        /** Compute the mean of the array elements over one or more axes.
+
+            Axis selection and the <tt>tags::squeeze</tt> option are as in
+            <tt>sum(axes)</tt>. The sums are accumulated in a single pass over
+            the array and then divided by the number of reduced elements.
+         */
+    template <class U=T, class AXES, class KEEP=tags::KeepDimsTag,
+              VIGRA_REQUIRE<array_detail::IsAxesReduction<AXES, KEEP>::value>>
+    ArrayND<array_detail::ReducedNDim<N, AXES, KEEP>::value, RealPromoteType<U>>
+    mean(AXES const & axes, KEEP = KEEP()) const
+    {
+        typedef RealPromoteType<U> R;
+        auto a = array_detail::selectedAxes(axes);
+        ArrayIndex count = array_detail::reducedCount(*this, a, "ArrayViewND::mean");
+        auto res = array_detail::reduceAxesImpl<array_detail::ReducedNDim<N, AXES, KEEP>::value, R>(
+                       *this, a, std::is_same<KEEP, tags::SqueezeTag>::value,
+                       array_detail::AxesSumOp<R>(), "ArrayViewND::mean");
+        res /= R(count);
+        return res;
+    }
+
+        /** Compute the variance of the array elements over one or more axes.
+
+            Axis selection and the <tt>tags::squeeze</tt> option are as in
+            <tt>sum(axes)</tt>. The result is the population variance (i.e. the
+            squared deviations are divided by the number of elements).
+         */
+    template <class U=T, class AXES, class KEEP=tags::KeepDimsTag,
+              VIGRA_REQUIRE<array_detail::IsAxesReduction<AXES, KEEP>::value>>
+    ArrayND<array_detail::ReducedNDim<N, AXES, KEEP>::value, RealPromoteType<U>>
+    variance(AXES const & axes, KEEP = KEEP()) const
+    {
+        typedef RealPromoteType<U> R;
+        auto a = array_detail::selectedAxes(axes);
+        array_detail::AxesVarianceOp<R> op{(double)array_detail::reducedCount(*this, a, "ArrayViewND::variance")};
+        return array_detail::reduceAxesImpl<array_detail::ReducedNDim<N, AXES, KEEP>::value, R>(
+                   *this, a, std::is_same<KEEP, tags::SqueezeTag>::value,
+                   op, "ArrayViewND::variance");
+    }
+
+        /** Find the minimum of the array elements over one or more axes.
+
+            Axis selection and the <tt>tags::squeeze</tt> option are as in
+            <tt>sum(axes)</tt>. For example, the maximum intensity projection
+            of a volume along z is
+            \code
+            ArrayND<3, float> volume(Shape3(depth, height, width));
+
+            ArrayND<2, float> mip = volume.maximum(tags::axis = 0, tags::squeeze);
+            \endcode
+         */
+    template <class AXES, class KEEP=tags::KeepDimsTag,
+              VIGRA_REQUIRE<array_detail::IsAxesReduction<AXES, KEEP>::value>>
+    ArrayND<array_detail::ReducedNDim<N, AXES, KEEP>::value, value_type>
+    minimum(AXES const & axes, KEEP = KEEP()) const
+    {
+        auto a = array_detail::selectedAxes(axes);
+        array_detail::reducedCount(*this, a, "ArrayViewND::minimum");
+        return array_detail::reduceAxesImpl<array_detail::ReducedNDim<N, AXES, KEEP>::value, value_type>(
+                   *this, a, std::is_same<KEEP, tags::SqueezeTag>::value,
+                   array_detail::AxesMinOp<value_type>(), "ArrayViewND::minimum");
+    }
+
+        /** Find the maximum of the array elements over one or more axes.
+
+            See <tt>minimum(axes)</tt>.
+         */
+    template <class AXES, class KEEP=tags::KeepDimsTag,
+              VIGRA_REQUIRE<array_detail::IsAxesReduction<AXES, KEEP>::value>>
+    ArrayND<array_detail::ReducedNDim<N, AXES, KEEP>::value, value_type>
+    maximum(AXES const & axes, KEEP = KEEP()) const
+    {
+        auto a = array_detail::selectedAxes(axes);
+        array_detail::reducedCount(*this, a, "ArrayViewND::maximum");
+        return array_detail::reduceAxesImpl<array_detail::ReducedNDim<N, AXES, KEEP>::value, value_type>(
+                   *this, a, std::is_same<KEEP, tags::SqueezeTag>::value,
+                   array_detail::AxesMaxOp<value_type>(), "ArrayViewND::maximum");
+    }
+
+        /** Find the position of the minimum over one or more axes.
+
+            Axis selection and the <tt>tags::squeeze</tt> option are as in
+            <tt>sum(axes)</tt>. The result holds scan-order indices into the
+            subarray spanned by the reduced axes (in the order of the axes
+            in this array). When the minimum occurs several times, the
+            smallest index is returned.
+         */
+    template <class AXES, class KEEP=tags::KeepDimsTag,
+              VIGRA_REQUIRE<array_detail::IsAxesReduction<AXES, KEEP>::value>>
+    ArrayND<array_detail::ReducedNDim<N, AXES, KEEP>::value, ArrayIndex>
+    argMin(AXES const & axes, KEEP = KEEP()) const
+    {
+        auto a = array_detail::selectedAxes(axes);
+        array_detail::reducedCount(*this, a, "ArrayViewND::argMin");
+        return array_detail::reduceAxesImpl<array_detail::ReducedNDim<N, AXES, KEEP>::value, ArrayIndex>(
+                   *this, a, std::is_same<KEEP, tags::SqueezeTag>::value,
+                   array_detail::AxesArgMinOp<value_type>(), "ArrayViewND::argMin");
+    }
+
+        /** Find the position of the maximum over one or more axes.
+
+            See <tt>argMin(axes)</tt>.
+         */
+    template <class AXES, class KEEP=tags::KeepDimsTag,
+              VIGRA_REQUIRE<array_detail::IsAxesReduction<AXES, KEEP>::value>>
+    ArrayND<array_detail::ReducedNDim<N, AXES, KEEP>::value, ArrayIndex>
+    argMax(AXES const & axes, KEEP = KEEP()) const
+    {
+        auto a = array_detail::selectedAxes(axes);
+        array_detail::reducedCount(*this, a, "ArrayViewND::argMax");
+        return array_detail::reduceAxesImpl<array_detail::ReducedNDim<N, AXES, KEEP>::value, ArrayIndex>(
+                   *this, a, std::is_same<KEEP, tags::SqueezeTag>::value,
+                   array_detail::AxesArgMaxOp<value_type>(), "ArrayViewND::argMax");
+    }
+
         /** Compute the product of the array elements.
 
             You must provide the type of the result by an explicit template parameter:
@@ -1417,12 +2359,24 @@ public:
     }
 
         /**
-        * Returns the addresses of the first array element and one byte beyond the
-        * last array element.
+        * Returns the lowest address of any array element and the address one
+        * byte beyond the highest element (the first and last element, unless
+        * the array has reversed axes).
         */
     TinyArray<char *, 2> memoryRange() const
     {
-        return{ data_, (char*)(1 + &(*this)[shape() - 1]) };
+        if(size() == 0)
+            return{ data_, data_ };
+        char * low = data_, * high = data_;
+        for(int k=0; k<ndim(); ++k)
+        {
+            ArrayIndex extent = (shape_[k] - 1) * strides_[k];
+            if(extent < 0)
+                low += extent;
+            else
+                high += extent;
+        }
+        return{ low, high + sizeof(T) };
     }
 
     unsigned flags() const
@@ -1724,6 +2678,44 @@ norm(ArrayViewND<N, T> const & array, int type = 2)
     }
 }
 
+    /** Compute the L1 or L2 norm with the given summation algorithm
+        (see <tt>ArrayViewND::sum(SummationMode, ParallelOptions const &)</tt>).
+        Types -1 and 0 don't involve summation and are forwarded to
+        <tt>norm(array, type)</tt>.
+     */
+template <int N, class T>
+NormType<ArrayViewND<N, T> >
+norm(ArrayViewND<N, T> const & array, int type, SummationMode mode,
+     ParallelOptions const & options = ParallelOptions(ParallelOptions::NoThreads))
+{
+    if(mode == NaiveSummation || type == -1 || type == 0)
+        return norm(array, type);
+    switch(type)
+    {
+      case 1:
+        return array_detail::pairwiseSum<NormType<ArrayViewND<N, T> >>(array,
+                   [](T const & v) { return abs(v); }, options.getActualNumThreads());
+      case 2:
+      {
+        typedef SquaredNormType<ArrayViewND<N, T> > R;
+        return sqrt(array_detail::pairwiseSum<R>(array,
+                   [](T const & v) { return R(v*v); }, options.getActualNumThreads()));
+      }
+      default:
+        vigra_precondition(false,
+            "norm(ArrayViewND, type): type must be 0, 1, or 2.");
+        return NormType<ArrayViewND<N, T> >();
+    }
+}
+
+template <int N, class T, class U = PromoteType<T> >
+inline U
+sum(ArrayViewND<N, T> const & array, SummationMode mode,
+    ParallelOptions const & options = ParallelOptions(ParallelOptions::NoThreads))
+{
+    return array.template sum<U>(mode, options);
+}
+
 template <int N, class T, class U = PromoteType<T> >
 inline U
 sum(ArrayViewND<N, T> const & array, U init = U{})
@@ -1773,6 +2765,106 @@ swap(ArrayViewND<N,T> & array1, ArrayViewND<N,T> & array2)
     array1.swap(array2);
 }
 
+/********************************************************/
+/*                                                      */
+/*                  MaskedArrayViewND                   */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Elements of an array selected by a mask.
+
+        Created by <tt>ArrayViewND::operator[](mask)</tt> in order to
+        modify only those elements where the mask is non-zero:
+        \code
+        view[elementwiseEqual(labels, 3)] = 0;
+        view[mask] += 2.0 * other;
+        \endcode
+        The mask and right-hand side are evaluated for all elements, and the
+        results are blended with the old values, so that the loop needs no
+        branches (except for integer division, where masked-out elements
+        could cause a division by zero).
+    */
+template <int N, class T, class MASK>
+class MaskedArrayViewND
+{
+  public:
+    typedef ArrayViewND<N, T>                   view_type;
+    typedef typename view_type::value_type      value_type;
+    typedef array_math::ArrayMathArgType<MASK>  mask_type;
+
+    MaskedArrayViewND(view_type const & view, MASK const & mask)
+    : view_(view)
+    , mask_(mask)
+    {
+        auto shape = view_.shape();
+        vigra_precondition(mask_.unifyShape(shape) && shape == view_.shape(),
+            "ArrayViewND::operator[](MASK): shape mismatch.");
+    }
+
+#define VIGRA_MASKED_ARRAY_ASSIGNMENT(OP) \
+    template <class ARG, \
+              VIGRA_REQUIRE<ArrayLikeConcept<ARG>::value> > \
+    MaskedArrayViewND & operator OP(ARG const & rhs) \
+    { \
+        typedef ArrayMathExpression<array_math::ArrayMathMaskedValue<mask_type, ARG>> Expr; \
+        typedef typename Expr::value_type U; \
+        universalArrayNDFunction(view_, Expr(mask_, rhs), \
+            [](value_type & v, U const & u) \
+            { \
+                value_type w = v; \
+                w OP detail::RequiresExplicitCast<value_type>::cast(u.second); \
+                v = u.first ? w : v; \
+            }, \
+            "ArrayViewND::operator[](MASK) " #OP); \
+        return *this; \
+    } \
+    \
+    MaskedArrayViewND & operator OP(value_type const & u) \
+    { \
+        return operator OP(ArrayMathExpression<PointerND<0, value_type>>(u)); \
+    }
+
+    VIGRA_MASKED_ARRAY_ASSIGNMENT(=)
+    VIGRA_MASKED_ARRAY_ASSIGNMENT(+=)
+    VIGRA_MASKED_ARRAY_ASSIGNMENT(-=)
+    VIGRA_MASKED_ARRAY_ASSIGNMENT(*=)
+
+#undef VIGRA_MASKED_ARRAY_ASSIGNMENT
+
+    template <class ARG,
+              VIGRA_REQUIRE<ArrayLikeConcept<ARG>::value> >
+    MaskedArrayViewND & operator/=(ARG const & rhs)
+    {
+        typedef ArrayMathExpression<array_math::ArrayMathMaskedValue<mask_type, ARG>> Expr;
+        typedef typename Expr::value_type U;
+        universalArrayNDFunction(view_, Expr(mask_, rhs),
+            [](value_type & v, U const & u)
+            {
+                if(std::is_integral<value_type>::value)
+                {
+                    if(u.first)
+                        v /= detail::RequiresExplicitCast<value_type>::cast(u.second);
+                }
+                else
+                {
+                    value_type w = v / detail::RequiresExplicitCast<value_type>::cast(u.second);
+                    v = u.first ? w : v;
+                }
+            },
+            "ArrayViewND::operator[](MASK) /=");
+        return *this;
+    }
+
+    MaskedArrayViewND & operator/=(value_type const & u)
+    {
+        return operator/=(ArrayMathExpression<PointerND<0, value_type>>(u));
+    }
+
+  protected:
+    view_type view_;
+    mask_type mask_;
+};
+
 /********************************************************/
 /*                                                      */
 /*                       ArrayND                        */
@@ -1791,6 +2883,30 @@ class ArrayND
 
     DataVector allocated_data_;
 
+    typedef array_detail::AllocatorInitializesArray<Alloc> AllocatorInitializes;
+
+    static DataVector
+    makeData(ArrayIndex size, typename view_type::const_reference init,
+             Alloc const & alloc, std::false_type)
+    {
+        return DataVector(size, init, alloc);
+    }
+
+    static DataVector
+    makeData(ArrayIndex size, typename view_type::const_reference,
+             Alloc const & alloc, std::true_type)
+    {
+        return DataVector(size, alloc);
+    }
+
+    void initializeData(typename view_type::const_reference, std::false_type)
+    {}
+
+    void initializeData(typename view_type::const_reference init, std::true_type)
+    {
+        allocated_data_.get_allocator().initialize(static_cast<view_type &>(*this), init);
+    }
+
   public:
 
     using view_type::actual_dimension;
@@ -1891,12 +3007,13 @@ class ArrayND
             MemoryOrder order = C_ORDER,
             allocator_type const & alloc = allocator_type())
     : view_type(shape, 0, order)
-    , allocated_data_(this->size(), init, alloc)
+    , allocated_data_(makeData(this->size(), init, alloc, AllocatorInitializes()))
     {
         vigra_precondition(allGreaterEqual(shape, 0),
             "ArrayND(): invalid shape.");
         this->data_  = (char*)&allocated_data_[0];
         this->flags_ |= this->ConsecutiveMemory | this->OwnsMemory;
+        initializeData(init, AllocatorInitializes());
     }
 
         /** construct from shape with an initial value
@@ -1907,12 +3024,13 @@ class ArrayND
             MemoryOrder order = C_ORDER,
             allocator_type const & alloc = allocator_type())
     : view_type(shape, axistags, 0, order)
-    , allocated_data_(this->size(), init, alloc)
+    , allocated_data_(makeData(this->size(), init, alloc, AllocatorInitializes()))
     {
         vigra_precondition(allGreaterEqual(shape, 0),
             "ArrayND(): invalid shape.");
         this->data_  = (char*)&allocated_data_[0];
         this->flags_ |= this->ConsecutiveMemory | this->OwnsMemory;
+        initializeData(init, AllocatorInitializes());
     }
 
         // /** construct from shape and initialize with a linear sequence in scan order
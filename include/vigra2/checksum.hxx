@@ -0,0 +1,192 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014-2017 by Ullrich Koethe                  */
+/*                                                                      */
+/*    This file is part of the VIGRA2 computer vision library.          */
+/*    The VIGRA2 Website is                                             */
+/*        http://ukoethe.github.io/vigra2                               */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#pragma once
+
+#ifndef VIGRA2_CHECKSUM_HXX
+#define VIGRA2_CHECKSUM_HXX
+
+#include "config.hxx"
+#include "error.hxx"
+#include "algorithm.hxx"
+#include "array_nd.hxx"
+#include "parallel.hxx"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace vigra {
+
+namespace checksum_detail {
+
+    // chunks of consecutive data processed by one thread
+static const std::size_t minChunkBytes = 1 << 20;
+    // buffer for gathering non-consecutive elements
+static const std::size_t bufferBytes = 1 << 16;
+
+    // Checksum of the elements of 'a' in C-order. Each thread computes the
+    // checksum of a chunk, and the results are merged in chunk order by 'combine'
+    // (combineChecksums() or combineCrc32c(), matching POLY).
+template <uint32_t POLY, int N, class T>
+uint32_t
+arrayChecksum(ArrayViewND<N, T> const & a, ParallelOptions const & options,
+              uint32_t (*combine)(uint32_t, uint32_t, std::size_t))
+{
+    typedef detail::CrcImpl<POLY> Crc;
+
+    if(a.size() == 0)
+        return 0;
+
+    std::vector<uint32_t> crcs;
+    std::vector<std::size_t> sizes;
+    if(array_detail::isOrdered(a, C_ORDER))
+    {
+        const char * data = (const char *)a.data();
+        ArrayIndex size = a.size()*sizeof(T);
+        int chunkCount = parallelChunkCount(size, options, minChunkBytes);
+        crcs.resize(chunkCount);
+        sizes.resize(chunkCount);
+        parallelForeachChunk(size, chunkCount,
+            [&](int chunk, ArrayIndex begin, ArrayIndex end)
+            {
+                crcs[chunk]  = Crc::exec(data + begin, end - begin);
+                sizes[chunk] = end - begin;
+            });
+    }
+    else
+    {
+        // gather the rows (along the last axis) into a buffer and
+        // checksum the buffer whenever it is full
+        int last = a.ndim() - 1;
+        ArrayIndex rowLength = a.shape(last),
+                   rowStride = a.byte_strides()[last],
+                   rows      = a.size() / rowLength,
+                   rowBytes  = rowLength*sizeof(T);
+        int chunkCount = parallelChunkCount(rows, options,
+                                            std::max<ArrayIndex>(1, minChunkBytes / rowBytes));
+        crcs.resize(chunkCount);
+        sizes.resize(chunkCount);
+        parallelForeachChunk(rows, chunkCount,
+            [&](int chunk, ArrayIndex begin, ArrayIndex end)
+            {
+                std::vector<char> buffer(std::max<std::size_t>(bufferBytes, rowBytes));
+                std::size_t filled = 0;
+                uint32_t crc = 0;
+
+                // coordinates of row 'begin' (the last axis is not used)
+                Shape<N> point(tags::size = a.ndim(), 0);
+                for(ArrayIndex r = begin, k = last-1; k >= 0; --k)
+                {
+                    point[k] = r % a.shape(k);
+                    r /= a.shape(k);
+                }
+                for(ArrayIndex r = begin; r < end; ++r)
+                {
+                    if(filled + rowBytes > buffer.size())
+                    {
+                        crc = Crc::exec(buffer.data(), filled, crc);
+                        filled = 0;
+                    }
+                    const char * p = (const char *)a.data() + dot(point, a.byte_strides());
+                    for(ArrayIndex x = 0; x < rowLength; ++x, p += rowStride, filled += sizeof(T))
+                        std::memcpy(&buffer[filled], p, sizeof(T));
+                    for(int k = last-1; k >= 0 && ++point[k] == a.shape(k); --k)
+                        point[k] = 0;
+                }
+                crcs[chunk]  = Crc::exec(buffer.data(), filled, crc);
+                sizes[chunk] = (end - begin)*rowBytes;
+            });
+    }
+
+    uint32_t crc = crcs[0];
+    for(std::size_t k = 1; k < crcs.size(); ++k)
+        crc = combine(crc, crcs[k], sizes[k]);
+    return crc;
+}
+
+} // namespace checksum_detail
+
+/********************************************************/
+/*                                                      */
+/*                checksum() / crc32c()                 */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Compute the CRC-32 checksum of the elements of an array.
+
+        The elements' bytes are processed in C-order (last index fastest) regardless
+        of the array's memory layout, i.e. the result equals
+        <tt>checksum((char*)c.data(), c.size()*sizeof(T))</tt> for a consecutive
+        C-order copy <tt>c</tt> of the array. Large arrays are split into chunks
+        whose checksums are computed in parallel and then combined by
+        <tt>combineChecksums()</tt>. Non-consecutive arrays are gathered row by row
+        into a small buffer.
+
+        <b>\#include</b> \<vigra2/checksum.hxx\><br>
+        Namespace: vigra
+    */
+template <int N, class T>
+uint32_t
+checksum(ArrayViewND<N, T> const & a, ParallelOptions const & options = ParallelOptions())
+{
+    return checksum_detail::arrayChecksum<detail::crc32Polynomial>(a, options, &combineChecksums);
+}
+
+    /** \brief Compute the CRC-32C checksum of the elements of an array.
+
+        Like <tt>checksum(ArrayViewND)</tt>, but computes the CRC-32C checksum
+        (see <tt>crc32c()</tt>), which is much faster on CPUs with hardware support.
+        \code
+        ArrayND<3, float> volume(...);
+        uint32_t crc = crc32c(volume);
+        // the same value for a non-consecutive view of the same data
+        ArrayND<3, float> fortran(volume.shape(), F_ORDER);
+        fortran = volume;
+        assert(crc == crc32c(fortran));
+        \endcode
+
+        <b>\#include</b> \<vigra2/checksum.hxx\><br>
+        Namespace: vigra
+    */
+template <int N, class T>
+uint32_t
+crc32c(ArrayViewND<N, T> const & a, ParallelOptions const & options = ParallelOptions())
+{
+    return checksum_detail::arrayChecksum<detail::crc32cPolynomial>(a, options, &combineCrc32c);
+}
+
+} // namespace vigra
+
+#endif // VIGRA2_CHECKSUM_HXX
@@ -0,0 +1,721 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014-2017 by Ullrich Koethe                  */
+/*                                                                      */
+/*    This file is part of the VIGRA2 computer vision library.          */
+/*    The VIGRA2 Website is                                             */
+/*        http://ukoethe.github.io/vigra2                               */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#pragma once
+
+#ifndef VIGRA2_CHUNK_STORE_HXX
+#define VIGRA2_CHUNK_STORE_HXX
+
+#include "config.hxx"
+#include "error.hxx"
+#include "numeric_traits.hxx"
+#include "axistags.hxx"
+#include "box.hxx"
+#include "array_nd.hxx"
+#include "parallel.hxx"
+#include "array_file.hxx"
+#include "codecs.hxx"
+#include <cctype>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+namespace vigra {
+
+namespace chunk_store_detail {
+
+using array_file_detail::File;
+
+static const char * metadataName = "store.json";
+static const char * formatName = "vigra2-chunk-store";
+static const int formatVersion = 1;
+
+    // a JSON object whose values are strings, numbers, or flat arrays
+    // of these (sufficient for the metadata file)
+class Metadata
+{
+  public:
+    void set(std::string const & key, std::string const & value, bool quoted = true)
+    {
+        entries_[key] = std::vector<std::string>(1, value);
+        quoted_[key] = quoted;
+        arrays_[key] = false;
+    }
+
+    void set(std::string const & key, std::vector<std::string> const & values, bool quoted = true)
+    {
+        entries_[key] = values;
+        quoted_[key] = quoted;
+        arrays_[key] = true;
+    }
+
+    bool has(std::string const & key) const
+    {
+        return entries_.find(key) != entries_.end();
+    }
+
+    std::vector<std::string> const & get(std::string const & key) const
+    {
+        auto i = entries_.find(key);
+        vigra_precondition(i != entries_.end(),
+            "ChunkStore(): metadata entry '" + key + "' is missing.");
+        return i->second;
+    }
+
+    std::string const & getScalar(std::string const & key) const
+    {
+        auto const & v = get(key);
+        vigra_precondition(v.size() == 1 && !arrays_.find(key)->second,
+            "ChunkStore(): metadata entry '" + key + "' must be a scalar.");
+        return v[0];
+    }
+
+    std::string encode(std::vector<std::string> const & order) const
+    {
+        std::string res("{\n");
+        for(std::size_t k = 0; k < order.size(); ++k)
+        {
+            std::string const & key = order[k];
+            auto const & values = entries_.find(key)->second;
+            bool quoted = quoted_.find(key)->second;
+            res += "    \"" + key + "\": ";
+            if(arrays_.find(key)->second)
+                res += "[";
+            for(std::size_t i = 0; i < values.size(); ++i)
+                res += (i > 0 ? ", " : "") + (quoted ? "\"" + values[i] + "\"" : values[i]);
+            if(arrays_.find(key)->second)
+                res += "]";
+            res += k + 1 < order.size() ? ",\n" : "\n";
+        }
+        return res + "}\n";
+    }
+
+    void decode(std::string const & s)
+    {
+        std::size_t p = 0;
+        expect(s, p, '{');
+        if(accept(s, p, '}'))
+            return;
+        do
+        {
+            std::string key = parseString(s, p);
+            expect(s, p, ':');
+            bool isArray = accept(s, p, '[');
+            std::vector<std::string> values;
+            if(!isArray || !accept(s, p, ']'))
+            {
+                do
+                    values.push_back(parseValue(s, p));
+                while(isArray && accept(s, p, ','));
+                if(isArray)
+                    expect(s, p, ']');
+            }
+            entries_[key] = values;
+            arrays_[key] = isArray;
+            quoted_[key] = false;
+        }
+        while(accept(s, p, ','));
+        expect(s, p, '}');
+    }
+
+  private:
+    static void fail()
+    {
+        vigra_fail("ChunkStore(): corrupt metadata file.");
+    }
+
+    static void skipSpace(std::string const & s, std::size_t & p)
+    {
+        while(p < s.size() && std::isspace((unsigned char)s[p]))
+            ++p;
+    }
+
+    static bool accept(std::string const & s, std::size_t & p, char c)
+    {
+        skipSpace(s, p);
+        if(p < s.size() && s[p] == c)
+        {
+            ++p;
+            return true;
+        }
+        return false;
+    }
+
+    static void expect(std::string const & s, std::size_t & p, char c)
+    {
+        if(!accept(s, p, c))
+            fail();
+    }
+
+    static std::string parseString(std::string const & s, std::size_t & p)
+    {
+        expect(s, p, '"');
+        std::size_t end = s.find('"', p);
+        if(end == std::string::npos)
+            fail();
+        std::string res = s.substr(p, end - p);
+        p = end + 1;
+        return res;
+    }
+
+    static std::string parseValue(std::string const & s, std::size_t & p)
+    {
+        skipSpace(s, p);
+        if(p < s.size() && s[p] == '"')
+            return parseString(s, p);
+        std::size_t start = p;
+        while(p < s.size() && (std::isalnum((unsigned char)s[p]) || s[p] == '-' || s[p] == '+' || s[p] == '.'))
+            ++p;
+        if(p == start)
+            fail();
+        return s.substr(start, p - start);
+    }
+
+    std::map<std::string, std::vector<std::string>> entries_;
+    std::map<std::string, bool> quoted_, arrays_;
+};
+
+    // strict conversion of a metadata value (the whole string must be an
+    // integer in the range [minimum, maximum])
+inline long long
+parseInteger(std::string const & s,
+             long long minimum = LLONG_MIN, long long maximum = LLONG_MAX)
+{
+    errno = 0;
+    char * end = 0;
+    long long res = std::strtoll(s.c_str(), &end, 10);
+    vigra_precondition(s.size() > 0 && end == s.c_str() + s.size() && errno == 0 &&
+                       minimum <= res && res <= maximum,
+        "ChunkStore(): corrupt metadata file (invalid integer '" + s + "').");
+    return res;
+}
+
+template <int N>
+Shape<N>
+unravelIndex(ArrayIndex k, Shape<N> const & shape)
+{
+    Shape<N> res(shape.size(), DontInit);
+    for(int d = shape.size()-1; d >= 0; --d)
+    {
+        res[d] = k % shape[d];
+        k /= shape[d];
+    }
+    return res;
+}
+
+inline bool
+fileExists(std::string const & name)
+{
+    struct stat s;
+    return ::stat(name.c_str(), &s) == 0;
+}
+
+    // chunk files are named by their grid coordinates, e.g. "0.3.1"
+    // (possibly with suffix ".tmp" while being written)
+inline bool
+isChunkFileName(std::string name)
+{
+    static const std::string suffix(".tmp");
+    if(name.size() > suffix.size() &&
+       name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0)
+        name.resize(name.size() - suffix.size());
+    return name.size() > 0 && std::isdigit((unsigned char)name[0]) &&
+           name.find_first_not_of("0123456789.") == std::string::npos;
+}
+
+    // true if directory 'path' contains the metadata file of a chunk store
+inline bool
+containsChunkStore(std::string const & path)
+{
+    std::string json;
+    try
+    {
+        File file(path + "/" + metadataName, O_RDONLY, "ChunkStore()");
+        json.resize(file.size());
+        file.read(&json[0], json.size(), 0);
+        Metadata m;
+        m.decode(json);
+        return m.has("format") && m.get("format").size() == 1 &&
+               m.get("format")[0] == formatName;
+    }
+    catch(std::exception &)
+    {
+        return false;
+    }
+}
+
+    // per-thread work buffers
+template <int N, class T>
+struct ChunkBuffers
+{
+    std::string encoded, decoded;
+    ArrayND<N, T> chunk;
+};
+
+} // namespace chunk_store_detail
+
+/********************************************************/
+/*                                                      */
+/*                      ChunkStore                      */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Chunked, compressed array storage in a directory of the local file system.
+
+        The array is split into a regular grid of chunks, and each chunk is stored
+        in a file of its own, named by its grid coordinates (e.g. <tt>"0.3.1"</tt>,
+        as in Zarr). A chunk file contains the chunk's elements in C-order (border
+        chunks are clipped to the array shape), transformed by the store's
+        codec pipeline (see <tt>ChunkCodec</tt>; by default, byte shuffle followed
+        by LZ compression). The shape, chunk shape, element type, axistags, and codec
+        names are kept in the JSON file <tt>store.json</tt>. Chunks that have never
+        been written read as <tt>T()</tt>.
+
+        <tt>write()</tt> and <tt>read()</tt> transfer arbitrary rectangular regions
+        (given as <tt>Box</tt> or offset). They process the chunks intersecting the
+        region in parallel (each chunk by a single thread), so that encoding and
+        decoding scale with the number of threads. Chunks only partially covered by
+        a write are read, updated, and re-encoded. Chunk files are replaced
+        atomically (written to a temporary file and renamed). Concurrent writes to
+        the same chunk from different <tt>ChunkStore</tt> objects are not supported.
+        \code
+        // create a store for a 3D volume in 64^3 chunks, with delta coding
+        ChunkStore<3, std::uint16_t> store("volume.chunks", Shape3(2000, 4000, 4000), Shape3(64, 64, 64),
+                                           makeChunkCodecs({"delta", "shuffle", "lz"}));
+        for(int z = 0; z < 2000; z += 100)
+            store.write(acquireSlab(z, 100), Shape3(z, 0, 0));
+
+        // later: open it and read a region
+        ChunkStore<3, std::uint16_t> in("volume.chunks");
+        ArrayND<3, std::uint16_t> roi = in.read(Box<3>(Shape3(500, 1000, 1000), Shape3(600, 1200, 1200)));
+        \endcode
+
+        <b>\#include</b> \<vigra2/chunk_store.hxx\><br/>
+        Namespace: vigra
+    */
+template <int N, class T>
+class ChunkStore
+{
+  public:
+    typedef Shape<N>                       shape_type;
+    typedef AxisTags<N>                    axistags_type;
+    typedef Box<N>                         box_type;
+    typedef ArrayViewND<N, T>              view_type;
+    typedef ElementTypeCode<T>             type_code;
+
+    static_assert(type_code::kind != 0,
+        "ChunkStore: unsupported element type.");
+
+        /** The default codec pipeline: byte shuffle and LZ compression.
+        */
+    static ChunkCodecPipeline defaultCodecs()
+    {
+        return makeChunkCodecs({ "shuffle", "lz" });
+    }
+
+        /** Create a new, empty store in directory \a path (which is created
+            if necessary). Chunk files of an existing store in this directory
+            are removed. Any other existing directory must be empty.
+        */
+    ChunkStore(std::string const & path,
+               shape_type const & shape, shape_type const & chunkShape,
+               ChunkCodecPipeline const & codecs = defaultCodecs(),
+               axistags_type const & axistags = axistags_type())
+    : path_(path)
+    , shape_(shape)
+    , chunkShape_(chunkShape)
+    , axistags_(axistags)
+    , codecs_(codecs)
+    {
+        using namespace chunk_store_detail;
+
+        vigra_precondition(shape.size() == chunkShape.size() && shape.size() > 0 &&
+                           allGreaterEqual(shape, 0) && allGreater(chunkShape, 0),
+            "ChunkStore(): invalid shape or chunk shape.");
+        if(axistags_.size() == 0)
+            axistags_ = axistags_type(tags::size = shape.size(), tags::axis_unknown);
+        vigra_precondition(axistags_.size() == shape.size(),
+            "ChunkStore(): axistags.size() doesn't match ndim().");
+
+        if(::mkdir(path.c_str(), 0755) != 0)
+        {
+            if(errno != EEXIST)
+                vigra_fail("ChunkStore(): unable to create directory '" + path + "'.");
+            // only clean up after a previous store, never delete foreign files
+            bool isStore = containsChunkStore(path);
+            DIR * dir = ::opendir(path.c_str());
+            if(dir == 0)
+                vigra_fail("ChunkStore(): unable to open directory '" + path + "'.");
+            std::vector<std::string> names;
+            while(dirent * entry = ::readdir(dir))
+            {
+                std::string name(entry->d_name);
+                if(name != "." && name != "..")
+                    names.push_back(name);
+            }
+            ::closedir(dir);
+            vigra_precondition(isStore || names.size() == 0,
+                "ChunkStore(): directory '" + path + "' is neither empty nor a chunk store.");
+            for(auto const & name : names)
+                if(isChunkFileName(name))
+                    ::unlink((path + "/" + name).c_str());
+        }
+        writeMetadata();
+    }
+
+        /** Open an existing store. The element type \a T and the dimension
+            must match the store (<tt>N = runtime_size</tt> accepts any dimension).
+        */
+    explicit
+    ChunkStore(std::string const & path)
+    : path_(path)
+    {
+        readMetadata();
+    }
+
+    std::string const & path() const
+    {
+        return path_;
+    }
+
+    int ndim() const
+    {
+        return shape_.size();
+    }
+
+    shape_type const & shape() const
+    {
+        return shape_;
+    }
+
+    shape_type const & chunkShape() const
+    {
+        return chunkShape_;
+    }
+
+        /** Number of chunks along each axis.
+        */
+    shape_type chunkGridShape() const
+    {
+        return (shape_ + chunkShape_ - 1) / chunkShape_;
+    }
+
+    axistags_type const & axistags() const
+    {
+        return axistags_;
+    }
+
+    ChunkCodecPipeline const & codecs() const
+    {
+        return codecs_;
+    }
+
+        /** The region of the array covered by the chunk at grid coordinate \a chunk.
+        */
+    box_type chunkBox(shape_type const & chunk) const
+    {
+        shape_type lower = chunk*chunkShape_;
+        return box_type(lower, min(lower + chunkShape_, shape_));
+    }
+
+        /** Check if the chunk at grid coordinate \a chunk has been written.
+        */
+    bool hasChunk(shape_type const & chunk) const
+    {
+        return chunk_store_detail::fileExists(chunkFileName(chunk));
+    }
+
+        /** Write \a src into the region starting at \a offset.
+        */
+    void write(view_type const & src, shape_type const & offset,
+               ParallelOptions const & options = ParallelOptions())
+    {
+        typedef chunk_store_detail::ChunkBuffers<N, T> Buffers;
+
+        box_type region(offset, offset + src.shape());
+        vigra_precondition(src.ndim() == ndim() && box_type(shape_).contains(region),
+            "ChunkStore::write(): region outside of the array.");
+
+        foreachChunk(region, options,
+            [&](shape_type const & chunk, Buffers & buffers)
+            {
+                box_type cbox = chunkBox(chunk),
+                         common = cbox & region;
+                if(common != cbox)
+                    loadChunk(chunk, buffers, "ChunkStore::write()");
+                else if(buffers.chunk.shape() != cbox.shape())
+                    buffers.chunk = ArrayND<N, T>(cbox.shape());
+                auto target = buffers.chunk.subarray(common.lower() - cbox.lower(),
+                                                     common.upper() - cbox.lower());
+                target = src.subarray(common.lower() - offset, common.upper() - offset);
+                storeChunk(chunk, buffers);
+            });
+    }
+
+        /** Write \a src into the region starting at the origin.
+        */
+    void write(view_type const & src, ParallelOptions const & options = ParallelOptions())
+    {
+        write(src, shape_type(tags::size = ndim(), 0), options);
+    }
+
+        /** Read the region \a box into \a dest (whose shape must equal the box's shape).
+        */
+    void read(box_type const & box, view_type dest,
+              ParallelOptions const & options = ParallelOptions()) const
+    {
+        typedef chunk_store_detail::ChunkBuffers<N, T> Buffers;
+
+        vigra_precondition(box.ndim() == ndim() && box_type(shape_).contains(box),
+            "ChunkStore::read(): region outside of the array.");
+        vigra_precondition(dest.shape() == box.shape(),
+            "ChunkStore::read(): shape mismatch between region and destination.");
+
+        foreachChunk(box, options,
+            [&](shape_type const & chunk, Buffers & buffers)
+            {
+                box_type cbox = chunkBox(chunk),
+                         common = cbox & box;
+                auto target = dest.subarray(common.lower() - box.lower(),
+                                            common.upper() - box.lower());
+                if(!loadChunk(chunk, buffers, "ChunkStore::read()"))
+                    target.init(T());
+                else
+                    target = buffers.chunk.subarray(common.lower() - cbox.lower(),
+                                                    common.upper() - cbox.lower());
+            });
+    }
+
+        /** Read the region \a box into a new array.
+        */
+    ArrayND<N, T> read(box_type const & box,
+                       ParallelOptions const & options = ParallelOptions()) const
+    {
+        ArrayND<N, T> res(box.shape(), axistags_);
+        read(box, res, options);
+        return res;
+    }
+
+        /** Read the entire array.
+        */
+    ArrayND<N, T> read(ParallelOptions const & options = ParallelOptions()) const
+    {
+        return read(box_type(shape_), options);
+    }
+
+  private:
+    std::string chunkFileName(shape_type const & chunk) const
+    {
+        std::string res = path_ + "/";
+        for(int k=0; k<chunk.size(); ++k)
+            res += (k > 0 ? "." : "") + std::to_string(chunk[k]);
+        return res;
+    }
+
+        // call f(chunk, buffers) for all chunks intersecting 'box' in parallel
+    template <class FCT>
+    void foreachChunk(box_type const & box, ParallelOptions const & options, FCT f) const
+    {
+        typedef chunk_store_detail::ChunkBuffers<N, T> Buffers;
+
+        if(box.empty())
+            return;
+        shape_type first = box.lower() / chunkShape_,
+                   grid  = (box.upper() - 1) / chunkShape_ + 1 - first;
+        parallelForeachChunk(prod(grid), options,
+            [&](int, ArrayIndex begin, ArrayIndex end)
+            {
+                Buffers buffers;
+                for(ArrayIndex k = begin; k < end; ++k)
+                    f(first + chunk_store_detail::unravelIndex(k, grid), buffers);
+            });
+    }
+
+        // decode a chunk into buffers.chunk (or fill it with T() if it doesn't exist)
+    bool loadChunk(shape_type const & chunk, chunk_store_detail::ChunkBuffers<N, T> & buffers,
+                   std::string const & function) const
+    {
+        using namespace chunk_store_detail;
+
+        shape_type cshape = chunkBox(chunk).shape();
+        if(buffers.chunk.shape() != cshape)
+            buffers.chunk = ArrayND<N, T>(cshape);
+        std::string name = chunkFileName(chunk);
+        if(!fileExists(name))
+        {
+            buffers.chunk.init(T());
+            return false;
+        }
+
+        File file(name, O_RDONLY, function);
+        buffers.encoded.resize(file.size());
+        file.read(&buffers.encoded[0], buffers.encoded.size(), 0);
+        std::size_t size = buffers.chunk.size()*sizeof(T);
+        try
+        {
+            decodeChunk(codecs_, buffers.encoded.data(), buffers.encoded.size(), buffers.decoded,
+                        type_code::itemsize, type_code::channels);
+        }
+        catch(std::exception &)
+        {
+            buffers.decoded.clear();
+        }
+        if(buffers.decoded.size() != size)
+            vigra_fail(function + ": corrupt chunk '" + name + "'.");
+        std::memcpy(buffers.chunk.data(), buffers.decoded.data(), size);
+        return true;
+    }
+
+    void storeChunk(shape_type const & chunk, chunk_store_detail::ChunkBuffers<N, T> & buffers) const
+    {
+        using namespace chunk_store_detail;
+
+        encodeChunk(codecs_, (char const *)buffers.chunk.data(), buffers.chunk.size()*sizeof(T),
+                    buffers.encoded, type_code::itemsize, type_code::channels);
+        std::string name = chunkFileName(chunk), tmp = name + ".tmp";
+        {
+            File file(tmp, O_WRONLY | O_CREAT | O_TRUNC, "ChunkStore::write()");
+            file.write(buffers.encoded.data(), buffers.encoded.size(), 0);
+        }
+        if(::rename(tmp.c_str(), name.c_str()) != 0)
+            vigra_fail("ChunkStore::write(): unable to write '" + name + "'.");
+    }
+
+    static std::string dtype()
+    {
+        std::string res(1, type_code::itemsize == 1
+                              ? '|'
+                              : detail::isLittleEndian() ? '<' : '>');
+        return res + type_code::kind + std::to_string(type_code::itemsize);
+    }
+
+    void writeMetadata() const
+    {
+        using namespace chunk_store_detail;
+
+        std::vector<std::string> shape, chunks, axistags, codecs;
+        for(int k=0; k<ndim(); ++k)
+        {
+            shape.push_back(std::to_string(shape_[k]));
+            chunks.push_back(std::to_string(chunkShape_[k]));
+            axistags.push_back(std::to_string((int)axistags_[k]));
+        }
+        for(auto const & c : codecs_)
+            codecs.push_back(c->name());
+
+        Metadata m;
+        m.set("format", formatName);
+        m.set("version", std::to_string(formatVersion), false);
+        m.set("dtype", dtype());
+        m.set("channels", std::to_string(type_code::channels), false);
+        m.set("shape", shape, false);
+        m.set("chunks", chunks, false);
+        m.set("axistags", axistags, false);
+        m.set("codecs", codecs);
+        std::string json = m.encode({ "format", "version", "dtype", "channels",
+                                      "shape", "chunks", "axistags", "codecs" });
+
+        std::string name = path_ + "/" + metadataName, tmp = name + ".tmp";
+        {
+            File file(tmp, O_WRONLY | O_CREAT | O_TRUNC, "ChunkStore()");
+            file.write(json.data(), json.size(), 0);
+        }
+        if(::rename(tmp.c_str(), name.c_str()) != 0)
+            vigra_fail("ChunkStore(): unable to write '" + name + "'.");
+    }
+
+    void readMetadata()
+    {
+        using namespace chunk_store_detail;
+
+        std::string json;
+        {
+            File file(path_ + "/" + metadataName, O_RDONLY, "ChunkStore()");
+            json.resize(file.size());
+            file.read(&json[0], json.size(), 0);
+        }
+        Metadata m;
+        m.decode(json);
+        vigra_precondition(m.getScalar("format") == formatName,
+            "ChunkStore(): '" + path_ + "' is not a chunk store.");
+        vigra_precondition(parseInteger(m.getScalar("version")) == formatVersion,
+            "ChunkStore(): unsupported format version.");
+
+        std::string storedType = m.getScalar("dtype");
+        vigra_precondition(storedType.size() < 2 || storedType.substr(1) != dtype().substr(1) ||
+                           storedType[0] == dtype()[0],
+            "ChunkStore(): store was written with a different byte order.");
+        vigra_precondition(storedType == dtype() &&
+                           parseInteger(m.getScalar("channels")) == type_code::channels,
+            "ChunkStore(): element type mismatch.");
+
+        auto const & shape = m.get("shape"),
+                   & chunks = m.get("chunks"),
+                   & axistags = m.get("axistags");
+        int n = (int)shape.size();
+        vigra_precondition(N == runtime_size || N == n,
+            "ChunkStore(): dimension mismatch.");
+        if(n == 0 || (int)chunks.size() != n || (int)axistags.size() != n)
+            vigra_fail("ChunkStore(): corrupt metadata file.");
+        shape_ = shape_type(tags::size = n, 0);
+        chunkShape_ = shape_type(tags::size = n, 0);
+        axistags_ = axistags_type(tags::size = n, tags::axis_unknown);
+        for(int k=0; k<n; ++k)
+        {
+            shape_[k] = (ArrayIndex)parseInteger(shape[k]);
+            chunkShape_[k] = (ArrayIndex)parseInteger(chunks[k]);
+            axistags_[k] = (AxisTag)parseInteger(axistags[k], INT_MIN, INT_MAX);
+        }
+        if(!allGreaterEqual(shape_, 0) || !allGreater(chunkShape_, 0))
+            vigra_fail("ChunkStore(): corrupt metadata file.");
+        codecs_ = makeChunkCodecs(m.get("codecs"));
+    }
+
+    std::string path_;
+    shape_type shape_, chunkShape_;
+    axistags_type axistags_;
+    ChunkCodecPipeline codecs_;
+};
+
+} // namespace vigra
+
+#endif // VIGRA2_CHUNK_STORE_HXX
@@ -0,0 +1,563 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014-2017 by Ullrich Koethe                  */
+/*                                                                      */
+/*    This file is part of the VIGRA2 computer vision library.          */
+/*    The VIGRA2 Website is                                             */
+/*        http://ukoethe.github.io/vigra2                               */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#pragma once
+
+#ifndef VIGRA2_CODECS_HXX
+#define VIGRA2_CODECS_HXX
+
+#include "config.hxx"
+#include "error.hxx"
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace vigra {
+
+/********************************************************/
+/*                                                      */
+/*                      ChunkCodec                      */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Abstract base class of lossless codecs for chunks of array data.
+
+        A codec transforms a byte buffer into another byte buffer. Codecs are
+        applied as a pipeline: <tt>encode()</tt> runs the codecs in order,
+        <tt>decode()</tt> in reverse order. \a itemsize is the size of a scalar
+        in bytes and \a channels the number of scalars per array element, so
+        that codecs can exploit the structure of the data.
+
+        Codecs are identified by <tt>name()</tt>, which is stored with encoded
+        data and mapped back to a codec object by <tt>makeChunkCodec()</tt>. To
+        add a codec, derive from <tt>ChunkCodec</tt> and register a factory
+        with <tt>registerChunkCodec()</tt>. Implementations must be thread-safe
+        (i.e. <tt>encode()</tt> and <tt>decode()</tt> must not modify the codec).
+
+        <b>\#include</b> \<vigra2/codecs.hxx\><br/>
+        Namespace: vigra
+    */
+class ChunkCodec
+{
+  public:
+    virtual ~ChunkCodec() {}
+
+    virtual std::string name() const = 0;
+
+    virtual void encode(char const * data, std::size_t size, std::string & result,
+                        int itemsize, int channels) const = 0;
+
+        /** Decoders must throw an exception when \a data is corrupt.
+        */
+    virtual void decode(char const * data, std::size_t size, std::string & result,
+                        int itemsize, int channels) const = 0;
+};
+
+typedef std::vector<std::shared_ptr<ChunkCodec>> ChunkCodecPipeline;
+
+/********************************************************/
+/*                                                      */
+/*                     ShuffleCodec                     */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Byte shuffle: store the k-th byte of all scalars consecutively.
+
+        The high bytes of integers and the sign and exponent bytes of floating
+        point numbers often vary slowly. After shuffling, they form long runs
+        that <tt>LZCodec</tt> compresses well. The size of the data is unchanged.
+    */
+class ShuffleCodec
+: public ChunkCodec
+{
+  public:
+    std::string name() const
+    {
+        return "shuffle";
+    }
+
+    void encode(char const * data, std::size_t size, std::string & result,
+                int itemsize, int) const
+    {
+        result.resize(size);
+        std::size_t count = size / itemsize;
+        char * out = &result[0];
+        for(int b = 0; b < itemsize; ++b, out += count)
+            for(std::size_t k = 0; k < count; ++k)
+                out[k] = data[k*itemsize + b];
+        std::memcpy(out, data + count*itemsize, size - count*itemsize);
+    }
+
+    void decode(char const * data, std::size_t size, std::string & result,
+                int itemsize, int) const
+    {
+        result.resize(size);
+        std::size_t count = size / itemsize;
+        char * out = &result[0];
+        for(int b = 0; b < itemsize; ++b, data += count)
+            for(std::size_t k = 0; k < count; ++k)
+                out[k*itemsize + b] = data[k];
+        std::memcpy(out + count*itemsize, data, size - count*itemsize);
+    }
+};
+
+/********************************************************/
+/*                                                      */
+/*                      DeltaCodec                      */
+/*                                                      */
+/********************************************************/
+
+namespace codecs_detail {
+
+template <class U>
+void
+deltaEncode(char const * data, std::size_t count, char * out, int channels)
+{
+    U previous = 0;
+    for(std::size_t k = 0; k < count; ++k)
+    {
+        U v, p;
+        std::memcpy(&v, data + k*sizeof(U), sizeof(U));
+        if(k >= (std::size_t)channels)
+            std::memcpy(&previous, data + (k - channels)*sizeof(U), sizeof(U));
+        p = U(v - previous);
+        std::memcpy(out + k*sizeof(U), &p, sizeof(U));
+    }
+}
+
+template <class U>
+void
+deltaDecode(char const * data, std::size_t count, char * out, int channels)
+{
+    U previous = 0;
+    for(std::size_t k = 0; k < count; ++k)
+    {
+        U d, v;
+        std::memcpy(&d, data + k*sizeof(U), sizeof(U));
+        if(k >= (std::size_t)channels)
+            std::memcpy(&previous, out + (k - channels)*sizeof(U), sizeof(U));
+        v = U(d + previous);
+        std::memcpy(out + k*sizeof(U), &v, sizeof(U));
+    }
+}
+
+} // namespace codecs_detail
+
+    /** \brief Delta coding: replace each scalar by its difference to the
+        corresponding scalar of the previous element.
+
+        Differences are computed modulo 2<sup>8*itemsize</sup> on the bit
+        patterns, so that the transformation is lossless for all types. It turns
+        smooth integer data into small numbers, which compress well after
+        <tt>ShuffleCodec</tt>. For floating point data, it is usually not helpful.
+        The size of the data is unchanged.
+    */
+class DeltaCodec
+: public ChunkCodec
+{
+  public:
+    std::string name() const
+    {
+        return "delta";
+    }
+
+    void encode(char const * data, std::size_t size, std::string & result,
+                int itemsize, int channels) const
+    {
+        apply(data, size, result, itemsize, channels, true);
+    }
+
+    void decode(char const * data, std::size_t size, std::string & result,
+                int itemsize, int channels) const
+    {
+        apply(data, size, result, itemsize, channels, false);
+    }
+
+  private:
+    static void apply(char const * data, std::size_t size, std::string & result,
+                      int itemsize, int channels, bool encode)
+    {
+        using namespace codecs_detail;
+
+        result.resize(size);
+        char * out = &result[0];
+        std::size_t count = size / itemsize;
+        switch(itemsize)
+        {
+          case 1:
+            encode ? deltaEncode<std::uint8_t>(data, count, out, channels)
+                   : deltaDecode<std::uint8_t>(data, count, out, channels);
+            break;
+          case 2:
+            encode ? deltaEncode<std::uint16_t>(data, count, out, channels)
+                   : deltaDecode<std::uint16_t>(data, count, out, channels);
+            break;
+          case 4:
+            encode ? deltaEncode<std::uint32_t>(data, count, out, channels)
+                   : deltaDecode<std::uint32_t>(data, count, out, channels);
+            break;
+          case 8:
+            encode ? deltaEncode<std::uint64_t>(data, count, out, channels)
+                   : deltaDecode<std::uint64_t>(data, count, out, channels);
+            break;
+          default:
+            count = 0;
+        }
+        std::memcpy(out + count*itemsize, data + count*itemsize, size - count*itemsize);
+    }
+};
+
+/********************************************************/
+/*                                                      */
+/*                        LZCodec                       */
+/*                                                      */
+/********************************************************/
+
+namespace codecs_detail {
+
+static const int lzMinMatch = 4;
+static const int lzHashBits = 16;
+static const std::size_t lzMaxOffset = 0xFFFF;
+
+inline std::uint32_t
+load32(unsigned char const * p)
+{
+    std::uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+
+inline std::uint32_t
+lzHash(std::uint32_t v)
+{
+    return (v * 2654435761u) >> (32 - lzHashBits);
+}
+
+inline void
+lzPutLength(unsigned char * & out, std::size_t length)
+{
+    for(; length >= 255; length -= 255)
+        *out++ = 255;
+    *out++ = (unsigned char)length;
+}
+
+inline void
+lzPutSequence(unsigned char * & out, unsigned char const * literals, std::size_t literalCount,
+              std::size_t offset, std::size_t matchLength)
+{
+    unsigned char * token = out++;
+    *token = (unsigned char)(std::min<std::size_t>(literalCount, 15) << 4);
+    if(literalCount >= 15)
+        lzPutLength(out, literalCount - 15);
+    std::memcpy(out, literals, literalCount);
+    out += literalCount;
+    if(matchLength == 0)
+        return;
+    *out++ = (unsigned char)(offset & 0xFF);
+    *out++ = (unsigned char)(offset >> 8);
+    matchLength -= lzMinMatch;
+    *token |= (unsigned char)std::min<std::size_t>(matchLength, 15);
+    if(matchLength >= 15)
+        lzPutLength(out, matchLength - 15);
+}
+
+inline bool
+lzGetLength(unsigned char const * & in, unsigned char const * end, std::size_t & length)
+{
+    unsigned char b;
+    do
+    {
+        if(in == end)
+            return false;
+        b = *in++;
+        length += b;
+    }
+    while(b == 255);
+    return true;
+}
+
+} // namespace codecs_detail
+
+    /** \brief Self-contained LZ77 compressor in the style of LZ4.
+
+        The data are encoded as a sequence of literal runs and back-references
+        (16-bit offsets, minimum match length 4) found by a single-probe hash
+        table, which gives fast compression and very fast decompression. The
+        result starts with a flag byte and the uncompressed size (64-bit,
+        little-endian). Incompressible data are stored verbatim.
+    */
+class LZCodec
+: public ChunkCodec
+{
+  public:
+    std::string name() const
+    {
+        return "lz";
+    }
+
+    void encode(char const * data, std::size_t size, std::string & result,
+                int, int) const
+    {
+        using namespace codecs_detail;
+
+        result.resize(9 + size + size / 255 + 64);
+        unsigned char * out = (unsigned char *)&result[0],
+                      * start = out;
+        unsigned char const * src = (unsigned char const *)data;
+        out[0] = 1;
+        for(int k=0; k<8; ++k)
+            out[k+1] = (unsigned char)((std::uint64_t)size >> (8*k));
+        out += 9;
+
+        std::vector<std::uint32_t> table(std::size_t(1) << lzHashBits, 0);
+        std::size_t ip = 0, anchor = 0;
+        while(ip + lzMinMatch <= size)
+        {
+            std::uint32_t sequence = load32(src + ip);
+            std::uint32_t & entry = table[lzHash(sequence)];
+            std::size_t candidate = entry;
+            entry = (std::uint32_t)ip;
+            if(candidate < ip && ip - candidate <= lzMaxOffset && load32(src + candidate) == sequence)
+            {
+                std::size_t length = lzMinMatch;
+                while(ip + length < size && src[candidate + length] == src[ip + length])
+                    ++length;
+                lzPutSequence(out, src + anchor, ip - anchor, ip - candidate, length);
+                ip += length;
+                anchor = ip;
+            }
+            else
+            {
+                // skip faster through incompressible data
+                ip += 1 + ((ip - anchor) >> 6);
+            }
+        }
+        lzPutSequence(out, src + anchor, size - anchor, 0, 0);
+
+        std::size_t compressed = out - start;
+        if(compressed >= size + 9)
+        {
+            start[0] = 0;
+            std::memcpy(start + 9, data, size);
+            compressed = size + 9;
+        }
+        result.resize(compressed);
+    }
+
+    void decode(char const * data, std::size_t size, std::string & result,
+                int, int) const
+    {
+        using namespace codecs_detail;
+
+        unsigned char const * in = (unsigned char const *)data,
+                            * end = in + size;
+        if(size < 9 || in[0] > 1)
+            vigra_fail("LZCodec::decode(): corrupt data.");
+        std::uint64_t resultSize = 0;
+        for(int k=0; k<8; ++k)
+            resultSize |= (std::uint64_t)in[k+1] << (8*k);
+        in += 9;
+        if(resultSize > ((std::size_t)(end - in) + 1) * 255 * 16 + 4096)
+            vigra_fail("LZCodec::decode(): corrupt data.");
+        result.resize(resultSize);
+        if(data[0] == 0)
+        {
+            if((std::size_t)(end - in) != resultSize)
+                vigra_fail("LZCodec::decode(): corrupt data.");
+            std::memcpy(&result[0], in, resultSize);
+            return;
+        }
+
+        unsigned char * out = (unsigned char *)&result[0];
+        std::size_t op = 0;
+        while(in < end)
+        {
+            unsigned char token = *in++;
+            std::size_t literalCount = token >> 4;
+            if(literalCount == 15 && !lzGetLength(in, end, literalCount))
+                break;
+            if(literalCount > (std::size_t)(end - in) || literalCount > resultSize - op)
+                break;
+            std::memcpy(out + op, in, literalCount);
+            in += literalCount;
+            op += literalCount;
+            if(in == end)
+            {
+                if(op == resultSize)
+                    return;
+                break;
+            }
+
+            if(end - in < 2)
+                break;
+            std::size_t offset = in[0] | (in[1] << 8);
+            in += 2;
+            std::size_t matchLength = token & 15;
+            if(matchLength == 15 && !lzGetLength(in, end, matchLength))
+                break;
+            matchLength += lzMinMatch;
+            if(offset == 0 || offset > op || matchLength > resultSize - op)
+                break;
+            unsigned char const * match = out + op - offset;
+            if(offset >= matchLength)
+                std::memcpy(out + op, match, matchLength);
+            else
+                for(std::size_t k = 0; k < matchLength; ++k)
+                    out[op + k] = match[k];
+            op += matchLength;
+        }
+        vigra_fail("LZCodec::decode(): corrupt data.");
+    }
+};
+
+/********************************************************/
+/*                                                      */
+/*                    codec registry                    */
+/*                                                      */
+/********************************************************/
+
+typedef std::function<std::shared_ptr<ChunkCodec>()> ChunkCodecFactory;
+
+namespace codecs_detail {
+
+struct CodecRegistry
+{
+    std::mutex lock;
+    std::map<std::string, ChunkCodecFactory> factories;
+
+    CodecRegistry()
+    {
+        factories["shuffle"] = []() { return std::make_shared<ShuffleCodec>(); };
+        factories["delta"]   = []() { return std::make_shared<DeltaCodec>(); };
+        factories["lz"]      = []() { return std::make_shared<LZCodec>(); };
+    }
+
+    static CodecRegistry & get()
+    {
+        static CodecRegistry registry;
+        return registry;
+    }
+};
+
+} // namespace codecs_detail
+
+    /** \brief Register a codec factory under \a name (replacing an existing one).
+
+        The built-in codecs are registered as <tt>"shuffle"</tt>,
+        <tt>"delta"</tt>, and <tt>"lz"</tt>.
+    */
+inline void
+registerChunkCodec(std::string const & name, ChunkCodecFactory factory)
+{
+    auto & registry = codecs_detail::CodecRegistry::get();
+    std::lock_guard<std::mutex> guard(registry.lock);
+    registry.factories[name] = factory;
+}
+
+    /** \brief Create the codec registered under \a name.
+    */
+inline std::shared_ptr<ChunkCodec>
+makeChunkCodec(std::string const & name)
+{
+    auto & registry = codecs_detail::CodecRegistry::get();
+    std::lock_guard<std::mutex> guard(registry.lock);
+    auto f = registry.factories.find(name);
+    vigra_precondition(f != registry.factories.end(),
+        "makeChunkCodec(): unknown codec '" + name + "'.");
+    return f->second();
+}
+
+    /** \brief Create a pipeline of registered codecs, e.g.
+        <tt>makeChunkCodecs({"delta", "shuffle", "lz"})</tt>.
+    */
+inline ChunkCodecPipeline
+makeChunkCodecs(std::vector<std::string> const & names)
+{
+    ChunkCodecPipeline res;
+    for(auto const & name : names)
+        res.push_back(makeChunkCodec(name));
+    return res;
+}
+
+    /** \brief Apply all codecs of a pipeline in order.
+    */
+inline void
+encodeChunk(ChunkCodecPipeline const & codecs, char const * data, std::size_t size,
+            std::string & result, int itemsize, int channels)
+{
+    if(codecs.size() == 0)
+    {
+        result.assign(data, size);
+        return;
+    }
+    std::string tmp;
+    for(std::size_t k = 0; k < codecs.size(); ++k)
+    {
+        std::string & out = (codecs.size() - k) % 2 == 1 ? result : tmp;
+        codecs[k]->encode(data, size, out, itemsize, channels);
+        data = out.data();
+        size = out.size();
+    }
+}
+
+    /** \brief Apply all codecs of a pipeline in reverse order.
+    */
+inline void
+decodeChunk(ChunkCodecPipeline const & codecs, char const * data, std::size_t size,
+            std::string & result, int itemsize, int channels)
+{
+    if(codecs.size() == 0)
+    {
+        result.assign(data, size);
+        return;
+    }
+    std::string tmp;
+    for(std::size_t k = 0; k < codecs.size(); ++k)
+    {
+        std::string & out = (codecs.size() - k) % 2 == 1 ? result : tmp;
+        codecs[codecs.size() - 1 - k]->decode(data, size, out, itemsize, channels);
+        data = out.data();
+        size = out.size();
+    }
+}
+
+} // namespace vigra
+
+#endif // VIGRA2_CODECS_HXX
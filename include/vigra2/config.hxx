@@ -310,6 +310,17 @@
 #  define VIGRA_SHARED_PTR  std::shared_ptr
 #endif
 
+    // usage:
+    //   VIGRA_PREFETCH(p);  // hint that *p will be read soon
+    //
+#ifndef VIGRA_PREFETCH
+    #if defined(__GNUC__) || defined(__clang__)
+        #define VIGRA_PREFETCH(p) __builtin_prefetch((const void *)(p))
+    #else
+        #define VIGRA_PREFETCH(p) ((void)0)
+    #endif
+#endif
+
 #ifndef VIGRA_NO_THREADSAFE_STATIC_INIT
     // usage:
     //   static int * p = VIGRA_SAFE_STATIC(p, new int(42));
@@ -0,0 +1,497 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014-2017 by Ullrich Koethe                  */
+/*                                                                      */
+/*    This file is part of the VIGRA2 computer vision library.          */
+/*    The VIGRA2 Website is                                             */
+/*        http://ukoethe.github.io/vigra2                               */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#pragma once
+
+#ifndef VIGRA2_CONVERSION_HXX
+#define VIGRA2_CONVERSION_HXX
+
+#include "config.hxx"
+#include "numeric_traits.hxx"
+#include "pointer_nd.hxx"
+#include "array_nd.hxx"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) && !defined(VIGRA_NO_SSE2)
+    #define VIGRA_CONVERSION_SSE2
+    #include <emmintrin.h>
+#endif
+
+namespace vigra {
+
+/********************************************************/
+/*                                                      */
+/*                    ConversionMode                    */
+/*                                                      */
+/********************************************************/
+
+    /** \brief How real values are converted into integer types.
+
+        <ul>
+        <li><tt>ConvertTruncate</tt>: round towards zero, like <tt>static_cast</tt>.
+        <li><tt>ConvertRound</tt>: round to the nearest integer (ties to even
+            in the default floating-point environment).
+        <li><tt>ConvertSaturate</tt>: clamp to the range of the target type
+            and round to the nearest integer. NaN is mapped to the
+            target's minimum.
+        </ul>
+        With <tt>ConvertTruncate</tt> and <tt>ConvertRound</tt>, the result
+        for values outside the target's range is unspecified. When the
+        target type is a floating-point type, all modes are equivalent
+        to <tt>static_cast</tt>, except that <tt>ConvertSaturate</tt> clamps
+        to the target's range.
+    */
+enum ConversionMode { ConvertTruncate, ConvertRound, ConvertSaturate };
+
+/********************************************************/
+/*                                                      */
+/*                     ConvertValue                     */
+/*                                                      */
+/********************************************************/
+
+namespace conversion_detail {
+
+template <class T, class U,
+          bool INTEGER_TARGET = std::is_integral<T>::value && !std::is_same<T, bool>::value,
+          bool REAL_TARGET    = std::is_floating_point<T>::value,
+          bool REAL_SOURCE    = std::is_floating_point<U>::value>
+struct ConvertScalar
+{
+    // neither integer nor real target: use the default conversion
+    static T truncate(U v) { return detail::RequiresExplicitCast<T>::cast(v); }
+    static T round(U v)    { return detail::RequiresExplicitCast<T>::cast(v); }
+    static T saturate(U v) { return detail::RequiresExplicitCast<T>::cast(v); }
+};
+
+    // real => integer
+template <class T, class U>
+struct ConvertScalar<T, U, true, false, true>
+{
+    static T truncate(U v)
+    {
+        return static_cast<T>(v);
+    }
+
+    static T round(U v)
+    {
+        return static_cast<T>(std::nearbyint(v));
+    }
+
+    static T saturate(U v)
+    {
+        // NaN fails the first comparison and maps to the minimum,
+        // the upper bound is never cast (it may not be representable)
+        static const U lower = static_cast<U>(std::numeric_limits<T>::min()),
+                       upper = static_cast<U>(std::numeric_limits<T>::max());
+        return !(v >= lower)
+                   ? std::numeric_limits<T>::min()
+                   : v < upper
+                        ? static_cast<T>(std::nearbyint(v))
+                        : std::numeric_limits<T>::max();
+    }
+};
+
+    // integer => integer
+template <class T, class U>
+struct ConvertScalar<T, U, true, false, false>
+{
+    static T truncate(U v) { return static_cast<T>(v); }
+    static T round(U v)    { return static_cast<T>(v); }
+
+    static T saturate(U v)
+    {
+        if(std::is_signed<U>::value && v < 0)
+        {
+            return (long long)v < (long long)std::numeric_limits<T>::min()
+                        ? std::numeric_limits<T>::min()
+                        : static_cast<T>(v);
+        }
+        return (unsigned long long)v > (unsigned long long)std::numeric_limits<T>::max()
+                    ? std::numeric_limits<T>::max()
+                    : static_cast<T>(v);
+    }
+};
+
+    // integer or real => real
+template <class T, class U, bool REAL_SOURCE>
+struct ConvertScalar<T, U, false, true, REAL_SOURCE>
+{
+    static T truncate(U v) { return static_cast<T>(v); }
+    static T round(U v)    { return static_cast<T>(v); }
+
+    static T saturate(U v)
+    {
+        return REAL_SOURCE
+                  ? NumericTraits<T>::fromRealPromote(v)
+                  : static_cast<T>(v);
+    }
+};
+
+} // namespace conversion_detail
+
+    /** \brief Convert a single value according to a <tt>ConversionMode</tt>.
+
+        The mode is a template parameter, so that the conversion can be
+        inlined into loops:
+        \code
+        UInt8 g = ConvertValue<UInt8, ConvertSaturate>::exec(300.7f);  // 255
+        \endcode
+    */
+template <class T, ConversionMode MODE>
+struct ConvertValue;
+
+template <class T>
+struct ConvertValue<T, ConvertTruncate>
+{
+    template <class U>
+    static T exec(U v)
+    {
+        return conversion_detail::ConvertScalar<T, U>::truncate(v);
+    }
+};
+
+template <class T>
+struct ConvertValue<T, ConvertRound>
+{
+    template <class U>
+    static T exec(U v)
+    {
+        return conversion_detail::ConvertScalar<T, U>::round(v);
+    }
+};
+
+template <class T>
+struct ConvertValue<T, ConvertSaturate>
+{
+    template <class U>
+    static T exec(U v)
+    {
+        return conversion_detail::ConvertScalar<T, U>::saturate(v);
+    }
+};
+
+/********************************************************/
+/*                                                      */
+/*                    convertBlock()                    */
+/*                                                      */
+/********************************************************/
+
+namespace conversion_detail {
+
+template <ConversionMode MODE, class T, class U>
+inline void
+convertScalarBlock(T * dest, U const * src, ArrayIndex size)
+{
+    for(ArrayIndex k=0; k<size; ++k)
+        dest[k] = ConvertValue<T, MODE>::exec(src[k]);
+}
+
+    // default: scalar loop, which the compiler may vectorize on its own
+template <ConversionMode MODE, class T, class U>
+inline void
+convertBlockImpl(T * dest, U const * src, ArrayIndex size)
+{
+    convertScalarBlock<MODE>(dest, src, size);
+}
+
+#ifdef VIGRA_CONVERSION_SSE2
+
+    // convert four floats to int32 according to MODE
+template <ConversionMode MODE>
+inline __m128i
+convertPS(__m128 v, __m128 lower, __m128 upper)
+{
+    if(MODE == ConvertSaturate)
+    {
+        // _mm_max_ps() returns its second argument when 'v' is NaN
+        v = _mm_min_ps(_mm_max_ps(v, lower), upper);
+    }
+    return MODE == ConvertTruncate
+              ? _mm_cvttps_epi32(v)
+              : _mm_cvtps_epi32(v);
+}
+
+template <ConversionMode MODE>
+inline void
+convertBlockImpl(std::uint8_t * dest, float const * src, ArrayIndex size)
+{
+    __m128 lower = _mm_set1_ps(0.0f),
+           upper = _mm_set1_ps(255.0f);
+    ArrayIndex k = 0;
+    for(; k+16 <= size; k += 16)
+    {
+        __m128i i0 = convertPS<MODE>(_mm_loadu_ps(src + k),      lower, upper),
+                i1 = convertPS<MODE>(_mm_loadu_ps(src + k + 4),  lower, upper),
+                i2 = convertPS<MODE>(_mm_loadu_ps(src + k + 8),  lower, upper),
+                i3 = convertPS<MODE>(_mm_loadu_ps(src + k + 12), lower, upper);
+        __m128i s0 = _mm_packs_epi32(i0, i1),
+                s1 = _mm_packs_epi32(i2, i3);
+        _mm_storeu_si128((__m128i *)(dest + k), _mm_packus_epi16(s0, s1));
+    }
+    convertScalarBlock<MODE>(dest + k, src + k, size - k);
+}
+
+template <ConversionMode MODE>
+inline void
+convertBlockImpl(std::int16_t * dest, float const * src, ArrayIndex size)
+{
+    __m128 lower = _mm_set1_ps(-32768.0f),
+           upper = _mm_set1_ps(32767.0f);
+    ArrayIndex k = 0;
+    for(; k+8 <= size; k += 8)
+    {
+        __m128i i0 = convertPS<MODE>(_mm_loadu_ps(src + k),     lower, upper),
+                i1 = convertPS<MODE>(_mm_loadu_ps(src + k + 4), lower, upper);
+        _mm_storeu_si128((__m128i *)(dest + k), _mm_packs_epi32(i0, i1));
+    }
+    convertScalarBlock<MODE>(dest + k, src + k, size - k);
+}
+
+template <ConversionMode MODE>
+inline void
+convertBlockImpl(std::uint16_t * dest, float const * src, ArrayIndex size)
+{
+    // SSE2 has no unsigned 32 => 16 bit pack, so we shift the values into
+    // the signed range, pack, and flip the sign bit back
+    __m128 lower = _mm_set1_ps(0.0f),
+           upper = _mm_set1_ps(65535.0f);
+    __m128i offset32 = _mm_set1_epi32(32768),
+            offset16 = _mm_set1_epi16((short)0x8000);
+    ArrayIndex k = 0;
+    for(; k+8 <= size; k += 8)
+    {
+        __m128i i0 = _mm_sub_epi32(convertPS<MODE>(_mm_loadu_ps(src + k),     lower, upper), offset32),
+                i1 = _mm_sub_epi32(convertPS<MODE>(_mm_loadu_ps(src + k + 4), lower, upper), offset32);
+        _mm_storeu_si128((__m128i *)(dest + k), _mm_xor_si128(_mm_packs_epi32(i0, i1), offset16));
+    }
+    convertScalarBlock<MODE>(dest + k, src + k, size - k);
+}
+
+    // integer => float is exact, so the mode doesn't matter
+template <ConversionMode MODE>
+inline void
+convertBlockImpl(float * dest, std::uint8_t const * src, ArrayIndex size)
+{
+    __m128i zero = _mm_setzero_si128();
+    ArrayIndex k = 0;
+    for(; k+16 <= size; k += 16)
+    {
+        __m128i b  = _mm_loadu_si128((__m128i const *)(src + k)),
+                s0 = _mm_unpacklo_epi8(b, zero),
+                s1 = _mm_unpackhi_epi8(b, zero);
+        _mm_storeu_ps(dest + k,      _mm_cvtepi32_ps(_mm_unpacklo_epi16(s0, zero)));
+        _mm_storeu_ps(dest + k + 4,  _mm_cvtepi32_ps(_mm_unpackhi_epi16(s0, zero)));
+        _mm_storeu_ps(dest + k + 8,  _mm_cvtepi32_ps(_mm_unpacklo_epi16(s1, zero)));
+        _mm_storeu_ps(dest + k + 12, _mm_cvtepi32_ps(_mm_unpackhi_epi16(s1, zero)));
+    }
+    convertScalarBlock<MODE>(dest + k, src + k, size - k);
+}
+
+template <ConversionMode MODE>
+inline void
+convertBlockImpl(float * dest, std::uint16_t const * src, ArrayIndex size)
+{
+    __m128i zero = _mm_setzero_si128();
+    ArrayIndex k = 0;
+    for(; k+8 <= size; k += 8)
+    {
+        __m128i s = _mm_loadu_si128((__m128i const *)(src + k));
+        _mm_storeu_ps(dest + k,     _mm_cvtepi32_ps(_mm_unpacklo_epi16(s, zero)));
+        _mm_storeu_ps(dest + k + 4, _mm_cvtepi32_ps(_mm_unpackhi_epi16(s, zero)));
+    }
+    convertScalarBlock<MODE>(dest + k, src + k, size - k);
+}
+
+template <ConversionMode MODE>
+inline void
+convertBlockImpl(float * dest, std::int16_t const * src, ArrayIndex size)
+{
+    ArrayIndex k = 0;
+    for(; k+8 <= size; k += 8)
+    {
+        // duplicate each value into both halves of a 32-bit lane,
+        // then sign-extend by an arithmetic shift
+        __m128i s = _mm_loadu_si128((__m128i const *)(src + k));
+        _mm_storeu_ps(dest + k,     _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16)));
+        _mm_storeu_ps(dest + k + 4, _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16)));
+    }
+    convertScalarBlock<MODE>(dest + k, src + k, size - k);
+}
+
+#endif // VIGRA_CONVERSION_SSE2
+
+} // namespace conversion_detail
+
+    /** \brief Convert \a size consecutive values from \a src into \a dest.
+
+        Conversions from <tt>float</tt> to <tt>UInt8</tt>, <tt>UInt16</tt>, and
+        <tt>Int16</tt> and back use SSE2 pack/convert instructions when available
+        (define <tt>VIGRA_NO_SSE2</tt> to disable them). Other type combinations
+        use a scalar loop. The memory regions must not overlap.
+    */
+template <class T, class U>
+inline void
+convertBlock(T * dest, U const * src, ArrayIndex size,
+             ConversionMode mode = ConvertSaturate)
+{
+    switch(mode)
+    {
+      case ConvertTruncate:
+        conversion_detail::convertBlockImpl<ConvertTruncate>(dest, src, size);
+        break;
+      case ConvertRound:
+        conversion_detail::convertBlockImpl<ConvertRound>(dest, src, size);
+        break;
+      default:
+        conversion_detail::convertBlockImpl<ConvertSaturate>(dest, src, size);
+    }
+}
+
+/********************************************************/
+/*                                                      */
+/*                    convertArray()                    */
+/*                                                      */
+/********************************************************/
+
+namespace conversion_detail {
+
+    // array source: convert the memory block directly
+template <ConversionMode MODE, class T, int N, class U>
+inline void
+convertFlat(T * dest, PointerND<N, U> & src, ArrayIndex count, int)
+{
+    convertBlockImpl<MODE>(dest, (typename std::remove_const<U>::type const *)src.ptr(), count);
+}
+
+    // expression source: evaluate chunks into a buffer and convert the buffer
+template <ConversionMode MODE, class T, class P>
+inline void
+convertFlat(T * dest, P & src, ArrayIndex count, int dim)
+{
+    typedef typename std::remove_const<typename P::value_type>::type U;
+    static const ArrayIndex chunk = 256;
+    U buffer[chunk];
+    for(ArrayIndex k=0; k<count; k+=chunk)
+    {
+        ArrayIndex size = std::min(chunk, count - k);
+        for(ArrayIndex l=0; l<size; ++l, src.inc(dim))
+            buffer[l] = *src;
+        convertBlockImpl<MODE>(dest + k, buffer, size);
+    }
+}
+
+template <ConversionMode MODE, int N, class T, class ARRAY_LIKE>
+void
+convertArrayImpl(ArrayViewND<N, T> target, ARRAY_LIKE && src)
+{
+    using namespace array_detail;
+
+    typedef typename std::remove_reference<ARRAY_LIKE>::type ARRAY;
+    typedef typename ARRAY::value_type U;
+    static const int dimension = array_math::ArrayMathUnifyDimension<ArrayViewND<N, T>, ARRAY>::value;
+
+    Shape<dimension> shape = target.shape();
+    vigra_precondition(unifyShape(shape, src),
+        "convertArray(): shape mismatch.");
+
+    // fast path: both operands are consecutive in C-order, and there is no aliasing
+    // => convert in blocks
+    if(shape.size() > 0 && shape == target.shape())
+    {
+        auto tp = target.pointer_nd();
+        auto sp = src.pointer_nd();
+        if(tp.isCConsecutive(shape) && sp.isCConsecutive(shape) &&
+           checkMemoryOverlap(target.memoryRange(), src) == NoMemoryOverlap)
+        {
+            convertFlat<MODE>(target.data(), sp, prod(shape), innermostAxis(shape));
+            return;
+        }
+    }
+
+    universalArrayNDFunction(target, std::forward<ARRAY_LIKE>(src),
+        [](T & v, U const & u)
+        {
+            v = ConvertValue<T, MODE>::exec(u);
+        },
+        "convertArray()");
+}
+
+} // namespace conversion_detail
+
+    /** \brief Assign an array or array expression to \a target with the given
+        <tt>ConversionMode</tt>.
+
+        This is the bulk version of <tt>ConvertValue</tt> and typically the
+        last step before visualization or export, e.g.
+        \code
+        ArrayND<3, float> volume(...);
+        ArrayND<3, UInt8> gray(volume.shape());
+
+        convertArray(gray, 255.0f * volume, ConvertSaturate);
+        \endcode
+        When target and source are consecutive in C-order and don't overlap,
+        the data are converted by <tt>convertBlock()</tt>, i.e. with SIMD
+        instructions for the common float/integer pairs. Otherwise, the
+        function falls back to element-wise conversion, which handles
+        arbitrary strides, singleton expansion, and overlapping memory like
+        ordinary array assignment.
+    */
+template <int N, class T, class ARRAY_LIKE,
+          VIGRA_REQUIRE<ArrayLikeConcept<ARRAY_LIKE>::value> >
+inline void
+convertArray(ArrayViewND<N, T> target, ARRAY_LIKE && src,
+             ConversionMode mode = ConvertSaturate)
+{
+    switch(mode)
+    {
+      case ConvertTruncate:
+        conversion_detail::convertArrayImpl<ConvertTruncate>(target, std::forward<ARRAY_LIKE>(src));
+        break;
+      case ConvertRound:
+        conversion_detail::convertArrayImpl<ConvertRound>(target, std::forward<ARRAY_LIKE>(src));
+        break;
+      default:
+        conversion_detail::convertArrayImpl<ConvertSaturate>(target, std::forward<ARRAY_LIKE>(src));
+    }
+}
+
+} // namespace vigra
+
+#endif // VIGRA2_CONVERSION_HXX
@@ -0,0 +1,442 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014-2017 by Ullrich Koethe                  */
+/*                                                                      */
+/*    This file is part of the VIGRA2 computer vision library.          */
+/*    The VIGRA2 Website is                                             */
+/*        http://ukoethe.github.io/vigra2                               */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#pragma once
+
+#ifndef VIGRA2_GATHER_HXX
+#define VIGRA2_GATHER_HXX
+
+#include "config.hxx"
+#include "error.hxx"
+#include "numeric_traits.hxx"
+#include "array_nd.hxx"
+#include "parallel.hxx"
+#include <algorithm>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace vigra {
+
+/********************************************************/
+/*                                                      */
+/*                    gather/scatter                    */
+/*                                                      */
+/********************************************************/
+
+namespace gather_detail {
+
+    // number of iterations between prefetching and accessing an element
+static const ArrayIndex prefetchDistance = 8;
+static const ArrayIndex minChunkSize     = 1 << 14;
+
+    // Convert an index into a byte offset relative to the first element of an
+    // array. Indices are either coordinates (TinyArray) or scan-order indices
+    // (integers).
+template <int N, class INDEX, bool LINEAR = std::is_integral<INDEX>::value>
+struct IndexToOffset
+{
+    Shape<N> shape_, strides_;
+
+    template <class T>
+    IndexToOffset(ArrayViewND<N, T> const & a)
+    : shape_(a.shape())
+    , strides_(a.byte_strides())
+    {}
+
+    bool checkDimension(INDEX const & c) const
+    {
+        return c.size() == shape_.size();
+    }
+
+        // 'inside' is cleared when the index is out of range
+    ArrayIndex operator()(INDEX const & c, bool & inside) const
+    {
+        // unsigned comparison also rejects negative indices
+        ArrayIndex res = 0;
+        for(int k=0; k<shape_.size(); ++k)
+        {
+            inside &= (std::size_t)c[k] < (std::size_t)shape_[k];
+            res += c[k] * strides_[k];
+        }
+        return res;
+    }
+};
+
+template <int N, class INDEX>
+struct IndexToOffset<N, INDEX, true>
+{
+    Shape<N> shape_, strides_;
+    ArrayIndex size_, elementSize_;
+    bool consecutive_;
+
+    template <class T>
+    IndexToOffset(ArrayViewND<N, T> const & a)
+    : shape_(a.shape())
+    , strides_(a.byte_strides())
+    , size_(a.size())
+    , elementSize_(sizeof(T))
+    , consecutive_(a.pointer_nd().isCConsecutive(a.shape()))
+    {}
+
+    bool checkDimension(INDEX const &) const
+    {
+        return true;
+    }
+
+    ArrayIndex operator()(INDEX const & i, bool & inside) const
+    {
+        ArrayIndex j = (ArrayIndex)i;
+        inside &= 0 <= j && j < size_;
+        if(consecutive_)
+            return j * elementSize_;
+        ArrayIndex res = 0;
+        for(int k=shape_.size()-1; k >= 0; --k)
+        {
+            res += (j % shape_[k]) * strides_[k];
+            j /= shape_[k];
+        }
+        return res;
+    }
+};
+
+    // Return 'a' if its elements are consecutive in C-order, otherwise
+    // copy it into 'copy' and return that, so that the elements can be
+    // addressed via a plain pointer in scan order.
+template <int M, class T>
+ArrayViewND<M, T>
+scanOrderView(ArrayViewND<M, T> const & a, ArrayND<M, T> & copy)
+{
+    if(a.pointer_nd().isCConsecutive(a.shape()))
+        return a;
+    copy = ArrayND<M, T>(a);
+    return copy;
+}
+
+    // Offset of 'index', throws when the index is outside the array.
+template <class OFFSET, class INDEX>
+inline ArrayIndex
+checkedOffset(OFFSET const & toOffset, INDEX const & index, char const * name)
+{
+    vigra_precondition(toOffset.checkDimension(index),
+        std::string(name) + ": index has wrong dimension.");
+    bool inside = true;
+    ArrayIndex res = toOffset(index, inside);
+    vigra_precondition(inside,
+        std::string(name) + ": index out of range.");
+    return res;
+}
+
+    // Call 'f(element, k)' for the elements at 'indices[begin]' ... 'indices[end-1]'.
+    // Offsets are computed 'prefetchDistance' iterations before the element
+    // is accessed, and the element is prefetched at that time.
+template <class T, class OFFSET, class INDEX, class FCT>
+void
+foreachIndexedElement(char * base, OFFSET const & toOffset, INDEX const * indices,
+                      ArrayIndex begin, ArrayIndex end, FCT && f, char const * name)
+{
+    ArrayIndex ring[prefetchDistance];
+    for(ArrayIndex k=begin; k<end && k<begin+prefetchDistance; ++k)
+    {
+        ring[k % prefetchDistance] = checkedOffset(toOffset, indices[k], name);
+        VIGRA_PREFETCH(base + ring[k % prefetchDistance]);
+    }
+    for(ArrayIndex k=begin; k<end; ++k)
+    {
+        ArrayIndex & slot = ring[k % prefetchDistance];
+        T & element = *(T*)(base + slot);
+        if(k + prefetchDistance < end)
+        {
+            slot = checkedOffset(toOffset, indices[k + prefetchDistance], name);
+            VIGRA_PREFETCH(base + slot);
+        }
+        f(element, k);
+    }
+}
+
+} // namespace gather_detail
+
+    /** \brief Read the elements of \a a at the given indices (fancy indexing).
+
+        \a indices is an array of coordinates (<tt>Shape<N></tt> or another
+        integer <tt>TinyArray</tt>) or of scan-order indices (integers, where
+        index <tt>k</tt> refers to the <tt>k</tt>'th element of \a a in
+        C-order). The result has the shape of \a indices, i.e. <tt>res[i] = a[indices[i]]</tt>.
+        A <tt>ContractViolation</tt> is thrown when an index is outside the array.
+
+        The byte offsets of the indices are computed in blocks, so that
+        the addressed elements can be prefetched, and large index arrays
+        are processed by several threads.
+        \code
+        ArrayND<3, float> volume(...);
+        ArrayND<1, Shape<3>> points(...);
+        ArrayND<1, float> samples = gather(volume, points);
+
+        // label table lookup
+        ArrayND<1, UInt8> table(...);
+        ArrayND<3, UInt32> labels(...);
+        ArrayND<3, UInt8> classes = gather(table, labels);
+        \endcode
+    */
+template <int N, class T, int M, class INDEX>
+ArrayND<M, typename std::remove_const<T>::type>
+gather(ArrayViewND<N, T> const & a, ArrayViewND<M, INDEX> const & indices,
+       ParallelOptions const & options = ParallelOptions())
+{
+    using namespace gather_detail;
+    typedef typename std::remove_const<T>::type Value;
+
+    ArrayND<M, INDEX> copy;
+    auto idx = scanOrderView(indices, copy);
+    ArrayND<M, Value> res(indices.shape());
+    if(res.size() == 0)
+        return res;
+
+    IndexToOffset<N, INDEX> toOffset(a);
+    char * base = (char *)a.data();
+    INDEX const * ip = idx.data();
+    Value * rp = res.data();
+    parallelForeachChunk(idx.size(), options,
+        [&](int, ArrayIndex begin, ArrayIndex end)
+        {
+            foreachIndexedElement<Value>(base, toOffset, ip, begin, end,
+                [rp](Value const & v, ArrayIndex k)
+                {
+                    rp[k] = v;
+                }, "gather()");
+        }, minChunkSize);
+    return res;
+}
+
+    /** \brief Write \a values into \a a at the given indices (fancy indexing).
+
+        Performs <tt>a[indices[i]] = values[i]</tt> for all <tt>i</tt>, where
+        \a indices is interpreted as in \ref gather() and \a values must have the
+        same shape as \a indices. When the same index occurs several times,
+        it is unspecified which value is stored if several threads are used
+        (with <tt>ParallelOptions::NoThreads</tt>, the last one wins).
+    */
+template <int N, class T, int M, class INDEX, class U>
+void
+scatter(ArrayViewND<N, T> a, ArrayViewND<M, INDEX> const & indices,
+        ArrayViewND<M, U> const & values,
+        ParallelOptions const & options = ParallelOptions())
+{
+    using namespace gather_detail;
+
+    vigra_precondition(indices.shape() == values.shape(),
+        "scatter(): shape mismatch between indices and values.");
+    ArrayND<M, INDEX> icopy;
+    ArrayND<M, U> vcopy;
+    auto idx = scanOrderView(indices, icopy);
+    auto val = scanOrderView(values, vcopy);
+
+    IndexToOffset<N, INDEX> toOffset(a);
+    char * base = (char *)a.data();
+    INDEX const * ip = idx.data();
+    U const * vp = val.data();
+    parallelForeachChunk(idx.size(), options,
+        [&](int, ArrayIndex begin, ArrayIndex end)
+        {
+            foreachIndexedElement<T>(base, toOffset, ip, begin, end,
+                [vp](T & t, ArrayIndex k)
+                {
+                    t = detail::RequiresExplicitCast<T>::cast(vp[k]);
+                }, "scatter()");
+        }, minChunkSize);
+}
+
+    /** \brief Write \a value into \a a at the given indices.
+
+        Equivalent to <tt>a[indices[i]] = value</tt> for all <tt>i</tt>.
+    */
+template <int N, class T, int M, class INDEX, class U,
+          VIGRA_REQUIRE<!ArrayNDConcept<U>::value> >
+void
+scatter(ArrayViewND<N, T> a, ArrayViewND<M, INDEX> const & indices,
+        U const & value,
+        ParallelOptions const & options = ParallelOptions())
+{
+    using namespace gather_detail;
+
+    ArrayND<M, INDEX> copy;
+    auto idx = scanOrderView(indices, copy);
+
+    IndexToOffset<N, INDEX> toOffset(a);
+    char * base = (char *)a.data();
+    INDEX const * ip = idx.data();
+    T v = detail::RequiresExplicitCast<T>::cast(value);
+    parallelForeachChunk(idx.size(), options,
+        [&](int, ArrayIndex begin, ArrayIndex end)
+        {
+            foreachIndexedElement<T>(base, toOffset, ip, begin, end,
+                [v](T & t, ArrayIndex)
+                {
+                    t = v;
+                }, "scatter()");
+        }, minChunkSize);
+}
+
+    /** \brief Add \a values to the elements of \a a at the given indices.
+
+        Performs <tt>a[indices[i]] += values[i]</tt> for all <tt>i</tt>,
+        where repeated indices accumulate all their values (e.g. to compute
+        per-label sums). \a indices is interpreted as in \ref gather().
+
+        In order to avoid synchronization, each additional thread accumulates
+        into a private zero-initialized copy of \a a, and the copies are added
+        to \a a at the end in a fixed order. The number of threads is limited
+        such that each thread processes at least <tt>a.size()</tt> indices, so that
+        the private copies never cost more than the scatter itself.
+    */
+template <int N, class T, int M, class INDEX, class U>
+void
+scatterAdd(ArrayViewND<N, T> a, ArrayViewND<M, INDEX> const & indices,
+           ArrayViewND<M, U> const & values,
+           ParallelOptions const & options = ParallelOptions())
+{
+    using namespace gather_detail;
+
+    vigra_precondition(indices.shape() == values.shape(),
+        "scatterAdd(): shape mismatch between indices and values.");
+    ArrayND<M, INDEX> icopy;
+    ArrayND<M, U> vcopy;
+    auto idx = scanOrderView(indices, icopy);
+    auto val = scanOrderView(values, vcopy);
+    INDEX const * ip = idx.data();
+    U const * vp = val.data();
+
+    int chunkCount = parallelChunkCount(idx.size(), options,
+                                        std::max(minChunkSize, a.size()));
+    std::vector<ArrayND<N, T>> buffers;
+    for(int k=1; k<chunkCount; ++k)
+        buffers.emplace_back(a.shape(), T());
+
+    parallelForeachChunk(idx.size(), chunkCount,
+        [&](int chunk, ArrayIndex begin, ArrayIndex end)
+        {
+            ArrayViewND<N, T> target = chunk == 0
+                                          ? a
+                                          : buffers[chunk-1];
+            IndexToOffset<N, INDEX> toOffset(target);
+            char * base = (char *)target.data();
+            foreachIndexedElement<T>(base, toOffset, ip, begin, end,
+                [vp](T & t, ArrayIndex k)
+                {
+                    t += detail::RequiresExplicitCast<T>::cast(vp[k]);
+                }, "scatterAdd()");
+        });
+
+    for(auto & b : buffers)
+        a += b;
+}
+
+    /** \brief Add \a value to the elements of \a a at the given indices.
+
+        Equivalent to <tt>a[indices[i]] += value</tt> for all <tt>i</tt>. For
+        example, <tt>scatterAdd(counts, labels, 1)</tt> counts how often each
+        label occurs.
+    */
+template <int N, class T, int M, class INDEX, class U,
+          VIGRA_REQUIRE<!ArrayNDConcept<U>::value> >
+void
+scatterAdd(ArrayViewND<N, T> a, ArrayViewND<M, INDEX> const & indices,
+           U const & value,
+           ParallelOptions const & options = ParallelOptions())
+{
+    using namespace gather_detail;
+
+    ArrayND<M, INDEX> copy;
+    auto idx = scanOrderView(indices, copy);
+    INDEX const * ip = idx.data();
+    T v = detail::RequiresExplicitCast<T>::cast(value);
+
+    int chunkCount = parallelChunkCount(idx.size(), options,
+                                        std::max(minChunkSize, a.size()));
+    std::vector<ArrayND<N, T>> buffers;
+    for(int k=1; k<chunkCount; ++k)
+        buffers.emplace_back(a.shape(), T());
+
+    parallelForeachChunk(idx.size(), chunkCount,
+        [&](int chunk, ArrayIndex begin, ArrayIndex end)
+        {
+            ArrayViewND<N, T> target = chunk == 0
+                                          ? a
+                                          : buffers[chunk-1];
+            IndexToOffset<N, INDEX> toOffset(target);
+            char * base = (char *)target.data();
+            foreachIndexedElement<T>(base, toOffset, ip, begin, end,
+                [v](T & t, ArrayIndex)
+                {
+                    t += v;
+                }, "scatterAdd()");
+        });
+
+    for(auto & b : buffers)
+        a += b;
+}
+
+    /** \brief Read the elements of \a a at the given scan-order indices.
+
+        Same as \ref gather() with an integer index array (the name
+        follows <tt>numpy.take()</tt>).
+    */
+template <int N, class T, int M, class INDEX,
+          VIGRA_REQUIRE<std::is_integral<INDEX>::value> >
+inline ArrayND<M, typename std::remove_const<T>::type>
+take(ArrayViewND<N, T> const & a, ArrayViewND<M, INDEX> const & indices,
+     ParallelOptions const & options = ParallelOptions())
+{
+    return gather(a, indices, options);
+}
+
+    /** \brief Write \a values into \a a at the given scan-order indices.
+
+        Same as \ref scatter() with an integer index array (the name
+        follows <tt>numpy.put()</tt>).
+    */
+template <int N, class T, int M, class INDEX, class VALUES,
+          VIGRA_REQUIRE<std::is_integral<INDEX>::value> >
+inline void
+put(ArrayViewND<N, T> a, ArrayViewND<M, INDEX> const & indices,
+    VALUES const & values,
+    ParallelOptions const & options = ParallelOptions())
+{
+    scatter(a, indices, values, options);
+}
+
+} // namespace vigra
+
+#endif // VIGRA2_GATHER_HXX
@@ -0,0 +1,680 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014-2017 by Ullrich Koethe                  */
+/*                                                                      */
+/*    This file is part of the VIGRA2 computer vision library.          */
+/*    The VIGRA2 Website is                                             */
+/*        http://ukoethe.github.io/vigra2                               */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#pragma once
+
+#ifndef VIGRA2_HISTOGRAM_HXX
+#define VIGRA2_HISTOGRAM_HXX
+
+#include "config.hxx"
+#include "error.hxx"
+#include "numeric_traits.hxx"
+#include "array_nd.hxx"
+#include "algorithm_nd.hxx"
+#include "parallel.hxx"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+namespace vigra {
+
+/********************************************************/
+/*                                                      */
+/*                       Histogram                      */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Histogram with equally sized bins.
+
+        The bins cover the range <tt>[lower, upper]</tt>. Integral histograms
+        created with \ref histogram(ArrayViewND<N, T> const &, ParallelOptions const &)
+        use direct binning, i.e. every bin corresponds to exactly one value.
+        Values outside the range are counted in <tt>underflow()</tt> and
+        <tt>overflow()</tt>. In addition, the histogram records the smallest and
+        largest value it has seen, so that a <tt>minmax()</tt> of the data comes for free.
+
+        <b>\#include</b> \<vigra2/histogram.hxx\><br>
+        Namespace: vigra
+    */
+template <class T>
+class Histogram
+{
+  public:
+    typedef T           value_type;
+    typedef ArrayIndex  count_type;
+
+    Histogram()
+    : lower_(0.0)
+    , upper_(0.0)
+    , scale_(0.0)
+    , direct_(false)
+    , underflow_(0)
+    , overflow_(0)
+    , minimum_(NumericTraits<T>::max())
+    , maximum_(NumericTraits<T>::min())
+    {}
+
+        /** Create \a binCount bins for the range <tt>[lower, upper]</tt>.
+            For integral types, <tt>upper - lower + 1 == binCount</tt> results in
+            direct binning.
+        */
+    Histogram(double lower, double upper, ArrayIndex binCount)
+    : Histogram()
+    {
+        vigra_precondition(binCount > 0 && lower <= upper,
+            "Histogram(): invalid range or bin count.");
+        lower_ = lower;
+        upper_ = upper;
+        direct_ = std::is_integral<T>::value && upper - lower + 1.0 == (double)binCount;
+        scale_ = direct_
+                    ? 1.0
+                    : upper > lower
+                        ? binCount / (upper - lower)
+                        : 0.0;
+        counts_.resize(binCount, 0);
+    }
+
+    ArrayIndex binCount() const
+    {
+        return (ArrayIndex)counts_.size();
+    }
+
+        /** Bin index of value \a v (negative for underflow,
+            <tt>binCount()</tt> or more for overflow).
+        */
+    ArrayIndex binIndex(T v) const
+    {
+        if(direct_)
+            return (ArrayIndex)((double)v - lower_);
+        if(!((double)v >= lower_))
+            return -1;
+        if((double)v > upper_)
+            return binCount();
+        return std::min<ArrayIndex>((ArrayIndex)(((double)v - lower_) * scale_), binCount() - 1);
+    }
+
+    double binLower(ArrayIndex k) const
+    {
+        return direct_
+                   ? lower_ + k
+                   : scale_ == 0.0
+                        ? lower_
+                        : lower_ + k / scale_;
+    }
+
+    double binUpper(ArrayIndex k) const
+    {
+        return binLower(k+1);
+    }
+
+        /** True if every bin corresponds to exactly one value.
+        */
+    bool isDirect() const
+    {
+        return direct_ || scale_ == 0.0;
+    }
+
+    double lower() const
+    {
+        return lower_;
+    }
+
+    double upper() const
+    {
+        return upper_;
+    }
+
+    count_type operator[](ArrayIndex k) const
+    {
+        return counts_[k];
+    }
+
+    std::vector<count_type> const & counts() const
+    {
+        return counts_;
+    }
+
+    count_type underflow() const
+    {
+        return underflow_;
+    }
+
+    count_type overflow() const
+    {
+        return overflow_;
+    }
+
+        /** Total number of values seen (including underflow and overflow).
+        */
+    count_type size() const
+    {
+        count_type res = underflow_ + overflow_;
+        for(auto c : counts_)
+            res += c;
+        return res;
+    }
+
+    T minimum() const
+    {
+        return minimum_;
+    }
+
+    T maximum() const
+    {
+        return maximum_;
+    }
+
+    void update(T v)
+    {
+        ArrayIndex k = binIndex(v);
+        if(k < 0)
+            ++underflow_;
+        else if(k >= binCount())
+            ++overflow_;
+        else
+            ++counts_[k];
+        if(v < minimum_)
+            minimum_ = v;
+        if(maximum_ < v)
+            maximum_ = v;
+    }
+
+        /** Add the counts of another histogram with the same binning.
+        */
+    void merge(Histogram const & o)
+    {
+        vigra_precondition(binCount() == o.binCount() && lower_ == o.lower_ && upper_ == o.upper_,
+            "Histogram::merge(): histograms have different binning.");
+        for(ArrayIndex k=0; k<binCount(); ++k)
+            counts_[k] += o.counts_[k];
+        underflow_ += o.underflow_;
+        overflow_  += o.overflow_;
+        if(o.minimum_ < minimum_)
+            minimum_ = o.minimum_;
+        if(maximum_ < o.maximum_)
+            maximum_ = o.maximum_;
+    }
+
+    void reset()
+    {
+        std::fill(counts_.begin(), counts_.end(), 0);
+        underflow_ = overflow_ = 0;
+        minimum_ = NumericTraits<T>::max();
+        maximum_ = NumericTraits<T>::min();
+    }
+
+  private:
+    double lower_, upper_, scale_;
+    bool direct_;
+    std::vector<count_type> counts_;
+    count_type underflow_, overflow_;
+    T minimum_, maximum_;
+};
+
+/********************************************************/
+/*                                                      */
+/*                        minmax                        */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Find the smallest and largest value of an array using several threads.
+
+        Returns a <tt>TinyArray<T, 2></tt> as <tt>ArrayViewND::minmax()</tt>.
+    */
+template <int N, class T>
+TinyArray<T, 2>
+minmax(ArrayViewND<N, T> const & a, ParallelOptions const & options)
+{
+    std::vector<TinyArray<T, 2>> partials(options.getActualNumThreads());
+    int chunkCount = parallelForeachChunk(a, options,
+        [&partials](int chunk, ArrayViewND<N, T> const & part)
+        {
+            partials[chunk] = part.minmax();
+        });
+    TinyArray<T, 2> res(NumericTraits<T>::max(), NumericTraits<T>::min());
+    for(int k=0; k<chunkCount; ++k)
+    {
+        if(partials[k][0] < res[0])
+            res[0] = partials[k][0];
+        if(res[1] < partials[k][1])
+            res[1] = partials[k][1];
+    }
+    return res;
+}
+
+/********************************************************/
+/*                                                      */
+/*                       histogram                      */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Compute a histogram with the given binning using several threads.
+
+        Each thread fills a private sub-histogram, and the sub-histograms are
+        added at the end, so that no synchronization is needed during the scan.
+        Values exactly equal to \a upper are counted in the last bin.
+
+        \code
+        ArrayND<3, float> volume(...);
+        Histogram<float> h = histogram(volume, 0.0, 1.0, 256);
+        auto range = TinyArray<float, 2>(h.minimum(), h.maximum());
+        \endcode
+    */
+template <int N, class T>
+Histogram<T>
+histogram(ArrayViewND<N, T> const & a, double lower, double upper, ArrayIndex binCount,
+          ParallelOptions const & options = ParallelOptions())
+{
+    static_assert(std::is_arithmetic<T>::value,
+        "histogram(): array must have a scalar arithmetic value_type.");
+    Histogram<T> res(lower, upper, binCount);
+    std::vector<Histogram<T>> partials(options.getActualNumThreads());
+    int chunkCount = parallelForeachChunk(a, options,
+        [&partials, &res](int chunk, ArrayViewND<N, T> const & part)
+        {
+            Histogram<T> & h = partials[chunk];
+            h = res;
+            universalArrayNDFunction(part,
+                [&h](T const & v)
+                {
+                    h.update(v);
+                }, "histogram()");
+        });
+    for(int k=0; k<chunkCount; ++k)
+        res.merge(partials[k]);
+    return res;
+}
+
+    /** \brief Compute a histogram with \a binCount bins spanning the data range.
+
+        The range is determined by a preceding call to \ref minmax().
+    */
+template <int N, class T>
+Histogram<T>
+histogram(ArrayViewND<N, T> const & a, ArrayIndex binCount,
+          ParallelOptions const & options = ParallelOptions())
+{
+    vigra_precondition(a.size() > 0,
+        "histogram(): array must not be empty.");
+    auto range = minmax(a, options);
+    return histogram(a, (double)range[0], (double)range[1], binCount, options);
+}
+
+    /** \brief Compute a histogram of an integral array with one bin per value.
+
+        For 8- and 16-bit types, the bins cover the entire value range of the type,
+        so that only a single pass over the data is required. For larger types,
+        the range is determined by a preceding call to \ref minmax() and must
+        not exceed 2<sup>24</sup> values.
+    */
+template <int N, class T>
+Histogram<T>
+histogram(ArrayViewND<N, T> const & a, ParallelOptions const & options = ParallelOptions())
+{
+    static_assert(std::is_integral<T>::value,
+        "histogram(): direct binning requires an integral value_type, specify the bin count.");
+    double lower, upper;
+    if(sizeof(T) <= 2)
+    {
+        lower = (double)NumericTraits<T>::min();
+        upper = (double)NumericTraits<T>::max();
+    }
+    else
+    {
+        vigra_precondition(a.size() > 0,
+            "histogram(): array must not be empty.");
+        auto range = minmax(a, options);
+        lower = (double)range[0];
+        upper = (double)range[1];
+        vigra_precondition(upper - lower < (double)(1 << 24),
+            "histogram(): value range too large for direct binning, specify the bin count.");
+    }
+    return histogram(a, lower, upper, (ArrayIndex)(upper - lower + 1.0), options);
+}
+
+/********************************************************/
+/*                                                      */
+/*                       quantiles                      */
+/*                                                      */
+/********************************************************/
+
+namespace histogram_detail {
+
+    // the values of an array in the range [lo, hi], where lo and hi are
+    // themselves array values, and the number of smaller values
+template <class T>
+struct QuantileWindow
+{
+    T lo, hi;
+    ArrayIndex below, count;
+    bool splittable;
+
+    bool operator==(QuantileWindow const & o) const
+    {
+        return lo == o.lo && hi == o.hi && below == o.below;
+    }
+};
+
+    // windows containing at most this many values are selected directly
+static const ArrayIndex quantileCollectLimit = 1 << 16;
+
+    // histogram of the values in a window with the smallest and largest value of each bin
+template <class T>
+struct WindowBins
+{
+    Histogram<T> binning;
+    std::vector<ArrayIndex> counts;
+    std::vector<T> minimum, maximum;
+
+    explicit WindowBins(QuantileWindow<T> const & w)
+    : binning((double)w.lo, (double)w.hi,
+              std::min<ArrayIndex>(std::max<ArrayIndex>(w.count / 16, 1), 1 << 16))
+    , counts(binning.binCount(), 0)
+    , minimum(binning.binCount(), NumericTraits<T>::max())
+    , maximum(binning.binCount(), NumericTraits<T>::min())
+    {}
+
+    void update(T v)
+    {
+        ArrayIndex k = binning.binIndex(v);
+        ++counts[k];
+        if(v < minimum[k])
+            minimum[k] = v;
+        if(maximum[k] < v)
+            maximum[k] = v;
+    }
+
+    void merge(WindowBins const & o)
+    {
+        for(ArrayIndex k=0; k<(ArrayIndex)counts.size(); ++k)
+        {
+            counts[k] += o.counts[k];
+            if(o.minimum[k] < minimum[k])
+                minimum[k] = o.minimum[k];
+            if(maximum[k] < o.maximum[k])
+                maximum[k] = o.maximum[k];
+        }
+    }
+
+        // the sub-window (i.e. bin) containing the value of the given rank
+    QuantileWindow<T> select(QuantileWindow<T> const & w, ArrayIndex rank) const
+    {
+        ArrayIndex below = w.below;
+        for(ArrayIndex k=0; k<(ArrayIndex)counts.size(); ++k)
+        {
+            if(rank < below + counts[k])
+                return QuantileWindow<T>{ minimum[k], maximum[k], below, counts[k],
+                                          counts[k] < w.count };
+            below += counts[k];
+        }
+        vigra_invariant(false,
+            "quantiles(): internal error: rank outside histogram.");
+        return w;
+    }
+};
+
+    // bin the values of each window in a single pass over the array
+template <int N, class T>
+std::vector<WindowBins<T>>
+binWindows(ArrayViewND<N, T> const & a, std::vector<QuantileWindow<T>> const & windows,
+           ParallelOptions const & options)
+{
+    std::vector<WindowBins<T>> res;
+    for(auto const & w : windows)
+        res.emplace_back(w);
+    std::vector<std::vector<WindowBins<T>>> partials(options.getActualNumThreads());
+    int chunkCount = parallelForeachChunk(a, options,
+        [&](int chunk, ArrayViewND<N, T> const & part)
+        {
+            auto & bins = partials[chunk];
+            bins = res;
+            universalArrayNDFunction(part,
+                [&](T const & v)
+                {
+                    for(unsigned int k=0; k<windows.size(); ++k)
+                        if(windows[k].lo <= v && v <= windows[k].hi)
+                            bins[k].update(v);
+                }, "quantiles()");
+        });
+    for(int c=0; c<chunkCount; ++c)
+        for(unsigned int k=0; k<windows.size(); ++k)
+            res[k].merge(partials[c][k]);
+    return res;
+}
+
+    // copy the values of each window in a single pass over the array
+template <int N, class T>
+std::vector<std::vector<T>>
+collectWindows(ArrayViewND<N, T> const & a, std::vector<QuantileWindow<T>> const & windows,
+               ParallelOptions const & options)
+{
+    std::vector<std::vector<std::vector<T>>> partials(options.getActualNumThreads(),
+                                                      std::vector<std::vector<T>>(windows.size()));
+    int chunkCount = parallelForeachChunk(a, options,
+        [&](int chunk, ArrayViewND<N, T> const & part)
+        {
+            auto & values = partials[chunk];
+            universalArrayNDFunction(part,
+                [&](T const & v)
+                {
+                    for(unsigned int k=0; k<windows.size(); ++k)
+                        if(windows[k].lo <= v && v <= windows[k].hi)
+                            values[k].push_back(v);
+                }, "quantiles()");
+        });
+    std::vector<std::vector<T>> res(windows.size());
+    for(unsigned int k=0; k<windows.size(); ++k)
+    {
+        res[k].reserve(windows[k].count);
+        for(int c=0; c<chunkCount; ++c)
+            res[k].insert(res[k].end(), partials[c][k].begin(), partials[c][k].end());
+    }
+    return res;
+}
+
+} // namespace histogram_detail
+
+    /** \brief Compute exact quantiles of an array.
+
+        The quantiles \a q (in the range [0, 1]) are defined as in NumPy's default mode,
+        i.e. by linear interpolation between the neighboring order statistics.
+        A histogram identifies the bins that contain the required order statistics.
+        If the bins are not direct, further histogram passes restricted to the
+        selected bins narrow them down until they contain at most 2<sup>16</sup>
+        values. These values are copied, and <tt>std::nth_element()</tt> determines
+        the exact answer. Typically, a single refinement pass is needed, but
+        strongly skewed data (e.g. spanning many orders of magnitude) may require
+        more passes. Only if the values of a bin cannot be separated by
+        floating-point binning, more values are copied. NaN values are ignored.
+    */
+template <int N, class T>
+std::vector<double>
+quantiles(ArrayViewND<N, T> const & a, std::vector<double> const & q,
+          ParallelOptions const & options = ParallelOptions())
+{
+    typedef histogram_detail::QuantileWindow<T> Window;
+
+    static_assert(std::is_arithmetic<T>::value,
+        "quantiles(): array must have a scalar arithmetic value_type.");
+    vigra_precondition(a.size() > 0,
+        "quantiles(): array must not be empty.");
+    for(double p : q)
+        vigra_precondition(0.0 <= p && p <= 1.0,
+            "quantiles(): quantiles must be in the range [0, 1].");
+
+    Histogram<T> h;
+    std::vector<histogram_detail::WindowBins<T>> rootBins;
+    Window root;
+    if(std::is_integral<T>::value && sizeof(T) <= 2)
+    {
+        // direct binning over the type's range needs no preceding minmax() pass
+        h = histogram(a, (double)NumericTraits<T>::min(), (double)NumericTraits<T>::max(),
+                      (ArrayIndex)NumericTraits<T>::max() - (ArrayIndex)NumericTraits<T>::min() + 1,
+                      options);
+    }
+    else
+    {
+        auto range = minmax(a, options);
+        double lower = (double)range[0],
+               upper = (double)range[1];
+        vigra_precondition(lower <= upper,
+            "quantiles(): array must contain at least one valid (non-NaN) value.");
+        if(std::is_integral<T>::value && upper - lower < (double)(1 << 20))
+        {
+            h = histogram(a, lower, upper, (ArrayIndex)(upper - lower + 1.0), options);
+        }
+        else
+        {
+            root = Window{ range[0], range[1], 0, a.size(), true };
+            rootBins = histogram_detail::binWindows(a, std::vector<Window>(1, root), options);
+        }
+    }
+
+    // NaNs fall outside every bin and are ignored, so ranks refer to the histogram total
+    std::vector<ArrayIndex> const & counts = rootBins.empty()
+                                                 ? h.counts()
+                                                 : rootBins[0].counts;
+    ArrayIndex total = 0;
+    for(auto c : counts)
+        total += c;
+    vigra_precondition(total > 0,
+        "quantiles(): array must contain at least one valid (non-NaN) value.");
+
+    std::vector<ArrayIndex> ranks;
+    for(double p : q)
+    {
+        double r = p * (total - 1);
+        ranks.push_back((ArrayIndex)std::floor(r));
+        ranks.push_back((ArrayIndex)std::ceil(r));
+    }
+
+    std::vector<double> orderStatistics(ranks.size());
+    if(rootBins.empty())
+    {
+        // locate the direct bins containing the order statistics
+        std::vector<ArrayIndex> cumulative(counts.size() + 1, 0);
+        for(unsigned int k=0; k<counts.size(); ++k)
+            cumulative[k+1] = cumulative[k] + counts[k];
+        for(unsigned int k=0; k<ranks.size(); ++k)
+        {
+            ArrayIndex b = (ArrayIndex)(std::upper_bound(cumulative.begin(), cumulative.end(), ranks[k])
+                                         - cumulative.begin()) - 1;
+            vigra_invariant(0 <= b && b < (ArrayIndex)counts.size(),
+                "quantiles(): internal error: rank outside histogram.");
+            orderStatistics[k] = h.binLower(b);
+        }
+    }
+    else
+    {
+        // narrow down the bin of each rank until it is small enough to be
+        // copied, or its values cannot be separated
+        root.count = total;
+        std::vector<Window> windows;
+        for(auto r : ranks)
+            windows.push_back(rootBins[0].select(root, r));
+        auto needsRefinement = [](Window const & w)
+        {
+            return w.count > histogram_detail::quantileCollectLimit && w.lo < w.hi && w.splittable;
+        };
+        for(;;)
+        {
+            std::vector<Window> large;
+            for(auto const & w : windows)
+                if(needsRefinement(w) && std::find(large.begin(), large.end(), w) == large.end())
+                    large.push_back(w);
+            if(large.empty())
+                break;
+            auto bins = histogram_detail::binWindows(a, large, options);
+            for(unsigned int k=0; k<windows.size(); ++k)
+            {
+                auto i = std::find(large.begin(), large.end(), windows[k]);
+                if(i != large.end())
+                    windows[k] = bins[i - large.begin()].select(*i, ranks[k]);
+            }
+        }
+
+        // copy the values of the remaining windows and select the order statistics
+        std::vector<Window> selected;
+        for(auto const & w : windows)
+            if(w.lo < w.hi && std::find(selected.begin(), selected.end(), w) == selected.end())
+                selected.push_back(w);
+        auto values = histogram_detail::collectWindows(a, selected, options);
+        for(unsigned int k=0; k<ranks.size(); ++k)
+        {
+            Window const & w = windows[k];
+            if(w.lo == w.hi)
+            {
+                orderStatistics[k] = (double)w.lo;
+                continue;
+            }
+            auto & v = values[std::find(selected.begin(), selected.end(), w) - selected.begin()];
+            auto nth = v.begin() + (ranks[k] - w.below);
+            std::nth_element(v.begin(), nth, v.end());
+            orderStatistics[k] = (double)*nth;
+        }
+    }
+
+    std::vector<double> res(q.size());
+    for(unsigned int k=0; k<q.size(); ++k)
+    {
+        double r = q[k] * (total - 1),
+               f = r - std::floor(r);
+        res[k] = orderStatistics[2*k] + f * (orderStatistics[2*k+1] - orderStatistics[2*k]);
+    }
+    return res;
+}
+
+    /** \brief Compute a single exact quantile (see \ref quantiles()).
+    */
+template <int N, class T>
+double
+quantile(ArrayViewND<N, T> const & a, double q,
+         ParallelOptions const & options = ParallelOptions())
+{
+    return quantiles(a, std::vector<double>(1, q), options)[0];
+}
+
+    /** \brief Compute the exact median (see \ref quantiles()).
+    */
+template <int N, class T>
+double
+median(ArrayViewND<N, T> const & a, ParallelOptions const & options = ParallelOptions())
+{
+    return quantile(a, 0.5, options);
+}
+
+} // namespace vigra
+
+#endif // VIGRA2_HISTOGRAM_HXX
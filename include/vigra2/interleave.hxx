@@ -0,0 +1,490 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014-2017 by Ullrich Koethe                  */
+/*                                                                      */
+/*    This file is part of the VIGRA2 computer vision library.          */
+/*    The VIGRA2 Website is                                             */
+/*        http://ukoethe.github.io/vigra2                               */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#pragma once
+
+#ifndef VIGRA2_INTERLEAVE_HXX
+#define VIGRA2_INTERLEAVE_HXX
+
+#include "config.hxx"
+#include "error.hxx"
+#include "tinyarray.hxx"
+#include "axistags.hxx"
+#include "array_nd.hxx"
+#include "transpose.hxx"
+#include <algorithm>
+#include <cstdlib>
+#include <type_traits>
+
+#if defined(__SSE2__) && !defined(VIGRA_NO_SSE2)
+    #define VIGRA_INTERLEAVE_SSE2
+    #include <emmintrin.h>
+#endif
+
+namespace vigra {
+
+namespace interleave_detail {
+
+/********************************************************/
+/*                                                      */
+/*                    ChannelKernel                     */
+/*                                                      */
+/********************************************************/
+
+    // Convert 'n' pixels between interleaved layout (channel values of a pixel
+    // are adjacent) at 'pixels' and planar layout, where channel 'c' starts at
+    // 'planes + c*channelStride' (in bytes) and pixels are adjacent.
+    // The default implementation is a scalar loop with compile-time channel count.
+template <class T, int C, bool SIMD = false>
+struct ChannelKernel
+{
+    static void deinterleave(T const * pixels, char * planes, ArrayIndex channelStride,
+                             ArrayIndex n)
+    {
+        T * p[C];
+        for(int c = 0; c < C; ++c)
+            p[c] = reinterpret_cast<T *>(planes + c*channelStride);
+        for(ArrayIndex k = 0; k < n; ++k, pixels += C)
+            for(int c = 0; c < C; ++c)
+                p[c][k] = pixels[c];
+    }
+
+    static void interleave(char const * planes, ArrayIndex channelStride, T * pixels,
+                           ArrayIndex n)
+    {
+        T const * p[C];
+        for(int c = 0; c < C; ++c)
+            p[c] = reinterpret_cast<T const *>(planes + c*channelStride);
+        for(ArrayIndex k = 0; k < n; ++k, pixels += C)
+            for(int c = 0; c < C; ++c)
+                pixels[c] = p[c][k];
+    }
+};
+
+    // generic channel count
+template <class T>
+struct ChannelKernel<T, runtime_size, false>
+{
+    static void deinterleave(T const * pixels, char * planes, ArrayIndex channelStride,
+                             ArrayIndex n, int channels)
+    {
+        for(int c = 0; c < channels; ++c)
+        {
+            T * p = reinterpret_cast<T *>(planes + c*channelStride);
+            for(ArrayIndex k = 0; k < n; ++k)
+                p[k] = pixels[k*channels + c];
+        }
+    }
+
+    static void interleave(char const * planes, ArrayIndex channelStride, T * pixels,
+                           ArrayIndex n, int channels)
+    {
+        for(int c = 0; c < channels; ++c)
+        {
+            T const * p = reinterpret_cast<T const *>(planes + c*channelStride);
+            for(ArrayIndex k = 0; k < n; ++k)
+                pixels[k*channels + c] = p[k];
+        }
+    }
+};
+
+#ifdef VIGRA_INTERLEAVE_SSE2
+
+    // SSE2 kernels for 32-bit types, four pixels per iteration.
+    // The values are only moved, so that int32 data can use the float shuffles.
+template <int C>
+struct ChannelKernelSSE;
+
+template <>
+struct ChannelKernelSSE<2>
+{
+    static void deinterleave(float const * s, float ** p, ArrayIndex k)
+    {
+        __m128 a = _mm_loadu_ps(s),
+               b = _mm_loadu_ps(s + 4);
+        _mm_storeu_ps(p[0] + k, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2,0,2,0)));
+        _mm_storeu_ps(p[1] + k, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3,1,3,1)));
+    }
+
+    static void interleave(float const ** p, ArrayIndex k, float * d)
+    {
+        __m128 x = _mm_loadu_ps(p[0] + k),
+               y = _mm_loadu_ps(p[1] + k);
+        _mm_storeu_ps(d,     _mm_unpacklo_ps(x, y));
+        _mm_storeu_ps(d + 4, _mm_unpackhi_ps(x, y));
+    }
+};
+
+template <>
+struct ChannelKernelSSE<3>
+{
+    static void deinterleave(float const * s, float ** p, ArrayIndex k)
+    {
+        // a = (r0 g0 b0 r1), b = (g1 b1 r2 g2), c = (b2 r3 g3 b3)
+        __m128 a = _mm_loadu_ps(s),
+               b = _mm_loadu_ps(s + 4),
+               c = _mm_loadu_ps(s + 8);
+        __m128 r = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1,1,2,2)), _MM_SHUFFLE(2,0,3,0)),
+               g = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0,0,1,1)),
+                                  _mm_shuffle_ps(b, c, _MM_SHUFFLE(2,2,3,3)), _MM_SHUFFLE(2,0,2,0)),
+               bl = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1,1,2,2)),
+                                   _mm_shuffle_ps(c, c, _MM_SHUFFLE(3,3,0,0)), _MM_SHUFFLE(2,0,2,0));
+        _mm_storeu_ps(p[0] + k, r);
+        _mm_storeu_ps(p[1] + k, g);
+        _mm_storeu_ps(p[2] + k, bl);
+    }
+
+    static void interleave(float const ** p, ArrayIndex k, float * d)
+    {
+        __m128 r = _mm_loadu_ps(p[0] + k),
+               g = _mm_loadu_ps(p[1] + k),
+               b = _mm_loadu_ps(p[2] + k);
+        _mm_storeu_ps(d,     _mm_shuffle_ps(_mm_shuffle_ps(r, g, _MM_SHUFFLE(0,0,0,0)),
+                                            _mm_shuffle_ps(b, r, _MM_SHUFFLE(1,1,0,0)), _MM_SHUFFLE(2,0,2,0)));
+        _mm_storeu_ps(d + 4, _mm_shuffle_ps(_mm_shuffle_ps(g, b, _MM_SHUFFLE(1,1,1,1)),
+                                            _mm_shuffle_ps(r, g, _MM_SHUFFLE(2,2,2,2)), _MM_SHUFFLE(2,0,2,0)));
+        _mm_storeu_ps(d + 8, _mm_shuffle_ps(_mm_shuffle_ps(b, r, _MM_SHUFFLE(3,3,2,2)),
+                                            _mm_shuffle_ps(g, b, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(2,0,2,0)));
+    }
+};
+
+template <>
+struct ChannelKernelSSE<4>
+{
+    static void deinterleave(float const * s, float ** p, ArrayIndex k)
+    {
+        __m128 r0 = _mm_loadu_ps(s),
+               r1 = _mm_loadu_ps(s + 4),
+               r2 = _mm_loadu_ps(s + 8),
+               r3 = _mm_loadu_ps(s + 12);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _mm_storeu_ps(p[0] + k, r0);
+        _mm_storeu_ps(p[1] + k, r1);
+        _mm_storeu_ps(p[2] + k, r2);
+        _mm_storeu_ps(p[3] + k, r3);
+    }
+
+    static void interleave(float const ** p, ArrayIndex k, float * d)
+    {
+        __m128 r0 = _mm_loadu_ps(p[0] + k),
+               r1 = _mm_loadu_ps(p[1] + k),
+               r2 = _mm_loadu_ps(p[2] + k),
+               r3 = _mm_loadu_ps(p[3] + k);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _mm_storeu_ps(d,      r0);
+        _mm_storeu_ps(d + 4,  r1);
+        _mm_storeu_ps(d + 8,  r2);
+        _mm_storeu_ps(d + 12, r3);
+    }
+};
+
+template <class T, int C>
+struct ChannelKernel<T, C, true>
+{
+    static void deinterleave(T const * pixels, char * planes, ArrayIndex channelStride,
+                             ArrayIndex n)
+    {
+        float * p[C];
+        for(int c = 0; c < C; ++c)
+            p[c] = reinterpret_cast<float *>(planes + c*channelStride);
+        float const * s = reinterpret_cast<float const *>(pixels);
+        ArrayIndex k = 0;
+        for(; k + 4 <= n; k += 4, s += 4*C)
+            ChannelKernelSSE<C>::deinterleave(s, p, k);
+        ChannelKernel<T, C>::deinterleave(pixels + k*C, planes + k*sizeof(T), channelStride, n - k);
+    }
+
+    static void interleave(char const * planes, ArrayIndex channelStride, T * pixels,
+                           ArrayIndex n)
+    {
+        float const * p[C];
+        for(int c = 0; c < C; ++c)
+            p[c] = reinterpret_cast<float const *>(planes + c*channelStride);
+        float * d = reinterpret_cast<float *>(pixels);
+        ArrayIndex k = 0;
+        for(; k + 4 <= n; k += 4, d += 4*C)
+            ChannelKernelSSE<C>::interleave(p, k, d);
+        ChannelKernel<T, C>::interleave(planes + k*sizeof(T), channelStride, pixels + k*C, n - k);
+    }
+};
+
+template <class T, int C>
+struct UseChannelKernelSSE
+{
+    static const bool value = sizeof(T) == 4 && std::is_trivially_copyable<T>::value &&
+                              2 <= C && C <= 4;
+};
+
+#else
+
+template <class T, int C>
+struct UseChannelKernelSSE
+{
+    static const bool value = false;
+};
+
+#endif // VIGRA_INTERLEAVE_SSE2
+
+template <class T, int C>
+struct ChannelKernelFor
+: public ChannelKernel<T, C, UseChannelKernelSSE<T, C>::value>
+{};
+
+template <class T>
+void
+deinterleavePixels(T const * pixels, char * planes, ArrayIndex channelStride,
+                   ArrayIndex n, int channels)
+{
+    switch(channels)
+    {
+      case 2:
+        ChannelKernelFor<T, 2>::deinterleave(pixels, planes, channelStride, n);
+        break;
+      case 3:
+        ChannelKernelFor<T, 3>::deinterleave(pixels, planes, channelStride, n);
+        break;
+      case 4:
+        ChannelKernelFor<T, 4>::deinterleave(pixels, planes, channelStride, n);
+        break;
+      default:
+        ChannelKernel<T, runtime_size>::deinterleave(pixels, planes, channelStride, n, channels);
+    }
+}
+
+template <class T>
+void
+interleavePixels(char const * planes, ArrayIndex channelStride, T * pixels,
+                 ArrayIndex n, int channels)
+{
+    switch(channels)
+    {
+      case 2:
+        ChannelKernelFor<T, 2>::interleave(planes, channelStride, pixels, n);
+        break;
+      case 3:
+        ChannelKernelFor<T, 3>::interleave(planes, channelStride, pixels, n);
+        break;
+      case 4:
+        ChannelKernelFor<T, 4>::interleave(planes, channelStride, pixels, n);
+        break;
+      default:
+        ChannelKernel<T, runtime_size>::interleave(planes, channelStride, pixels, n, channels);
+    }
+}
+
+/********************************************************/
+/*                                                      */
+/*                   layout detection                   */
+/*                                                      */
+/********************************************************/
+
+    // Check if the pixels (all axes except 'c') are a flat sequence with
+    // the given element stride, when the axes are traversed in 'order'
+    // (outermost first). Singleton axes are ignored.
+template <int N>
+bool
+pixelsAreFlat(Shape<N> const & shape, Shape<N> const & strides,
+              Shape<runtime_size> const & order, ArrayIndex step)
+{
+    for(int k = order.size() - 1; k >= 0; --k)
+    {
+        int a = order[k];
+        if(shape[a] == 1)
+            continue;
+        if(strides[a] != step)
+            return false;
+        step *= shape[a];
+    }
+    return true;
+}
+
+    // pixel axes sorted by decreasing absolute stride
+template <int N>
+Shape<runtime_size>
+pixelOrder(Shape<N> const & strides, int c)
+{
+    Shape<runtime_size> res = Shape<runtime_size>::range(strides.size()).erase(c);
+    std::sort(res.begin(), res.end(),
+              [&strides](ArrayIndex l, ArrayIndex r)
+              {
+                  return std::abs(strides[r]) < std::abs(strides[l]);
+              });
+    return res;
+}
+
+    // Returns true if 'interleaved' has consecutive pixels with adjacent channels,
+    // and 'planar' has the same pixel order with consecutive pixels in each channel.
+template <class T>
+bool
+isInterleavedPlanarPair(ArrayViewND<runtime_size, T> const & interleaved,
+                        ArrayViewND<runtime_size, T> const & planar, int c)
+{
+    auto const & shape = interleaved.shape();
+    if(interleaved.byte_strides(c) != (ArrayIndex)sizeof(T))
+        return false;
+    auto order = pixelOrder(interleaved.byte_strides(), c);
+    return pixelsAreFlat(shape, interleaved.byte_strides(), order, shape[c]*sizeof(T)) &&
+           pixelsAreFlat(shape, planar.byte_strides(), order, sizeof(T));
+}
+
+} // namespace interleave_detail
+
+/********************************************************/
+/*                                                      */
+/*                    copyChannels()                    */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Copy a multiband array into another one with possibly
+        different channel layout.
+
+        Both arrays must have an axis tagged as channel axis (see
+        <tt>ArrayViewND::channelAxis()</tt>). The source's channel axis is moved
+        to the position of the destination's channel axis (as in
+        <tt>src.ensureChannelAxis(dest.channelAxis())</tt>), and the remaining
+        shapes must agree. When one array is interleaved (channel axis
+        consecutive, pixels adjacent) and the other is planar (each channel
+        consecutive) with the same pixel order, the data are converted by
+        dedicated kernels, which use SSE2 shuffles for 32-bit types with 2, 3,
+        or 4 channels. Otherwise, the function falls back to
+        <tt>transposeCopy()</tt>.
+        \code
+        ArrayND<3, float> rgb(Shape3(h, w, 3));      // channel-last (interleaved)
+        rgb.setChannelAxis(2);
+        ArrayND<3, float> planes(Shape3(3, h, w));   // channel-first (planar)
+        planes.setChannelAxis(0);
+
+        copyChannels(rgb, planes);
+        \endcode
+    */
+template <int N, class T>
+void
+copyChannels(ArrayViewND<N, T> const & src, ArrayViewND<N, T> dest)
+{
+    using namespace interleave_detail;
+
+    int c = dest.channelAxis();
+    vigra_precondition(src.hasChannelAxis() && c != tags::axis_missing,
+        "copyChannels(): source and destination must have a channel axis.");
+
+    ArrayViewND<runtime_size, T> s = src.ensureChannelAxis(c),
+                                 d(dest);
+    vigra_precondition(s.shape() == d.shape(),
+        "copyChannels(): shape mismatch.");
+    if(d.size() == 0)
+        return;
+
+    if(array_detail::checkMemoryOverlap(d.memoryRange(), s) == array_detail::NoMemoryOverlap)
+    {
+        int channels = (int)d.shape(c);
+        ArrayIndex n = d.size() / channels;
+        if(isInterleavedPlanarPair(s, d, c))
+        {
+            deinterleavePixels(s.data(), (char *)d.data(), d.byte_strides(c), n, channels);
+            return;
+        }
+        if(isInterleavedPlanarPair(d, s, c))
+        {
+            interleavePixels((char const *)s.data(), s.byte_strides(c), d.data(), n, channels);
+            return;
+        }
+    }
+    transposeCopy(s, d, Shape<runtime_size>::range(d.ndim()));
+}
+
+/********************************************************/
+/*                                                      */
+/*              deinterleave() / interleave()           */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Copy an array of vector-valued pixels into a scalar multiband array.
+
+        The channels of \a src's <tt>TinyArray</tt> elements are written to
+        the channel axis of \a dest. If \a dest has no axis tagged as channel
+        axis, axis 0 is used (i.e. channel-first, planar layout). The remaining
+        axes of \a dest must have the shape of \a src.
+        \code
+        ArrayND<2, TinyArray<float, 3>> rgb(Shape2(h, w));
+        ArrayND<3, float> planes(Shape3(3, h, w));
+
+        deinterleave(rgb, planes);   // planes(c, y, x) = rgb(y, x)[c]
+        \endcode
+        See <tt>copyChannels()</tt> for the conditions under which SIMD
+        kernels are used.
+    */
+template <int N, class T, int C, int M>
+void
+deinterleave(ArrayViewND<N, TinyArray<T, C>> const & src, ArrayViewND<M, T> dest)
+{
+    static_assert(N == runtime_size || M == runtime_size || M == N+1,
+        "deinterleave(): dest.ndim() must be src.ndim() + 1.");
+    vigra_precondition(dest.ndim() == src.ndim() + 1,
+        "deinterleave(): dest.ndim() must be src.ndim() + 1.");
+    if(!dest.hasChannelAxis())
+        dest.setChannelAxis(0);
+    ArrayViewND<runtime_size, T> s = src.expandElements(src.ndim());
+    copyChannels(s, ArrayViewND<runtime_size, T>(dest));
+}
+
+    /** \brief Copy a scalar multiband array into an array of vector-valued pixels.
+
+        This is the inverse of <tt>deinterleave()</tt>: the channel axis of
+        \a src (axis 0 if no axis is tagged as channel axis) becomes the
+        <tt>TinyArray</tt> element of \a dest.
+        \code
+        ArrayND<3, float> planes(Shape3(3, h, w));
+        ArrayND<2, TinyArray<float, 3>> rgb(Shape2(h, w));
+
+        interleave(planes, rgb);     // rgb(y, x)[c] = planes(c, y, x)
+        \endcode
+    */
+template <int M, class T, int N, int C>
+void
+interleave(ArrayViewND<M, T> const & src, ArrayViewND<N, TinyArray<T, C>> dest)
+{
+    static_assert(N == runtime_size || M == runtime_size || M == N+1,
+        "interleave(): src.ndim() must be dest.ndim() + 1.");
+    vigra_precondition(src.ndim() == dest.ndim() + 1,
+        "interleave(): src.ndim() must be dest.ndim() + 1.");
+    ArrayViewND<runtime_size, T> s(src);
+    if(!s.hasChannelAxis())
+        s.setChannelAxis(0);
+    copyChannels(s, ArrayViewND<runtime_size, T>(dest.expandElements(dest.ndim())));
+}
+
+} // namespace vigra
+
+#endif // VIGRA2_INTERLEAVE_HXX
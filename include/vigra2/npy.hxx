@@ -0,0 +1,1107 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014-2017 by Ullrich Koethe                  */
+/*                                                                      */
+/*    This file is part of the VIGRA2 computer vision library.          */
+/*    The VIGRA2 Website is                                             */
+/*        http://ukoethe.github.io/vigra2                               */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#pragma once
+
+#ifndef VIGRA2_NPY_HXX
+#define VIGRA2_NPY_HXX
+
+#include "config.hxx"
+#include "error.hxx"
+#include "numeric_traits.hxx"
+#include "tinyarray.hxx"
+#include "array_nd.hxx"
+#include "array_file.hxx"
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace vigra {
+
+/********************************************************/
+/*                                                      */
+/*                       NpyInfo                        */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Contents of the header of a NumPy <tt>.npy</tt> file.
+
+        Arrays of <tt>TinyArray&lt;T, C&gt;</tt> elements correspond to
+        <tt>.npy</tt> arrays whose last axis has length <tt>C</tt>.
+    */
+struct NpyInfo
+{
+        /** Format version (1, 2, or 3).
+        */
+    int version;
+
+        /** NumPy type descriptor, e.g. <tt>"&lt;f4"</tt>.
+        */
+    std::string descr;
+
+        /** Byte order ('<', '>', or '|' for single-byte types), element kind
+            ('b', 'i', 'u', 'f', or 'c', see <tt>ElementTypeCode</tt>), and
+            size of a scalar in bytes.
+        */
+    char byteorder, kind;
+    int itemsize;
+
+        /** Storage order of the data (F-order if true, C-order otherwise).
+        */
+    bool fortranOrder;
+
+        /** Shape of the stored array (zero-dimensional arrays are reported
+            as shape <tt>(1,)</tt>).
+        */
+    Shape<runtime_size> shape;
+
+        /** Position and size of the data in the file.
+        */
+    std::size_t dataOffset, dataSize;
+
+    int ndim() const
+    {
+        return (int)shape.size();
+    }
+
+    bool isNativeByteOrder() const
+    {
+        return byteorder == '|' || (byteorder == '<') == detail::isLittleEndian();
+    }
+
+        /** Check if the file's elements are of type \a T.
+        */
+    template <class T>
+    bool hasElementType() const
+    {
+        typedef ElementTypeCode<T> Code;
+        return kind == Code::kind && itemsize == Code::itemsize &&
+               (Code::channels == 1 || (ndim() > 1 && shape[ndim()-1] == Code::channels));
+    }
+};
+
+namespace npy_detail {
+
+using array_file_detail::File;
+
+static const char magic[6] = { '\x93', 'N', 'U', 'M', 'P', 'Y' };
+static const std::size_t headerAlignment = 64;
+
+template <class T>
+struct Channels
+{
+    typedef T scalar_type;
+};
+
+template <class T, int C>
+struct Channels<TinyArray<T, C>>
+{
+    typedef T scalar_type;
+};
+
+    // little-endian integers (used by the .npy prefix and by zip records)
+inline void
+putLE(std::string & s, std::uint64_t v, int bytes)
+{
+    for(int k=0; k<bytes; ++k)
+        s += (char)((v >> (8*k)) & 0xFF);
+}
+
+inline std::uint64_t
+getLE(char const * p, int bytes)
+{
+    std::uint64_t v = 0;
+    for(int k=bytes-1; k>=0; --k)
+        v = (v << 8) | (std::uint8_t)p[k];
+    return v;
+}
+
+inline void
+byteSwap(char * data, std::size_t size, int swapsize)
+{
+    if(swapsize == 1)
+        return;
+    for(std::size_t k = 0; k < size; k += swapsize)
+        std::reverse(data + k, data + k + swapsize);
+}
+
+    // parser for the Python dict literal in the .npy header
+class HeaderParser
+{
+  public:
+    HeaderParser(std::string const & s, std::string const & function)
+    : s_(s)
+    , p_(0)
+    , function_(function)
+    {}
+
+    bool accept(char c)
+    {
+        skipSpace();
+        if(p_ < s_.size() && s_[p_] == c)
+        {
+            ++p_;
+            return true;
+        }
+        return false;
+    }
+
+    void expect(char c)
+    {
+        if(!accept(c))
+            fail();
+    }
+
+    bool peek(char c)
+    {
+        skipSpace();
+        return p_ < s_.size() && s_[p_] == c;
+    }
+
+    std::string parseString()
+    {
+        skipSpace();
+        if(p_ >= s_.size() || (s_[p_] != '\'' && s_[p_] != '"'))
+            fail();
+        std::size_t end = s_.find(s_[p_], p_+1);
+        if(end == std::string::npos)
+            fail();
+        std::string res = s_.substr(p_+1, end-p_-1);
+        p_ = end + 1;
+        return res;
+    }
+
+    bool parseBool()
+    {
+        skipSpace();
+        if(s_.compare(p_, 4, "True") == 0)
+        {
+            p_ += 4;
+            return true;
+        }
+        if(s_.compare(p_, 5, "False") != 0)
+            fail();
+        p_ += 5;
+        return false;
+    }
+
+    Shape<runtime_size> parseShape()
+    {
+        std::vector<ArrayIndex> res;
+        expect('(');
+        while(!accept(')'))
+        {
+            skipSpace();
+            std::size_t start = p_;
+            while(p_ < s_.size() && std::isdigit((unsigned char)s_[p_]))
+                ++p_;
+            if(p_ == start || p_ - start > 18)
+                fail();
+            res.push_back(std::stoll(s_.substr(start, p_ - start)));
+            accept('L');
+            if(!accept(','))
+            {
+                expect(')');
+                break;
+            }
+        }
+        return Shape<runtime_size>(res.begin(), res.end());
+    }
+
+    void fail() const
+    {
+        vigra_fail(function_ + ": corrupt header.");
+    }
+
+  private:
+    void skipSpace()
+    {
+        while(p_ < s_.size() && std::isspace((unsigned char)s_[p_]))
+            ++p_;
+    }
+
+    std::string const & s_;
+    std::size_t p_;
+    std::string function_;
+};
+
+inline void
+parseHeader(std::string const & header, NpyInfo & info, std::string const & function)
+{
+    HeaderParser p(header, function);
+    bool haveDescr = false, haveOrder = false, haveShape = false;
+    p.expect('{');
+    while(!p.accept('}'))
+    {
+        std::string key = p.parseString();
+        p.expect(':');
+        if(key == "descr")
+        {
+            vigra_precondition(!p.peek('['),
+                function + ": structured dtypes are not supported.");
+            info.descr = p.parseString();
+            haveDescr = true;
+        }
+        else if(key == "fortran_order")
+        {
+            info.fortranOrder = p.parseBool();
+            haveOrder = true;
+        }
+        else if(key == "shape")
+        {
+            info.shape = p.parseShape();
+            haveShape = true;
+        }
+        else
+        {
+            p.fail();
+        }
+        if(!p.accept(','))
+        {
+            p.expect('}');
+            break;
+        }
+    }
+    if(!haveDescr || !haveOrder || !haveShape)
+        p.fail();
+
+    // descr is <byte order><kind><item size>, e.g. '<f4'
+    std::string const & d = info.descr;
+    bool valid = d.size() >= 3 && d.size() <= 5 &&
+                 std::strchr("<>|=", d[0]) != 0 && std::strchr("biufc", d[1]) != 0;
+    for(std::size_t k = 2; k < d.size(); ++k)
+        valid = valid && std::isdigit((unsigned char)d[k]);
+    vigra_precondition(valid,
+        function + ": unsupported dtype '" + d + "'.");
+    info.byteorder = d[0] == '='
+                        ? (detail::isLittleEndian() ? '<' : '>')
+                        : d[0];
+    info.kind = d[1];
+    info.itemsize = std::stoi(d.substr(2));
+}
+
+    // read the header of the .npy data at 'offset' in 'file', which may
+    // extend over 'available' bytes (the file size or size of a zip member)
+inline NpyInfo
+readHeader(File & file, std::size_t offset, std::size_t available, std::string const & function)
+{
+    char prefix[12];
+    vigra_precondition(available >= 10,
+        function + ": not a .npy file.");
+    file.read(prefix, 10, offset);
+    vigra_precondition(std::memcmp(prefix, magic, 6) == 0,
+        function + ": not a .npy file.");
+
+    NpyInfo info;
+    info.version = (std::uint8_t)prefix[6];
+    std::size_t prefixSize = 10, headerSize = 0;
+    if(info.version == 1)
+    {
+        headerSize = getLE(prefix + 8, 2);
+    }
+    else
+    {
+        vigra_precondition(info.version == 2 || info.version == 3,
+            function + ": unsupported .npy format version.");
+        prefixSize = 12;
+        if(available < prefixSize)
+            vigra_fail(function + ": corrupt header.");
+        file.read(prefix + 10, 2, offset + 10);
+        headerSize = getLE(prefix + 8, 4);
+    }
+    if(prefixSize + headerSize > available)
+        vigra_fail(function + ": corrupt header.");
+
+    std::string header(headerSize, '\0');
+    file.read(&header[0], headerSize, offset + prefixSize);
+    parseHeader(header, info, function);
+    if(info.ndim() == 0)
+        info.shape = Shape<runtime_size>{ 1 };
+
+    info.dataOffset = offset + prefixSize + headerSize;
+
+    // compare each partial product with the available bytes, so that the
+    // data size of a corrupt shape cannot overflow
+    vigra_precondition(info.itemsize > 0,
+        function + ": unsupported dtype '" + info.descr + "'.");
+    std::size_t dataBytes = available - prefixSize - headerSize;
+    info.dataSize = std::find(info.shape.begin(), info.shape.end(), 0) == info.shape.end()
+                        ? (std::size_t)info.itemsize
+                        : 0;
+    for(int k=0; k<info.ndim() && info.dataSize > 0; ++k)
+    {
+        vigra_precondition((std::size_t)info.shape[k] <= dataBytes / info.dataSize,
+            function + ": file is truncated.");
+        info.dataSize *= (std::size_t)info.shape[k];
+    }
+    vigra_precondition(info.dataSize <= dataBytes,
+        function + ": file is truncated.");
+    return info;
+}
+
+template <int N, class T>
+void
+checkElementType(NpyInfo const & info, std::string const & function)
+{
+    typedef ElementTypeCode<T> Code;
+    static_assert(Code::kind != 0,
+        "npy: unsupported element type.");
+    static_assert(ElementTypeCode<typename Channels<T>::scalar_type>::channels == 1,
+        "npy: element type must be a scalar or a TinyArray of scalars.");
+
+    vigra_precondition(info.hasElementType<T>(),
+        function + ": element type mismatch.");
+    int ndim = info.ndim() - (Code::channels > 1 ? 1 : 0);
+    vigra_precondition(N == runtime_size || N == ndim,
+        function + ": dimension mismatch.");
+}
+
+inline int
+swapSize(NpyInfo const & info)
+{
+    return info.kind == 'c'
+               ? info.itemsize / 2
+               : info.itemsize;
+}
+
+inline void
+readBytes(File & file, NpyInfo const & info, char * dest)
+{
+    file.read(dest, info.dataSize, info.dataOffset);
+    if(!info.isNativeByteOrder())
+        byteSwap(dest, info.dataSize, swapSize(info));
+}
+
+    // Fortran-order data with vector elements: the channel axis is the
+    // outermost axis, read into a scalar array and interleave
+template <int N, class T>
+void
+readChannelsLast(File & file, NpyInfo const & info, ArrayND<N, T> & res, std::true_type)
+{
+    typedef typename Channels<T>::scalar_type S;
+    ArrayND<runtime_size, S> tmp(info.shape, F_ORDER);
+    readBytes(file, info, (char *)tmp.data());
+    ArrayViewND<runtime_size, S> v = res.expandElements(res.ndim());
+    v = tmp;
+}
+
+template <int N, class T>
+void
+readChannelsLast(File &, NpyInfo const &, ArrayND<N, T> &, std::false_type)
+{}
+
+template <int N, class T>
+ArrayND<N, T>
+readData(File & file, NpyInfo const & info, std::string const & function)
+{
+    checkElementType<N, T>(info, function);
+
+    static const bool hasChannels = ElementTypeCode<T>::channels > 1;
+    typedef typename ArrayND<N, T>::difference_type Shp;
+    Shp shape(info.shape.begin(), info.shape.begin() + info.ndim() - (hasChannels ? 1 : 0));
+    if(hasChannels && info.fortranOrder)
+    {
+        ArrayND<N, T> res(shape);
+        readChannelsLast(file, info, res, std::integral_constant<bool, hasChannels>());
+        return res;
+    }
+
+    ArrayND<N, T> res(shape, info.fortranOrder ? F_ORDER : C_ORDER);
+    readBytes(file, info, (char *)res.data());
+    return res;
+}
+
+    // F-order files are only written for scalar F-order arrays,
+    // everything else is written in C-order
+template <int N, class T>
+bool
+useFortranOrder(ArrayViewND<N, T> const & a)
+{
+    return ElementTypeCode<T>::channels == 1 && a.ndim() > 1 &&
+           !array_detail::isOrdered(a, C_ORDER) && array_detail::isOrdered(a, F_ORDER);
+}
+
+    // prefix and header of a .npy file (native byte order), padded with
+    // spaces such that the data start at a multiple of 64 bytes
+template <int N, class T>
+std::string
+encodeHeader(ArrayViewND<N, T> const & a, bool fortranOrder)
+{
+    typedef ElementTypeCode<T> Code;
+    static_assert(Code::kind != 0,
+        "npy: unsupported element type.");
+    static_assert(ElementTypeCode<typename Channels<T>::scalar_type>::channels == 1,
+        "npy: element type must be a scalar or a TinyArray of scalars.");
+
+    std::string dict("{'descr': '");
+    dict += Code::itemsize == 1
+                ? '|'
+                : detail::isLittleEndian() ? '<' : '>';
+    dict += Code::kind + std::to_string(Code::itemsize);
+    dict += "', 'fortran_order': ";
+    dict += fortranOrder ? "True" : "False";
+    dict += ", 'shape': (";
+    for(int k=0; k<a.ndim(); ++k)
+        dict += (k > 0 ? ", " : "") + std::to_string(a.shape(k));
+    if(Code::channels > 1)
+        dict += ", " + std::to_string(Code::channels);
+    else if(a.ndim() == 1)
+        dict += ",";
+    dict += "), }";
+
+    std::size_t prefixSize = 10;
+    if(prefixSize + dict.size() + headerAlignment > 0xFFFF)
+        prefixSize = 12;
+    std::size_t headerSize = prefixSize + dict.size() + 1;
+    headerSize = (headerSize + headerAlignment - 1) / headerAlignment * headerAlignment - prefixSize;
+    dict.resize(headerSize - 1, ' ');
+    dict += '\n';
+
+    std::string res(magic, 6);
+    res += (char)(prefixSize == 10 ? 1 : 2);
+    res += '\0';
+    putLE(res, headerSize, prefixSize - 8);
+    return res + dict;
+}
+
+} // namespace npy_detail
+
+/********************************************************/
+/*                                                      */
+/*          readNpyInfo() / readNpy() / writeNpy()      */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Read the header of a NumPy <tt>.npy</tt> file.
+    */
+inline NpyInfo
+readNpyInfo(std::string const & filename)
+{
+    npy_detail::File file(filename, O_RDONLY, "readNpyInfo()");
+    return npy_detail::readHeader(file, 0, file.size(), "readNpyInfo()");
+}
+
+    /** \brief Read a NumPy <tt>.npy</tt> file into an <tt>ArrayND</tt>.
+
+        Format versions 1 to 3 are supported. The element type \a T must
+        match the file's dtype (e.g. <tt>float</tt> for <tt>'&lt;f4'</tt>),
+        and \a N must equal the file's dimension (<tt>N = runtime_size</tt>
+        accepts any dimension). For <tt>TinyArray&lt;T, C&gt;</tt> elements,
+        the file's last axis must have length <tt>C</tt> and is mapped to the
+        element. Fortran-order files result in F-order arrays (except for
+        <tt>TinyArray</tt> elements, which are always C-order), and data
+        in non-native byte order are swapped while reading.
+        \code
+        ArrayND<3, float> volume = readNpy<3, float>("volume.npy");
+        ArrayND<2, TinyArray<std::uint8_t, 3>> rgb =
+                              readNpy<2, TinyArray<std::uint8_t, 3>>("rgb.npy");
+        \endcode
+    */
+template <int N, class T>
+ArrayND<N, T>
+readNpy(std::string const & filename)
+{
+    npy_detail::File file(filename, O_RDONLY, "readNpy()");
+    NpyInfo info = npy_detail::readHeader(file, 0, file.size(), "readNpy()");
+    return npy_detail::readData<N, T>(file, info, "readNpy()");
+}
+
+    /** \brief Write an array to a NumPy <tt>.npy</tt> file.
+
+        Arrays consecutive in C-order (or, for scalar elements, in F-order)
+        are written directly from memory with the corresponding
+        <tt>fortran_order</tt> flag, other arrays are copied into C-order
+        block by block. Data are written in native byte order, and the
+        header is padded such that the data start at a multiple of 64 bytes
+        (so that <tt>MappedNpyArrayND</tt> and <tt>numpy.load(..., mmap_mode='r')</tt>
+        yield aligned arrays). <tt>TinyArray&lt;T, C&gt;</tt> elements
+        become an additional last axis of length <tt>C</tt>.
+    */
+template <int N, class T>
+void
+writeNpy(std::string const & filename, ArrayViewND<N, T> const & a)
+{
+    using namespace npy_detail;
+
+    bool fortranOrder = useFortranOrder(a);
+    std::string header = encodeHeader(a, fortranOrder);
+    File file(filename, O_WRONLY | O_CREAT | O_TRUNC, "writeNpy()");
+    file.write(header.data(), header.size(), 0);
+    array_file_detail::writeData(file, a, header.size(), fortranOrder || array_detail::isOrdered(a, C_ORDER));
+}
+
+/********************************************************/
+/*                                                      */
+/*                       NpzFile                        */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Read access to the members of an uncompressed NumPy <tt>.npz</tt> file.
+
+        A <tt>.npz</tt> file is a zip archive of <tt>.npy</tt> files, as written
+        by <tt>numpy.savez()</tt> or <tt>NpzWriter</tt>. The constructor reads
+        the archive's central directory (including ZIP64 extensions). Members
+        are addressed by their name without the <tt>.npy</tt> suffix. Compressed
+        members (<tt>numpy.savez_compressed()</tt>) are not supported.
+        \code
+        NpzFile npz("results.npz");
+        for(auto const & name : npz.names())
+            std::cout << name << ": " << npz.info(name).shape << "\n";
+
+        ArrayND<2, float> weights = npz.read<2, float>("weights");
+        MappedNpyArrayND<3, float> volume(npz, "volume");  // zero-copy
+        \endcode
+    */
+class NpzFile
+{
+  public:
+    explicit
+    NpzFile(std::string const & filename)
+    : filename_(filename)
+    {
+        npy_detail::File file(filename, O_RDONLY, "NpzFile()");
+        readDirectory(file);
+    }
+
+    std::string const & filename() const
+    {
+        return filename_;
+    }
+
+        /** Names of the members in file order.
+        */
+    std::vector<std::string> names() const
+    {
+        std::vector<std::string> res;
+        for(auto const & m : members_)
+            res.push_back(m.name);
+        return res;
+    }
+
+    bool contains(std::string const & name) const
+    {
+        for(auto const & m : members_)
+            if(m.name == name)
+                return true;
+        return false;
+    }
+
+        /** The header of member \a name.
+        */
+    NpyInfo info(std::string const & name) const
+    {
+        npy_detail::File file(filename_, O_RDONLY, "NpzFile::info()");
+        return memberInfo(file, name, "NpzFile::info()");
+    }
+
+        /** Read member \a name into an <tt>ArrayND</tt> (see <tt>readNpy()</tt>).
+        */
+    template <int N, class T>
+    ArrayND<N, T> read(std::string const & name) const
+    {
+        npy_detail::File file(filename_, O_RDONLY, "NpzFile::read()");
+        NpyInfo info = memberInfo(file, name, "NpzFile::read()");
+        return npy_detail::readData<N, T>(file, info, "NpzFile::read()");
+    }
+
+  private:
+    template <int M, class U>
+    friend class MappedNpyArrayND;
+
+    struct Member
+    {
+        std::string name;
+        std::uint64_t offset, size;
+        unsigned int method, flags;
+    };
+
+    void corrupt() const
+    {
+        vigra_fail("NpzFile(): corrupt zip file '" + filename_ + "'.");
+    }
+
+    void readDirectory(npy_detail::File & file)
+    {
+        using npy_detail::getLE;
+
+        // find the end of central directory record (followed by a comment of at most 64k)
+        std::size_t fileSize = file.size(),
+                    tail = std::min<std::size_t>(fileSize, 22 + 0xFFFF);
+        vigra_precondition(fileSize >= 22,
+            "NpzFile(): not a zip file.");
+        std::string buffer(tail, '\0');
+        file.read(&buffer[0], tail, fileSize - tail);
+        std::ptrdiff_t pos = tail - 22;
+        while(pos >= 0 && getLE(&buffer[pos], 4) != 0x06054b50)
+            --pos;
+        vigra_precondition(pos >= 0,
+            "NpzFile(): not a zip file.");
+
+        char const * end = &buffer[pos];
+        std::uint64_t count = getLE(end + 10, 2),
+                      directorySize = getLE(end + 12, 4),
+                      directoryOffset = getLE(end + 16, 4);
+        if(count == 0xFFFF || directorySize == 0xFFFFFFFF || directoryOffset == 0xFFFFFFFF)
+        {
+            // ZIP64: the locator precedes the end record and points to the ZIP64 end record
+            std::size_t endOffset = fileSize - tail + pos;
+            char locator[20], record[56];
+            if(endOffset < 20)
+                corrupt();
+            file.read(locator, 20, endOffset - 20);
+            std::uint64_t recordOffset = getLE(locator + 8, 8);
+            if(getLE(locator, 4) != 0x07064b50 || recordOffset > endOffset ||
+               endOffset - recordOffset < 56)
+                corrupt();
+            file.read(record, 56, recordOffset);
+            if(getLE(record, 4) != 0x06064b50)
+                corrupt();
+            count = getLE(record + 32, 8);
+            directorySize = getLE(record + 40, 8);
+            directoryOffset = getLE(record + 48, 8);
+        }
+        // check in subtraction form, so that corrupt 64-bit values can't overflow
+        if(directoryOffset > fileSize || directorySize > fileSize - directoryOffset)
+            corrupt();
+
+        std::string directory(directorySize, '\0');
+        file.read(&directory[0], directorySize, directoryOffset);
+        std::size_t p = 0;
+        for(std::uint64_t k = 0; k < count; ++k)
+        {
+            if(p + 46 > directorySize || getLE(&directory[p], 4) != 0x02014b50)
+                corrupt();
+            char const * h = &directory[p];
+            std::size_t nameSize  = getLE(h + 28, 2),
+                        extraSize = getLE(h + 30, 2),
+                        entrySize = 46 + nameSize + extraSize + getLE(h + 32, 2);
+            if(p + entrySize > directorySize)
+                corrupt();
+
+            Member m;
+            m.flags  = (unsigned int)getLE(h + 8, 2);
+            m.method = (unsigned int)getLE(h + 10, 2);
+            std::uint64_t compressed = getLE(h + 20, 4),
+                          uncompressed = getLE(h + 24, 4);
+            m.offset = getLE(h + 42, 4);
+            m.name = std::string(h + 46, nameSize);
+            if(m.name.size() > 4 && m.name.compare(m.name.size() - 4, 4, ".npy") == 0)
+                m.name.resize(m.name.size() - 4);
+
+            // ZIP64 extra field: 64-bit values for the entries set to 0xFFFFFFFF
+            char const * e = h + 46 + nameSize, * eend = e + extraSize;
+            while(e + 4 <= eend)
+            {
+                char const * f = e + 4, * fend = f + getLE(e + 2, 2);
+                if(fend > eend)
+                    break;
+                if(getLE(e, 2) == 1)
+                {
+                    if(uncompressed == 0xFFFFFFFF && f + 8 <= fend)
+                        uncompressed = getLE(f, 8), f += 8;
+                    if(compressed == 0xFFFFFFFF && f + 8 <= fend)
+                        compressed = getLE(f, 8), f += 8;
+                    if(m.offset == 0xFFFFFFFF && f + 8 <= fend)
+                        m.offset = getLE(f, 8), f += 8;
+                }
+                e = fend;
+            }
+            m.size = compressed;
+            if(m.offset > fileSize || m.size > fileSize - m.offset)
+                corrupt();
+            members_.push_back(m);
+            p += entrySize;
+        }
+    }
+
+    NpyInfo memberInfo(npy_detail::File & file, std::string const & name,
+                       std::string const & function) const
+    {
+        using npy_detail::getLE;
+
+        auto m = std::find_if(members_.begin(), members_.end(),
+                              [&name](Member const & m) { return m.name == name; });
+        vigra_precondition(m != members_.end(),
+            function + ": no member '" + name + "' in '" + filename_ + "'.");
+        vigra_precondition(m->method == 0 && (m->flags & 1) == 0,
+            function + ": member '" + name + "' is compressed or encrypted "
+            "(only uncompressed .npz files are supported).");
+
+        // the data follow the local header with its own name and extra field,
+        // which must fit into the file together with the member's data
+        std::size_t fileSize = file.size();
+        char local[30];
+        if(m->offset > fileSize || fileSize - m->offset < 30)
+            corrupt();
+        file.read(local, 30, m->offset);
+        if(getLE(local, 4) != 0x04034b50)
+            corrupt();
+        std::size_t localSize = 30 + getLE(local + 26, 2) + getLE(local + 28, 2);
+        if(fileSize - m->offset < localSize)
+            corrupt();
+        std::size_t start = m->offset + localSize;
+        if(m->size > fileSize - start)
+            corrupt();
+        return npy_detail::readHeader(file, start, m->size, function);
+    }
+
+    std::string filename_;
+    std::vector<Member> members_;
+};
+
+/********************************************************/
+/*                                                      */
+/*                      NpzWriter                       */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Write arrays to an uncompressed NumPy <tt>.npz</tt> file.
+
+        Each call to <tt>add()</tt> appends a member <tt>name.npy</tt> in
+        the format of <tt>writeNpy()</tt>. The member data are aligned to 64
+        bytes (by means of padding in the zip extra field), so that
+        <tt>MappedNpyArrayND</tt> can map them. ZIP64 records are written when
+        members or the archive exceed 4 GB. The central directory is written
+        by <tt>close()</tt> or the destructor.
+        \code
+        NpzWriter npz("results.npz");
+        npz.add("weights", weights);
+        npz.add("volume", volume);
+        npz.close();
+        \endcode
+        The file can be read in Python by <tt>numpy.load("results.npz")</tt>.
+    */
+class NpzWriter
+{
+  public:
+    explicit
+    NpzWriter(std::string const & filename)
+    : file_(filename, O_WRONLY | O_CREAT | O_TRUNC, "NpzWriter()")
+    , offset_(0)
+    , closed_(false)
+    {
+        std::time_t t = std::time(0);
+        std::tm tm;
+        ::localtime_r(&t, &tm);
+        time_ = (tm.tm_hour << 11) | (tm.tm_min << 5) | (tm.tm_sec / 2);
+        date_ = ((tm.tm_year - 80) << 9) | ((tm.tm_mon + 1) << 5) | tm.tm_mday;
+    }
+
+    NpzWriter(NpzWriter const &) = delete;
+    NpzWriter & operator=(NpzWriter const &) = delete;
+
+    ~NpzWriter()
+    {
+        try
+        {
+            close();
+        }
+        catch(...) {}
+    }
+
+        /** Append array \a a as member \a name.
+        */
+    template <int N, class T>
+    void add(std::string const & name, ArrayViewND<N, T> const & a)
+    {
+        using namespace npy_detail;
+
+        vigra_precondition(!closed_,
+            "NpzWriter::add(): file is already closed.");
+        Entry e;
+        e.name = name + ".npy";
+        for(auto const & other : entries_)
+            vigra_precondition(other.name != e.name,
+                "NpzWriter::add(): duplicate member '" + name + "'.");
+
+        bool fortranOrder = useFortranOrder(a);
+        std::string header = encodeHeader(a, fortranOrder);
+        e.offset = offset_;
+        e.size = header.size() + a.size()*sizeof(T);
+        e.crc = 0;
+        std::size_t dataOffset = offset_ + localHeader(e).size();
+
+        // the local header is written last, when the checksum is known
+        e.crc = checksum(header.data(), header.size());
+        file_.write(header.data(), header.size(), dataOffset);
+        array_file_detail::writeData(file_, a, dataOffset + header.size(),
+                                     fortranOrder || array_detail::isOrdered(a, C_ORDER), &e.crc);
+        std::string local = localHeader(e);
+        file_.write(local.data(), local.size(), offset_);
+
+        offset_ = dataOffset + e.size;
+        entries_.push_back(e);
+    }
+
+        /** Write the central directory. Further calls have no effect.
+        */
+    void close()
+    {
+        using npy_detail::putLE;
+
+        if(closed_)
+            return;
+        closed_ = true;
+
+        std::string directory;
+        for(auto const & e : entries_)
+            directory += directoryEntry(e);
+        std::uint64_t count = entries_.size(),
+                      directorySize = directory.size(),
+                      directoryOffset = offset_;
+
+        std::string & end = directory;
+        if(count >= 0xFFFF || directorySize >= 0xFFFFFFFF || directoryOffset >= 0xFFFFFFFF)
+        {
+            // ZIP64 end of central directory record and locator
+            putLE(end, 0x06064b50, 4);
+            putLE(end, 44, 8);
+            putLE(end, 45, 2);
+            putLE(end, 45, 2);
+            putLE(end, 0, 4);
+            putLE(end, 0, 4);
+            putLE(end, count, 8);
+            putLE(end, count, 8);
+            putLE(end, directorySize, 8);
+            putLE(end, directoryOffset, 8);
+            putLE(end, 0x07064b50, 4);
+            putLE(end, 0, 4);
+            putLE(end, directoryOffset + directorySize, 8);
+            putLE(end, 1, 4);
+        }
+        putLE(end, 0x06054b50, 4);
+        putLE(end, 0, 2);
+        putLE(end, 0, 2);
+        putLE(end, std::min<std::uint64_t>(count, 0xFFFF), 2);
+        putLE(end, std::min<std::uint64_t>(count, 0xFFFF), 2);
+        putLE(end, std::min<std::uint64_t>(directorySize, 0xFFFFFFFF), 4);
+        putLE(end, std::min<std::uint64_t>(directoryOffset, 0xFFFFFFFF), 4);
+        putLE(end, 0, 2);
+        file_.write(end.data(), end.size(), directoryOffset);
+    }
+
+  private:
+    struct Entry
+    {
+        std::string name;
+        std::uint64_t offset, size;
+        std::uint32_t crc;
+    };
+
+    std::string localHeader(Entry const & e) const
+    {
+        using npy_detail::putLE;
+
+        bool zip64 = e.size >= 0xFFFFFFFF;
+        std::string extra;
+        if(zip64)
+        {
+            putLE(extra, 1, 2);
+            putLE(extra, 16, 2);
+            putLE(extra, e.size, 8);
+            putLE(extra, e.size, 8);
+        }
+        // pad the extra field (as zipalign does, ID 0xD935) such that
+        // the data start at a multiple of 64 bytes
+        std::size_t start = e.offset + 30 + e.name.size() + extra.size() + 6,
+                    padding = (npy_detail::headerAlignment - start % npy_detail::headerAlignment)
+                                   % npy_detail::headerAlignment;
+        putLE(extra, 0xD935, 2);
+        putLE(extra, 2 + padding, 2);
+        putLE(extra, npy_detail::headerAlignment, 2);
+        extra.append(padding, '\0');
+
+        std::string h;
+        putLE(h, 0x04034b50, 4);
+        putLE(h, zip64 ? 45 : 20, 2);
+        putLE(h, 0, 2);     // flags
+        putLE(h, 0, 2);     // method: stored
+        putLE(h, time_, 2);
+        putLE(h, date_, 2);
+        putLE(h, e.crc, 4);
+        putLE(h, zip64 ? 0xFFFFFFFF : e.size, 4);
+        putLE(h, zip64 ? 0xFFFFFFFF : e.size, 4);
+        putLE(h, e.name.size(), 2);
+        putLE(h, extra.size(), 2);
+        return h + e.name + extra;
+    }
+
+    std::string directoryEntry(Entry const & e) const
+    {
+        using npy_detail::putLE;
+
+        bool largeSize = e.size >= 0xFFFFFFFF,
+             largeOffset = e.offset >= 0xFFFFFFFF;
+        std::string extra;
+        if(largeSize || largeOffset)
+        {
+            putLE(extra, 1, 2);
+            putLE(extra, (largeSize ? 16 : 0) + (largeOffset ? 8 : 0), 2);
+            if(largeSize)
+            {
+                putLE(extra, e.size, 8);
+                putLE(extra, e.size, 8);
+            }
+            if(largeOffset)
+                putLE(extra, e.offset, 8);
+        }
+
+        std::string h;
+        putLE(h, 0x02014b50, 4);
+        putLE(h, extra.size() > 0 ? 45 : 20, 2);
+        putLE(h, extra.size() > 0 ? 45 : 20, 2);
+        putLE(h, 0, 2);     // flags
+        putLE(h, 0, 2);     // method: stored
+        putLE(h, time_, 2);
+        putLE(h, date_, 2);
+        putLE(h, e.crc, 4);
+        putLE(h, largeSize ? 0xFFFFFFFF : e.size, 4);
+        putLE(h, largeSize ? 0xFFFFFFFF : e.size, 4);
+        putLE(h, e.name.size(), 2);
+        putLE(h, extra.size(), 2);
+        putLE(h, 0, 2);     // comment length
+        putLE(h, 0, 2);     // disk number
+        putLE(h, 0, 2);     // internal attributes
+        putLE(h, 0, 4);     // external attributes
+        putLE(h, largeOffset ? 0xFFFFFFFF : e.offset, 4);
+        return h + e.name + extra;
+    }
+
+    npy_detail::File file_;
+    std::uint64_t offset_;
+    std::vector<Entry> entries_;
+    unsigned int time_, date_;
+    bool closed_;
+};
+
+/********************************************************/
+/*                                                      */
+/*                   MappedNpyArrayND                   */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Zero-copy access to a <tt>.npy</tt> file or <tt>.npz</tt> member via <tt>mmap()</tt>.
+
+        The element type and dimension must match the file as described for
+        <tt>readNpy()</tt>. The view has the file's shape and the strides
+        of its C- or F-order. Like <tt>MappedArrayND</tt>, the mapping is
+        private: modifications are not written back to the file. Data in
+        non-native byte order are swapped in place, which copies all pages.
+
+        <tt>.npz</tt> members can only be mapped when they are uncompressed
+        and their data are suitably aligned (this is always the case for files
+        written by <tt>NpzWriter</tt>). Fortran-order files with
+        <tt>TinyArray</tt> elements cannot be mapped, because the channels are
+        not adjacent in memory; use <tt>readNpy()</tt> in these cases.
+        \code
+        MappedNpyArrayND<3, float> volume("volume.npy");
+        ArrayViewND<2, float> slice = volume.bind(0, 10);   // no data are read yet
+        \endcode
+    */
+template <int N, class T>
+class MappedNpyArrayND
+: public ArrayViewND<N, T>
+{
+  public:
+    typedef ArrayViewND<N, T> view_type;
+
+    explicit
+    MappedNpyArrayND(std::string const & filename)
+    {
+        npy_detail::File file(filename, O_RDONLY, "MappedNpyArrayND()");
+        map(file, npy_detail::readHeader(file, 0, file.size(), "MappedNpyArrayND()"));
+    }
+
+    MappedNpyArrayND(NpzFile const & npz, std::string const & name)
+    {
+        npy_detail::File file(npz.filename(), O_RDONLY, "MappedNpyArrayND()");
+        map(file, npz.memberInfo(file, name, "MappedNpyArrayND()"));
+    }
+
+    MappedNpyArrayND(MappedNpyArrayND const &) = delete;
+    MappedNpyArrayND & operator=(MappedNpyArrayND const &) = delete;
+
+    MappedNpyArrayND(MappedNpyArrayND && rhs)
+    : view_type(rhs)
+    , mapping_(std::move(rhs.mapping_))
+    , info_(std::move(rhs.info_))
+    {}
+
+        /** The file's header.
+        */
+    NpyInfo const & info() const
+    {
+        return info_;
+    }
+
+  private:
+    void map(npy_detail::File & file, NpyInfo const & info)
+    {
+        std::string function("MappedNpyArrayND()");
+        static const int channels = ElementTypeCode<T>::channels;
+
+        info_ = info;
+        npy_detail::checkElementType<N, T>(info_, function);
+        vigra_precondition(channels == 1 || !info_.fortranOrder,
+            function + ": Fortran-order files with a channel axis cannot be mapped (use readNpy()).");
+        vigra_precondition(info_.dataOffset % alignof(T) == 0,
+            function + ": data are not aligned (use readNpy()).");
+
+        mapping_ = array_file_detail::FileMapping(file, info_.dataOffset, info_.dataSize, function);
+        if(!info_.isNativeByteOrder())
+            npy_detail::byteSwap(mapping_.data(), info_.dataSize, npy_detail::swapSize(info_));
+
+        typedef typename view_type::difference_type Shp;
+        int ndim = info_.ndim() - (channels > 1 ? 1 : 0);
+        Shape<runtime_size> strides = shapeToStrides(info_.shape, info_.fortranOrder ? F_ORDER : C_ORDER)*
+                                      info_.itemsize;
+        view_type v(Shp(info_.shape.begin(), info_.shape.begin() + ndim),
+                    tags::byte_strides = Shp(strides.begin(), strides.begin() + ndim),
+                    (T *)mapping_.data());
+        this->swapImpl(v);
+    }
+
+    array_file_detail::FileMapping mapping_;
+    NpyInfo info_;
+};
+
+} // namespace vigra
+
+#endif // VIGRA2_NPY_HXX
@@ -0,0 +1,344 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014-2017 by Ullrich Koethe                  */
+/*                                                                      */
+/*    This file is part of the VIGRA2 computer vision library.          */
+/*    The VIGRA2 Website is                                             */
+/*        http://ukoethe.github.io/vigra2                               */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#pragma once
+
+#ifndef VIGRA2_NUMA_HXX
+#define VIGRA2_NUMA_HXX
+
+#include "config.hxx"
+#include "error.hxx"
+#include "array_nd.hxx"
+#include "parallel.hxx"
+#include "algorithm_nd.hxx"
+#include <cctype>
+#include <cstddef>
+#include <fstream>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__unix) || defined(__APPLE__)
+    #define VIGRA_NUMA_MMAP
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+#if defined(__linux__)
+    #include <sys/syscall.h>
+    #if defined(SYS_mbind)
+        #define VIGRA_NUMA_MBIND
+    #endif
+#endif
+
+namespace vigra {
+
+/********************************************************/
+/*                                                      */
+/*                   MemoryPlacement                    */
+/*                                                      */
+/********************************************************/
+
+    /** \brief How the pages of a <tt>FirstTouchAllocator</tt> are distributed
+        over the NUMA nodes.
+
+        <ul>
+        <li><tt>PlaceFirstTouch</tt>: the operating system's default policy, i.e.
+            each page is placed on the node of the thread that touches it first.
+        <li><tt>PlaceInterleaved</tt>: pages are distributed round-robin over all
+            nodes (via <tt>mbind()</tt> on Linux). This is preferable when the access
+            pattern of later passes is unknown. On other systems, single-node
+            machines, or when <tt>mbind()</tt> fails, first-touch placement is used.
+        </ul>
+    */
+enum MemoryPlacement { PlaceFirstTouch, PlaceInterleaved };
+
+namespace numa_detail {
+
+    // allocations below this size are served by operator new
+static const std::size_t minMappedSize = 1 << 16;
+
+    // from <numaif.h>, which is part of libnuma and not always installed
+static const int mpolInterleave = 3;
+
+    // Number of nodes in a kernel node list such as "0", "0-3" or "0,2-5"
+    // (i.e. the highest node number plus one), 0 if the list is invalid.
+inline int
+nodeListSize(std::string const & list)
+{
+    int res = 0, node = -1;
+    for(char c : list)
+    {
+        if(std::isdigit((unsigned char)c))
+            node = (node < 0 ? 0 : 10*node) + (c - '0');
+        else if(c == ',' || c == '-' || c == '\n')
+            node = -1;
+        else
+            return 0;
+        if(node >= 1 << 16)
+            return 0;
+        if(node >= res)
+            res = node + 1;
+    }
+    return res;
+}
+
+    // number of possible NUMA nodes (0 if unknown)
+inline int
+possibleNodeCount()
+{
+    static const int count = []()
+    {
+        std::ifstream f("/sys/devices/system/node/possible");
+        std::string list;
+        std::getline(f, list);
+        return nodeListSize(list);
+    }();
+    return count;
+}
+
+    // Ask the kernel to interleave the pages in [p, p+bytes) over all nodes.
+    // Returns false if this is impossible or pointless (single node), in which
+    // case the default first-touch policy remains in effect.
+inline bool
+interleavePages(void * p, std::size_t bytes)
+{
+#ifdef VIGRA_NUMA_MBIND
+    int nodes = possibleNodeCount();
+    if(nodes <= 1)
+        return false;
+    // Set the bits of all possible nodes, the kernel restricts them to the
+    // allowed nodes with memory. Like libnuma, pass one more than the number
+    // of valid bits as 'maxnode', since the kernel ignores the last bit.
+    static const int bitsPerWord = 8*sizeof(unsigned long);
+    std::vector<unsigned long> nodemask((nodes + bitsPerWord - 1) / bitsPerWord, 0ul);
+    for(int k = 0; k < nodes; ++k)
+        nodemask[k / bitsPerWord] |= 1ul << (k % bitsPerWord);
+    return syscall(SYS_mbind, p, bytes, mpolInterleave, nodemask.data(),
+                   (unsigned long)nodes + 1, 0u) == 0;
+#else
+    (void)p;
+    (void)bytes;
+    return false;
+#endif
+}
+
+    // Get memory whose pages are not yet touched, so that their
+    // placement is decided by the first write.
+inline void *
+allocatePages(std::size_t bytes, MemoryPlacement placement)
+{
+#ifdef VIGRA_NUMA_MMAP
+    if(bytes >= minMappedSize)
+    {
+        void * p = mmap(0, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(p == MAP_FAILED)
+            throw std::bad_alloc();
+        // on failure, the pages are placed by first touch
+        if(placement == PlaceInterleaved)
+            interleavePages(p, bytes);
+        return p;
+    }
+#endif
+    (void)placement;
+    return ::operator new(bytes);
+}
+
+inline void
+deallocatePages(void * p, std::size_t bytes)
+{
+#ifdef VIGRA_NUMA_MMAP
+    if(bytes >= minMappedSize)
+    {
+        munmap(p, bytes);
+        return;
+    }
+#endif
+    (void)bytes;
+    ::operator delete(p);
+}
+
+} // namespace numa_detail
+
+/********************************************************/
+/*                                                      */
+/*                  FirstTouchAllocator                 */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Allocator that initializes <tt>ArrayND</tt> in parallel.
+
+        With the default allocator, a new array is filled by the constructing
+        thread, so that on a NUMA machine all pages end up on that thread's node,
+        and later parallel passes are limited by remote-memory bandwidth.
+        <tt>FirstTouchAllocator</tt> obtains untouched pages from the operating
+        system, and <tt>ArrayND</tt>'s shape constructors then let it write the
+        initial value with the same chunk partitioning as
+        <tt>parallelForeachChunk(ArrayViewND, ParallelOptions, ...)</tt>.
+        Thus, each page is placed on the node of the thread that
+        will later process it (given the same number of threads):
+        \code
+        typedef FirstTouchAllocator<float> Alloc;
+
+        ArrayND<3, float, Alloc> volume(Shape3(1024, 1024, 1024), 0.0f, C_ORDER,
+                                        Alloc(ParallelOptions(16)));
+
+        parallelForeachChunk(volume, ParallelOptions(16),
+            [](int, ArrayViewND<3, float> chunk)
+            {
+                ...  // mostly local memory accesses
+            });
+        \endcode
+        Alternatively, <tt>PlaceInterleaved</tt> spreads the pages round-robin
+        over all nodes.
+
+        The elements of trivially copyable types are not constructed before
+        <tt>initialize()</tt> assigns the initial value, other types are
+        default-constructed by the allocating thread first.
+        Other <tt>ArrayND</tt> constructors (e.g. copying from a view) fill the
+        array sequentially, but still benefit from <tt>PlaceInterleaved</tt>.
+
+        <b>\#include</b> \<vigra2/numa.hxx\><br>
+        Namespace: vigra
+    */
+template <class T>
+class FirstTouchAllocator
+{
+  public:
+    typedef T value_type;
+
+        // tell ArrayND to call initialize()
+    typedef std::true_type initializes_array;
+
+    template <class U>
+    struct rebind
+    {
+        typedef FirstTouchAllocator<U> other;
+    };
+
+    explicit
+    FirstTouchAllocator(ParallelOptions const & options = ParallelOptions(),
+                        MemoryPlacement placement = PlaceFirstTouch)
+    : options_(options)
+    , placement_(placement)
+    {}
+
+    template <class U>
+    FirstTouchAllocator(FirstTouchAllocator<U> const & other)
+    : options_(other.options())
+    , placement_(other.placement())
+    {}
+
+    T * allocate(std::size_t n)
+    {
+        return static_cast<T *>(numa_detail::allocatePages(n*sizeof(T), placement_));
+    }
+
+    void deallocate(T * p, std::size_t n)
+    {
+        numa_detail::deallocatePages(p, n*sizeof(T));
+    }
+
+        // leave the memory untouched for trivial types
+    template <class U>
+    void construct(U * p)
+    {
+        constructDefault(p, std::is_trivially_copyable<U>());
+    }
+
+    template <class U, class ... ARGS>
+    void construct(U * p, ARGS && ... args)
+    {
+        ::new((void *)p) U(std::forward<ARGS>(args)...);
+    }
+
+        /** Assign \a init to all elements of the newly allocated array \a a,
+            using the threads specified in the allocator's options.
+        */
+    template <int N>
+    void initialize(ArrayViewND<N, T> const & a, T const & init) const
+    {
+        parallelForeachChunk(a, options_,
+            [&init](int, ArrayViewND<N, T> chunk)
+            {
+                chunk = init;
+            });
+    }
+
+    ParallelOptions const & options() const
+    {
+        return options_;
+    }
+
+    MemoryPlacement placement() const
+    {
+        return placement_;
+    }
+
+  private:
+    template <class U>
+    static void constructDefault(U *, std::true_type)
+    {}
+
+    template <class U>
+    static void constructDefault(U * p, std::false_type)
+    {
+        ::new((void *)p) U();
+    }
+
+    ParallelOptions options_;
+    MemoryPlacement placement_;
+};
+
+    // memory can be released by any instance
+template <class T, class U>
+inline bool
+operator==(FirstTouchAllocator<T> const &, FirstTouchAllocator<U> const &)
+{
+    return true;
+}
+
+template <class T, class U>
+inline bool
+operator!=(FirstTouchAllocator<T> const &, FirstTouchAllocator<U> const &)
+{
+    return false;
+}
+
+} // namespace vigra
+
+#endif // VIGRA2_NUMA_HXX
@@ -433,6 +433,44 @@ struct UninitializedMemoryTraits
     static const bool value = std::is_scalar<T>::value || std::is_pod<T>::value;
 };
 
+///////////////////////////////////////////////////////////////
+// ElementTypeCode
+
+    // Portable description of an array element type for file formats.
+    // 'kind' follows the numpy convention ('b': bool, 'i': signed integer,
+    // 'u': unsigned integer, 'f': floating point, 'c': complex) and is 0 for
+    // unsupported types, 'itemsize' is the size of one scalar in bytes, and
+    // 'channels' the number of scalars per element (e.g. 3 for TinyArray<float, 3>,
+    // see the specialization in tinyarray.hxx).
+template <class T, bool ARITHMETIC = std::is_arithmetic<T>::value>
+struct ElementTypeCode
+{
+    static const char kind = 0;
+    static const int itemsize = sizeof(T);
+    static const int channels = 1;
+};
+
+template <class T>
+struct ElementTypeCode<T, true>
+{
+    static const char kind = std::is_same<T, bool>::value
+                                 ? 'b'
+                                 : std::is_floating_point<T>::value
+                                      ? 'f'
+                                      : std::is_signed<T>::value
+                                           ? 'i'
+                                           : 'u';
+    static const int itemsize = sizeof(T);
+    static const int channels = 1;
+};
+
+template <class T>
+struct ElementTypeCode<std::complex<T>, false>
+{
+    static const char kind = ElementTypeCode<T>::kind == 'f' ? 'c' : 0;
+    static const int itemsize = sizeof(std::complex<T>);
+    static const int channels = 1;
+};
 
 ///////////////////////////////////////////////////////////////
 // NormTraits
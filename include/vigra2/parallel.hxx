@@ -0,0 +1,229 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014-2017 by Ullrich Koethe                  */
+/*                                                                      */
+/*    This file is part of the VIGRA2 computer vision library.          */
+/*    The VIGRA2 Website is                                             */
+/*        http://ukoethe.github.io/vigra2                               */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#pragma once
+
+#ifndef VIGRA2_PARALLEL_HXX
+#define VIGRA2_PARALLEL_HXX
+
+#include "config.hxx"
+#include "error.hxx"
+#include <algorithm>
+#include <exception>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace vigra {
+
+/********************************************************/
+/*                                                      */
+/*                    ParallelOptions                   */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Option object for parallel algorithms.
+
+        The number of threads can be given explicitly or via one of the
+        special values <tt>ParallelOptions::Auto</tt> (use as many threads as
+        the hardware supports), <tt>ParallelOptions::Nice</tt> (use half as many)
+        and <tt>ParallelOptions::NoThreads</tt> (compute everything in the calling thread).
+
+        <b>\#include</b> \<vigra2/parallel.hxx\><br>
+        Namespace: vigra
+    */
+class ParallelOptions
+{
+  public:
+
+    enum {
+        Auto       = -1,
+        Nice       = -2,
+        NoThreads  =  0
+    };
+
+    explicit ParallelOptions(int nThreads = Auto)
+    : numThreads_(actualNumThreads(nThreads))
+    {}
+
+        /** Set the number of threads.
+        */
+    ParallelOptions & numThreads(int n)
+    {
+        numThreads_ = actualNumThreads(n);
+        return *this;
+    }
+
+        /** Get the desired number of threads (zero means <tt>NoThreads</tt>).
+        */
+    int getNumThreads() const
+    {
+        return numThreads_;
+    }
+
+        /** Get the number of threads that will actually be used (at least one).
+        */
+    int getActualNumThreads() const
+    {
+        return std::max(1, numThreads_);
+    }
+
+  private:
+
+    static int actualNumThreads(int n)
+    {
+        int hardware = (int)std::thread::hardware_concurrency();
+        if(hardware <= 0)
+            hardware = 1;
+        return n >= 0
+                   ? n
+                   : n == Nice
+                        ? std::max(1, hardware / 2)
+                        : hardware;
+    }
+
+    int numThreads_;
+};
+
+/********************************************************/
+/*                                                      */
+/*                  parallelChunkCount                  */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Number of chunks a range of given size is split into.
+
+        The result is at most the number of threads requested by \a options
+        and ensures that each chunk contains at least \a minChunkSize items.
+        Algorithms use this to allocate per-chunk partial results before
+        calling \ref parallelForeachChunk().
+    */
+inline int
+parallelChunkCount(ArrayIndex size, ParallelOptions const & options,
+                   ArrayIndex minChunkSize = 1)
+{
+    if(size <= 0)
+        return 0;
+    minChunkSize = std::max<ArrayIndex>(minChunkSize, 1);
+    ArrayIndex maxChunks = (size + minChunkSize - 1) / minChunkSize;
+    return (int)std::min<ArrayIndex>(options.getActualNumThreads(), maxChunks);
+}
+
+    /** \brief First index of chunk \a k when \a size items are split into \a chunkCount chunks.
+
+        The partitioning depends only on \a size and \a chunkCount, so that
+        results combined in chunk order are reproducible.
+    */
+inline ArrayIndex
+parallelChunkBegin(ArrayIndex size, int chunkCount, int k)
+{
+    return (size / chunkCount) * k + std::min<ArrayIndex>(k, size % chunkCount);
+}
+
+/********************************************************/
+/*                                                      */
+/*                 parallelForeachChunk                 */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Split the range <tt>[0, size)</tt> into \a chunkCount contiguous chunks
+        and process them concurrently.
+
+        The functor is called as <tt>f(chunk_index, begin, end)</tt>, with chunk 0
+        executed by the calling thread. If no more threads can be created, the
+        remaining chunks are executed by the calling thread as well. The first
+        exception thrown by any chunk (in chunk order) is re-thrown after all
+        threads have finished.
+    */
+template <class FCT>
+void
+parallelForeachChunk(ArrayIndex size, int chunkCount, FCT && f)
+{
+    if(size <= 0 || chunkCount <= 0)
+        return;
+    if(chunkCount == 1)
+    {
+        f(0, ArrayIndex(0), size);
+        return;
+    }
+
+    std::vector<std::exception_ptr> errors(chunkCount);
+    std::vector<std::thread> threads;
+    threads.reserve(chunkCount - 1);
+
+    auto run = [&](int k)
+    {
+        try
+        {
+            f(k, parallelChunkBegin(size, chunkCount, k),
+                 parallelChunkBegin(size, chunkCount, k+1));
+        }
+        catch(...)
+        {
+            errors[k] = std::current_exception();
+        }
+    };
+
+    int started = 1;
+    try
+    {
+        for(; started<chunkCount; ++started)
+            threads.emplace_back(run, started);
+    }
+    catch(std::system_error &)
+    {}
+    run(0);
+    for(int k=started; k<chunkCount; ++k)
+        run(k);
+    for(auto & t : threads)
+        t.join();
+    for(auto & e : errors)
+        if(e)
+            std::rethrow_exception(e);
+}
+
+template <class FCT>
+int
+parallelForeachChunk(ArrayIndex size, ParallelOptions const & options,
+                     FCT && f, ArrayIndex minChunkSize = 1)
+{
+    int chunkCount = parallelChunkCount(size, options, minChunkSize);
+    parallelForeachChunk(size, chunkCount, std::forward<FCT>(f));
+    return chunkCount;
+}
+
+} // namespace vigra
+
+#endif // VIGRA2_PARALLEL_HXX
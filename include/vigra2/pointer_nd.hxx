@@ -44,6 +44,7 @@
 #include "concepts.hxx"
 #include "tinyarray.hxx"
 #include "shape.hxx"
+#include "scratch.hxx"
 
 // Bounds checking Macro used if VIGRA_CHECK_BOUNDS is defined.
 #ifdef VIGRA_CHECK_BOUNDS
@@ -70,6 +71,15 @@ class ArrayViewND;
 template <int N, class T, class Alloc = std::allocator<T> >
 class ArrayND;
 
+template <int N, class T>
+class SharedArrayND;
+
+template <int N, class T>
+class MappedArrayND;
+
+template <int N, class T>
+class MappedNpyArrayND;
+
 namespace array_math {
 
 // Forward declarations.
@@ -225,7 +235,27 @@ class PointerND
         if (other.size() == 0)
             return true;
         // FIXME: can singletons be considered as compatible strides?
-        return strides_ == other;
+        // Reversed axes are incompatible: the overlap direction found by
+        // checkMemoryOverlap() doesn't correspond to the iteration direction.
+        return strides_ == other && allGreaterEqual(strides_, 0);
+    }
+
+        // Check if the elements covered by 'shape' form a consecutive
+        // block of memory in C-order (strides of singleton axes don't matter).
+    template <class SHAPE>
+    bool
+    isCConsecutive(SHAPE const & shape) const
+    {
+        ArrayIndex size = sizeof(T);
+        for(int k=shape.size()-1; k >= 0; --k)
+        {
+            if(shape[k] == 1)
+                continue;
+            if(strides_[k] != size)
+                return false;
+            size *= shape[k];
+        }
+        return true;
     }
 
     template <class SHAPE>
@@ -310,6 +340,12 @@ class PointerND<0, T>
         return true;
     }
 
+    template <class SHAPE>
+    constexpr bool isCConsecutive(SHAPE const &) const
+    {
+        return true;
+    }
+
     template <class SHAPE>
     PointerND
     pointer_nd(SHAPE const &) const
@@ -793,8 +829,8 @@ principalStrides(SHAPE1 & target, SHAPE2 const & src,
     {
         if (src[k] == 0)
             ++s;
-        else if (src[k] < m)
-            m = src[k];
+        else if (abs(src[k]) < m)
+            m = abs(src[k]);
     }
     if (s <= singletonCount && m <= minimalStride)
     {
@@ -1095,6 +1131,75 @@ reversePointerNDFunction(POINTER_ND1 && h1, POINTER_ND2 && h2, SHAPE const & sha
     h2.inc(dim);
 }
 
+/********************************************************/
+/*                                                      */
+/*                 flatPointerNDFunction()              */
+/*                                                      */
+/********************************************************/
+
+    // Call `f` for `count` consecutive elements, starting at the current
+    // position of the pointer(s) and incrementing along axis `dim`. This is
+    // only valid when the pointers refer to C-order consecutive memory
+    // and `dim` is the innermost non-singleton axis.
+template <class P, class FCT>
+inline void
+flatPointerNDFunction(P & p, ArrayIndex count, int dim, FCT && f)
+{
+    for(ArrayIndex k=0; k<count; ++k, p.inc(dim))
+        f(*p);
+}
+
+template <int N, class T, class FCT>
+inline void
+flatPointerNDFunction(PointerND<N, T> & p, ArrayIndex count, int, FCT && f)
+{
+    auto q = p.ptr();
+    for(ArrayIndex k=0; k<count; ++k)
+        f(q[k]);
+}
+
+template <class P1, class P2, class FCT>
+inline void
+flatPointerNDFunction(P1 & p1, P2 & p2, ArrayIndex count, int dim, FCT && f)
+{
+    for(ArrayIndex k=0; k<count; ++k, p1.inc(dim), p2.inc(dim))
+        f(*p1, *p2);
+}
+
+template <int M, class T, int N, class U, class FCT>
+inline void
+flatPointerNDFunction(PointerND<M, T> & p1, PointerND<N, U> & p2, ArrayIndex count, int, FCT && f)
+{
+    auto q1 = p1.ptr();
+    auto q2 = p2.ptr();
+    for(ArrayIndex k=0; k<count; ++k)
+        f(q1[k], q2[k]);
+}
+
+template <int M, class T, class U, class FCT>
+inline void
+flatPointerNDFunction(PointerND<M, T> & p1, PointerND<0, U> & p2, ArrayIndex count, int, FCT && f)
+{
+    auto q1 = p1.ptr();
+    for(ArrayIndex k=0; k<count; ++k)
+        f(q1[k], *p2);
+}
+
+namespace array_detail {
+
+    // innermost non-singleton axis (or 0 if all axes are singletons)
+template <class SHAPE>
+inline int
+innermostAxis(SHAPE const & shape)
+{
+    int dim = shape.size() - 1;
+    while(dim > 0 && shape[dim] == 1)
+        --dim;
+    return dim;
+}
+
+} // namespace array_detail
+
 /********************************************************/
 /*                                                      */
 /*               universalArrayNDFunction()             */
@@ -1107,7 +1212,7 @@ reversePointerNDFunction(POINTER_ND1 && h1, POINTER_ND2 && h2, SHAPE const & sha
 template <class TARGET, class ARRAY_LIKE, class FCT>
 enable_if_t<ArrayNDConcept<TARGET>::value && ArrayLikeConcept<ARRAY_LIKE>::value>
 universalArrayNDFunction(TARGET && target, ARRAY_LIKE && src, FCT &&f,
-                         std::string func_name)
+                         const char * func_name)
 {
     using namespace array_detail;
 
@@ -1118,7 +1223,33 @@ universalArrayNDFunction(TARGET && target, ARRAY_LIKE && src, FCT &&f,
 
     // find the common shape, possibly expanding singleton axes
     Shape<dimension> shape = target.shape();
-    vigra_precondition(unifyShape(shape, src), func_name + ": shape mismatch.");
+    vigra_precondition(unifyShape(shape, src), std::string(func_name) + ": shape mismatch.");
+
+    // Take care of overlapping arrays unless the target is read-only
+    // (source data could otherwise be overwritten before reading).
+    typedef typename std::remove_reference<decltype(*target.pointer_nd())>::type TARGET_VALUE;
+    static const bool read_only_target = std::is_const<TARGET_VALUE>::value ||
+                                         !std::is_reference<decltype(*target.pointer_nd())>::value;
+
+    if(dimension != runtime_size && shape.size() > 0)
+    {
+        // Fast path for small arrays: when all operands cover consecutive memory
+        // in C-order, skip the loop order optimization and run a flat loop.
+        auto tp = target.pointer_nd();
+        auto sp = src.pointer_nd();
+        if(tp.isCConsecutive(shape) && sp.isCConsecutive(shape))
+        {
+            MemoryOverlap overlap = read_only_target
+                                        ? NoMemoryOverlap
+                                        : checkMemoryOverlap(target.memoryRange(), src);
+            if(overlap == NoMemoryOverlap ||
+               ((overlap & TargetOverlapsLeft) && sp.compatibleStrides(tp.byte_strides())))
+            {
+                flatPointerNDFunction(tp, sp, prod(shape), innermostAxis(shape), std::forward<FCT>(f));
+                return;
+            }
+        }
+    }
 
     Shape<dimension> p(tags::size = shape.size());
     if (shape.size() > 1)
@@ -1135,11 +1266,6 @@ universalArrayNDFunction(TARGET && target, ARRAY_LIKE && src, FCT &&f,
     auto sp = src.pointer_nd(p);
     shape   = shape.transpose(p);
 
-    // Take care of overlapping arrays unless the target is read-only
-    // (source data could otherwise be overwritten before reading).
-    typedef typename std::remove_reference<decltype(*tp)>::type TARGET_VALUE;
-    static const bool read_only_target = std::is_const<TARGET_VALUE>::value ||
-                                         !std::is_reference<decltype(*tp)>::value;
     MemoryOverlap overlap = read_only_target
                                 ? NoMemoryOverlap
                                 : checkMemoryOverlap(target.memoryRange(), src);
@@ -1156,8 +1282,10 @@ universalArrayNDFunction(TARGET && target, ARRAY_LIKE && src, FCT &&f,
     }
     else
     {
-        // hopeless overlap, create a temporary copy of src
-        ArrayND<ARRAY2::dimension, typename ARRAY2::value_type> tmp(forwardPointerND(sp, shape));
+        // hopeless overlap, create a temporary copy of src in the scratch arena
+        typedef typename ARRAY2::value_type SRC_VALUE;
+        ScratchScope scope;
+        ArrayND<ARRAY2::dimension, SRC_VALUE, ScratchAllocator<SRC_VALUE>> tmp(forwardPointerND(sp, shape));
         universalPointerNDFunction(tp, tmp.pointer_nd(), shape, std::forward<FCT>(f));
     }
 }
@@ -1168,13 +1296,24 @@ universalArrayNDFunction(TARGET && target, ARRAY_LIKE && src, FCT &&f,
 template <class TARGET, class FCT>
 enable_if_t<ArrayLikeConcept<TARGET>::value>
 universalArrayNDFunction(TARGET && target, FCT && f,
-                         std::string func_name)
+                         const char * func_name)
 {
     typedef typename std::remove_reference<TARGET>::type ARRAY;
 
     // find the common shape, possibly expanding singleton axes
     Shape<ARRAY::dimension> shape(tags::size = target.ndim());
-    vigra_precondition(target.unifyShape(shape), func_name + ": shape mismatch.");
+    vigra_precondition(target.unifyShape(shape), std::string(func_name) + ": shape mismatch.");
+
+    if(ARRAY::dimension != runtime_size && shape.size() > 0)
+    {
+        // fast path for operands covering consecutive memory in C-order
+        auto tp = target.pointer_nd();
+        if(tp.isCConsecutive(shape))
+        {
+            flatPointerNDFunction(tp, prod(shape), array_detail::innermostAxis(shape), std::forward<FCT>(f));
+            return;
+        }
+    }
 
     if (shape.size() > 1)
     {
@@ -1192,6 +1331,25 @@ universalArrayNDFunction(TARGET && target, FCT && f,
     }
 }
 
+template <class TARGET, class ARRAY_LIKE, class FCT>
+inline
+enable_if_t<ArrayNDConcept<TARGET>::value && ArrayLikeConcept<ARRAY_LIKE>::value>
+universalArrayNDFunction(TARGET && target, ARRAY_LIKE && src, FCT &&f,
+                         std::string const & func_name)
+{
+    universalArrayNDFunction(std::forward<TARGET>(target), std::forward<ARRAY_LIKE>(src),
+                             std::forward<FCT>(f), func_name.c_str());
+}
+
+template <class TARGET, class FCT>
+inline
+enable_if_t<ArrayLikeConcept<TARGET>::value>
+universalArrayNDFunction(TARGET && target, FCT && f,
+                         std::string const & func_name)
+{
+    universalArrayNDFunction(std::forward<TARGET>(target), std::forward<FCT>(f), func_name.c_str());
+}
+
 } // namespace vigra
 
 #endif // VIGRA2_POINTER_ND_HXX
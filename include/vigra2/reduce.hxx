@@ -0,0 +1,949 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014-2017 by Ullrich Koethe                  */
+/*                                                                      */
+/*    This file is part of the VIGRA2 computer vision library.          */
+/*    The VIGRA2 Website is                                             */
+/*        http://ukoethe.github.io/vigra2                               */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#pragma once
+
+#ifndef VIGRA2_REDUCE_HXX
+#define VIGRA2_REDUCE_HXX
+
+#include "config.hxx"
+#include "error.hxx"
+#include "numeric_traits.hxx"
+#include "mathutil.hxx"
+#include "array_nd.hxx"
+#include "algorithm_nd.hxx"
+#include "parallel.hxx"
+#include "accumulator.hxx"
+#include <tuple>
+#include <vector>
+#include <cmath>
+
+namespace vigra {
+
+namespace reduce_detail {
+
+    // Number of independent partial results each reducer maintains.
+    // Consecutive elements are distributed round-robin over the lanes,
+    // which breaks the dependency chain of the accumulation and allows
+    // the compiler to map the lanes onto SIMD registers.
+static const int laneCount = 8;
+
+    // floating point type used for means and variances
+using acc::acc_detail::RealType;
+
+    // combine the lanes in a fixed tree order
+template <class U, class FCT>
+inline U
+combineLanes(U const * lanes, FCT f)
+{
+    U l0 = f(lanes[0], lanes[1]), l1 = f(lanes[2], lanes[3]),
+      l2 = f(lanes[4], lanes[5]), l3 = f(lanes[6], lanes[7]);
+    return f(f(l0, l1), f(l2, l3));
+}
+
+template <class U>
+inline void
+initLanes(U * lanes, U const & v)
+{
+    for(int l=0; l<laneCount; ++l)
+        lanes[l] = v;
+}
+
+} // namespace reduce_detail
+
+/********************************************************/
+/*                                                      */
+/*                       reducers                       */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Reducers to be passed to \ref reduce().
+
+        A reducer is a tag class whose nested template <tt>Impl<T></tt> computes
+        the statistic for value type <tt>T</tt>. <tt>Impl<T></tt> provides
+
+        <ul>
+        <li> <tt>result_type</tt>: the type of the result,
+        <li> <tt>prepare(T const & first)</tt>: called once with the first element
+             of each chunk before any update,
+        <li> <tt>updateLanes(T const * p)</tt>: update lane <tt>l</tt> with <tt>p[l]</tt> for all
+             <tt>reduce_detail::laneCount</tt> lanes,
+        <li> <tt>update(T const & v)</tt>: update a single lane with <tt>v</tt>,
+        <li> <tt>merge(Impl const & other)</tt>: combine with the partial result of another chunk,
+        <li> <tt>result()</tt>: the final result.
+        </ul>
+
+        <b>\#include</b> \<vigra2/reduce.hxx\><br>
+        Namespace: vigra::reducers
+    */
+namespace reducers {
+
+using reduce_detail::laneCount;
+
+    /** \brief Base class of reducers that don't need <tt>prepare()</tt>.
+    */
+struct ReducerBase
+{
+    template <class T>
+    void prepare(T const &)
+    {}
+};
+
+    /** \brief Number of elements.
+    */
+struct Count
+{
+    template <class T>
+    struct Impl
+    : public ReducerBase
+    {
+        typedef ArrayIndex result_type;
+
+        void updateLanes(T const *)
+        {
+            count_ += laneCount;
+        }
+
+        void update(T const &)
+        {
+            ++count_;
+        }
+
+        void merge(Impl const & o)
+        {
+            count_ += o.count_;
+        }
+
+        result_type result() const
+        {
+            return count_;
+        }
+
+        ArrayIndex count_ = 0;
+    };
+};
+
+    /** \brief Sum of the elements (in <tt>PromoteType<T></tt>, as <tt>ArrayViewND::sum()</tt>).
+    */
+struct Sum
+{
+    template <class T>
+    struct Impl
+    : public ReducerBase
+    {
+        typedef PromoteType<T> result_type;
+
+        Impl()
+        {
+            reduce_detail::initLanes(lanes_, result_type());
+        }
+
+        void updateLanes(T const * p)
+        {
+            for(int l=0; l<laneCount; ++l)
+                lanes_[l] += p[l];
+        }
+
+        void update(T const & v)
+        {
+            lanes_[0] += v;
+        }
+
+        void merge(Impl const & o)
+        {
+            for(int l=0; l<laneCount; ++l)
+                lanes_[l] += o.lanes_[l];
+        }
+
+        result_type result() const
+        {
+            return reduce_detail::combineLanes(lanes_,
+                       [](result_type a, result_type b) { return a + b; });
+        }
+
+        result_type lanes_[laneCount];
+    };
+};
+
+    /** \brief Product of the elements (in <tt>PromoteType<T></tt>).
+    */
+struct Prod
+{
+    template <class T>
+    struct Impl
+    : public ReducerBase
+    {
+        typedef PromoteType<T> result_type;
+
+        Impl()
+        {
+            reduce_detail::initLanes(lanes_, result_type(1));
+        }
+
+        void updateLanes(T const * p)
+        {
+            for(int l=0; l<laneCount; ++l)
+                lanes_[l] *= p[l];
+        }
+
+        void update(T const & v)
+        {
+            lanes_[0] *= v;
+        }
+
+        void merge(Impl const & o)
+        {
+            for(int l=0; l<laneCount; ++l)
+                lanes_[l] *= o.lanes_[l];
+        }
+
+        result_type result() const
+        {
+            return reduce_detail::combineLanes(lanes_,
+                       [](result_type a, result_type b) { return a * b; });
+        }
+
+        result_type lanes_[laneCount];
+    };
+};
+
+    /** \brief Smallest element.
+    */
+struct Minimum
+{
+    template <class T>
+    struct Impl
+    : public ReducerBase
+    {
+        typedef T result_type;
+
+        Impl()
+        {
+            reduce_detail::initLanes(lanes_, NumericTraits<T>::max());
+        }
+
+        void updateLanes(T const * p)
+        {
+            for(int l=0; l<laneCount; ++l)
+                lanes_[l] = p[l] < lanes_[l] ? p[l] : lanes_[l];
+        }
+
+        void update(T const & v)
+        {
+            lanes_[0] = v < lanes_[0] ? v : lanes_[0];
+        }
+
+        void merge(Impl const & o)
+        {
+            updateLanes(o.lanes_);
+        }
+
+        result_type result() const
+        {
+            return reduce_detail::combineLanes(lanes_,
+                       [](T a, T b) { return b < a ? b : a; });
+        }
+
+        T lanes_[laneCount];
+    };
+};
+
+    /** \brief Largest element.
+    */
+struct Maximum
+{
+    template <class T>
+    struct Impl
+    : public ReducerBase
+    {
+        typedef T result_type;
+
+        Impl()
+        {
+            reduce_detail::initLanes(lanes_, NumericTraits<T>::min());
+        }
+
+        void updateLanes(T const * p)
+        {
+            for(int l=0; l<laneCount; ++l)
+                lanes_[l] = lanes_[l] < p[l] ? p[l] : lanes_[l];
+        }
+
+        void update(T const & v)
+        {
+            lanes_[0] = lanes_[0] < v ? v : lanes_[0];
+        }
+
+        void merge(Impl const & o)
+        {
+            updateLanes(o.lanes_);
+        }
+
+        result_type result() const
+        {
+            return reduce_detail::combineLanes(lanes_,
+                       [](T a, T b) { return a < b ? b : a; });
+        }
+
+        T lanes_[laneCount];
+    };
+};
+
+    /** \brief Arithmetic mean (accumulated in double precision).
+    */
+struct Mean
+{
+    template <class T>
+    struct Impl
+    : public ReducerBase
+    {
+        typedef reduce_detail::RealType<T> result_type;
+
+        Impl()
+        {
+            reduce_detail::initLanes(lanes_, result_type());
+        }
+
+        void updateLanes(T const * p)
+        {
+            for(int l=0; l<laneCount; ++l)
+                lanes_[l] += p[l];
+            count_ += laneCount;
+        }
+
+        void update(T const & v)
+        {
+            lanes_[0] += v;
+            ++count_;
+        }
+
+        void merge(Impl const & o)
+        {
+            for(int l=0; l<laneCount; ++l)
+                lanes_[l] += o.lanes_[l];
+            count_ += o.count_;
+        }
+
+        result_type result() const
+        {
+            return reduce_detail::combineLanes(lanes_,
+                       [](result_type a, result_type b) { return a + b; }) / (double)count_;
+        }
+
+        result_type lanes_[laneCount];
+        ArrayIndex count_ = 0;
+    };
+};
+
+    /** \brief Population variance.
+
+        Within a chunk, the lanes accumulate the first and second moment of the
+        data relative to a shift (the chunk's first element), which avoids
+        cancellation when the mean is large compared to the standard deviation.
+        Chunks are combined with the pairwise formula of Chan et al.
+    */
+struct Variance
+{
+    template <class T>
+    struct Impl
+    {
+        typedef reduce_detail::RealType<T> result_type;
+
+        Impl()
+        {
+            reduce_detail::initLanes(s1_, result_type());
+            reduce_detail::initLanes(s2_, result_type());
+        }
+
+        void prepare(T const & first)
+        {
+            if(count_ == 0 && !prepared_)
+            {
+                shift_ = first;
+                prepared_ = true;
+            }
+        }
+
+        void updateLanes(T const * p)
+        {
+            for(int l=0; l<laneCount; ++l)
+            {
+                result_type d = p[l] - shift_;
+                s1_[l] += d;
+                s2_[l] += d*d;
+            }
+            count_ += laneCount;
+        }
+
+        void update(T const & v)
+        {
+            result_type d = v - shift_;
+            s1_[0] += d;
+            s2_[0] += d*d;
+            ++count_;
+        }
+
+            // count, mean and sum of squared deviations (combined by
+            // the pairwise formula of acc::Variance)
+        typedef acc::Variance::Impl<T, 1> Moments;
+
+            // moments of the data seen so far
+        Moments moments() const
+        {
+            Moments res = merged_, current;
+            if(count_ > 0)
+            {
+                auto plus = [](result_type a, result_type b) { return a + b; };
+                result_type s1 = reduce_detail::combineLanes(s1_, plus),
+                            s2 = reduce_detail::combineLanes(s2_, plus);
+                current.count_ = (double)count_;
+                current.mean_  = s1 / current.count_;
+                current.m2_    = s2 - s1 * current.mean_;
+                current.mean_ += shift_;
+                res.merge(current);
+            }
+            return res;
+        }
+
+        void merge(Impl const & o)
+        {
+            Moments m = moments();
+            m.merge(o.moments());
+            *this = Impl();
+            merged_ = m;
+        }
+
+        result_type result() const
+        {
+            Moments m = moments();
+            return m.m2_ / m.count_;
+        }
+
+        result_type s1_[laneCount], s2_[laneCount];
+        result_type shift_ = result_type();
+        ArrayIndex count_ = 0;
+        bool prepared_ = false;
+        Moments merged_;
+    };
+};
+
+    /** \brief Standard deviation (square root of the population variance).
+    */
+struct StdDev
+{
+    template <class T>
+    struct Impl
+    : public Variance::Impl<T>
+    {
+        typedef typename Variance::Impl<T>::result_type result_type;
+
+        result_type result() const
+        {
+            using std::sqrt;
+            return sqrt(Variance::Impl<T>::result());
+        }
+    };
+};
+
+    /** \brief Sum of squared elements (in <tt>SquaredNormType<T></tt>, as <tt>squaredNorm()</tt>).
+    */
+struct SquaredNorm
+{
+    template <class T>
+    struct Impl
+    : public ReducerBase
+    {
+        typedef SquaredNormType<T> result_type;
+
+        Impl()
+        {
+            reduce_detail::initLanes(lanes_, result_type());
+        }
+
+        void updateLanes(T const * p)
+        {
+            for(int l=0; l<laneCount; ++l)
+                lanes_[l] += (result_type)p[l] * p[l];
+        }
+
+        void update(T const & v)
+        {
+            lanes_[0] += (result_type)v * v;
+        }
+
+        void merge(Impl const & o)
+        {
+            for(int l=0; l<laneCount; ++l)
+                lanes_[l] += o.lanes_[l];
+        }
+
+        result_type result() const
+        {
+            return reduce_detail::combineLanes(lanes_,
+                       [](result_type a, result_type b) { return a + b; });
+        }
+
+        result_type lanes_[laneCount];
+    };
+};
+
+    /** \brief Euclidean norm (square root of <tt>SquaredNorm</tt>).
+    */
+struct L2Norm
+{
+    template <class T>
+    struct Impl
+    : public SquaredNorm::Impl<T>
+    {
+        typedef NormType<T> result_type;
+
+        result_type result() const
+        {
+            using std::sqrt;
+            return sqrt(SquaredNorm::Impl<T>::result());
+        }
+    };
+};
+
+    /** \brief Sum of absolute values.
+    */
+struct L1Norm
+{
+    template <class T>
+    struct Impl
+    : public ReducerBase
+    {
+        typedef PromoteType<NormType<T>> result_type;
+
+        Impl()
+        {
+            reduce_detail::initLanes(lanes_, result_type());
+        }
+
+        void updateLanes(T const * p)
+        {
+            for(int l=0; l<laneCount; ++l)
+                lanes_[l] += p[l] < T() ? -(result_type)p[l] : (result_type)p[l];
+        }
+
+        void update(T const & v)
+        {
+            lanes_[0] += v < T() ? -(result_type)v : (result_type)v;
+        }
+
+        void merge(Impl const & o)
+        {
+            for(int l=0; l<laneCount; ++l)
+                lanes_[l] += o.lanes_[l];
+        }
+
+        result_type result() const
+        {
+            return reduce_detail::combineLanes(lanes_,
+                       [](result_type a, result_type b) { return a + b; });
+        }
+
+        result_type lanes_[laneCount];
+    };
+};
+
+    /** \brief Largest absolute value.
+    */
+struct LInfNorm
+{
+    template <class T>
+    struct Impl
+    : public ReducerBase
+    {
+        typedef NormType<T> result_type;
+
+        Impl()
+        {
+            reduce_detail::initLanes(lanes_, result_type());
+        }
+
+        void updateLanes(T const * p)
+        {
+            for(int l=0; l<laneCount; ++l)
+            {
+                result_type a = p[l] < T() ? -(result_type)p[l] : (result_type)p[l];
+                lanes_[l] = lanes_[l] < a ? a : lanes_[l];
+            }
+        }
+
+        void update(T const & v)
+        {
+            result_type a = v < T() ? -(result_type)v : (result_type)v;
+            lanes_[0] = lanes_[0] < a ? a : lanes_[0];
+        }
+
+        void merge(Impl const & o)
+        {
+            for(int l=0; l<laneCount; ++l)
+                lanes_[l] = lanes_[l] < o.lanes_[l] ? o.lanes_[l] : lanes_[l];
+        }
+
+        result_type result() const
+        {
+            return reduce_detail::combineLanes(lanes_,
+                       [](result_type a, result_type b) { return a < b ? b : a; });
+        }
+
+        result_type lanes_[laneCount];
+    };
+};
+
+    /** \brief True if all elements are non-zero.
+    */
+struct All
+{
+    template <class T>
+    struct Impl
+    : public ReducerBase
+    {
+        typedef bool result_type;
+
+        void updateLanes(T const * p)
+        {
+            for(int l=0; l<laneCount; ++l)
+                zeros_ |= (p[l] == T());
+        }
+
+        void update(T const & v)
+        {
+            zeros_ |= (v == T());
+        }
+
+        void merge(Impl const & o)
+        {
+            zeros_ |= o.zeros_;
+        }
+
+        result_type result() const
+        {
+            return !zeros_;
+        }
+
+        bool zeros_ = false;
+    };
+};
+
+    /** \brief True if any element is non-zero.
+    */
+struct Any
+{
+    template <class T>
+    struct Impl
+    : public ReducerBase
+    {
+        typedef bool result_type;
+
+        void updateLanes(T const * p)
+        {
+            for(int l=0; l<laneCount; ++l)
+                nonzeros_ |= (p[l] != T());
+        }
+
+        void update(T const & v)
+        {
+            nonzeros_ |= (v != T());
+        }
+
+        void merge(Impl const & o)
+        {
+            nonzeros_ |= o.nonzeros_;
+        }
+
+        result_type result() const
+        {
+            return nonzeros_;
+        }
+
+        bool nonzeros_ = false;
+    };
+};
+
+    /** \brief True if all elements are finite (i.e. neither infinite nor NaN).
+    */
+struct AllFinite
+{
+    template <class T>
+    struct Impl
+    : public ReducerBase
+    {
+        typedef bool result_type;
+
+        void updateLanes(T const * p)
+        {
+            for(int l=0; l<laneCount; ++l)
+                update(p[l]);
+        }
+
+        void update(T const & v)
+        {
+            // v - v is NaN for infinite and NaN values, and zero otherwise
+            nonfinite_ |= !(v - v == T());
+        }
+
+        void merge(Impl const & o)
+        {
+            nonfinite_ |= o.nonfinite_;
+        }
+
+        result_type result() const
+        {
+            return !nonfinite_;
+        }
+
+        bool nonfinite_ = false;
+    };
+};
+
+} // namespace reducers
+
+/********************************************************/
+/*                                                      */
+/*                        reduce                        */
+/*                                                      */
+/********************************************************/
+
+namespace reduce_detail {
+
+template <int I, int SIZE>
+struct ReducerLoop
+{
+    template <class TUPLE, class T>
+    static void prepare(TUPLE & t, T const & v)
+    {
+        std::get<I>(t).prepare(v);
+        ReducerLoop<I+1, SIZE>::prepare(t, v);
+    }
+
+    template <class TUPLE, class T>
+    static void updateLanes(TUPLE & t, T const * p)
+    {
+        std::get<I>(t).updateLanes(p);
+        ReducerLoop<I+1, SIZE>::updateLanes(t, p);
+    }
+
+    template <class TUPLE, class T>
+    static void update(TUPLE & t, T const & v)
+    {
+        std::get<I>(t).update(v);
+        ReducerLoop<I+1, SIZE>::update(t, v);
+    }
+
+    template <class TUPLE>
+    static void merge(TUPLE & t, TUPLE const & o)
+    {
+        std::get<I>(t).merge(std::get<I>(o));
+        ReducerLoop<I+1, SIZE>::merge(t, o);
+    }
+
+    template <class TUPLE, class RESULT>
+    static void result(TUPLE const & t, RESULT & r)
+    {
+        std::get<I>(r) = std::get<I>(t).result();
+        ReducerLoop<I+1, SIZE>::result(t, r);
+    }
+};
+
+template <int SIZE>
+struct ReducerLoop<SIZE, SIZE>
+{
+    template <class TUPLE, class T>
+    static void prepare(TUPLE &, T const &)
+    {}
+
+    template <class TUPLE, class T>
+    static void updateLanes(TUPLE &, T const *)
+    {}
+
+    template <class TUPLE, class T>
+    static void update(TUPLE &, T const &)
+    {}
+
+    template <class TUPLE>
+    static void merge(TUPLE &, TUPLE const &)
+    {}
+
+    template <class TUPLE, class RESULT>
+    static void result(TUPLE const &, RESULT &)
+    {}
+};
+
+    // reduce a line of 'n' elements starting at 'p' with the given byte stride
+template <class IMPLS, class T>
+void
+reduceLine(IMPLS & impls, T const * p, ArrayIndex n, ArrayIndex stride)
+{
+    typedef ReducerLoop<0, std::tuple_size<IMPLS>::value> Loop;
+    ArrayIndex k = 0;
+    if(stride == sizeof(T))
+    {
+        for(; k + laneCount <= n; k += laneCount)
+            Loop::updateLanes(impls, p + k);
+        for(; k < n; ++k)
+            Loop::update(impls, p[k]);
+    }
+    else
+    {
+        char const * q = reinterpret_cast<char const *>(p);
+        T buffer[laneCount];
+        for(; k + laneCount <= n; k += laneCount)
+        {
+            for(int l=0; l<laneCount; ++l, q += stride)
+                buffer[l] = *reinterpret_cast<T const *>(q);
+            Loop::updateLanes(impls, buffer);
+        }
+        for(; k < n; ++k, q += stride)
+            Loop::update(impls, *reinterpret_cast<T const *>(q));
+    }
+}
+
+template <class IMPLS, class T, class SHAPE>
+void
+reduceND(IMPLS & impls, char const * p, SHAPE const & shape, SHAPE const & strides, int dim)
+{
+    if(dim == shape.size() - 1)
+    {
+        reduceLine(impls, reinterpret_cast<T const *>(p), shape[dim], strides[dim]);
+    }
+    else
+    {
+        for(ArrayIndex k=0; k<shape[dim]; ++k, p += strides[dim])
+            reduceND<IMPLS, T>(impls, p, shape, strides, dim+1);
+    }
+}
+
+    // reduce an array whose elements are visited in memory order
+template <class IMPLS, int N, class T>
+void
+reduceArray(IMPLS & impls, ArrayViewND<N, T> const & a)
+{
+    typedef ReducerLoop<0, std::tuple_size<IMPLS>::value> Loop;
+    if(a.size() == 0)
+        return;
+    Loop::prepare(impls, *a.data());
+    if(a.isConsecutive())
+    {
+        reduceLine(impls, a.data(), a.size(), sizeof(T));
+        return;
+    }
+    Shape<N> strides = a.byte_strides();
+    for(int k=0; k<a.ndim(); ++k)
+        if(a.shape(k) == 1)
+            strides[k] = 0;
+    Shape<N> p = detail::permutationToOrder(strides, C_ORDER);
+    reduceND<IMPLS, T>(impls, reinterpret_cast<char const *>(a.data()),
+                       a.shape().transpose(p), a.byte_strides().transpose(p), 0);
+}
+
+} // namespace reduce_detail
+
+    /** \brief Compute several statistics of an array in a single pass.
+
+        The reducers (see namespace <tt>vigra::reducers</tt>) are evaluated together
+        while the array is traversed once in memory order. Each reducer distributes
+        consecutive elements over several lanes of partial results, so that the inner
+        loop is free of loop-carried dependencies and can be vectorized.
+        The results are returned as a <tt>std::tuple</tt> in the order of the reducers.
+
+        If \a options requests several threads (the default, like the other parallel
+        algorithms, is <tt>ParallelOptions::Auto</tt>), the array is split into chunks
+        (see \ref parallelForeachChunk()). The partial results are combined in chunk
+        order, so the result for a given thread count is reproducible.
+
+        \code
+        ArrayND<3, float> volume(...);
+        auto stats = reduce(volume, reducers::Mean(), reducers::Variance(),
+                                    reducers::Minimum(), reducers::Maximum(),
+                                    reducers::L2Norm());
+        double mean = std::get<0>(stats);
+        \endcode
+
+        <b>\#include</b> \<vigra2/reduce.hxx\><br>
+        Namespace: vigra
+    */
+template <int N, class T, class ... REDUCERS>
+std::tuple<typename REDUCERS::template Impl<T>::result_type...>
+reduce(ArrayViewND<N, T> const & a, ParallelOptions const & options, REDUCERS const & ...)
+{
+    static_assert(std::is_arithmetic<T>::value,
+        "reduce(): array must have a scalar arithmetic value_type.");
+    static_assert(sizeof...(REDUCERS) > 0,
+        "reduce(): at least one reducer required.");
+
+    typedef std::tuple<typename REDUCERS::template Impl<T>...>               Impls;
+    typedef std::tuple<typename REDUCERS::template Impl<T>::result_type...>  Result;
+    typedef reduce_detail::ReducerLoop<0, sizeof...(REDUCERS)>               Loop;
+
+    std::vector<Impls> partials(options.getActualNumThreads());
+    int chunkCount = 0;
+    if(a.isConsecutive())
+    {
+        chunkCount = parallelForeachChunk(a.size(), options,
+            [&partials, &a](int chunk, ArrayIndex begin, ArrayIndex end)
+            {
+                Loop::prepare(partials[chunk], a.data()[begin]);
+                reduce_detail::reduceLine(partials[chunk], a.data() + begin, end - begin, sizeof(T));
+            }, 1 << 16);
+    }
+    else
+    {
+        chunkCount = parallelForeachChunk(a, options,
+            [&partials](int chunk, ArrayViewND<N, T> const & part)
+            {
+                reduce_detail::reduceArray(partials[chunk], part);
+            });
+    }
+    for(int k=1; k<chunkCount; ++k)
+        Loop::merge(partials[0], partials[k]);
+
+    Result res;
+    Loop::result(partials[0], res);
+    return res;
+}
+
+template <int N, class T, class ... REDUCERS>
+inline std::tuple<typename REDUCERS::template Impl<T>::result_type...>
+reduce(ArrayViewND<N, T> const & a, REDUCERS const & ... reducers)
+{
+    return reduce(a, ParallelOptions(), reducers...);
+}
+
+} // namespace vigra
+
+#endif // VIGRA2_REDUCE_HXX
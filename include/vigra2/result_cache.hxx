@@ -0,0 +1,597 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014-2017 by Ullrich Koethe                  */
+/*                                                                      */
+/*    This file is part of the VIGRA2 computer vision library.          */
+/*    The VIGRA2 Website is                                             */
+/*        http://ukoethe.github.io/vigra2                               */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#pragma once
+
+#ifndef VIGRA2_RESULT_CACHE_HXX
+#define VIGRA2_RESULT_CACHE_HXX
+
+#include "config.hxx"
+#include "error.hxx"
+#include "numeric_traits.hxx"
+#include "tinyarray.hxx"
+#include "tags.hxx"
+#include "array_nd.hxx"
+#include "shared_array_nd.hxx"
+#include "array_file.hxx"
+#include "checksum.hxx"
+#include "parallel.hxx"
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+#include <unistd.h>
+
+namespace vigra {
+
+/********************************************************/
+/*                                                      */
+/*                       CacheKey                       */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Key identifying the result of an operation in a <tt>ResultCache</tt>.
+
+        The key consists of the operation's name and its arguments, which are
+        appended by <tt>add()</tt>. Numbers and strings are encoded exactly.
+        Arrays are represented by their element type, shape, and content
+        hash (the CRC-32C and CRC-32 checksums of the elements in C-order, see
+        <tt>crc32c(ArrayViewND)</tt>), so that the key doesn't depend on the
+        memory layout. With two independent 32-bit checksums, different inputs
+        of the same shape are confused with probability about 2<sup>-64</sup>.
+        \code
+        CacheKey key = CacheKey("gaussianGradient").add(image).add(sigma)
+                                                   .add(BORDER_TREATMENT_REFLECT);
+        \endcode
+
+        <b>\#include</b> \<vigra2/result_cache.hxx\><br>
+        Namespace: vigra
+    */
+class CacheKey
+{
+  public:
+    explicit CacheKey(std::string const & operation)
+    : key_(operation)
+    {}
+
+        /** Append a string argument.
+        */
+    CacheKey & add(std::string const & s)
+    {
+        key_ += "|s" + std::to_string(s.size()) + ":" + s;
+        return *this;
+    }
+
+    CacheKey & add(char const * s)
+    {
+        return add(std::string(s));
+    }
+
+        /** Append a number, a <tt>bool</tt>, or an enum value (e.g.
+            <tt>BorderTreatmentMode</tt>).
+        */
+    template <class V>
+    enable_if_t<std::is_integral<V>::value || std::is_enum<V>::value,
+                CacheKey &>
+    add(V v)
+    {
+        key_ += "|i" + std::to_string((long long)v);
+        return *this;
+    }
+
+    template <class V>
+    enable_if_t<std::is_floating_point<V>::value,
+                CacheKey &>
+    add(V v)
+    {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.17g", (double)v);
+        key_ += std::string("|d") + buffer;
+        return *this;
+    }
+
+        /** Append a parameter vector (e.g. per-axis scales).
+        */
+    template <class V, int ... M>
+    CacheKey & add(TinyArray<V, M...> const & v)
+    {
+        key_ += "|v" + std::to_string(v.size());
+        for(auto const & x : v)
+            add(x);
+        return *this;
+    }
+
+        /** Append an array by its element type, shape, and content hash.
+        */
+    template <int N, class T>
+    CacheKey & add(ArrayViewND<N, T> const & a,
+                   ParallelOptions const & options = ParallelOptions())
+    {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%08x%08x",
+                      (unsigned int)crc32c(a, options), (unsigned int)checksum(a, options));
+        key_ += std::string("|a") + typeid(T).name() + ":" + std::to_string(a.ndim());
+        for(int k=0; k<a.ndim(); ++k)
+            key_ += ":" + std::to_string(a.shape(k));
+        key_ += std::string(":") + buffer;
+        return *this;
+    }
+
+    std::string const & str() const
+    {
+        return key_;
+    }
+
+    bool operator==(CacheKey const & other) const
+    {
+        return key_ == other.key_;
+    }
+
+    bool operator!=(CacheKey const & other) const
+    {
+        return key_ != other.key_;
+    }
+
+  private:
+    std::string key_;
+};
+
+namespace result_cache_detail {
+
+struct Entry
+{
+    std::string key;
+    std::type_index type;
+    std::size_t bytes;
+        // the cached SharedArrayND (empty when the entry has been spilled)
+    std::shared_ptr<void> value;
+        // write the value to the given file (empty if the type can't be spilled)
+    std::function<void(std::string const &)> spill;
+        // file holding a copy of the value (empty if not spilled yet)
+    std::string filename;
+        // the value while its file is being written (outside the lock)
+    std::shared_ptr<void> writing;
+
+    Entry(std::string const & k, std::type_index t, std::size_t b)
+    : key(k)
+    , type(t)
+    , bytes(b)
+    {}
+};
+
+template <int N, class T>
+std::function<void(std::string const &)>
+spillFunction(std::shared_ptr<SharedArrayND<N, T>> const & value, std::true_type)
+{
+    return [value](std::string const & filename)
+    {
+        writeArray(filename, *value);
+    };
+}
+
+template <int N, class T>
+std::function<void(std::string const &)>
+spillFunction(std::shared_ptr<SharedArrayND<N, T>> const &, std::false_type)
+{
+    return std::function<void(std::string const &)>();
+}
+
+    // a file to be written after the cache's lock has been released
+struct SpillJob
+{
+    std::string key, filename;
+    std::function<void(std::string const &)> spill;
+};
+
+} // namespace result_cache_detail
+
+/********************************************************/
+/*                                                      */
+/*                     ResultCache                      */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Memoization cache for the results of expensive array operations.
+
+        Results are stored as <tt>SharedArrayND</tt> under a <tt>CacheKey</tt> that
+        identifies the operation, its parameters, and the contents of its input
+        arrays. An operation opts in by calling <tt>get(key, compute)</tt>, which
+        returns the cached result or calls <tt>compute()</tt> and caches its result.
+        Returned arrays share memory with the cache, and their copy-on-write
+        assignment operators protect the cached data. Writing to the shared buffer
+        by other means (e.g. algorithms writing into views) modifies the cached result.
+
+        The memory used by cached arrays is limited by \a memoryBudget (in bytes).
+        When the budget is exceeded, the least recently used results are evicted
+        or, if a \a spillDirectory is given, moved to disk in the binary array
+        format (see <tt>writeArray()</tt>). The cache creates a private
+        subdirectory for its files and removes it in the destructor. Spilled
+        results are memory-mapped when requested again (see <tt>MappedArrayND</tt>)
+        and count towards the memory budget from then on. The disk usage is limited
+        by \a diskBudget. Element types not supported by <tt>writeArray()</tt> are
+        evicted instead of being spilled.
+
+        All member functions are thread-safe. When several threads request the
+        same missing result simultaneously, each of them computes it.
+        \code
+        ResultCache cache(1 << 30, "/tmp");    // 1 GB in memory, spill to /tmp
+
+        SharedArrayND<3, float>
+        cachedStructureTensorTrace(ResultCache & cache, ArrayViewND<3, float> const & volume,
+                                   double innerScale, double outerScale)
+        {
+            CacheKey key = CacheKey("structureTensorTrace").add(volume)
+                                                            .add(innerScale).add(outerScale);
+            return cache.get<3, float>(key, [&]()
+            {
+                return structureTensorTrace(volume, innerScale, outerScale);  // expensive
+            });
+        }
+        \endcode
+
+        <b>\#include</b> \<vigra2/result_cache.hxx\><br>
+        Namespace: vigra
+    */
+class ResultCache
+{
+    typedef result_cache_detail::Entry Entry;
+    typedef result_cache_detail::SpillJob SpillJob;
+    typedef std::list<Entry>::iterator EntryIterator;
+
+  public:
+        /** Statistics about the cache's effectiveness.
+        */
+    struct Statistics
+    {
+        std::size_t hits, misses, spills, reloads, evictions;
+
+        Statistics()
+        : hits(0), misses(0), spills(0), reloads(0), evictions(0)
+        {}
+    };
+
+    explicit
+    ResultCache(std::size_t memoryBudget,
+                std::string const & spillDirectory = "",
+                std::size_t diskBudget = ~std::size_t(0))
+    : memoryBudget_(memoryBudget)
+    , diskBudget_(diskBudget)
+    , memoryUsage_(0)
+    , diskUsage_(0)
+    , fileCount_(0)
+    {
+        if(spillDirectory != "")
+        {
+            std::string pattern = spillDirectory + "/vigra2-cache-XXXXXX";
+            std::vector<char> buffer(pattern.begin(), pattern.end());
+            buffer.push_back('\0');
+            if(::mkdtemp(buffer.data()) == 0)
+                vigra_fail("ResultCache(): unable to create a directory in '" + spillDirectory + "'.");
+            directory_ = buffer.data();
+        }
+    }
+
+    ResultCache(ResultCache const &) = delete;
+    ResultCache & operator=(ResultCache const &) = delete;
+
+    ~ResultCache()
+    {
+        clear();
+        if(directory_ != "")
+            ::rmdir(directory_.c_str());
+    }
+
+        /** Return the result for \a key, computing it by <tt>compute()</tt>
+            if it is not in the cache. <tt>compute()</tt> must return an
+            <tt>ArrayND&lt;N, T&gt;</tt> or a <tt>SharedArrayND&lt;N, T&gt;</tt>.
+        */
+    template <int N, class T, class FCT>
+    SharedArrayND<N, T> get(CacheKey const & key, FCT && compute)
+    {
+        SharedArrayND<N, T> res;
+        if(!lookup(key, res))
+        {
+            res = SharedArrayND<N, T>(compute());
+            insert(key, res);
+        }
+        return res;
+    }
+
+        /** Look up \a key and store the result in \a res. Returns <tt>false</tt>
+            if \a key is not in the cache.
+        */
+    template <int N, class T>
+    bool lookup(CacheKey const & key, SharedArrayND<N, T> & res)
+    {
+        std::unique_lock<std::mutex> guard(lock_);
+        auto i = index_.find(key.str());
+        if(i == index_.end())
+        {
+            ++statistics_.misses;
+            return false;
+        }
+        Entry & e = *i->second;
+        vigra_precondition(e.type == std::type_index(typeid(SharedArrayND<N, T>)),
+            "ResultCache::lookup(): element type or dimension mismatch for key '" + key.str() + "'.");
+        lru_.splice(lru_.begin(), lru_, i->second);
+        if(!e.value)
+        {
+            if(e.writing)
+            {
+                // the file is still being written, take the value back
+                e.value = e.writing;
+            }
+            else
+            {
+                // reload a spilled result by mapping its file
+                try
+                {
+                    auto mapped = std::make_shared<MappedArrayND<N, T>>(e.filename);
+                    e.value = std::make_shared<SharedArrayND<N, T>>(*mapped, mapped);
+                }
+                catch(std::exception &)
+                {
+                    // the file is missing or damaged, let the caller recompute the result
+                    remove(i->second);
+                    ++statistics_.misses;
+                    return false;
+                }
+                ++statistics_.reloads;
+            }
+            ++statistics_.hits;
+            memoryUsage_ += e.bytes;
+            res = *std::static_pointer_cast<SharedArrayND<N, T>>(e.value);
+            std::vector<SpillJob> jobs = enforceBudget();
+            guard.unlock();
+            writeSpills(jobs);
+        }
+        else
+        {
+            ++statistics_.hits;
+            res = *std::static_pointer_cast<SharedArrayND<N, T>>(e.value);
+        }
+        return true;
+    }
+
+        /** Store \a value under \a key (replacing an existing result).
+        */
+    template <int N, class T>
+    void insert(CacheKey const & key, SharedArrayND<N, T> const & value)
+    {
+        typedef std::integral_constant<bool, ElementTypeCode<T>::kind != 0> Spillable;
+
+        auto shared = std::make_shared<SharedArrayND<N, T>>(value);
+        std::unique_lock<std::mutex> guard(lock_);
+        auto i = index_.find(key.str());
+        if(i != index_.end())
+            remove(i->second);
+        lru_.emplace_front(key.str(), std::type_index(typeid(SharedArrayND<N, T>)),
+                           value.size()*sizeof(T));
+        Entry & e = lru_.front();
+        e.value = shared;
+        e.spill = result_cache_detail::spillFunction(shared, Spillable());
+        index_[e.key] = lru_.begin();
+        memoryUsage_ += e.bytes;
+        std::vector<SpillJob> jobs = enforceBudget();
+        guard.unlock();
+        writeSpills(jobs);
+    }
+
+        /** Check if \a key is in the cache (in memory or on disk).
+        */
+    bool contains(CacheKey const & key) const
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        return index_.find(key.str()) != index_.end();
+    }
+
+        /** Remove \a key from the cache.
+        */
+    void erase(CacheKey const & key)
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        auto i = index_.find(key.str());
+        if(i != index_.end())
+            remove(i->second);
+    }
+
+        /** Remove all results from the cache.
+        */
+    void clear()
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        while(!lru_.empty())
+            remove(lru_.begin());
+    }
+
+        /** Number of cached results (in memory or on disk).
+        */
+    std::size_t size() const
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        return lru_.size();
+    }
+
+    std::size_t memoryUsage() const
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        return memoryUsage_;
+    }
+
+    std::size_t diskUsage() const
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        return diskUsage_;
+    }
+
+    std::size_t memoryBudget() const
+    {
+        return memoryBudget_;
+    }
+
+    std::string const & spillDirectory() const
+    {
+        return directory_;
+    }
+
+    Statistics statistics() const
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        return statistics_;
+    }
+
+  private:
+        // Evict the least recently used results until the budgets are met (lock
+        // must be held). Results to be spilled are detached from the memory budget
+        // immediately, but their files are written by writeSpills() after the
+        // lock has been released, so that other threads are not blocked by the I/O.
+    std::vector<SpillJob> enforceBudget()
+    {
+        std::vector<SpillJob> jobs;
+        for(auto i = lru_.end(); memoryUsage_ > memoryBudget_ && i != lru_.begin(); )
+        {
+            if(!(--i)->value)
+                continue;
+            if(i->filename == "" && directory_ != "" && i->spill && i->bytes <= diskBudget_)
+            {
+                i->filename = directory_ + "/" + std::to_string(fileCount_++) + ".v2a";
+                i->writing = i->value;
+                jobs.push_back(SpillJob{ i->key, i->filename, std::move(i->spill) });
+                i->spill = std::function<void(std::string const &)>();
+                diskUsage_ += i->bytes;
+            }
+            if(i->filename != "")
+            {
+                // the result remains available on disk
+                i->value.reset();
+                memoryUsage_ -= i->bytes;
+            }
+            else
+            {
+                i = remove(i);
+                ++statistics_.evictions;
+            }
+        }
+        for(auto i = lru_.end(); diskUsage_ > diskBudget_ && i != lru_.begin(); )
+        {
+            if((--i)->filename != "")
+            {
+                i = remove(i);
+                ++statistics_.evictions;
+            }
+        }
+        return jobs;
+    }
+
+        // write the files of detached results (lock must not be held)
+    void writeSpills(std::vector<SpillJob> & jobs)
+    {
+        for(auto & job : jobs)
+        {
+            bool written = true;
+            try
+            {
+                job.spill(job.filename);
+            }
+            catch(std::exception &)
+            {
+                written = false;
+            }
+
+            std::unique_lock<std::mutex> guard(lock_);
+            auto i = index_.find(job.key);
+            if(i == index_.end() || i->second->filename != job.filename)
+            {
+                // the result was removed in the meantime
+                std::remove(job.filename.c_str());
+            }
+            else if(written)
+            {
+                i->second->writing.reset();
+                ++statistics_.spills;
+            }
+            else if(i->second->value)
+            {
+                // lookup() has taken the result back, keep it in memory only
+                Entry & e = *i->second;
+                std::remove(e.filename.c_str());
+                e.filename = "";
+                e.writing.reset();
+                e.spill = std::move(job.spill);
+                diskUsage_ -= e.bytes;
+            }
+            else
+            {
+                // keeping the result in memory would exceed the budget
+                remove(i->second);
+                ++statistics_.evictions;
+            }
+            guard.unlock();
+            job.spill = std::function<void(std::string const &)>();
+        }
+    }
+
+    EntryIterator remove(EntryIterator i)
+    {
+        if(i->value)
+            memoryUsage_ -= i->bytes;
+        if(i->filename != "")
+        {
+            diskUsage_ -= i->bytes;
+            std::remove(i->filename.c_str());
+        }
+        index_.erase(i->key);
+        return lru_.erase(i);
+    }
+
+    std::size_t memoryBudget_, diskBudget_, memoryUsage_, diskUsage_, fileCount_;
+    std::string directory_;
+    std::list<Entry> lru_;
+    std::unordered_map<std::string, EntryIterator> index_;
+    Statistics statistics_;
+    mutable std::mutex lock_;
+};
+
+} // namespace vigra
+
+#endif // VIGRA2_RESULT_CACHE_HXX
@@ -0,0 +1,390 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014-2017 by Ullrich Koethe                  */
+/*                                                                      */
+/*    This file is part of the VIGRA2 computer vision library.          */
+/*    The VIGRA2 Website is                                             */
+/*        http://ukoethe.github.io/vigra2                               */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#pragma once
+
+#ifndef VIGRA2_SCRATCH_HXX
+#define VIGRA2_SCRATCH_HXX
+
+#include "config.hxx"
+#include "error.hxx"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace vigra {
+
+/********************************************************/
+/*                                                      */
+/*                     ScratchArena                     */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Bump allocator for temporary memory of algorithms.
+
+        Allocation just advances a pointer in a large block of memory, and
+        all memory allocated after a marker is released at once by
+        <tt>rewind(marker)</tt> (usually via a <tt>ScratchScope</tt>).
+        Blocks are kept after rewinding, so that subsequent temporaries reuse
+        memory that is already mapped instead of page-faulting fresh allocations.
+        <tt>deallocate()</tt> only reclaims memory when it is the most recent
+        allocation.
+
+        When the arena becomes empty (e.g. when the outermost <tt>ScratchScope</tt>
+        exits), blocks exceeding <tt>retainedCapacity()</tt> are returned to the
+        system, so that a single large temporary doesn't pin its memory for
+        the lifetime of the thread. <tt>trim()</tt> releases all unused blocks.
+
+        Each thread has its own arena, which is returned by <tt>ScratchArena::local()</tt>.
+        An arena must only be used by a single thread.
+
+        <b>\#include</b> \<vigra2/scratch.hxx\><br>
+        Namespace: vigra
+    */
+class ScratchArena
+{
+  public:
+
+        /** Default alignment of allocations (a cache line).
+        */
+    static const std::size_t default_alignment = 64;
+
+        /** Minimal size of a newly allocated block.
+        */
+    static const std::size_t min_block_size = 1 << 20;
+
+        /** Default of <tt>retainedCapacity()</tt>.
+        */
+    static const std::size_t default_retained_capacity = 1 << 26;
+
+        /** Position in the arena, see <tt>mark()</tt> and <tt>rewind()</tt>.
+        */
+    struct Marker
+    {
+        std::size_t block, offset;
+    };
+
+    ScratchArena()
+    : current_(0)
+    , offset_(0)
+    , retained_(default_retained_capacity)
+    {}
+
+    ScratchArena(ScratchArena const &) = delete;
+    ScratchArena & operator=(ScratchArena const &) = delete;
+
+        /** The arena of the calling thread.
+        */
+    static ScratchArena & local()
+    {
+        static thread_local ScratchArena arena;
+        return arena;
+    }
+
+        /** Allocate \a bytes of memory with the given \a alignment
+            (which must be a power of two).
+        */
+    void * allocate(std::size_t bytes, std::size_t alignment = default_alignment)
+    {
+        vigra_precondition(alignment > 0 && (alignment & (alignment - 1)) == 0,
+            "ScratchArena::allocate(): alignment must be a power of two.");
+        while(true)
+        {
+            if(current_ < blocks_.size())
+            {
+                Block & b = blocks_[current_];
+                std::size_t start = alignedOffset(b, offset_, alignment);
+                if(start + bytes <= b.size)
+                {
+                    offset_ = start + bytes;
+                    return b.data.get() + start;
+                }
+                if(offset_ == 0 && current_ + 1 == blocks_.size())
+                {
+                    // an unused block that is too small => replace it
+                    blocks_.pop_back();
+                    continue;
+                }
+                ++current_;
+                offset_ = 0;
+                // the following block is unused, replace it when it is too small
+                if(current_ < blocks_.size() &&
+                   blocks_[current_].size < bytes + alignment)
+                {
+                    blocks_.erase(blocks_.begin() + current_, blocks_.end());
+                }
+                continue;
+            }
+            std::size_t size = std::max(bytes + alignment, std::size_t(min_block_size));
+            if(blocks_.size() > 0)
+                size = std::max(size, 2*blocks_.back().size);
+            blocks_.push_back(Block{std::unique_ptr<char[]>(new char[size]), size});
+            current_ = blocks_.size() - 1;
+            offset_ = 0;
+        }
+    }
+
+        /** Release memory of the most recent allocation. Other
+            calls are ignored (memory is reclaimed by <tt>rewind()</tt>).
+        */
+    void deallocate(void * p, std::size_t bytes)
+    {
+        if(current_ < blocks_.size() &&
+           static_cast<char *>(p) + bytes == blocks_[current_].data.get() + offset_)
+        {
+            offset_ = static_cast<char *>(p) - blocks_[current_].data.get();
+        }
+    }
+
+        /** Get the current position.
+        */
+    Marker mark() const
+    {
+        return Marker{current_, offset_};
+    }
+
+        /** Release all memory allocated since \a marker was obtained.
+        */
+    void rewind(Marker const & marker)
+    {
+        vigra_precondition(marker.block < current_ ||
+                           (marker.block == current_ && marker.offset <= offset_),
+            "ScratchArena::rewind(): marker lies behind the current position.");
+        current_ = marker.block;
+        offset_  = marker.offset;
+        if(current_ == 0 && offset_ == 0)
+            release(retained_);
+    }
+
+        /** Number of bytes currently in use (including alignment padding
+            and unused space at the end of full blocks).
+        */
+    std::size_t used() const
+    {
+        std::size_t res = offset_;
+        for(std::size_t k=0; k<current_ && k<blocks_.size(); ++k)
+            res += blocks_[k].size;
+        return res;
+    }
+
+        /** Total number of bytes held by the arena.
+        */
+    std::size_t capacity() const
+    {
+        std::size_t res = 0;
+        for(auto const & b : blocks_)
+            res += b.size;
+        return res;
+    }
+
+        /** Return the blocks that are currently unused to the system.
+        */
+    void trim()
+    {
+        std::size_t keep = offset_ > 0 ? current_ + 1 : current_;
+        if(keep < blocks_.size())
+            blocks_.erase(blocks_.begin() + keep, blocks_.end());
+    }
+
+        /** Maximal number of bytes kept when the arena becomes empty.
+        */
+    std::size_t retainedCapacity() const
+    {
+        return retained_;
+    }
+
+    void setRetainedCapacity(std::size_t bytes)
+    {
+        retained_ = bytes;
+        if(current_ == 0 && offset_ == 0)
+            release(retained_);
+    }
+
+  private:
+    struct Block
+    {
+        std::unique_ptr<char[]> data;
+        std::size_t size;
+    };
+
+    static std::size_t alignedOffset(Block const & b, std::size_t offset, std::size_t alignment)
+    {
+        std::uintptr_t p = reinterpret_cast<std::uintptr_t>(b.data.get()) + offset;
+        return offset + ((alignment - p % alignment) % alignment);
+    }
+
+        // drop the last blocks of an empty arena until at most 'bytes' remain
+    void release(std::size_t bytes)
+    {
+        std::size_t total = capacity();
+        while(total > bytes)
+        {
+            total -= blocks_.back().size;
+            blocks_.pop_back();
+        }
+    }
+
+    std::vector<Block> blocks_;
+    std::size_t current_, offset_, retained_;
+};
+
+/********************************************************/
+/*                                                      */
+/*                     ScratchScope                     */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Rewind a ScratchArena at the end of a scope.
+
+        All temporaries that live in the arena must be destroyed before
+        the scope object, i.e. the scope must be created first:
+        \code
+        {
+            ScratchScope scope;
+            ArrayND<2, float, ScratchAllocator<float>> tmp(shape);
+            ...
+        }   // 'tmp' is destroyed, then the arena is rewound
+        \endcode
+
+        <b>\#include</b> \<vigra2/scratch.hxx\><br>
+        Namespace: vigra
+    */
+class ScratchScope
+{
+  public:
+    explicit ScratchScope(ScratchArena & arena = ScratchArena::local())
+    : arena_(arena)
+    , marker_(arena.mark())
+    {}
+
+    ScratchScope(ScratchScope const &) = delete;
+    ScratchScope & operator=(ScratchScope const &) = delete;
+
+    ~ScratchScope()
+    {
+        arena_.rewind(marker_);
+    }
+
+    ScratchArena & arena() const
+    {
+        return arena_;
+    }
+
+  private:
+    ScratchArena & arena_;
+    ScratchArena::Marker marker_;
+};
+
+/********************************************************/
+/*                                                      */
+/*                   ScratchAllocator                   */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Standard allocator that obtains its memory from a ScratchArena.
+
+        By default, the calling thread's arena is used. The allocator can
+        be passed to <tt>ArrayND</tt> and the standard containers, so that
+        temporaries are placed in the arena:
+        \code
+        ScratchScope scope;
+        ArrayND<3, float, ScratchAllocator<float>> tmp(shape);
+        \endcode
+
+        <b>\#include</b> \<vigra2/scratch.hxx\><br>
+        Namespace: vigra
+    */
+template <class T>
+class ScratchAllocator
+{
+  public:
+    typedef T value_type;
+
+    template <class U>
+    struct rebind
+    {
+        typedef ScratchAllocator<U> other;
+    };
+
+    ScratchAllocator(ScratchArena & arena = ScratchArena::local())
+    : arena_(&arena)
+    {}
+
+    template <class U>
+    ScratchAllocator(ScratchAllocator<U> const & other)
+    : arena_(&other.arena())
+    {}
+
+    T * allocate(std::size_t n)
+    {
+        std::size_t alignment = alignof(T) > ScratchArena::default_alignment
+                                    ? alignof(T)
+                                    : ScratchArena::default_alignment;
+        return static_cast<T *>(arena_->allocate(n*sizeof(T), alignment));
+    }
+
+    void deallocate(T * p, std::size_t n)
+    {
+        arena_->deallocate(p, n*sizeof(T));
+    }
+
+    ScratchArena & arena() const
+    {
+        return *arena_;
+    }
+
+  private:
+    ScratchArena * arena_;
+};
+
+template <class T, class U>
+inline bool
+operator==(ScratchAllocator<T> const & a, ScratchAllocator<U> const & b)
+{
+    return &a.arena() == &b.arena();
+}
+
+template <class T, class U>
+inline bool
+operator!=(ScratchAllocator<T> const & a, ScratchAllocator<U> const & b)
+{
+    return &a.arena() != &b.arena();
+}
+
+} // namespace vigra
+
+#endif // VIGRA2_SCRATCH_HXX
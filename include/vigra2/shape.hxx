@@ -162,7 +162,8 @@ namespace detail {
 
     // Compute a permutation that transposes an array with given strides
     // into the given order (C_ORDER or F_ORDER). Singleton axes must be
-    // marked by zero strides.
+    // marked by zero strides. Negative strides (reversed axes) are ordered
+    // by their magnitude.
     //
     // In case of C_ORDER, the transposed array will have ascending strides,
     // except for singleton dimensions, which will be placed into the leading
@@ -171,8 +172,11 @@ namespace detail {
     // over the last dimensions. In case of F_ORDER, the transposition is reversed.
 template <int N>
 inline Shape<N>
-permutationToOrder(Shape<N> const & stride, MemoryOrder order)
+permutationToOrder(Shape<N> stride, MemoryOrder order)
 {
+    for(int k=0; k<stride.size(); ++k)
+        if(stride[k] < 0)
+            stride[k] = -stride[k];
     Shape<N> res = Shape<N>::range(stride.size());
     if(order == C_ORDER)
         std::sort(res.begin(), res.end(),
@@ -0,0 +1,424 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014-2017 by Ullrich Koethe                  */
+/*                                                                      */
+/*    This file is part of the VIGRA2 computer vision library.          */
+/*    The VIGRA2 Website is                                             */
+/*        http://ukoethe.github.io/vigra2                               */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#pragma once
+
+#ifndef VIGRA2_SHARED_ARRAY_ND_HXX
+#define VIGRA2_SHARED_ARRAY_ND_HXX
+
+#include "config.hxx"
+#include "error.hxx"
+#include "array_nd.hxx"
+#include <memory>
+#include <utility>
+
+namespace vigra {
+
+/********************************************************/
+/*                                                      */
+/*                     SharedArrayND                    */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Multi-dimensional array with reference-counted storage.
+
+        <tt>SharedArrayND</tt> is an <tt>ArrayViewND</tt> that keeps its
+        buffer alive via a reference count, so that results can be handed
+        between pipeline stages or threads without copying and without
+        worrying about the lifetime of the producer. Since it is derived from
+        <tt>ArrayViewND</tt>, it can be passed to all algorithms accepting views.
+
+        Copying and assigning another <tt>SharedArrayND</tt> of the same type
+        behave like <tt>std::shared_ptr</tt>: the buffer is shared, not copied.
+        <tt>share(view)</tt> turns a view into the buffer (e.g. a subarray or
+        transpose) into a <tt>SharedArrayND</tt> that keeps the buffer alive as well.
+        An <tt>ArrayND</tt> passed as an rvalue is adopted without copying.
+
+        Assignment of arrays, expressions, and scalars as well as the
+        arithmetic assignment operators implement copy-on-write: when the
+        buffer is shared, <tt>makeUnique()</tt> first copies the data into a
+        private buffer, so that the other owners don't see the modification.
+        Element access via <tt>operator[]</tt>, iterators, and algorithms writing
+        to an <tt>ArrayViewND</tt> modify the shared buffer directly. Call
+        <tt>makeUnique()</tt> beforehand to get copy-on-write semantics for these
+        operations as well. Plain <tt>ArrayViewND</tt>s of a <tt>SharedArrayND</tt>
+        don't participate in reference counting and keep referring to the old
+        buffer after a copy-on-write.
+
+        The reference count is thread-safe, but a single <tt>SharedArrayND</tt>
+        object must not be modified concurrently (as with <tt>std::shared_ptr</tt>).
+
+        <b>Usage:</b>
+        \code
+        SharedArrayND<2, float> a(Shape<2>{200, 100});
+        SharedArrayND<2, float> b = a;                           // shares the buffer
+        SharedArrayND<2, float> t = a.share(a.transpose());      // also shares the buffer
+        b += 1.0f;                // copy-on-write: 'a' and 't' are unchanged
+        b.makeUnique()[Shape<2>{0, 0}] = 2.0f;   // 'b' already is unique, no copy
+        \endcode
+
+        <b>\#include</b> \<vigra2/shared_array_nd.hxx\><br>
+        Namespace: vigra
+    */
+template <int N, class T>
+class SharedArrayND
+: public ArrayViewND<N, T>
+{
+  public:
+    typedef ArrayViewND<N, T> view_type;
+    typedef typename view_type::value_type value_type;
+    typedef typename view_type::reference reference;
+    typedef typename view_type::const_reference const_reference;
+    typedef typename view_type::difference_type difference_type;
+    typedef typename view_type::axistags_type axistags_type;
+
+  protected:
+
+    template <int M, class U>
+    friend class SharedArrayND;
+
+    std::shared_ptr<void> owner_;
+    TinyArray<char *, 2> buffer_range_;
+
+    void setBuffer(view_type const & view, std::shared_ptr<void> owner,
+              TinyArray<char *, 2> const & buffer_range)
+    {
+        view_type v(view);
+        this->swapImpl(v);
+        owner_ = std::move(owner);
+        buffer_range_ = buffer_range;
+    }
+
+    template <class A>
+    void adopt(ArrayND<N, T, A> && array)
+    {
+        auto p = std::make_shared<ArrayND<N, T, A>>(std::move(array));
+        setBuffer(*p, p, {(char*)p->data(), (char*)(p->data() + p->size())});
+    }
+
+    template <int M>
+    static TinyArray<char *, 2> viewRange(ArrayViewND<M, T> const & view)
+    {
+        return view.size() == 0
+                   ? TinyArray<char *, 2>{(char*)view.data(), (char*)view.data()}
+                   : view.memoryRange();
+    }
+
+  public:
+
+        /** default constructor: create an array without data,
+            i.e. hasData() returns false and size() is zero.
+         */
+    SharedArrayND()
+    : view_type()
+    , owner_()
+    , buffer_range_()
+    {}
+
+        /** construct with given shape
+         */
+    explicit
+    SharedArrayND(difference_type const & shape,
+                  MemoryOrder order = C_ORDER)
+    : SharedArrayND(ArrayND<N, T>(shape, order))
+    {}
+
+        /** construct with given shape and axistags
+         */
+    SharedArrayND(difference_type const & shape,
+                  axistags_type const & axistags,
+                  MemoryOrder order = C_ORDER)
+    : SharedArrayND(ArrayND<N, T>(shape, axistags, order))
+    {}
+
+        /** construct from shape with an initial value
+         */
+    SharedArrayND(difference_type const & shape,
+                  const_reference init,
+                  MemoryOrder order = C_ORDER)
+    : SharedArrayND(ArrayND<N, T>(shape, init, order))
+    {}
+
+        /** construct from shape and axistags with an initial value
+         */
+    SharedArrayND(difference_type const & shape,
+                  axistags_type const & axistags,
+                  const_reference init,
+                  MemoryOrder order = C_ORDER)
+    : SharedArrayND(ArrayND<N, T>(shape, axistags, init, order))
+    {}
+
+        /** Take over the memory of \a array without copying.
+         */
+    template <class A>
+    SharedArrayND(ArrayND<N, T, A> && array)
+    : SharedArrayND()
+    {
+        adopt(std::move(array));
+    }
+
+        /** construct by copying from an ArrayViewND
+         */
+    template <int M, class U>
+    explicit
+    SharedArrayND(ArrayViewND<M, U> const & rhs,
+                  MemoryOrder order = C_ORDER)
+    : SharedArrayND(ArrayND<N, T>(rhs, order))
+    {}
+
+        /** Constructor from an array expression.
+         */
+    template <class ARG>
+    SharedArrayND(ArrayMathExpression<ARG> && rhs,
+                  MemoryOrder order = C_ORDER)
+    : SharedArrayND(ArrayND<N, T>(std::move(rhs), order))
+    {}
+
+        /** Constructor from an array expression const reference.
+         */
+    template <class ARG>
+    SharedArrayND(ArrayMathExpression<ARG> const & rhs,
+                  MemoryOrder order = C_ORDER)
+    : SharedArrayND(ArrayND<N, T>(rhs, order))
+    {}
+
+        /** Wrap memory owned by someone else (e.g. a Python object).
+
+            \a view refers to the memory, and \a owner keeps it alive
+            as long as any <tt>SharedArrayND</tt> refers to it.
+         */
+    SharedArrayND(view_type const & view, std::shared_ptr<void> owner)
+    : SharedArrayND()
+    {
+        vigra_precondition(owner || !view.hasData(),
+            "SharedArrayND(view, owner): owner must not be empty.");
+        setBuffer(view, std::move(owner), viewRange(view));
+    }
+
+        /** copy constructor: shares the buffer of \a rhs.
+         */
+    SharedArrayND(SharedArrayND const & rhs)
+    : view_type(rhs)
+    , owner_(rhs.owner_)
+    , buffer_range_(rhs.buffer_range_)
+    {}
+
+        /** move constructor
+         */
+    SharedArrayND(SharedArrayND && rhs)
+    : SharedArrayND()
+    {
+        swap(rhs);
+    }
+
+        /** Copy assignment: shares the buffer of \a rhs and releases
+            the old buffer. No data are copied.
+         */
+    SharedArrayND & operator=(SharedArrayND const & rhs)
+    {
+        if(this != &rhs)
+            SharedArrayND(rhs).swap(*this);
+        return *this;
+    }
+
+        /** Move assignment: takes over the buffer of \a rhs.
+         */
+    SharedArrayND & operator=(SharedArrayND && rhs)
+    {
+        if(this != &rhs)
+            SharedArrayND(std::move(rhs)).swap(*this);
+        return *this;
+    }
+
+#ifdef DOXYGEN
+        /** Assignment from an array, an array expression, or a scalar.
+
+            The data are copied into this array after calling
+            <tt>makeUnique()</tt>. If the array has no data, it becomes
+            a copy of \a rhs.
+         */
+    template<class ARRAY_LIKE>
+    SharedArrayND & operator=(ARRAY_LIKE const & rhs);
+
+        /** Add-assignment (copy-on-write), see <tt>operator=()</tt>.
+         */
+    template <class ARRAY_LIKE>
+    SharedArrayND & operator+=(ARRAY_LIKE const & rhs);
+
+        /** Subtract-assignment (copy-on-write), see <tt>operator=()</tt>.
+         */
+    template <class ARRAY_LIKE>
+    SharedArrayND & operator-=(ARRAY_LIKE const & rhs);
+
+        /** Multiply-assignment (copy-on-write), see <tt>operator=()</tt>.
+         */
+    template <class ARRAY_LIKE>
+    SharedArrayND & operator*=(ARRAY_LIKE const & rhs);
+
+        /** Divide-assignment (copy-on-write), see <tt>operator=()</tt>.
+         */
+    template <class ARRAY_LIKE>
+    SharedArrayND & operator/=(ARRAY_LIKE const & rhs);
+
+#else
+
+#define VIGRA_SHARED_ARRAY_ARITHMETIC_ASSIGNMENT(OP) \
+    template <class ARG> \
+    enable_if_t<ArrayNDConcept<ARG>::value, \
+                SharedArrayND &> \
+    operator OP(ARG const & rhs) \
+    { \
+        if(this->hasData()) \
+        { \
+            makeUnique(); \
+            view_type::operator OP(rhs); \
+        } \
+        else \
+        { \
+            SharedArrayND(rhs).swap(*this); \
+        } \
+        return *this; \
+    } \
+    \
+    template <class ARG> \
+    SharedArrayND & \
+    operator OP(ArrayMathExpression<ARG> && rhs) \
+    { \
+        if(this->hasData()) \
+        { \
+            makeUnique(); \
+            view_type::operator OP(std::move(rhs)); \
+        } \
+        else \
+        { \
+            SharedArrayND(std::move(rhs)).swap(*this); \
+        } \
+        return *this; \
+    } \
+    \
+    template <class ARG> \
+    SharedArrayND & \
+    operator OP(ArrayMathExpression<ARG> const & rhs) \
+    { \
+        return operator OP(ArrayMathExpression<ARG>(rhs)); \
+    } \
+    \
+    SharedArrayND & operator OP(value_type const & u) \
+    { \
+        makeUnique(); \
+        view_type::operator OP(u); \
+        return *this; \
+    }
+
+    VIGRA_SHARED_ARRAY_ARITHMETIC_ASSIGNMENT(=)
+    VIGRA_SHARED_ARRAY_ARITHMETIC_ASSIGNMENT(+=)
+    VIGRA_SHARED_ARRAY_ARITHMETIC_ASSIGNMENT(-=)
+    VIGRA_SHARED_ARRAY_ARITHMETIC_ASSIGNMENT(*=)
+    VIGRA_SHARED_ARRAY_ARITHMETIC_ASSIGNMENT(/=)
+
+#undef VIGRA_SHARED_ARRAY_ARITHMETIC_ASSIGNMENT
+
+#endif  // DOXYGEN
+
+        /** Number of <tt>SharedArrayND</tt>s (including this one) that
+            refer to the buffer. Zero when the array has no buffer.
+         */
+    long useCount() const
+    {
+        return owner_.use_count();
+    }
+
+        /** True when no other <tt>SharedArrayND</tt> refers to the buffer.
+         */
+    bool isUnique() const
+    {
+        return owner_.use_count() <= 1;
+    }
+
+        /** Ensure that this array is the only owner of its buffer.
+
+            If the buffer is shared, the elements of this array are copied into
+            a new consecutive buffer. The other owners are not affected.
+            Returns <tt>*this</tt>, so that the function can be used to obtain
+            a writable view, e.g. <tt>a.makeUnique()[index] = value</tt>.
+         */
+    SharedArrayND & makeUnique()
+    {
+        if(!isUnique())
+            adopt(ArrayND<N, T>(*this));
+        return *this;
+    }
+
+        /** Create a <tt>SharedArrayND</tt> from a view into this array's buffer
+            (e.g. a subarray, a transpose, or a bound axis), which keeps the
+            buffer alive.
+         */
+    template <int M>
+    SharedArrayND<M, T> share(ArrayViewND<M, T> const & view) const
+    {
+        TinyArray<char *, 2> range = viewRange(view);
+        vigra_precondition(view.size() == 0 ||
+                           (buffer_range_[0] <= range[0] && range[1] <= buffer_range_[1]),
+            "SharedArrayND::share(): view must refer to the array's buffer.");
+        SharedArrayND<M, T> res;
+        res.setBuffer(view, owner_, buffer_range_);
+        return res;
+    }
+
+        /** The object keeping the buffer alive.
+         */
+    std::shared_ptr<void> const & owner() const
+    {
+        return owner_;
+    }
+
+    void swap(SharedArrayND & rhs)
+    {
+        this->swapImpl(rhs);
+        owner_.swap(rhs.owner_);
+        buffer_range_.swap(rhs.buffer_range_);
+    }
+};
+
+template <int N, class T>
+inline void
+swap(SharedArrayND<N,T> & array1, SharedArrayND<N,T> & array2)
+{
+    array1.swap(array2);
+}
+
+} // namespace vigra
+
+#endif // VIGRA2_SHARED_ARRAY_ND_HXX
@@ -0,0 +1,663 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014-2017 by Ullrich Koethe                  */
+/*                                                                      */
+/*    This file is part of the VIGRA2 computer vision library.          */
+/*    The VIGRA2 Website is                                             */
+/*        http://ukoethe.github.io/vigra2                               */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#pragma once
+
+#ifndef VIGRA2_STREAMING_HXX
+#define VIGRA2_STREAMING_HXX
+
+#include "config.hxx"
+#include "error.hxx"
+#include "box.hxx"
+#include "array_nd.hxx"
+#include "chunk_store.hxx"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vigra {
+
+/********************************************************/
+/*                                                      */
+/*                   StreamingOptions                   */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Option object for <tt>SlabReader</tt> and <tt>SlabWriter</tt>.
+
+        <tt>buffers(n)</tt> sets the number of slab buffers in the ring (default: 3),
+        i.e. how many slabs can be in flight at once. The consumer holds one buffer,
+        so that at least two are required to overlap I/O and computation.
+        <tt>threads(n)</tt> sets the number of background I/O threads (default: 1).
+        More threads help when the source decodes data (e.g. a compressed
+        <tt>ChunkStore</tt>), but should be at most <tt>buffers - 1</tt>.
+
+        <b>\#include</b> \<vigra2/streaming.hxx\><br>
+        Namespace: vigra
+    */
+class StreamingOptions
+{
+  public:
+    StreamingOptions()
+    : buffers_(3)
+    , threads_(1)
+    {}
+
+    StreamingOptions & buffers(int n)
+    {
+        vigra_precondition(n >= 1,
+            "StreamingOptions::buffers(): at least one buffer required.");
+        buffers_ = n;
+        return *this;
+    }
+
+    StreamingOptions & threads(int n)
+    {
+        vigra_precondition(n >= 1,
+            "StreamingOptions::threads(): at least one thread required.");
+        threads_ = n;
+        return *this;
+    }
+
+    int getBuffers() const
+    {
+        return buffers_;
+    }
+
+    int getThreads() const
+    {
+        return threads_;
+    }
+
+  private:
+    int buffers_, threads_;
+};
+
+namespace streaming_detail {
+
+    // Geometry of a volume split into slabs along one axis.
+template <int N>
+class SlabGeometry
+{
+  public:
+    typedef Shape<N> shape_type;
+
+    SlabGeometry(shape_type const & shape, int axis, ArrayIndex slabSize, ArrayIndex halo,
+                 std::string const & function)
+    : shape_(shape)
+    , axis_(axis)
+    , slabSize_(slabSize)
+    , halo_(halo)
+    {
+        vigra_precondition(0 <= axis && axis < shape.size(),
+            function + ": axis out of range.");
+        vigra_precondition(slabSize > 0 && halo >= 0,
+            function + ": slab size must be positive and halo non-negative.");
+        slabCount_ = (shape[axis] + slabSize - 1) / slabSize;
+    }
+
+    ArrayIndex slabCount() const
+    {
+        return slabCount_;
+    }
+
+        // region of slab i, extended by the halo and clipped to the volume
+    Box<N> region(ArrayIndex i, bool withHalo) const
+    {
+        ArrayIndex h = withHalo ? halo_ : 0;
+        shape_type lower(tags::size = shape_.size(), 0), upper(shape_);
+        lower[axis_] = std::max<ArrayIndex>(0, i*slabSize_ - h);
+        upper[axis_] = std::min<ArrayIndex>(shape_[axis_], (i+1)*slabSize_ + h);
+        return Box<N>(lower, upper);
+    }
+
+        // Allocate a buffer for the largest slab. The slab axis is the
+        // outermost axis in memory, so that every slab is consecutive.
+    template <class T>
+    ArrayViewND<N, T> makeBuffer(ArrayND<N, T> & storage) const
+    {
+        int n = shape_.size();
+        shape_type bufferShape(shape_), order(tags::size = n, 0), inverse(tags::size = n, 0);
+        bufferShape[axis_] = std::min<ArrayIndex>(shape_[axis_], slabSize_ + 2*halo_);
+        order[0] = axis_;
+        for(int k = 0, j = 1; k < n; ++k)
+            if(k != axis_)
+                order[j++] = k;
+        for(int k = 0; k < n; ++k)
+            inverse[order[k]] = k;
+        storage = ArrayND<N, T>(bufferShape.transpose(order));
+        return storage.transpose(inverse);
+    }
+
+    shape_type shape_;
+    int axis_;
+    ArrayIndex slabSize_, halo_, slabCount_;
+};
+
+} // namespace streaming_detail
+
+/********************************************************/
+/*                                                      */
+/*                      SlabReader                      */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Stream a volume slab by slab, reading ahead in background threads.
+
+        The volume is split into slabs of \a slabSize elements along \a axis
+        (the last slab may be thinner). Each slab is extended by \a halo elements
+        on both sides (clipped at the volume border), so that neighborhood
+        operations such as convolutions can be computed for the slab's core.
+        Background threads read the following slabs into a ring of reusable
+        buffers while the current slab is processed, so that I/O and computation
+        overlap. The slab axis is the outermost axis of the buffers, i.e.
+        each slab is consecutive in memory.
+
+        The data come from a <i>source</i> function
+        <tt>source(Box&lt;N&gt; const & region, ArrayViewND&lt;N, T&gt; dest)</tt>,
+        which must be callable concurrently for different regions when more than
+        one thread is used. Convenience constructors read from an
+        <tt>ArrayViewND</tt> (e.g. a <tt>MappedArrayND</tt> or
+        <tt>MappedNpyArrayND</tt>, whose pages are then faulted in by the
+        background threads) or a <tt>ChunkStore</tt>. The source object must
+        outlive the reader. Exceptions thrown by the source are re-thrown by
+        <tt>next()</tt>.
+        \code
+        MappedArrayND<3, float> volume("volume.v2a");
+        ChunkStore<3, float> result("smoothed.chunks", volume.shape(), Shape3(16, 256, 256));
+
+        SlabReader<3, float> reader(volume, 0, 16, 4);   // slabs of 16 slices, halo 4
+        SlabWriter<3, float> writer(result, 0, 16);
+        while(reader.next() && writer.next())
+        {
+            // reader.slab() has up to 24 slices, reader.core() the central 16,
+            // writer.slab() is the output buffer for the same 16 slices
+            smooth(reader.slab(), reader.haloBefore(), writer.slab());
+        }
+        writer.finish();
+        \endcode
+
+        <b>\#include</b> \<vigra2/streaming.hxx\><br>
+        Namespace: vigra
+    */
+template <int N, class T>
+class SlabReader
+{
+  public:
+    typedef Shape<N>                                                  shape_type;
+    typedef ArrayViewND<N, T>                                         view_type;
+    typedef std::function<void(Box<N> const &, ArrayViewND<N, T>)>  source_type;
+
+    SlabReader(shape_type const & shape, source_type const & source,
+               int axis, ArrayIndex slabSize, ArrayIndex halo = 0,
+               StreamingOptions const & options = StreamingOptions())
+    : geometry_(shape, axis, slabSize, halo, "SlabReader()")
+    , source_(source)
+    , storage_(options.getBuffers())
+    , buffers_(options.getBuffers())
+    , ready_(options.getBuffers(), -1)
+    , errors_(geometry_.slabCount())
+    , current_(-1)
+    , nextToRead_(0)
+    , stop_(false)
+    {
+        for(std::size_t b = 0; b < buffers_.size(); ++b)
+            buffers_[b] = geometry_.makeBuffer(storage_[b]);
+        for(int k = 0; k < options.getThreads(); ++k)
+            threads_.emplace_back(&SlabReader::work, this);
+    }
+
+        /** Stream the contents of \a array.
+        */
+    SlabReader(view_type const & array,
+               int axis, ArrayIndex slabSize, ArrayIndex halo = 0,
+               StreamingOptions const & options = StreamingOptions())
+    : SlabReader(array.shape(),
+                 [array](Box<N> const & region, view_type dest)
+                 {
+                     dest = array.subarray(region.lower(), region.upper());
+                 },
+                 axis, slabSize, halo, options)
+    {}
+
+        /** Stream the contents of \a store.
+        */
+    SlabReader(ChunkStore<N, T> const & store,
+               int axis, ArrayIndex slabSize, ArrayIndex halo = 0,
+               StreamingOptions const & options = StreamingOptions())
+    : SlabReader(store.shape(),
+                 [&store](Box<N> const & region, view_type dest)
+                 {
+                     store.read(region, dest);
+                 },
+                 axis, slabSize, halo, options)
+    {}
+
+    SlabReader(SlabReader const &) = delete;
+    SlabReader & operator=(SlabReader const &) = delete;
+
+    ~SlabReader()
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            stop_ = true;
+        }
+        changed_.notify_all();
+        for(auto & t : threads_)
+            t.join();
+    }
+
+        /** Release the current slab and wait for the next one. Returns
+            <tt>false</tt> when all slabs have been processed.
+        */
+    bool next()
+    {
+        std::unique_lock<std::mutex> guard(lock_);
+        if(current_ >= geometry_.slabCount())
+            return false;
+        ++current_;
+        changed_.notify_all();
+        if(current_ >= geometry_.slabCount())
+        {
+            bindSlab(view_type());
+            return false;
+        }
+        std::size_t b = current_ % buffers_.size();
+        changed_.wait(guard, [this, b]() { return ready_[b] == current_; });
+        if(errors_[current_])
+            std::rethrow_exception(errors_[current_]);
+        Box<N> region = geometry_.region(current_, true);
+        bindSlab(buffers_[b].subarray(shape_type(tags::size = region.ndim(), 0), region.shape()));
+        return true;
+    }
+
+        /** Number of slabs.
+        */
+    ArrayIndex slabCount() const
+    {
+        return geometry_.slabCount();
+    }
+
+        /** Index of the current slab.
+        */
+    ArrayIndex index() const
+    {
+        return current_;
+    }
+
+        /** The current slab including its halo.
+        */
+    view_type const & slab() const
+    {
+        return slab_;
+    }
+
+        /** The region of the volume covered by <tt>slab()</tt>.
+        */
+    Box<N> box() const
+    {
+        return geometry_.region(current_, true);
+    }
+
+        /** The region of the volume covered by <tt>core()</tt>.
+        */
+    Box<N> coreBox() const
+    {
+        return geometry_.region(current_, false);
+    }
+
+        /** Thickness of the halo before and after the core (smaller than
+            the requested halo at the volume border).
+        */
+    ArrayIndex haloBefore() const
+    {
+        return coreBox().lower()[geometry_.axis_] - box().lower()[geometry_.axis_];
+    }
+
+    ArrayIndex haloAfter() const
+    {
+        return box().upper()[geometry_.axis_] - coreBox().upper()[geometry_.axis_];
+    }
+
+        /** The current slab without its halo.
+        */
+    view_type core() const
+    {
+        Box<N> b = box(), c = coreBox();
+        return slab_.subarray(c.lower() - b.lower(), c.upper() - b.lower());
+    }
+
+  private:
+        // rebind slab_ (assignment would copy the data)
+    void bindSlab(view_type view)
+    {
+        slab_.swap(view);
+    }
+
+    void work()
+    {
+        std::unique_lock<std::mutex> guard(lock_);
+        while(true)
+        {
+            // slab i reuses the buffer of slab i - buffers, which must have been released
+            changed_.wait(guard, [this]()
+            {
+                return stop_ || nextToRead_ >= geometry_.slabCount() ||
+                       nextToRead_ < current_ + (ArrayIndex)buffers_.size();
+            });
+            if(stop_ || nextToRead_ >= geometry_.slabCount())
+                return;
+            ArrayIndex i = nextToRead_++;
+            std::size_t b = i % buffers_.size();
+            guard.unlock();
+
+            std::exception_ptr error;
+            try
+            {
+                Box<N> region = geometry_.region(i, true);
+                source_(region, buffers_[b].subarray(shape_type(tags::size = region.ndim(), 0),
+                                                     region.shape()));
+            }
+            catch(...)
+            {
+                error = std::current_exception();
+            }
+
+            guard.lock();
+            errors_[i] = error;
+            ready_[b] = i;
+            changed_.notify_all();
+        }
+    }
+
+    streaming_detail::SlabGeometry<N> geometry_;
+    source_type source_;
+    std::vector<ArrayND<N, T>> storage_;
+    std::vector<view_type> buffers_;
+    std::vector<ArrayIndex> ready_;
+    std::vector<std::exception_ptr> errors_;
+    view_type slab_;
+    ArrayIndex current_, nextToRead_;
+    bool stop_;
+    std::mutex lock_;
+    std::condition_variable changed_;
+    std::vector<std::thread> threads_;
+};
+
+/********************************************************/
+/*                                                      */
+/*                      SlabWriter                      */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Write a volume slab by slab, with background threads writing completed slabs.
+
+        This is the counterpart of <tt>SlabReader</tt> (without halo): each call to
+        <tt>next()</tt> hands the previous slab to the background threads and returns
+        a buffer for the following slab in <tt>slab()</tt>, waiting only when all
+        buffers of the ring are still being written. The data go to a <i>sink</i>
+        function <tt>sink(Box&lt;N&gt; const & region, ArrayViewND&lt;N, T&gt; const & src)</tt>.
+        Convenience constructors write into an <tt>ArrayViewND</tt> or a
+        <tt>ChunkStore</tt>. With more than one thread, slabs may be written
+        out of order and concurrently, so that the slab boundaries must coincide
+        with chunk boundaries when writing to a <tt>ChunkStore</tt>.
+
+        <tt>finish()</tt> waits until all slabs have been written and re-throws
+        the first exception thrown by the sink. The destructor waits as well,
+        but ignores errors.
+
+        <b>\#include</b> \<vigra2/streaming.hxx\><br>
+        Namespace: vigra
+    */
+template <int N, class T>
+class SlabWriter
+{
+  public:
+    typedef Shape<N>                                                        shape_type;
+    typedef ArrayViewND<N, T>                                               view_type;
+    typedef std::function<void(Box<N> const &, ArrayViewND<N, T> const &)> sink_type;
+
+    SlabWriter(shape_type const & shape, sink_type const & sink,
+               int axis, ArrayIndex slabSize,
+               StreamingOptions const & options = StreamingOptions())
+    : geometry_(shape, axis, slabSize, 0, "SlabWriter()")
+    , sink_(sink)
+    , storage_(options.getBuffers())
+    , buffers_(options.getBuffers())
+    , busy_(options.getBuffers(), false)
+    , current_(-1)
+    , stop_(false)
+    {
+        for(std::size_t b = 0; b < buffers_.size(); ++b)
+            buffers_[b] = geometry_.makeBuffer(storage_[b]);
+        for(int k = 0; k < options.getThreads(); ++k)
+            threads_.emplace_back(&SlabWriter::work, this);
+    }
+
+        /** Write into \a array.
+        */
+    SlabWriter(view_type const & array,
+               int axis, ArrayIndex slabSize,
+               StreamingOptions const & options = StreamingOptions())
+    : SlabWriter(array.shape(),
+                 [array](Box<N> const & region, view_type const & src)
+                 {
+                     view_type dest = array.subarray(region.lower(), region.upper());
+                     dest = src;
+                 },
+                 axis, slabSize, options)
+    {}
+
+        /** Write into \a store.
+        */
+    SlabWriter(ChunkStore<N, T> & store,
+               int axis, ArrayIndex slabSize,
+               StreamingOptions const & options = StreamingOptions())
+    : SlabWriter(store.shape(),
+                 [&store](Box<N> const & region, view_type const & src)
+                 {
+                     store.write(src, region.lower());
+                 },
+                 axis, slabSize, options)
+    {}
+
+    SlabWriter(SlabWriter const &) = delete;
+    SlabWriter & operator=(SlabWriter const &) = delete;
+
+    ~SlabWriter()
+    {
+        try
+        {
+            finish();
+        }
+        catch(...) {}
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            stop_ = true;
+        }
+        changed_.notify_all();
+        for(auto & t : threads_)
+            t.join();
+    }
+
+        /** Commit the current slab for writing and provide a buffer for the
+            next one in <tt>slab()</tt>. Returns <tt>false</tt> when all slabs
+            have been committed.
+        */
+    bool next()
+    {
+        std::unique_lock<std::mutex> guard(lock_);
+        if(error_)
+            std::rethrow_exception(error_);
+        if(current_ >= geometry_.slabCount())
+            return false;
+        commit();
+        ++current_;
+        if(current_ >= geometry_.slabCount())
+        {
+            bindSlab(view_type());
+            return false;
+        }
+        std::size_t b = current_ % buffers_.size();
+        changed_.wait(guard, [this, b]() { return !busy_[b]; });
+        busy_[b] = true;
+        Box<N> region = geometry_.region(current_, false);
+        bindSlab(buffers_[b].subarray(shape_type(tags::size = region.ndim(), 0), region.shape()));
+        return true;
+    }
+
+        /** Commit the current slab and wait until all committed slabs have
+            been written.
+        */
+    void finish()
+    {
+        std::unique_lock<std::mutex> guard(lock_);
+        commit();
+        current_ = std::max(current_, geometry_.slabCount());
+        bindSlab(view_type());
+        changed_.wait(guard, [this]()
+        {
+            return queue_.empty() && std::none_of(busy_.begin(), busy_.end(),
+                                                  [](bool b) { return b; });
+        });
+        if(error_)
+        {
+            std::exception_ptr error = error_;
+            error_ = std::exception_ptr();
+            std::rethrow_exception(error);
+        }
+    }
+
+        /** Number of slabs.
+        */
+    ArrayIndex slabCount() const
+    {
+        return geometry_.slabCount();
+    }
+
+        /** Index of the current slab.
+        */
+    ArrayIndex index() const
+    {
+        return current_;
+    }
+
+        /** Buffer for the current slab.
+        */
+    view_type slab() const
+    {
+        return slab_;
+    }
+
+        /** The region of the volume covered by <tt>slab()</tt>.
+        */
+    Box<N> box() const
+    {
+        return geometry_.region(current_, false);
+    }
+
+  private:
+        // rebind slab_ (assignment would copy the data)
+    void bindSlab(view_type view)
+    {
+        slab_.swap(view);
+    }
+
+        // hand the current slab to the threads (lock must be held)
+    void commit()
+    {
+        if(current_ >= 0 && current_ < geometry_.slabCount())
+        {
+            queue_.push_back(current_);
+            changed_.notify_all();
+        }
+    }
+
+    void work()
+    {
+        std::unique_lock<std::mutex> guard(lock_);
+        while(true)
+        {
+            changed_.wait(guard, [this]() { return stop_ || !queue_.empty(); });
+            if(queue_.empty())
+                return;
+            ArrayIndex i = queue_.front();
+            queue_.pop_front();
+            std::size_t b = i % buffers_.size();
+            guard.unlock();
+
+            std::exception_ptr error;
+            try
+            {
+                Box<N> region = geometry_.region(i, false);
+                sink_(region, buffers_[b].subarray(shape_type(tags::size = region.ndim(), 0),
+                                                   region.shape()));
+            }
+            catch(...)
+            {
+                error = std::current_exception();
+            }
+
+            guard.lock();
+            if(error && !error_)
+                error_ = error;
+            busy_[b] = false;
+            changed_.notify_all();
+        }
+    }
+
+    streaming_detail::SlabGeometry<N> geometry_;
+    sink_type sink_;
+    std::vector<ArrayND<N, T>> storage_;
+    std::vector<view_type> buffers_;
+    std::vector<bool> busy_;
+    std::deque<ArrayIndex> queue_;
+    std::exception_ptr error_;
+    view_type slab_;
+    ArrayIndex current_;
+    bool stop_;
+    std::mutex lock_;
+    std::condition_variable changed_;
+    std::vector<std::thread> threads_;
+};
+
+} // namespace vigra
+
+#endif // VIGRA2_STREAMING_HXX
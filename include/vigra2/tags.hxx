@@ -38,6 +38,8 @@
 #ifndef VIGRA2_TAGS_HXX
 #define VIGRA2_TAGS_HXX
 
+#include <initializer_list>
+
 namespace vigra {
 
 /********************************************************/
@@ -58,6 +60,12 @@ enum SkipInitialization { DontInit };
 enum ReverseCopyTag { ReverseCopy };
 enum MemoryOrder { C_ORDER = 1, F_ORDER = 2, RowMajor = C_ORDER, ColumnMajor = F_ORDER };
 
+    /// summation algorithm of sum(), mean() and norm(): PairwiseSummation
+    /// sums blocks of elements with several accumulators and combines the
+    /// block results in a binary tree, so that the error grows as O(log n)
+    /// instead of O(n)
+enum SummationMode { NaiveSummation, PairwiseSummation };
+
 template <class VALUETYPE, int M=runtime_size, int ... N>
 class TinyArray;
 
@@ -225,6 +233,56 @@ AxisSelectionTag axis;
 
 }
 
+/********************************************************/
+/*                                                      */
+/*                       tags::axes                     */
+/*                                                      */
+/********************************************************/
+
+    // Support for tags::axes keyword argument to select
+    // a set of axes an algorithm is supposed to operate on,
+    // e.g. 'tags::axes = {0, 2}' or 'tags::axes(0, 2)'
+template <int M>
+struct AxesSelectionProxy
+{
+    TinyArray<ArrayIndex, M> value;
+};
+
+struct AxesSelectionTag
+{
+    template <int M>
+    AxesSelectionProxy<M> operator=(TinyArray<ArrayIndex, M> const & s) const
+    {
+        return {s};
+    }
+
+    template <class I, int M = runtime_size>
+    AxesSelectionProxy<M> operator=(std::initializer_list<I> s) const
+    {
+        return {TinyArray<ArrayIndex, M>(s.begin(), s.end())};
+    }
+
+    template <class ... I>
+    AxesSelectionProxy<sizeof...(I)> operator()(I ... i) const
+    {
+        return {TinyArray<ArrayIndex, sizeof...(I)>{ArrayIndex(i)...}};
+    }
+};
+
+    // Support for tags::keepdims and tags::squeeze arguments to
+    // choose if the reduced axes of an axis-wise reduction are kept
+    // as singletons (the default) or dropped from the result.
+struct KeepDimsTag {};
+struct SqueezeTag {};
+
+namespace {
+
+AxesSelectionTag axes;
+KeepDimsTag      keepdims;
+SqueezeTag       squeeze;
+
+}
+
 /********************************************************/
 /*                                                      */
 /*                  tags::byte_strides                  */
@@ -0,0 +1,761 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014-2017 by Ullrich Koethe                  */
+/*                                                                      */
+/*    This file is part of the VIGRA2 computer vision library.          */
+/*    The VIGRA2 Website is                                             */
+/*        http://ukoethe.github.io/vigra2                               */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#pragma once
+
+#ifndef VIGRA2_TIFF_HXX
+#define VIGRA2_TIFF_HXX
+
+#include "config.hxx"
+#include "error.hxx"
+#include "numeric_traits.hxx"
+#include "tinyarray.hxx"
+#include "axistags.hxx"
+#include "box.hxx"
+#include "array_nd.hxx"
+#include "parallel.hxx"
+#include "algorithm.hxx"
+#include "array_file.hxx"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace vigra {
+
+/********************************************************/
+/*                                                      */
+/*                    TiffPageInfo                      */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Layout of a page (image file directory) of a TIFF file.
+
+        Strips are treated as tiles of width <tt>width</tt> and height
+        <tt>rowsPerStrip</tt>, so that <tt>tileWidth</tt> and <tt>tileHeight</tt>
+        describe the data segments in both cases (the last strip may be shorter,
+        whereas tiles at the right and bottom border are padded).
+        <tt>sampleFormat</tt> is 1 for unsigned, 2 for signed integers and 3 for
+        floating point, <tt>compression</tt> is 1 for uncompressed data.
+    */
+struct TiffPageInfo
+{
+    ArrayIndex width, height;
+    int samplesPerPixel, bitsPerSample, sampleFormat, compression, planarConfig;
+    bool tiled;
+    ArrayIndex tileWidth, tileHeight;
+    std::vector<std::uint64_t> offsets, byteCounts;
+
+    TiffPageInfo()
+    : width(0)
+    , height(0)
+    , samplesPerPixel(1)
+    , bitsPerSample(1)
+    , sampleFormat(1)
+    , compression(1)
+    , planarConfig(1)
+    , tiled(false)
+    , tileWidth(0)
+    , tileHeight(0)
+    {}
+
+    ArrayIndex tilesAcross() const
+    {
+        return (width + tileWidth - 1) / tileWidth;
+    }
+
+    ArrayIndex tilesDown() const
+    {
+        return (height + tileHeight - 1) / tileHeight;
+    }
+
+    int pixelBytes() const
+    {
+        return samplesPerPixel*bitsPerSample / 8;
+    }
+
+        // size of the uncompressed data segment k
+    std::uint64_t segmentSize(ArrayIndex k) const
+    {
+        ArrayIndex rows = tiled
+                             ? tileHeight
+                             : std::min(tileHeight, height - k*tileHeight);
+        return (std::uint64_t)rows*tileWidth*pixelBytes();
+    }
+
+        /** Check if the pixels can be read as type <tt>T</tt>, i.e. sample type and
+            number of samples per pixel (= number of channels of <tt>T</tt>) agree.
+        */
+    template <class T>
+    bool hasElementType() const
+    {
+        typedef ElementTypeCode<T> Code;
+        static const char kinds[] = { 0, 'u', 'i', 'f' };
+        return sampleFormat >= 1 && sampleFormat <= 3 && kinds[sampleFormat] == Code::kind &&
+               bitsPerSample == 8*Code::itemsize && samplesPerPixel == Code::channels;
+    }
+};
+
+namespace tiff_detail {
+
+using array_file_detail::File;
+using array_file_detail::FileMapping;
+
+enum Tag { ImageWidth = 256, ImageLength = 257, BitsPerSample = 258, Compression = 259,
+           Photometric = 262, StripOffsets = 273, SamplesPerPixel = 277, RowsPerStrip = 278,
+           StripByteCounts = 279, PlanarConfig = 284, TileWidth = 322, TileLength = 323,
+           TileOffsets = 324, TileByteCounts = 325, ExtraSamples = 338, SampleFormat = 339 };
+
+enum FieldType { Byte = 1, Short = 3, Long = 4, Long8 = 16, Ifd8 = 18 };
+
+inline int
+fieldSize(int type)
+{
+    static const int sizes[] = { 0, 1, 1, 2, 4, 8, 1, 1, 2, 4, 8, 4, 8, 4, 0, 0, 8, 8, 8 };
+    return type > 0 && type < 19 ? sizes[type] : 0;
+}
+
+    // bounds-checked access to the mapped file in the file's byte order
+class Decoder
+{
+  public:
+    Decoder(char const * data, std::size_t size, bool bigEndian, std::string const & function)
+    : data_(data)
+    , size_(size)
+    , bigEndian_(bigEndian)
+    , function_(function)
+    {}
+
+    void check(std::uint64_t offset, std::uint64_t size) const
+    {
+        if(offset > size_ || size > size_ - offset)
+            vigra_fail(function_ + ": file is truncated.");
+    }
+
+    std::uint64_t get(std::uint64_t offset, int bytes) const
+    {
+        check(offset, bytes);
+        std::uint64_t res = 0;
+        for(int k=0; k<bytes; ++k)
+        {
+            std::uint64_t b = (std::uint8_t)data_[offset + (bigEndian_ ? k : bytes-1-k)];
+            res = (res << 8) | b;
+        }
+        return res;
+    }
+
+    char const * data_;
+    std::size_t size_;
+    bool bigEndian_;
+    std::string function_;
+};
+
+    // parse the IFD at 'offset' and return the offset of the next one
+inline std::uint64_t
+parseIfd(Decoder const & d, std::uint64_t offset, bool bigTiff, TiffPageInfo & page)
+{
+    int countBytes = bigTiff ? 8 : 2,
+        valueBytes = bigTiff ? 8 : 4,
+        entrySize  = bigTiff ? 20 : 12;
+    std::uint64_t count = d.get(offset, countBytes);
+    d.check(offset + countBytes, count*entrySize + valueBytes);
+
+    ArrayIndex rowsPerStrip = 0;
+    std::vector<std::uint64_t> offsets[2], byteCounts[2];
+    for(std::uint64_t k = 0; k < count; ++k)
+    {
+        std::uint64_t entry = offset + countBytes + k*entrySize;
+        int tag  = (int)d.get(entry, 2),
+            type = (int)d.get(entry + 2, 2),
+            size = fieldSize(type);
+        std::uint64_t n = d.get(entry + 4, valueBytes),
+                      data = entry + 4 + valueBytes;
+        if(size == 0 || n == 0)
+            continue;
+        if(n*size > (std::uint64_t)valueBytes)
+            data = d.get(data, valueBytes);
+        d.check(data, n*size);
+
+        bool integral = type == Byte || type == Short || type == Long || type == Long8 || type == Ifd8;
+        std::uint64_t value = integral ? d.get(data, size) : 0;
+        switch(tag)
+        {
+          case ImageWidth:      page.width = (ArrayIndex)value; break;
+          case ImageLength:     page.height = (ArrayIndex)value; break;
+          case BitsPerSample:   page.bitsPerSample = (int)value; break;
+          case Compression:     page.compression = (int)value; break;
+          case SamplesPerPixel: page.samplesPerPixel = (int)value; break;
+          case RowsPerStrip:    rowsPerStrip = (ArrayIndex)value; break;
+          case PlanarConfig:    page.planarConfig = (int)value; break;
+          case TileWidth:       page.tileWidth = (ArrayIndex)value; break;
+          case TileLength:      page.tileHeight = (ArrayIndex)value; break;
+          case SampleFormat:    page.sampleFormat = (int)value; break;
+          case StripOffsets:
+          case TileOffsets:
+          case StripByteCounts:
+          case TileByteCounts:
+          {
+              vigra_precondition(integral,
+                  d.function_ + ": corrupt image file directory.");
+              bool tiles = tag == TileOffsets || tag == TileByteCounts;
+              std::vector<std::uint64_t> & v = (tag == StripOffsets || tag == TileOffsets)
+                                                   ? offsets[tiles]
+                                                   : byteCounts[tiles];
+              v.resize(n);
+              for(std::uint64_t i = 0; i < n; ++i)
+                  v[i] = d.get(data + i*size, size);
+              break;
+          }
+        }
+    }
+
+    page.tiled = offsets[1].size() > 0;
+    page.offsets.swap(offsets[page.tiled]);
+    page.byteCounts.swap(byteCounts[page.tiled]);
+    if(!page.tiled)
+    {
+        page.tileWidth  = page.width;
+        page.tileHeight = rowsPerStrip > 0
+                              ? std::min(rowsPerStrip, page.height)
+                              : page.height;
+    }
+    vigra_precondition(page.width > 0 && page.height > 0 && page.tileWidth > 0 && page.tileHeight > 0 &&
+                       page.offsets.size() > 0,
+        d.function_ + ": corrupt image file directory.");
+    return d.get(offset + countBytes + count*entrySize, valueBytes);
+}
+
+    // check that the pixels of 'page' can be copied into an array of type T
+template <class T>
+void
+checkPage(TiffPageInfo const & page, std::size_t fileSize, std::string const & function)
+{
+    static_assert(ElementTypeCode<T>::kind == 'u' || ElementTypeCode<T>::kind == 'i' ||
+                  ElementTypeCode<T>::kind == 'f',
+        "TiffFile: element type must be an integer or floating-point type (or a TinyArray thereof).");
+    vigra_precondition(page.compression == 1,
+        function + ": compressed pages are not supported (compression = " +
+        std::to_string(page.compression) + ").");
+    vigra_precondition(page.samplesPerPixel == 1 || page.planarConfig == 1,
+        function + ": planar multi-sample pages are not supported.");
+    vigra_precondition(page.hasElementType<T>(),
+        function + ": element type mismatch.");
+    ArrayIndex segments = page.tilesAcross()*page.tilesDown();
+    vigra_precondition((ArrayIndex)page.offsets.size() == segments &&
+                       (ArrayIndex)page.byteCounts.size() == segments,
+        function + ": corrupt image file directory.");
+    for(ArrayIndex k = 0; k < segments; ++k)
+    {
+        std::uint64_t size = page.segmentSize(k);
+        if(page.offsets[k] > fileSize || size > fileSize - page.offsets[k])
+            vigra_fail(function + ": file is truncated.");
+    }
+}
+
+inline void
+byteSwap(char * data, std::size_t size, int swapsize)
+{
+    for(std::size_t k = 0; k < size; k += swapsize)
+        std::reverse(data + k, data + k + swapsize);
+}
+
+    // copy 'n' pixels from the file to 'dest' (with the given byte stride)
+template <class T>
+void
+copyPixels(char const * src, char * dest, ArrayIndex n, ArrayIndex stride, int swapsize)
+{
+    if(stride == sizeof(T))
+    {
+        std::memcpy(dest, src, n*sizeof(T));
+        if(swapsize > 1)
+            byteSwap(dest, n*sizeof(T), swapsize);
+    }
+    else
+    {
+        for(ArrayIndex k = 0; k < n; ++k, src += sizeof(T), dest += stride)
+        {
+            std::memcpy(dest, src, sizeof(T));
+            if(swapsize > 1)
+                byteSwap(dest, sizeof(T), swapsize);
+        }
+    }
+}
+
+    // append an integer in native byte order
+inline void
+put(std::string & s, std::uint64_t v, int bytes)
+{
+    std::uint16_t v16 = (std::uint16_t)v;
+    std::uint32_t v32 = (std::uint32_t)v;
+    char const * p = bytes == 2
+                        ? (char const *)&v16
+                        : bytes == 4
+                             ? (char const *)&v32
+                             : (char const *)&v;
+    s.append(p, bytes);
+}
+
+struct IfdEntry
+{
+    int tag, type;
+    std::vector<std::uint64_t> values;
+};
+
+    // encode an IFD located at 'offset' (with out-of-line values appended);
+    // 'next' receives the position of the next-IFD pointer
+inline std::string
+encodeIfd(std::vector<IfdEntry> entries, std::uint64_t offset, bool bigTiff, std::uint64_t & next)
+{
+    int countBytes = bigTiff ? 8 : 2,
+        valueBytes = bigTiff ? 8 : 4,
+        entrySize  = bigTiff ? 20 : 12;
+    std::sort(entries.begin(), entries.end(),
+              [](IfdEntry const & l, IfdEntry const & r) { return l.tag < r.tag; });
+
+    std::string ifd, extra;
+    std::uint64_t extraOffset = offset + countBytes + entries.size()*entrySize + valueBytes;
+    put(ifd, entries.size(), countBytes);
+    for(auto const & e : entries)
+    {
+        int size = fieldSize(e.type);
+        std::string values;
+        for(auto v : e.values)
+            put(values, v, size);
+        put(ifd, e.tag, 2);
+        put(ifd, e.type, 2);
+        put(ifd, e.values.size(), valueBytes);
+        if((int)values.size() <= valueBytes)
+        {
+            values.resize(valueBytes, '\0');
+            ifd += values;
+        }
+        else
+        {
+            put(ifd, extraOffset + extra.size(), valueBytes);
+            extra += values;
+            extra.resize((extra.size() + 7) / 8 * 8, '\0');
+        }
+    }
+    next = offset + ifd.size();
+    put(ifd, 0, valueBytes);
+    return ifd + extra;
+}
+
+} // namespace tiff_detail
+
+/********************************************************/
+/*                                                      */
+/*                       TiffFile                       */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Read access to multi-page TIFF files.
+
+        The constructor parses the image file directories of classic TIFF and
+        BigTIFF files in either byte order. The pages are read as a 3D volume
+        with axes <tt>(page, row, column)</tt> and axistags <tt>"zyx"</tt>.
+        Pixels with several samples (e.g. RGB) are read into <tt>TinyArray</tt>
+        elements. Pixel data must be uncompressed, stored in strips or tiles.
+
+        Reading is done from a memory mapping of the file, and only the strips or
+        tiles intersecting the requested region are touched. Each row of a segment
+        is copied (and byte-swapped when the file's byte order differs from the
+        machine's) directly into the destination array, without intermediate buffers.
+        Different pages are read in parallel according to the <tt>ParallelOptions</tt>.
+        \code
+        TiffFile tiff("stack.tif");
+        std::cout << tiff.pageCount() << " pages of shape " << tiff.shape() << "\n";
+
+        ArrayND<3, std::uint16_t> stack = tiff.read<std::uint16_t>();
+        ArrayND<3, std::uint16_t> roi   = tiff.read<std::uint16_t>(Box<3>(Shape3(10, 100, 200),
+                                                                          Shape3(20, 356, 456)));
+        \endcode
+
+        <b>\#include</b> \<vigra2/tiff.hxx\><br>
+        Namespace: vigra
+    */
+class TiffFile
+{
+  public:
+    explicit TiffFile(std::string const & filename)
+    : filename_(filename)
+    , bigTiff_(false)
+    , bigEndian_(false)
+    {
+        static const std::string function("TiffFile()");
+        tiff_detail::File file(filename, O_RDONLY, function);
+        std::size_t size = file.size();
+        vigra_precondition(size >= 8,
+            function + ": not a TIFF file.");
+        tiff_detail::FileMapping mapping(file, 0, size, function);
+        char const * data = mapping.data();
+
+        vigra_precondition((data[0] == 'I' && data[1] == 'I') || (data[0] == 'M' && data[1] == 'M'),
+            function + ": not a TIFF file.");
+        bigEndian_ = data[0] == 'M';
+        tiff_detail::Decoder d(data, size, bigEndian_, function);
+        std::uint64_t version = d.get(2, 2), next = 0;
+        if(version == 42)
+        {
+            next = d.get(4, 4);
+        }
+        else
+        {
+            vigra_precondition(version == 43 && d.get(4, 2) == 8,
+                function + ": not a TIFF file.");
+            bigTiff_ = true;
+            next = d.get(8, 8);
+        }
+
+        std::set<std::uint64_t> visited;
+        while(next != 0)
+        {
+            vigra_precondition(visited.insert(next).second,
+                function + ": corrupt image file directory.");
+            pages_.push_back(TiffPageInfo());
+            next = tiff_detail::parseIfd(d, next, bigTiff_, pages_.back());
+        }
+        vigra_precondition(pages_.size() > 0,
+            function + ": file contains no pages.");
+    }
+
+    std::string const & filename() const
+    {
+        return filename_;
+    }
+
+    bool isBigTiff() const
+    {
+        return bigTiff_;
+    }
+
+    bool isBigEndian() const
+    {
+        return bigEndian_;
+    }
+
+    ArrayIndex pageCount() const
+    {
+        return (ArrayIndex)pages_.size();
+    }
+
+    TiffPageInfo const & page(ArrayIndex k) const
+    {
+        vigra_precondition(0 <= k && k < pageCount(),
+            "TiffFile::page(): index out of range.");
+        return pages_[k];
+    }
+
+        /** Shape <tt>(pages, height, width)</tt> of the volume
+            (all pages must have the same size).
+        */
+    Shape<3> shape() const
+    {
+        for(auto const & p : pages_)
+            vigra_precondition(p.width == pages_[0].width && p.height == pages_[0].height,
+                "TiffFile::shape(): pages differ in size.");
+        return Shape<3>(pageCount(), pages_[0].height, pages_[0].width);
+    }
+
+        /** Read the region \a box into \a dest (whose shape must equal the box's shape).
+        */
+    template <class T>
+    void read(Box<3> const & box, ArrayViewND<3, T> dest,
+              ParallelOptions const & options = ParallelOptions()) const
+    {
+        static const std::string function("TiffFile::read()");
+        vigra_precondition(Box<3>(shape()).contains(box),
+            function + ": region outside of the volume.");
+        vigra_precondition(dest.shape() == box.shape(),
+            function + ": shape mismatch between region and destination.");
+        if(box.empty())
+            return;
+
+        tiff_detail::File file(filename_, O_RDONLY, function);
+        std::size_t size = file.size();
+        for(ArrayIndex z = box.lower()[0]; z < box.upper()[0]; ++z)
+            tiff_detail::checkPage<T>(pages_[z], size, function);
+        tiff_detail::FileMapping mapping(file, 0, size, function);
+
+        ArrayIndex x0 = box.lower()[2], x1 = box.upper()[2];
+        int swapsize = bigEndian_ == detail::isLittleEndian()
+                           ? pages_[box.lower()[0]].bitsPerSample / 8
+                           : 0;
+        parallelForeachChunk(box.shape()[0], options,
+            [&](int, ArrayIndex begin, ArrayIndex end)
+            {
+                for(ArrayIndex z = begin; z < end; ++z)
+                {
+                    TiffPageInfo const & page = pages_[z + box.lower()[0]];
+                    ArrayIndex tw = page.tileWidth, th = page.tileHeight;
+                    for(ArrayIndex y = box.lower()[1]; y < box.upper()[1]; ++y)
+                    {
+                        char * row = (char *)dest.data() + z*dest.byte_strides()[0] +
+                                     (y - box.lower()[1])*dest.byte_strides()[1];
+                        for(ArrayIndex tx = x0 / tw; tx*tw < x1; ++tx)
+                        {
+                            ArrayIndex xa = std::max(x0, tx*tw),
+                                       xb = std::min(x1, (tx+1)*tw);
+                            char const * src = mapping.data() +
+                                               page.offsets[(y / th)*page.tilesAcross() + tx] +
+                                               ((y % th)*tw + xa - tx*tw)*sizeof(T);
+                            tiff_detail::copyPixels<T>(src, row + (xa - x0)*dest.byte_strides()[2],
+                                                       xb - xa, dest.byte_strides()[2], swapsize);
+                        }
+                    }
+                }
+            });
+    }
+
+        /** Read the region \a box into a new array.
+        */
+    template <class T>
+    ArrayND<3, T> read(Box<3> const & box,
+                       ParallelOptions const & options = ParallelOptions()) const
+    {
+        ArrayND<3, T> res(box.shape());
+        res.setAxistags(makeAxistags("zyx"));
+        read(box, res, options);
+        return res;
+    }
+
+        /** Read all pages.
+        */
+    template <class T>
+    ArrayND<3, T> read(ParallelOptions const & options = ParallelOptions()) const
+    {
+        return read<T>(Box<3>(shape()), options);
+    }
+
+  private:
+    std::string filename_;
+    bool bigTiff_, bigEndian_;
+    std::vector<TiffPageInfo> pages_;
+};
+
+/********************************************************/
+/*                                                      */
+/*                 readTiff() / writeTiff()             */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Read all pages of a TIFF file (see <tt>TiffFile</tt>).
+    */
+template <class T>
+ArrayND<3, T>
+readTiff(std::string const & filename)
+{
+    return TiffFile(filename).read<T>();
+}
+
+    /** \brief Option object for <tt>writeTiff()</tt>.
+
+        <tt>rowsPerStrip(n)</tt> sets the strip height (default: strips of about
+        256 kB), <tt>tileSize(n)</tt> switches to square tiles of the given size
+        (a multiple of 16), and <tt>bigTiff()</tt> enforces the BigTIFF format,
+        which is otherwise chosen automatically when the file would exceed 4 GB.
+    */
+class TiffWriteOptions
+{
+  public:
+    TiffWriteOptions()
+    : rowsPerStrip_(0)
+    , tileSize_(0)
+    , bigTiff_(false)
+    {}
+
+    TiffWriteOptions & rowsPerStrip(ArrayIndex n)
+    {
+        vigra_precondition(n > 0,
+            "TiffWriteOptions::rowsPerStrip(): must be positive.");
+        rowsPerStrip_ = n;
+        tileSize_ = 0;
+        return *this;
+    }
+
+    TiffWriteOptions & tileSize(ArrayIndex n)
+    {
+        vigra_precondition(n > 0 && n % 16 == 0,
+            "TiffWriteOptions::tileSize(): must be a positive multiple of 16.");
+        tileSize_ = n;
+        return *this;
+    }
+
+    TiffWriteOptions & bigTiff(bool on = true)
+    {
+        bigTiff_ = on;
+        return *this;
+    }
+
+    ArrayIndex rowsPerStrip_, tileSize_;
+    bool bigTiff_;
+};
+
+    /** \brief Write a volume as a multi-page TIFF file.
+
+        Axis 0 of \a a enumerates the pages, axes 1 and 2 are rows and columns.
+        The data are written uncompressed in the machine's byte order.
+        <tt>TinyArray&lt;T, C&gt;</tt> elements become pixels with <tt>C</tt>
+        samples (3 and 4 samples are marked as RGB and RGBA). Strips are written
+        directly from the array's memory when its pages are consecutive in C-order.
+        \code
+        ArrayND<3, std::uint16_t> stack(Shape3(100, 512, 512));
+        ...
+        writeTiff("stack.tif", stack);
+        writeTiff("tiled.tif", stack, TiffWriteOptions().tileSize(256).bigTiff());
+        \endcode
+    */
+template <class T>
+void
+writeTiff(std::string const & filename, ArrayViewND<3, T> const & a,
+          TiffWriteOptions const & options = TiffWriteOptions())
+{
+    using namespace tiff_detail;
+    typedef ElementTypeCode<T> Code;
+    static_assert(Code::kind == 'u' || Code::kind == 'i' || Code::kind == 'f',
+        "writeTiff(): element type must be an integer or floating-point type (or a TinyArray thereof).");
+    vigra_precondition(a.size() > 0,
+        "writeTiff(): array must not be empty.");
+
+    ArrayIndex pages = a.shape(0), height = a.shape(1), width = a.shape(2),
+               rowBytes = width*sizeof(T);
+    bool tiled = options.tileSize_ > 0;
+    ArrayIndex tw = tiled ? options.tileSize_ : width,
+               th = tiled
+                       ? options.tileSize_
+                       : options.rowsPerStrip_ > 0
+                            ? std::min(options.rowsPerStrip_, height)
+                            : std::max<ArrayIndex>(1, std::min<ArrayIndex>(height, (1 << 18) / rowBytes));
+    ArrayIndex tilesAcross = (width + tw - 1) / tw,
+               tilesDown   = (height + th - 1) / th,
+               segments    = tilesAcross*tilesDown;
+    std::uint64_t pageBytes = (std::uint64_t)(tiled ? tilesDown*th : height)*tilesAcross*tw*sizeof(T),
+                  estimate  = pages*(pageBytes + 512 + segments*16);
+    bool bigTiff = options.bigTiff_ || estimate >= (std::uint64_t(1) << 32);
+
+    std::string header(detail::isLittleEndian() ? "II" : "MM");
+    std::uint64_t next;
+    if(bigTiff)
+    {
+        put(header, 43, 2);
+        put(header, 8, 2);
+        put(header, 0, 2);
+        next = header.size();
+        put(header, 0, 8);
+    }
+    else
+    {
+        put(header, 42, 2);
+        next = header.size();
+        put(header, 0, 4);
+    }
+
+    File file(filename, O_WRONLY | O_CREAT | O_TRUNC, "writeTiff()");
+    file.write(header.data(), header.size(), 0);
+    std::uint64_t pos = header.size();
+
+    ArrayND<2, T> tile(tiled ? Shape<2>(th, tw) : Shape<2>(0, 0));
+    int spp = Code::channels, bits = 8*Code::itemsize,
+        format = Code::kind == 'u' ? 1 : Code::kind == 'i' ? 2 : 3;
+    for(ArrayIndex z = 0; z < pages; ++z)
+    {
+        ArrayViewND<2, T> page = a.bind(0, z);
+        std::vector<std::uint64_t> offsets(segments), byteCounts(segments);
+        for(ArrayIndex k = 0; k < segments; ++k)
+        {
+            ArrayIndex ty = k / tilesAcross, tx = k % tilesAcross;
+            Shape<2> lower(ty*th, tx*tw),
+                     upper(std::min(height, (ty+1)*th), std::min(width, (tx+1)*tw));
+            auto src = page.subarray(lower, upper);
+            offsets[k] = pos;
+            if(tiled)
+            {
+                tile.init(T());
+                tile.subarray(Shape<2>(0, 0), upper - lower) = src;
+                array_file_detail::writeData(file, tile, pos, true);
+            }
+            else
+            {
+                array_file_detail::writeData(file, src, pos, array_detail::isOrdered(src, C_ORDER));
+            }
+            byteCounts[k] = (tiled ? th*tw : src.size())*sizeof(T);
+            pos += byteCounts[k];
+        }
+
+        std::vector<IfdEntry> entries = {
+            { ImageWidth, Long, { (std::uint64_t)width } },
+            { ImageLength, Long, { (std::uint64_t)height } },
+            { BitsPerSample, Short, std::vector<std::uint64_t>(spp, bits) },
+            { Compression, Short, { 1 } },
+            { Photometric, Short, { spp == 3 || spp == 4 ? 2u : 1u } },
+            { SamplesPerPixel, Short, { (std::uint64_t)spp } },
+            { PlanarConfig, Short, { 1 } },
+            { SampleFormat, Short, std::vector<std::uint64_t>(spp, format) },
+            { tiled ? TileOffsets : StripOffsets, bigTiff ? Long8 : Long, offsets },
+            { tiled ? TileByteCounts : StripByteCounts, bigTiff ? Long8 : Long, byteCounts } };
+        if(tiled)
+        {
+            entries.push_back({ TileWidth, Long, { (std::uint64_t)tw } });
+            entries.push_back({ TileLength, Long, { (std::uint64_t)th } });
+        }
+        else
+        {
+            entries.push_back({ RowsPerStrip, Long, { (std::uint64_t)th } });
+        }
+        int extraSamples = spp == 3 || spp == 4 ? spp - 3 : spp - 1;
+        if(extraSamples > 0)
+            entries.push_back({ ExtraSamples, Short, std::vector<std::uint64_t>(extraSamples, 0) });
+
+        pos = (pos + 7) / 8 * 8;
+        std::uint64_t nextPos;
+        std::string ifd = encodeIfd(entries, pos, bigTiff, nextPos);
+        vigra_precondition(bigTiff || pos + ifd.size() < (std::uint64_t(1) << 32),
+            "writeTiff(): file exceeds 4 GB, use TiffWriteOptions().bigTiff().");
+        file.write(ifd.data(), ifd.size(), pos);
+
+        // link the previous IFD (or the header) to this one
+        std::string link;
+        put(link, pos, bigTiff ? 8 : 4);
+        file.write(link.data(), link.size(), next);
+        next = nextPos;
+        pos += ifd.size();
+    }
+}
+
+} // namespace vigra
+
+#endif // VIGRA2_TIFF_HXX
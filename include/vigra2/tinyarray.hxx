@@ -1259,6 +1259,11 @@ class TinyArray<VALUETYPE, runtime_size>
     using base_type = TinyArrayBase<VALUETYPE, TinyArray<VALUETYPE, runtime_size>, runtime_size>;
 
     using value_type = VALUETYPE;
+    using pointer = typename base_type::pointer;
+
+        // arrays up to this size are stored in an internal buffer,
+        // only bigger ones allocate memory on the heap
+    static const ArrayIndex small_size = 8;
 
     TinyArray()
     : base_type()
@@ -1269,7 +1274,7 @@ class TinyArray<VALUETYPE, runtime_size>
               value_type const & initial = value_type())
     : base_type(size)
     {
-        this->data_ = alloc_.allocate(this->size_);
+        this->data_ = allocate(this->size_);
         std::uninitialized_fill(this->begin(), this->end(), initial);
     }
 
@@ -1282,7 +1287,7 @@ class TinyArray<VALUETYPE, runtime_size>
     TinyArray(ArrayIndex size, SkipInitialization)
     : base_type(size)
     {
-        this->data_ = alloc_.allocate(this->size_);
+        this->data_ = allocate(this->size_);
         if(!base_type::may_use_uninitialized_memory)
             std::uninitialized_fill(this->begin(), this->end(), value_type());
     }
@@ -1298,14 +1303,14 @@ class TinyArray<VALUETYPE, runtime_size>
     TinyArray(TinyArray const & rhs )
     : base_type(rhs.size())
     {
-        this->data_ = alloc_.allocate(this->size_);
+        this->data_ = allocate(this->size_);
         std::uninitialized_copy(rhs.begin(), rhs.end(), this->begin());
     }
 
     TinyArray(TinyArray && rhs)
     : base_type()
     {
-        this->swap(rhs);
+        moveFrom(rhs);
     }
 
     template <class U, class D, int ... N>
@@ -1318,7 +1323,7 @@ class TinyArray<VALUETYPE, runtime_size>
     TinyArray(U begin, U end)
     : base_type(std::distance(begin, end))
     {
-        this->data_ = alloc_.allocate(this->size_);
+        this->data_ = allocate(this->size_);
         for(int i=0; i<this->size_; ++i, ++begin)
             new(this->data_+i) value_type(detail::RequiresExplicitCast<value_type>::cast(*begin));
     }
@@ -1328,7 +1333,7 @@ class TinyArray<VALUETYPE, runtime_size>
     TinyArray(U begin, U end, ReverseCopyTag)
     : base_type(std::distance(begin, end))
     {
-        this->data_ = alloc_.allocate(this->size_);
+        this->data_ = allocate(this->size_);
         for(int i=0; i<this->size_; ++i, --end)
             new(this->data_+i) value_type(detail::RequiresExplicitCast<value_type>::cast(*(end-1)));
     }
@@ -1375,21 +1380,84 @@ class TinyArray<VALUETYPE, runtime_size>
     }
 
     ~TinyArray()
+    {
+        destroy();
+    }
+
+    void swap(TinyArray & other)
+    {
+        if(this == &other)
+            return;
+        if(!isSmall() && !other.isSmall())
+        {
+            // both arrays live on the heap => just exchange the pointers
+            base_type::swap(other);
+            return;
+        }
+        TinyArray tmp(std::move(other));
+        other.moveFrom(*this);
+        moveFrom(tmp);
+    }
+
+  private:
+    using storage_type = typename std::aligned_storage<small_size*sizeof(value_type),
+                                                       alignof(value_type)>::type;
+
+    bool isSmall() const
+    {
+        return this->data_ == reinterpret_cast<value_type const *>(&buffer_);
+    }
+
+    pointer allocate(ArrayIndex size)
+    {
+        return size <= small_size
+                   ? reinterpret_cast<pointer>(&buffer_)
+                   : alloc_.allocate(size);
+    }
+
+    void destroy()
     {
         if(!base_type::may_use_uninitialized_memory)
         {
             for(ArrayIndex i=0; i<this->size_; ++i)
                 (this->data_+i)->~value_type();
         }
-        alloc_.deallocate(this->data_, this->size_);
+        if(this->data_ != 0 && !isSmall())
+            alloc_.deallocate(this->data_, this->size_);
+        this->data_ = 0;
+        this->size_ = 0;
     }
 
-  private:
-    // FIXME: implement an optimized allocator
-    // FIXME: (look at Alexandrescu's Loki library or Kolmogorov's code)
+        // take over the contents of 'rhs' and leave it empty (this array must be empty)
+    void moveFrom(TinyArray & rhs)
+    {
+        if(rhs.isSmall())
+        {
+            this->data_ = allocate(rhs.size_);
+            this->size_ = rhs.size_;
+            for(ArrayIndex i=0; i<this->size_; ++i)
+                new(this->data_+i) value_type(std::move(rhs.data_[i]));
+            rhs.destroy();
+        }
+        else
+        {
+            base_type::swap(rhs);
+        }
+    }
+
+    storage_type buffer_;
     std::allocator<value_type> alloc_;
 };
 
+    /// swap two arrays of runtime size, taking care of their internal buffers
+template <class T>
+inline void
+swap(TinyArray<T, runtime_size> & l,
+     TinyArray<T, runtime_size> & r)
+{
+    l.swap(r);
+}
+
 template<class T>
 struct UninitializedMemoryTraits<TinyArray<T, runtime_size>>
 {
@@ -3081,6 +3149,15 @@ struct NumericTraits<TinySymmetricView<T, N>>
     typedef TinySymmetricView<T, N>  Type;
 };
 
+template <class T, int ...N>
+struct ElementTypeCode<TinyArray<T, N...>, false>
+{
+    static const int static_size = TinyArray<T, N...>::static_size;
+    static const char kind = static_size > 0 ? ElementTypeCode<T>::kind : 0;
+    static const int itemsize = ElementTypeCode<T>::itemsize;
+    static const int channels = static_size * ElementTypeCode<T>::channels;
+};
+
 // mask cl.exe shortcomings [end]
 #if defined(_MSC_VER)
 #pragma warning( pop )
@@ -0,0 +1,491 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014-2017 by Ullrich Koethe                  */
+/*                                                                      */
+/*    This file is part of the VIGRA2 computer vision library.          */
+/*    The VIGRA2 Website is                                             */
+/*        http://ukoethe.github.io/vigra2                               */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#pragma once
+
+#ifndef VIGRA2_TRANSPOSE_HXX
+#define VIGRA2_TRANSPOSE_HXX
+
+#include "config.hxx"
+#include "error.hxx"
+#include "pointer_nd.hxx"
+#include "array_nd.hxx"
+#include <algorithm>
+#include <cstdlib>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) && !defined(VIGRA_NO_SSE2)
+    #define VIGRA_TRANSPOSE_SSE2
+    #include <emmintrin.h>
+#endif
+
+namespace vigra {
+
+namespace transpose_detail {
+
+    // recursion stops when both sides of a block are at most this long
+static const ArrayIndex leafSize = 32;
+
+/********************************************************/
+/*                                                      */
+/*                     TransposeTile                    */
+/*                                                      */
+/********************************************************/
+
+    // In-register transpose of a square tile of 16 bytes per row.
+    // 'exec' reads 'size' rows of 'src' and writes them as columns of 'dest',
+    // 'swap' exchanges the transposes of the tiles at 'a' and 'b'.
+    // Row elements must be consecutive, rows are 'stride' bytes apart.
+    // The default (size 1) means that no tile kernel is available.
+template <int ELEMENT_SIZE>
+struct TransposeTile
+{
+    static const int size = 1;
+
+    static void exec(char *, ArrayIndex, char const *, ArrayIndex) {}
+    static void swap(char *, char *, ArrayIndex) {}
+};
+
+#ifdef VIGRA_TRANSPOSE_SSE2
+
+template <>
+struct TransposeTile<4>
+{
+    static const int size = 4;
+
+    static void exec(char * dest, ArrayIndex dstride, char const * src, ArrayIndex sstride)
+    {
+        __m128 r0 = _mm_loadu_ps((float const *)(src)),
+               r1 = _mm_loadu_ps((float const *)(src + sstride)),
+               r2 = _mm_loadu_ps((float const *)(src + 2*sstride)),
+               r3 = _mm_loadu_ps((float const *)(src + 3*sstride));
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _mm_storeu_ps((float *)(dest), r0);
+        _mm_storeu_ps((float *)(dest + dstride), r1);
+        _mm_storeu_ps((float *)(dest + 2*dstride), r2);
+        _mm_storeu_ps((float *)(dest + 3*dstride), r3);
+    }
+
+    static void swap(char * a, char * b, ArrayIndex stride)
+    {
+        __m128 a0 = _mm_loadu_ps((float const *)(a)),
+               a1 = _mm_loadu_ps((float const *)(a + stride)),
+               a2 = _mm_loadu_ps((float const *)(a + 2*stride)),
+               a3 = _mm_loadu_ps((float const *)(a + 3*stride));
+        exec(a, stride, b, stride);
+        _MM_TRANSPOSE4_PS(a0, a1, a2, a3);
+        _mm_storeu_ps((float *)(b), a0);
+        _mm_storeu_ps((float *)(b + stride), a1);
+        _mm_storeu_ps((float *)(b + 2*stride), a2);
+        _mm_storeu_ps((float *)(b + 3*stride), a3);
+    }
+};
+
+template <>
+struct TransposeTile<8>
+{
+    static const int size = 2;
+
+    static void exec(char * dest, ArrayIndex dstride, char const * src, ArrayIndex sstride)
+    {
+        __m128d r0 = _mm_loadu_pd((double const *)(src)),
+                r1 = _mm_loadu_pd((double const *)(src + sstride));
+        _mm_storeu_pd((double *)(dest),           _mm_unpacklo_pd(r0, r1));
+        _mm_storeu_pd((double *)(dest + dstride), _mm_unpackhi_pd(r0, r1));
+    }
+
+    static void swap(char * a, char * b, ArrayIndex stride)
+    {
+        __m128d a0 = _mm_loadu_pd((double const *)(a)),
+                a1 = _mm_loadu_pd((double const *)(a + stride));
+        exec(a, stride, b, stride);
+        _mm_storeu_pd((double *)(b),          _mm_unpacklo_pd(a0, a1));
+        _mm_storeu_pd((double *)(b + stride), _mm_unpackhi_pd(a0, a1));
+    }
+};
+
+#endif // VIGRA_TRANSPOSE_SSE2
+
+    // the tile kernels copy bits, which is only valid for trivial types
+template <class T>
+struct TransposeTileFor
+: public TransposeTile<std::is_trivially_copyable<T>::value ? (int)sizeof(T) : 0>
+{};
+
+template <class T>
+inline T &
+elementAt(char * p)
+{
+    return *reinterpret_cast<T *>(p);
+}
+
+template <class T>
+inline T const &
+elementAt(char const * p)
+{
+    return *reinterpret_cast<T const *>(p);
+}
+
+/********************************************************/
+/*                                                      */
+/*                  transposeCopy helpers               */
+/*                                                      */
+/********************************************************/
+
+    // Copy an 'ni x nj' block, where element (i, j) is at 'src + i*ssi + j*ssj'
+    // and goes to 'dest + i*dsi + j*dsj'. The source is expected to be
+    // consecutive along 'i', the destination along 'j'.
+template <class T>
+void
+transposeLeaf(char * dest, ArrayIndex dsi, ArrayIndex dsj,
+              char const * src, ArrayIndex ssi, ArrayIndex ssj,
+              ArrayIndex ni, ArrayIndex nj)
+{
+    typedef TransposeTileFor<T> Tile;
+
+    ArrayIndex i = 0;
+    if(Tile::size > 1 && ssi == (ArrayIndex)sizeof(T) && dsj == (ArrayIndex)sizeof(T))
+    {
+        ArrayIndex ti = ni - ni % Tile::size,
+                   tj = nj - nj % Tile::size;
+        for(; i < ti; i += Tile::size)
+        {
+            ArrayIndex j = 0;
+            for(; j < tj; j += Tile::size)
+                Tile::exec(dest + i*dsi + j*dsj, dsi, src + i*ssi + j*ssj, ssj);
+            for(ArrayIndex ii = i; ii < i + Tile::size; ++ii)
+                for(ArrayIndex jj = j; jj < nj; ++jj)
+                    elementAt<T>(dest + ii*dsi + jj*dsj) = elementAt<T>(src + ii*ssi + jj*ssj);
+        }
+    }
+    for(; i < ni; ++i)
+        for(ArrayIndex j = 0; j < nj; ++j)
+            elementAt<T>(dest + i*dsi + j*dsj) = elementAt<T>(src + i*ssi + j*ssj);
+}
+
+    // cache-oblivious recursion: halve the longer side until the block
+    // fits into the cache at every level of the hierarchy
+template <class T>
+void
+transposeBlock(char * dest, ArrayIndex dsi, ArrayIndex dsj,
+               char const * src, ArrayIndex ssi, ArrayIndex ssj,
+               ArrayIndex ni, ArrayIndex nj)
+{
+    if(ni <= leafSize && nj <= leafSize)
+    {
+        transposeLeaf<T>(dest, dsi, dsj, src, ssi, ssj, ni, nj);
+    }
+    else if(ni >= nj)
+    {
+        // split at a multiple of the tile size
+        ArrayIndex m = (ni / 2) & ~(ArrayIndex)7;
+        transposeBlock<T>(dest, dsi, dsj, src, ssi, ssj, m, nj);
+        transposeBlock<T>(dest + m*dsi, dsi, dsj, src + m*ssi, ssi, ssj, ni - m, nj);
+    }
+    else
+    {
+        ArrayIndex m = (nj / 2) & ~(ArrayIndex)7;
+        transposeBlock<T>(dest, dsi, dsj, src, ssi, ssj, ni, m);
+        transposeBlock<T>(dest + m*dsj, dsi, dsj, src + m*ssj, ssi, ssj, ni, nj - m);
+    }
+}
+
+    // loop over the axes in 'outer' (outermost first) and transpose
+    // the plane spanned by axes 'ai' and 'aj' at each position
+template <class T, int N>
+void
+transposeOuter(int level, Shape<runtime_size> const & outer, Shape<N> const & shape,
+               char * dest, Shape<N> const & dstrides,
+               char const * src, Shape<N> const & sstrides,
+               int ai, int aj)
+{
+    if(level == outer.size())
+    {
+        transposeBlock<T>(dest, dstrides[ai], dstrides[aj],
+                          src, sstrides[ai], sstrides[aj],
+                          shape[ai], shape[aj]);
+        return;
+    }
+    int a = outer[level];
+    for(ArrayIndex k = 0; k < shape[a]; ++k, dest += dstrides[a], src += sstrides[a])
+        transposeOuter<T>(level + 1, outer, shape, dest, dstrides, src, sstrides, ai, aj);
+}
+
+    // index of the non-singleton axis with the smallest absolute stride, or -1
+template <int N>
+int
+innermostNonSingletonAxis(Shape<N> const & shape, Shape<N> const & strides)
+{
+    int res = -1;
+    for(int k = 0; k < shape.size(); ++k)
+        if(shape[k] > 1 && (res < 0 || std::abs(strides[k]) < std::abs(strides[res])))
+            res = k;
+    return res;
+}
+
+/********************************************************/
+/*                                                      */
+/*                transposeInPlace helpers              */
+/*                                                      */
+/********************************************************/
+
+    // Swap the 'ni x nj' block at (i0, j0) with the transposed block at (j0, i0)
+    // of a plane whose element (i, j) is at 'base + i*rs + j*cs'.
+template <class T>
+void
+swapTransposedBlocks(char * base, ArrayIndex rs, ArrayIndex cs,
+                     ArrayIndex i0, ArrayIndex j0, ArrayIndex ni, ArrayIndex nj)
+{
+    if(ni > leafSize || nj > leafSize)
+    {
+        if(ni >= nj)
+        {
+            ArrayIndex m = (ni / 2) & ~(ArrayIndex)7;
+            swapTransposedBlocks<T>(base, rs, cs, i0, j0, m, nj);
+            swapTransposedBlocks<T>(base, rs, cs, i0 + m, j0, ni - m, nj);
+        }
+        else
+        {
+            ArrayIndex m = (nj / 2) & ~(ArrayIndex)7;
+            swapTransposedBlocks<T>(base, rs, cs, i0, j0, ni, m);
+            swapTransposedBlocks<T>(base, rs, cs, i0, j0 + m, ni, nj - m);
+        }
+        return;
+    }
+
+    typedef TransposeTileFor<T> Tile;
+
+    ArrayIndex i = 0;
+    if(Tile::size > 1 && cs == (ArrayIndex)sizeof(T) && rs > 0)
+    {
+        ArrayIndex ti = ni - ni % Tile::size,
+                   tj = nj - nj % Tile::size;
+        for(; i < ti; i += Tile::size)
+        {
+            ArrayIndex j = 0;
+            for(; j < tj; j += Tile::size)
+                Tile::swap(base + (i0+i)*rs + (j0+j)*cs,
+                           base + (j0+j)*rs + (i0+i)*cs, rs);
+            for(ArrayIndex ii = i; ii < i + Tile::size; ++ii)
+                for(ArrayIndex jj = j; jj < nj; ++jj)
+                    std::swap(elementAt<T>(base + (i0+ii)*rs + (j0+jj)*cs),
+                              elementAt<T>(base + (j0+jj)*rs + (i0+ii)*cs));
+        }
+    }
+    for(; i < ni; ++i)
+        for(ArrayIndex j = 0; j < nj; ++j)
+            std::swap(elementAt<T>(base + (i0+i)*rs + (j0+j)*cs),
+                      elementAt<T>(base + (j0+j)*rs + (i0+i)*cs));
+}
+
+    // transpose the 'n x n' diagonal block at (i0, i0)
+template <class T>
+void
+transposeDiagonalBlock(char * base, ArrayIndex rs, ArrayIndex cs,
+                       ArrayIndex i0, ArrayIndex n)
+{
+    if(n <= leafSize)
+    {
+        for(ArrayIndex i = i0; i < i0 + n; ++i)
+            for(ArrayIndex j = i + 1; j < i0 + n; ++j)
+                std::swap(elementAt<T>(base + i*rs + j*cs),
+                          elementAt<T>(base + j*rs + i*cs));
+        return;
+    }
+    ArrayIndex m = (n / 2) & ~(ArrayIndex)7;
+    transposeDiagonalBlock<T>(base, rs, cs, i0, m);
+    transposeDiagonalBlock<T>(base, rs, cs, i0 + m, n - m);
+    swapTransposedBlocks<T>(base, rs, cs, i0, i0 + m, m, n - m);
+}
+
+template <class T, int N>
+void
+transposeInPlaceOuter(int level, Shape<runtime_size> const & outer, Shape<N> const & shape,
+                      char * data, Shape<N> const & strides, int axis1, int axis2)
+{
+    if(level == outer.size())
+    {
+        transposeDiagonalBlock<T>(data, strides[axis1], strides[axis2], 0, shape[axis1]);
+        return;
+    }
+    int a = outer[level];
+    for(ArrayIndex k = 0; k < shape[a]; ++k, data += strides[a])
+        transposeInPlaceOuter<T>(level + 1, outer, shape, data, strides, axis1, axis2);
+}
+
+    // the remaining axes, sorted by decreasing absolute stride
+template <int N>
+Shape<runtime_size>
+outerAxes(Shape<N> const & strides, int axis1, int axis2)
+{
+    Shape<runtime_size> res(strides.size() - 2, DontInit);
+    for(int k = 0, l = 0; k < strides.size(); ++k)
+        if(k != axis1 && k != axis2)
+            res[l++] = k;
+    std::sort(res.begin(), res.end(),
+              [&strides](ArrayIndex l, ArrayIndex r)
+              {
+                  return std::abs(strides[r]) < std::abs(strides[l]);
+              });
+    return res;
+}
+
+} // namespace transpose_detail
+
+/********************************************************/
+/*                                                      */
+/*                     transposeCopy()                  */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Copy a transposed array into \a dest.
+
+        Afterwards, <tt>dest</tt> holds the same values as
+        <tt>src.transpose(permutation)</tt>, but in the memory layout of
+        <tt>dest</tt>. In contrast to plain assignment, the function
+        handles the case where the consecutive axes of source and destination
+        differ efficiently: the plane spanned by these two axes is copied by
+        a cache-oblivious recursive algorithm, and the innermost tiles are
+        transposed in SSE2 registers for 4- and 8-byte element types.
+        This is the typical situation when converting between C-order and
+        Fortran-order:
+        \code
+        ArrayND<3, float> volume(Shape3(200, 300, 400));   // C-order
+        ArrayND<3, float> fvolume(Shape3(400, 300, 200));  // C-order as well
+
+        // fvolume.transpose() is now 'volume' in Fortran-order
+        transposeCopy(volume, fvolume, Shape3(2, 1, 0));
+        \endcode
+        When source and destination overlap, or already agree in their
+        innermost axis, the function falls back to ordinary assignment.
+    */
+template <int N, class T, int M>
+void
+transposeCopy(ArrayViewND<N, T> const & src, ArrayViewND<N, T> dest,
+              Shape<M> const & permutation)
+{
+    using namespace transpose_detail;
+
+    ArrayViewND<N, T> s = src.transpose(permutation);
+    vigra_precondition(s.shape() == dest.shape(),
+        "transposeCopy(): shape mismatch.");
+
+    auto const & shape = dest.shape();
+    int ai = innermostNonSingletonAxis(shape, s.byte_strides()),
+        aj = innermostNonSingletonAxis(shape, dest.byte_strides());
+    if(ai == aj ||
+       array_detail::checkMemoryOverlap(dest.memoryRange(), s) != array_detail::NoMemoryOverlap)
+    {
+        dest = s;
+        return;
+    }
+
+    transposeOuter<T>(0, outerAxes(dest.byte_strides(), ai, aj), shape,
+                      (char *)dest.data(), dest.byte_strides(),
+                      (char const *)s.data(), s.byte_strides(),
+                      ai, aj);
+}
+
+    /** \brief Copy the transpose of \a src into \a dest.
+
+        Equivalent to <tt>transposeCopy(src, dest, permutation)</tt> with
+        the axis order reversed, i.e. <tt>dest = src.transpose()</tt>.
+    */
+template <int N, class T>
+inline void
+transposeCopy(ArrayViewND<N, T> const & src, ArrayViewND<N, T> dest)
+{
+    transposeCopy(src, dest, reversed(Shape<N>::range(src.ndim())));
+}
+
+/********************************************************/
+/*                                                      */
+/*                   transposeInPlace()                 */
+/*                                                      */
+/********************************************************/
+
+    /** \brief Transpose the square planes of an array in place.
+
+        Exchanges the elements at positions <tt>(..., i, ..., j, ...)</tt> and
+        <tt>(..., j, ..., i, ...)</tt>, where <tt>i</tt> and <tt>j</tt> are
+        the indices along \a axis1 and \a axis2 respectively. Both axes must
+        have the same length. The view itself is unchanged, i.e. afterwards
+        <tt>a</tt> holds the data of the former <tt>a.transpose(p)</tt>, where
+        <tt>p</tt> is the identity permutation with \a axis1 and \a axis2
+        exchanged. The planes are processed by the same cache-oblivious
+        recursion as in <tt>transposeCopy()</tt>.
+        \code
+        ArrayND<3, float> cube(Shape3(256, 256, 256));
+        transposeInPlace(cube, 0, 2);  // cube(x, y, z) <=> cube(z, y, x)
+        \endcode
+    */
+template <int N, class T>
+void
+transposeInPlace(ArrayViewND<N, T> a, int axis1, int axis2)
+{
+    using namespace transpose_detail;
+
+    vigra_precondition(0 <= axis1 && axis1 < a.ndim() && 0 <= axis2 && axis2 < a.ndim() && axis1 != axis2,
+        "transposeInPlace(): invalid axes.");
+    vigra_precondition(a.shape(axis1) == a.shape(axis2),
+        "transposeInPlace(): axes must have the same length.");
+    if(a.size() == 0)
+        return;
+
+    // the tile kernels require that rows are traversed along the
+    // consecutive axis, which is axis2 in 'transposeDiagonalBlock'
+    if(std::abs(a.byte_strides(axis1)) < std::abs(a.byte_strides(axis2)))
+        std::swap(axis1, axis2);
+    transposeInPlaceOuter<T>(0, outerAxes(a.byte_strides(), axis1, axis2), a.shape(),
+                             (char *)a.data(), a.byte_strides(), axis1, axis2);
+}
+
+    /** \brief Transpose a square matrix in place.
+
+        Equivalent to <tt>transposeInPlace(a, 0, 1)</tt> for a 2D array.
+    */
+template <int N, class T>
+inline void
+transposeInPlace(ArrayViewND<N, T> a)
+{
+    vigra_precondition(a.ndim() == 2,
+        "transposeInPlace(): array must be 2-dimensional.");
+    transposeInPlace(a, 0, 1);
+}
+
+} // namespace vigra
+
+#endif // VIGRA2_TRANSPOSE_HXX
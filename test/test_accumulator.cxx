@@ -0,0 +1,232 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014-2017 by Ullrich Koethe                  */
+/*                                                                      */
+/*    This file is part of the VIGRA2 computer vision library.          */
+/*    The VIGRA2 Website is                                             */
+/*        http://ukoethe.github.io/vigra2                               */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+
+#include <typeinfo>
+#include <iostream>
+#include <string>
+#include <vigra2/unittest.hxx>
+#include <vigra2/accumulator.hxx>
+#include <vigra2/algorithm_nd.hxx>
+
+using namespace vigra;
+
+template <int N>
+struct AccumulatorTest
+{
+    typedef Shape<N> S;
+
+    ArrayND<N, double> data;
+    ArrayND<N, int> labels;
+
+    AccumulatorTest()
+    : data(S{5, 4, 3})
+    , labels(S{5, 4, 3})
+    {
+        int count = 0;
+        for(auto iter = data.begin(); iter != data.end(); ++iter, ++count)
+            *iter = (count * 7) % 11 + 0.5;
+        count = 0;
+        for(auto iter = labels.begin(); iter != labels.end(); ++iter, ++count)
+            *iter = (count / 3) % 4;
+    }
+
+    void testChain()
+    {
+        using namespace vigra::acc;
+        typedef AccumulatorChain<double, N, Select<Variance, Mean, Minimum, Maximum>> Chain;
+
+        static_assert(std::is_same<typename Chain::Tags,
+                                   Select<Variance, Count, Sum, Mean, Minimum, Maximum>>::value,
+                      "dependency resolution failed");
+
+        double v[] = { 4.0, 1.0, 3.0, 8.0, 2.0 };
+        Chain a, b, c;
+        for(int k=0; k<5; ++k)
+        {
+            a.update(v[k], S{0,0,0});
+            (k < 2 ? b : c).update(v[k], S{0,0,0});
+        }
+        b.merge(c);
+
+        shouldEqual(get<Count>(a), 5);
+        shouldEqual(get<Sum>(a), 18.0);
+        shouldEqual(get<Mean>(a), 3.6);
+        shouldEqual(get<Minimum>(a), 1.0);
+        shouldEqual(get<Maximum>(a), 8.0);
+        shouldEqualTolerance(get<Variance>(a), 5.84, 1e-14);
+
+        shouldEqual(get<Count>(b), 5);
+        shouldEqual(get<Mean>(b), 3.6);
+        shouldEqual(get<Minimum>(b), 1.0);
+        shouldEqual(get<Maximum>(b), 8.0);
+        shouldEqualTolerance(get<Variance>(b), 5.84, 1e-14);
+    }
+
+    template <class SELECTED>
+    acc::AccumulatorChainArray<double, N, SELECTED>
+    bruteForce(ArrayViewND<N, double> d, ArrayViewND<N, int> l)
+    {
+        acc::AccumulatorChainArray<double, N, SELECTED> res;
+        foreachCoordinate(d.shape(), [&](S const & p) {
+            res.update(d[p], p, l[p]);
+        });
+        return res;
+    }
+
+    void testRegions()
+    {
+        using namespace vigra::acc;
+        typedef Select<Count, Mean, Variance, Minimum, Maximum, BoundingBox, Centroid> Features;
+
+        auto ref = bruteForce<Features>(data, labels);
+        shouldEqual(ref.regionCount(), 4);
+
+        for(int threads : { 0, 1, 3, 8 })
+        {
+            AccumulatorChainArray<double, N, Features> a;
+            extractFeatures(data, labels, a, ParallelOptions().numThreads(threads));
+            shouldEqual(a.regionCount(), 4);
+            for(int k=0; k<4; ++k)
+            {
+                shouldEqual(get<Count>(a, k), get<Count>(ref, k));
+                shouldEqualTolerance(get<Mean>(a, k), get<Mean>(ref, k), 1e-12);
+                shouldEqualTolerance(get<Variance>(a, k), get<Variance>(ref, k), 1e-12);
+                shouldEqual(get<Minimum>(a, k), get<Minimum>(ref, k));
+                shouldEqual(get<Maximum>(a, k), get<Maximum>(ref, k));
+                shouldEqual(get<BoundingBox>(a, k), get<BoundingBox>(ref, k));
+                auto c = get<Centroid>(a, k), cref = get<Centroid>(ref, k);
+                shouldEqualSequenceTolerance(c.begin(), c.end(), cref.begin(), 1e-12);
+            }
+        }
+
+        // strided and transposed arrays
+        AccumulatorChainArray<double, N, Features> t;
+        extractFeatures(data.transpose(), labels.transpose(), t);
+        shouldEqual(t.regionCount(), 4);
+        for(int k=0; k<4; ++k)
+        {
+            shouldEqual(get<Count>(t, k), get<Count>(ref, k));
+            shouldEqualTolerance(get<Mean>(t, k), get<Mean>(ref, k), 1e-12);
+            shouldEqual(get<BoundingBox>(t, k).lower(), reversed(get<BoundingBox>(ref, k).lower()));
+            shouldEqual(get<BoundingBox>(t, k).upper(), reversed(get<BoundingBox>(ref, k).upper()));
+        }
+
+        // background label
+        AccumulatorChainArray<double, N, Features> b;
+        b.ignoreLabel(0);
+        extractFeatures(data, labels, b);
+        shouldEqual(get<Count>(b, 0), 0);
+        shouldEqual(get<Count>(b, 2), get<Count>(ref, 2));
+
+        // a single region equals the global statistics
+        ArrayND<N, int> zeros(data.shape(), 0);
+        AccumulatorChainArray<double, N, Features> g;
+        extractFeatures(data, zeros, g);
+        shouldEqual(get<Count>(g, 0), data.size());
+        shouldEqualTolerance(get<Mean>(g, 0), data.template sum<double>() / data.size(), 1e-12);
+        shouldEqual(get<BoundingBox>(g, 0), Box<N>(data.shape()));
+
+        // large enough to be split into several chunks
+        ArrayND<N, double> bigData(S{300, 50, 20});
+        ArrayND<N, int> bigLabels(bigData.shape());
+        int count = 0;
+        for(auto iter = bigData.begin(); iter != bigData.end(); ++iter, ++count)
+            *iter = (count * 13) % 101;
+        count = 0;
+        for(auto iter = bigLabels.begin(); iter != bigLabels.end(); ++iter, ++count)
+            *iter = (count / 7) % 1000;
+        AccumulatorChainArray<double, N, Features> serial, parallel;
+        extractFeatures(bigData, bigLabels, serial, ParallelOptions().numThreads(1));
+        extractFeatures(bigData, bigLabels, parallel, ParallelOptions().numThreads(4));
+        shouldEqual(serial.regionCount(), 1000);
+        shouldEqual(parallel.regionCount(), 1000);
+        for(int k=0; k<1000; ++k)
+        {
+            shouldEqual(get<Count>(parallel, k), get<Count>(serial, k));
+            shouldEqualTolerance(get<Mean>(parallel, k), get<Mean>(serial, k), 1e-12);
+            shouldEqualTolerance(get<Variance>(parallel, k), get<Variance>(serial, k), 1e-10);
+            shouldEqual(get<Minimum>(parallel, k), get<Minimum>(serial, k));
+            shouldEqual(get<Maximum>(parallel, k), get<Maximum>(serial, k));
+            shouldEqual(get<BoundingBox>(parallel, k), get<BoundingBox>(serial, k));
+        }
+
+        try
+        {
+            extractFeatures(data, labels.subarray(S{0,0,0}, S{2,2,2}), a_);
+            failTest("no exception thrown");
+        }
+        catch(ContractViolation & c)
+        {
+            std::string expected("\nPrecondition violation!\nextractFeatures(): shape mismatch between data and labels.");
+            std::string message(c.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+    }
+
+    acc::AccumulatorChainArray<double, N, acc::Select<acc::Count>> a_;
+};
+
+struct AccumulatorTestSuite
+: public vigra::test_suite
+{
+    AccumulatorTestSuite()
+    : vigra::test_suite("AccumulatorTestSuite")
+    {
+        addTests<3>();
+        addTests<runtime_size>();
+    }
+
+    template <int N>
+    void addTests()
+    {
+        add( testCase(&AccumulatorTest<N>::testChain));
+        add( testCase(&AccumulatorTest<N>::testRegions));
+    }
+};
+
+int main(int argc, char ** argv)
+{
+    AccumulatorTestSuite test;
+
+    int failed = test.run(vigra::testsToBeExecuted(argc, argv));
+
+    std::cout << test.report() << std::endl;
+
+    return (failed != 0);
+}
@@ -0,0 +1,344 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014-2017 by Ullrich Koethe                  */
+/*                                                                      */
+/*    This file is part of the VIGRA2 computer vision library.          */
+/*    The VIGRA2 Website is                                             */
+/*        http://ukoethe.github.io/vigra2                               */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vigra2/unittest.hxx>
+#include <vigra2/array_file.hxx>
+#include <vigra2/array_nd.hxx>
+#include <vigra2/array_math.hxx>
+
+using namespace vigra;
+
+struct ArrayFileTest
+{
+    typedef Shape<3> S;
+
+    std::string filename;
+
+    ArrayFileTest()
+    : filename("test_array_file.tmp")
+    {}
+
+    ~ArrayFileTest()
+    {
+        std::remove(filename.c_str());
+    }
+
+    template <class T>
+    ArrayND<3, T> makeArray(S const & shape, MemoryOrder order = C_ORDER)
+    {
+        ArrayND<3, T> a(shape, order);
+        int k = 0;
+        for(auto & v : a)
+            v = T(k++ % 251);
+        return a;
+    }
+
+    template <class ARRAY>
+    void checkRoundTrip(ARRAY const & a)
+    {
+        typedef typename ARRAY::value_type T;
+        static const int N = ARRAY::actual_dimension;
+
+        writeArray(filename, a);
+
+        ArrayND<N, T> r = readArray<N, T>(filename);
+        should(r == a);
+        should(r.axistags() == a.axistags());
+
+        MappedArrayND<N, T> m(filename, true);
+        should(m == a);
+        should(m.axistags() == a.axistags());
+        shouldEqual(m.info().dataOffset % 4096, 0u);
+        shouldEqual((std::size_t)m.data() % 4096, 0u);
+    }
+
+    void testRoundTrip()
+    {
+        auto a = makeArray<float>(S{ 4, 5, 6 });
+        a.setAxistags(makeAxistags("zyx"));
+        checkRoundTrip(a);
+
+        // zero-copy: the file keeps the strides of consecutive arrays
+        writeArray(filename, a.transpose());
+        MappedArrayND<3, float> t(filename);
+        should(t == a.transpose());
+        should(t.byte_strides() == a.transpose().byte_strides());
+        should((readArray<3, float>(filename) == a.transpose()));
+
+        checkRoundTrip(makeArray<float>(S{ 4, 5, 6 }, F_ORDER));
+        checkRoundTrip(a.transpose(S{ 1, 2, 0 }));
+        checkRoundTrip(makeArray<std::uint8_t>(S{ 1, 7, 1 }));
+        checkRoundTrip(makeArray<double>(S{ 0, 3, 2 }));
+
+        // non-consecutive arrays are written in C-order, several blocks
+        ArrayND<3, float> big(S{ 40, 200, 400 });
+        int k = 0;
+        for(auto & v : big)
+            v = float(k++);
+        checkRoundTrip(big.subarray(S{ 0, 0, 1 }, S{ 40, 200, 400 }));
+        checkRoundTrip(big.subarray(S{ 1, 3, 0 }, S{ 40, 200, 400 }, S{ 2, 1, 3 }).flip(2));
+        checkRoundTrip(big);
+
+        // vector elements are stored as channels
+        ArrayND<2, TinyArray<std::uint16_t, 3>> rgb(Shape<2>{ 20, 30 });
+        for(int y = 0; y < 20; ++y)
+            for(int x = 0; x < 30; ++x)
+                rgb(y, x) = TinyArray<std::uint16_t, 3>{ std::uint16_t(x), std::uint16_t(y), std::uint16_t(x*y) };
+        checkRoundTrip(rgb);
+        shouldEqual(readArrayInfo(filename).channels, 3);
+        checkRoundTrip(rgb.transpose());
+
+        // a file keeps its axistags and storage order when read with runtime dimension
+        writeArray(filename, a.transpose(S{ 2, 0, 1 }));
+        ArrayND<runtime_size, float> r = readArray<runtime_size, float>(filename);
+        shouldEqual(r.ndim(), 3);
+        should(r == a.transpose(S{ 2, 0, 1 }));
+        should(r.axistags() == a.transpose(S{ 2, 0, 1 }).axistags());
+        MappedArrayND<runtime_size, float> mr(filename);
+        should(mr.byte_strides() == a.transpose(S{ 2, 0, 1 }).byte_strides());
+    }
+
+    void testArrayInfo()
+    {
+        auto a = makeArray<std::int16_t>(S{ 2, 3, 4 });
+        a.setAxistags(makeAxistags("cyx"));
+        std::vector<AxisInfo> axes = { AxisInfo(tags::axis_c),
+                                       AxisInfo(tags::axis_y, 0.5, "rows"),
+                                       AxisInfo(tags::axis_x, 0.25, "columns") };
+        writeArray(filename, a, axes);
+
+        ArrayFileInfo info = readArrayInfo(filename);
+        shouldEqual(info.kind, 'i');
+        shouldEqual(info.itemsize, 2);
+        shouldEqual(info.channels, 1);
+        should(info.hasElementType<std::int16_t>());
+        should(!info.hasElementType<std::uint16_t>());
+        shouldEqual(info.ndim(), 3);
+        should(info.shape == a.shape());
+        should(info.axistags == a.axistags());
+        shouldEqual(info.dataSize, 48u);
+        shouldEqual(info.checksum, checksum((char const *)a.data(), 48));
+        shouldEqual(info.axisinfo.size(), 3u);
+        should(info.axisinfo[1] == axes[1]);
+        shouldEqual(info.axisinfo[1].resolution(), 0.5);
+        shouldEqual(info.axisinfo[2].description(), "columns");
+    }
+
+        // replace the header of a fresh 4x5x6 float file by 'patch(header)'
+        // and recompute its checksum, then expect a 'corrupt header' error
+    template <class F>
+    void checkCorruptHeader(F patch)
+    {
+        writeArray(filename, makeArray<float>(S{ 4, 5, 6 }));
+        {
+            std::fstream f(filename.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+            std::uint64_t headerSize;
+            f.seekg(16);
+            f.read((char *)&headerSize, 8);
+            std::string header(headerSize, '\0');
+            f.seekg(0);
+            f.read(&header[0], headerSize);
+            patch(header);
+            std::uint32_t crc = checksum(header.data(), headerSize - 4);
+            std::memcpy(&header[headerSize - 4], &crc, 4);
+            f.seekp(0);
+            f.write(header.data(), headerSize);
+        }
+        try
+        {
+            MappedArrayND<3, float> m(filename);
+            failTest("no exception thrown");
+        }
+        catch(std::exception & e)
+        {
+            std::string expected("\nreadArrayInfo(): corrupt header.");
+            std::string message(e.what());
+            shouldMsg(0 == expected.compare(message.substr(0,expected.size())), message.c_str());
+        }
+    }
+
+    void testErrors()
+    {
+        writeArray(filename, makeArray<float>(S{ 4, 5, 6 }));
+
+        try
+        {
+            readArray<3, double>(filename);
+            failTest("no exception thrown");
+        }
+        catch(std::exception & e)
+        {
+            std::string expected("\nPrecondition violation!\nreadArray(): element type mismatch.");
+            std::string message(e.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+        try
+        {
+            MappedArrayND<2, float> m(filename);
+            failTest("no exception thrown");
+        }
+        catch(std::exception & e)
+        {
+            std::string expected("\nPrecondition violation!\nMappedArrayND(): dimension mismatch.");
+            std::string message(e.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+
+        // corrupt a data byte
+        {
+            std::fstream f(filename.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+            f.seekp(4096 + 10);
+            f.put('x');
+        }
+        try
+        {
+            readArray<3, float>(filename);
+            failTest("no exception thrown");
+        }
+        catch(std::exception & e)
+        {
+            std::string expected("\nreadArray(): checksum mismatch.");
+            std::string message(e.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+        readArray<3, float>(filename, false);
+        MappedArrayND<3, float> unverified(filename);
+        try
+        {
+            MappedArrayND<3, float> m(filename, true);
+            failTest("no exception thrown");
+        }
+        catch(std::exception & e)
+        {
+            std::string expected("\nMappedArrayND(): checksum mismatch.");
+            std::string message(e.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+
+        // byte order mark of the other endianness
+        writeArray(filename, makeArray<float>(S{ 4, 5, 6 }));
+        {
+            std::fstream f(filename.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+            std::uint32_t bom;
+            f.seekg(12);
+            f.read((char *)&bom, 4);
+            bom = (bom >> 24) | ((bom >> 8) & 0xFF00) | ((bom << 8) & 0xFF0000) | (bom << 24);
+            f.seekp(12);
+            f.write((char const *)&bom, 4);
+        }
+        try
+        {
+            readArrayInfo(filename);
+            failTest("no exception thrown");
+        }
+        catch(std::exception & e)
+        {
+            std::string expected("\nPrecondition violation!\nreadArrayInfo(): file was written with a different byte order.");
+            std::string message(e.what());
+            shouldMsg(0 == expected.compare(message.substr(0,expected.size())), message.c_str());
+        }
+
+        // corrupt the header
+        writeArray(filename, makeArray<float>(S{ 4, 5, 6 }));
+        {
+            std::fstream f(filename.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+            f.seekp(60);
+            f.put('x');
+        }
+        try
+        {
+            readArrayInfo(filename);
+            failTest("no exception thrown");
+        }
+        catch(std::exception & e)
+        {
+            std::string expected("\nreadArrayInfo(): corrupt header.");
+            std::string message(e.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+
+        // headers with a valid checksum, but inconsistent contents
+        checkCorruptHeader([](std::string & h) { std::uint32_t ndim = 0x7fffffff; std::memcpy(&h[56], &ndim, 4); });
+        checkCorruptHeader([](std::string & h) { std::int64_t stride = 4*4*5*6; std::memcpy(&h[84], &stride, 8); });
+        checkCorruptHeader([](std::string & h) { std::int64_t stride = -4; std::memcpy(&h[100], &stride, 8); });
+        checkCorruptHeader([](std::string & h) { std::int64_t stride = 8; std::memcpy(&h[100], &stride, 8); });
+        checkCorruptHeader([](std::string & h) { std::int64_t shape = 1ll << 62; std::memcpy(&h[60], &shape, 8); });
+
+        try
+        {
+            readArrayInfo("non_existing_file.tmp");
+            failTest("no exception thrown");
+        }
+        catch(std::exception & e)
+        {
+            std::string expected("\nreadArrayInfo(): unable to open 'non_existing_file.tmp'.");
+            std::string message(e.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+    }
+};
+
+struct ArrayFileTestSuite
+: public vigra::test_suite
+{
+    ArrayFileTestSuite()
+    : vigra::test_suite("ArrayFileTestSuite")
+    {
+        add( testCase(&ArrayFileTest::testRoundTrip));
+        add( testCase(&ArrayFileTest::testArrayInfo));
+        add( testCase(&ArrayFileTest::testErrors));
+    }
+};
+
+int main(int argc, char ** argv)
+{
+    ArrayFileTestSuite test;
+
+    int failed = test.run(vigra::testsToBeExecuted(argc, argv));
+
+    std::cout << test.report() << std::endl;
+
+    return (failed != 0);
+}
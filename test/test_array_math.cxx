@@ -443,6 +443,329 @@ struct ArrayMathTest
         }
     }
 
+    void testConsecutiveFastPath()
+    {
+        using namespace array_math;
+
+        // consecutive operands are processed by a flat loop, everything
+        // else must still go through the general implementation
+        ArrayND<N, int> a(S{ 4, 3, 1 }), b(S{ 4, 3, 1 });
+        for(int k=0; k<a.size(); ++k)
+        {
+            a.data()[k] = k;
+            b.data()[k] = 2*k;
+        }
+        ArrayND<N, int> c(a + b);
+        for(int k=0; k<c.size(); ++k)
+            shouldEqual(c.data()[k], 3*k);
+
+        // singleton axis with arbitrary stride
+        ArrayViewND<N, int> v(S{ 4, 3, 1 }, tags::byte_strides = S{ 12, 4, 1000 }, a.data());
+        c = v;
+        should(c == a);
+        c += v * 2;
+        should(c == a * 3);
+
+        // broadcasting along a singleton axis
+        ArrayND<N, int> row(S{ 1, 3, 1 }), d(S{ 4, 3, 1 });
+        row.init(1);
+        row[S{ 0, 2, 0 }] = 5;
+        d = row;
+        for(int i=0; i<4; ++i)
+        {
+            shouldEqual((d[S{ i, 0, 0 }]), 1);
+            shouldEqual((d[S{ i, 2, 0 }]), 5);
+        }
+
+        // overlapping source and target
+        ArrayND<N, int> e(S{ 1, 1, 10 });
+        for(int k=0; k<10; ++k)
+            e.data()[k] = k;
+        e.subarray(S{ 0, 0, 1 }, S{ 1, 1, 10 }) = e.subarray(S{ 0, 0, 0 }, S{ 1, 1, 9 });
+        for(int k=1; k<10; ++k)
+            shouldEqual(e.data()[k], k-1);
+        e.subarray(S{ 0, 0, 0 }, S{ 1, 1, 9 }) += e.subarray(S{ 0, 0, 1 }, S{ 1, 1, 10 });
+        shouldEqual(e.data()[0], 0);
+        for(int k=1; k<9; ++k)
+            shouldEqual(e.data()[k], 2*k-1);
+
+        // overlapping reversed operand
+        for(int k=0; k<10; ++k)
+            e.data()[k] = k;
+        e.subarray(S{ 0, 0, 1 }, S{ 1, 1, 6 }) = e.subarray(S{ 0, 0, 0 }, S{ 1, 1, 5 }).flip(2) + 0;
+        for(int k=1; k<6; ++k)
+            shouldEqual(e.data()[k], 5-k);
+        for(int k=0; k<10; ++k)
+            e.data()[k] = k;
+        e.subarray(S{ 0, 0, 0 }, S{ 1, 1, 5 }).flip(2) += e.subarray(S{ 0, 0, 1 }, S{ 1, 1, 6 });
+        for(int k=0; k<5; ++k)
+            shouldEqual(e.data()[k], k + 5-k);
+        // identical reversed views alias elementwise
+        e.flip(2) += e.flip(2);
+        for(int k=0; k<5; ++k)
+            shouldEqual(e.data()[k], 10);
+
+        // reductions over expressions
+        shouldEqual(sum(a + b), 3 * 66);
+        shouldEqual(sum(a + b.transpose().transpose()), 3 * 66);
+    }
+
+    void testFuse()
+    {
+        using namespace array_math;
+
+        // sequential reference
+        DArray t1(b * c), e1(t1 + a), f1(sqrt(e1));
+
+        // fused, with the first intermediate kept in a register
+        FusedTemporary<double> t;
+        DArray e(s), f(s);
+        fuse(defer(t) = b * c,
+             defer(e) = t + a,
+             defer(f) = sqrt(e));
+        should(e == e1);
+        should(f == f1);
+        shouldEqual(t.value(), (b[S{ 3, 2, 1 }] * c[S{ 3, 2, 1 }]));
+
+        // arithmetic assignments and in-place updates of the same element
+        DArray g(a), h(s, 1.0);
+        fuse(defer(g) += b,
+             defer(g) *= 2.0,
+             defer(h) -= g,
+             defer(h) /= c);
+        should(g == (a + b) * 2.0);
+        should(h == (1.0 - (a + b) * 2.0) / c);
+
+        // strided operands, broadcasting and scalars
+        DArray k(s), l(s);
+        auto at = a.transpose().transpose();
+        DArray row(S{ 4, 1, 1 });
+        for(int x=0; x<4; ++x)
+            row[S{ x, 0, 0 }] = x;
+        fuse(defer(k.transpose()) = at.transpose() + row.transpose(),
+             defer(l.transpose()) = k.transpose() - 1);
+        should(k == a + row);
+        should(l == a + row - 1);
+
+        DArray m(s), n(s);
+        ArrayViewND<N, double> mv = m.transpose(), nv = n.transpose(), av = a.transpose();
+        fuse(defer(mv) = av * 2.0,
+             defer(nv) = mv + 1.0);
+        should(m == a * 2.0);
+        should(n == a * 2.0 + 1.0);
+
+        // errors
+        try
+        {
+            fuse(defer(t) = a);
+            failTest("no exception thrown");
+        }
+        catch(std::exception & e)
+        {
+            std::string expected("\nPrecondition violation!\nfuse(): at least one statement must assign to an array.");
+            std::string message(e.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+        try
+        {
+            DArray o(S{ 4, 3, 1 });
+            fuse(defer(e) = a, defer(o) = b);
+            failTest("no exception thrown");
+        }
+        catch(std::exception & e)
+        {
+            std::string expected("\nPrecondition violation!\nfuse(): shape mismatch between targets.");
+            std::string message(e.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+        try
+        {
+            DArray o(S{ 4, 3, 1 });
+            fuse(defer(o) = a);
+            failTest("no exception thrown");
+        }
+        catch(std::exception & e)
+        {
+            std::string expected("\nPrecondition violation!\nfuse(): shape mismatch.");
+            std::string message(e.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+        try
+        {
+            DArray o(S{ 3, 3, 3 });
+            fuse(defer(o) = o.transpose());
+            failTest("no exception thrown");
+        }
+        catch(std::exception & e)
+        {
+            std::string expected("\nPrecondition violation!\nfuse(): statements must only access the current element of a target.");
+            std::string message(e.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+    }
+
+    void testExpressionReductions()
+    {
+        using namespace array_math;
+
+        // reference values from materialized arrays
+        DArray ab(a * b), amb(a - b);
+        double dot = 0.0, sq = 0.0, l1 = 0.0, linf = 0.0;
+        for(int k=0; k<ab.size(); ++k)
+        {
+            dot  += ab[k];
+            sq   += amb[k]*amb[k];
+            l1   += std::abs(amb[k]);
+            linf  = std::max(linf, std::abs(amb[k]));
+        }
+
+        shouldEqualTolerance(sum(a * b), dot, 1e-12);
+        shouldEqualTolerance(sum(a * b, 1.0), dot + 1.0, 1e-12);
+        shouldEqualTolerance(squaredNorm(a - b), sq, 1e-12);
+        shouldEqualTolerance(norm(a - b), std::sqrt(sq), 1e-12);
+        shouldEqualTolerance(norm(a - b, 1), l1, 1e-12);
+        shouldEqual(norm(a - b, -1), linf);
+        shouldEqual(norm(i - 3, 0), 23.0);
+        shouldEqual(sum(i * j), 2 * 276);
+        shouldEqual(squaredNorm(i - 1), squaredNorm(Array(i - 1)));
+
+        // strided and broadcast operands give the same result
+        shouldEqualTolerance(sum(a.transpose() * b.transpose()), dot, 1e-12);
+        DArray row(S{ 1, 3, 1 }, 2.0);
+        shouldEqualTolerance(sum(a * b * row), 2.0 * dot, 1e-12);
+
+        // lvalue expressions are not modified and can be reused
+        auto e = a.transpose() - b.transpose();
+        shouldEqualTolerance(squaredNorm(e), sq, 1e-12);
+        shouldEqualTolerance(squaredNorm(e), sq, 1e-12);
+        should(all(e < 1.0));
+        should(!any(e > 1.0));
+        should(any(e > 0.0));
+        should(any(i > 22));
+        should(!all(i > 0));
+        should(all_finite(a / c));
+        should(!all_finite(a / z));
+
+        try
+        {
+            sum(a + Array(S{ 4, 3, 3 }));
+            failTest("no exception thrown");
+        }
+        catch(std::exception & e)
+        {
+            std::string expected("\nPrecondition violation!\nsum(ARRAY_EXPRESSION): shape mismatch.");
+            std::string message(e.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+    }
+
+    void testWhereClip()
+    {
+        using namespace array_math;
+
+        Array r(where(i > 10, i, -i));
+        for(int k=0; k<r.size(); ++k)
+            shouldEqual(r[k], k > 10 ? k : -k);
+
+        DArray rd(where(i % 2, a, 1.0));
+        for(int k=0; k<rd.size(); ++k)
+            shouldEqual(rd[k], k % 2 ? a[k] : 1.0);
+
+        rd = where(a > 0.5, b.transpose().transpose(), c);
+        for(int k=0; k<rd.size(); ++k)
+            shouldEqual(rd[k], a[k] > 0.5 ? b[k] : c[k]);
+
+        // a broadcast condition selects whole rows
+        Array row(S{ 1, 3, 1 });
+        row[1] = 1;
+        r = where(row, i, z);
+        for(int k=0; k<r.size(); ++k)
+            shouldEqual(r[k], (k / 2) % 3 == 1 ? k : 0);
+
+        should((std::is_same<double, typename decltype(where(i > 3, i, a))::value_type>::value));
+
+        r = clip(i, 5, 17);
+        for(int k=0; k<r.size(); ++k)
+            shouldEqual(r[k], std::min(std::max(k, 5), 17));
+
+        rd = clip(d + b, -a, a);
+        for(int k=0; k<rd.size(); ++k)
+            shouldEqual(rd[k], std::min(std::max(d[k] + b[k], -a[k]), a[k]));
+
+        // the scalar clip() remains available
+        shouldEqual(clip(7, 0, 5), 5);
+
+        try
+        {
+            Array(where(i, z, Array(S{ 4, 3, 3 })));
+            failTest("no exception thrown");
+        }
+        catch(std::exception & e)
+        {
+            std::string expected("\nPrecondition violation!\nArrayMathTernaryOperator(): shape mismatch.");
+            std::string message(e.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+    }
+
+    void testMaskedAssignment()
+    {
+        using namespace array_math;
+
+        Array r(i);
+        r[i > 10] = 0;
+        for(int k=0; k<r.size(); ++k)
+            shouldEqual(r[k], k > 10 ? 0 : k);
+
+        r = i;
+        r[elementwiseEqual(i % 3, 0)] += 2 * j;
+        for(int k=0; k<r.size(); ++k)
+            shouldEqual(r[k], k % 3 == 0 ? k + 4 : k);
+
+        r = i;
+        r[i < 5] -= i;
+        r[i >= 20] *= 2;
+        for(int k=0; k<r.size(); ++k)
+            shouldEqual(r[k], k < 5 ? 0 : k >= 20 ? 2*k : k);
+
+        // masked-out integer divisions by zero are never executed
+        r = i;
+        r[i > 0] /= i;
+        for(int k=0; k<r.size(); ++k)
+            shouldEqual(r[k], k > 0 ? 1 : 0);
+
+        DArray rd(b);
+        rd[a > 0.5] /= 0.0;
+        for(int k=0; k<rd.size(); ++k)
+            should(a[k] > 0.5 ? std::isinf(rd[k]) : rd[k] == b[k]);
+
+        // the mask may be transposed or broadcast, the target strided
+        r = i;
+        Array mask(S{ 4, 1, 1 });
+        mask[2] = 1;
+        r.transpose()[mask.transpose()] = -1;
+        for(int k=0; k<r.size(); ++k)
+            shouldEqual(r[k], k / 6 == 2 ? -1 : k);
+
+        // the right-hand side may overlap with the target
+        r = i;
+        r[i > 10] = r.transpose().transpose() * 2;
+        for(int k=0; k<r.size(); ++k)
+            shouldEqual(r[k], k > 10 ? 2*k : k);
+
+        try
+        {
+            r[Array(S{ 4, 3, 3 })] = 1;
+            failTest("no exception thrown");
+        }
+        catch(std::exception & e)
+        {
+            std::string expected("\nPrecondition violation!\nArrayViewND::operator[](MASK): shape mismatch.");
+            std::string message(e.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+    }
+
     void testVectorTypes()
     {
         using namespace array_math;
@@ -480,6 +803,11 @@ struct ArrayMathTestSuite
         add(testCase(&ArrayMathTest<N>::testBinary));
         add(testCase(&ArrayMathTest<N>::testArithmeticAssignment));
         add(testCase(&ArrayMathTest<N>::testOverlappingMemory));
+        add(testCase(&ArrayMathTest<N>::testConsecutiveFastPath));
+        add(testCase(&ArrayMathTest<N>::testFuse));
+        add(testCase(&ArrayMathTest<N>::testExpressionReductions));
+        add(testCase(&ArrayMathTest<N>::testWhereClip));
+        add(testCase(&ArrayMathTest<N>::testMaskedAssignment));
         add(testCase(&ArrayMathTest<N>::testVectorTypes)); 
     }
 };
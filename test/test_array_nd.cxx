@@ -356,6 +356,132 @@ struct ArrayNDTest
         }
     }
 
+    void testStridedViews()
+    {
+        using namespace array_math;
+
+        View v0(s, &data1[0]);
+        should(v0.isConsecutive());
+
+        auto half = v0.subarray(S{ 0,0,0 }, v0.shape(), S{ 2,2,1 });
+        shouldEqual(half.shape(), (S{ 2,2,2 }));
+        should(!half.isConsecutive());
+        for (int i = 0; i < 2; ++i)
+            for (int j = 0; j < 2; ++j)
+                for (int k = 0; k < 2; ++k)
+                    shouldEqual((half[{i, j, k}]), (v0[{2*i, 2*j, k}]));
+
+        auto odd = v0.subarray(S{ 1,0,0 }, v0.shape(), S{ 2,2,1 });
+        shouldEqual(odd.shape(), (S{ 2,2,2 }));
+        shouldEqual((odd[{1, 1, 1}]), (v0[{3, 2, 1}]));
+
+        auto flipped = v0.flip(0);
+        shouldEqual(flipped.shape(), s);
+        should(!flipped.isConsecutive());
+        should(flipped.memoryRange() == v0.memoryRange());
+        for (int i = 0; i < 4; ++i)
+            for (int j = 0; j < 3; ++j)
+                for (int k = 0; k < 2; ++k)
+                    shouldEqual((flipped[{i, j, k}]), (v0[{3 - i, j, k}]));
+        should(flipped.flip(0) == v0);
+        shouldEqual(flipped.sum(), v0.sum());
+
+        auto back = v0.subarray(S{ 1,0,0 }, v0.shape(), S{ -2,1,-1 });
+        shouldEqual(back.shape(), (S{ 2,3,2 }));
+        for (int j = 0; j < 3; ++j)
+            for (int k = 0; k < 2; ++k)
+            {
+                shouldEqual((back[{0, j, k}]), (v0[{3, j, 1 - k}]));
+                shouldEqual((back[{1, j, k}]), (v0[{1, j, 1 - k}]));
+            }
+
+        // flipping all axes of a consecutive array gives consecutive memory
+        // in reverse order, which must not be mistaken for a consecutive view
+        auto reversed = v0.flip(0).flip(1).flip(2);
+        should(!reversed.isConsecutive());
+        shouldEqual((reversed[{0, 0, 0}]), 23);
+
+        // assignment and expressions
+        Array a(v0.flip(1));
+        should(a.flip(1) == v0);
+        should(Array(a.transpose().flip(1)).transpose() == v0);
+        Array b(a + v0.flip(1));
+        should(b == 2 * a);
+
+        // hopelessly overlapping memory with reversed axes
+        a = v0;
+        a = a.flip(0);
+        should(a == v0.flip(0));
+        a = v0;
+        a.flip(2) += a.flip(2);
+        should(a == 2 * v0);
+
+        // shifted views with identical negative strides
+        Array1D c(typename Array1D::difference_type{ 10 });
+        for (int k = 0; k < 10; ++k)
+            c[k] = k;
+        typedef typename Array1D::difference_type S1;
+        c.subarray(S1{ 1 }, S1{ 10 }).flip(0) = c.subarray(S1{ 0 }, S1{ 9 }).flip(0);
+        shouldEqual(c[0], 0);
+        for (int k = 1; k < 10; ++k)
+            shouldEqual(c[k], k - 1);
+
+        try
+        {
+            v0.subarray(S{ 0,0,0 }, v0.shape(), S{ 1,0,1 });
+            failTest("no exception thrown");
+        }
+        catch (std::exception & c)
+        {
+            std::string expected("\nPrecondition violation!\nArrayViewND::subarray(): step must be non-zero.");
+            std::string message(c.what());
+            should(0 == expected.compare(message.substr(0, expected.size())));
+        }
+    }
+
+    void testBroadcastTo()
+    {
+        using namespace array_math;
+
+        View v0(s, &data1[0]);
+
+        auto column = v0.subarray(S{ 0,0,0 }, S{ 4,1,2 });
+        auto b = column.broadcastTo(s);
+        shouldEqual(b.shape(), s);
+        shouldEqual(b.byte_strides(), (S{ 6,0,1 } * sizeof(int)));
+        should(!b.isConsecutive());
+        for (int i = 0; i < 4; ++i)
+            for (int j = 0; j < 3; ++j)
+                for (int k = 0; k < 2; ++k)
+                    shouldEqual((b[{i, j, k}]), (v0[{i, 0, k}]));
+
+        // the array is aligned with the last axes of the new shape
+        Array1D row(typename Array1D::difference_type{ 2 });
+        row[0] = 10;
+        row[1] = 20;
+        auto rows = row.broadcastTo(s);
+        shouldEqual(rows.shape(), s);
+        Array a(v0 + rows);
+        for (int i = 0; i < 4; ++i)
+            for (int j = 0; j < 3; ++j)
+                for (int k = 0; k < 2; ++k)
+                    shouldEqual((a[{i, j, k}]), (v0[{i, j, k}] + 10 * (k + 1)));
+        shouldEqual(rows.sum(), 12 * 30);
+        should(rows.memoryRange() == row.memoryRange());
+
+        try
+        {
+            column.broadcastTo(S{ 4,3,3 });
+            failTest("no exception thrown");
+        }
+        catch (std::exception & c)
+        {
+            std::string expected("\nPrecondition violation!\nArrayViewND::broadcastTo(): shape mismatch.");
+            std::string message(c.what());
+            should(0 == expected.compare(message.substr(0, expected.size())));
+        }
+    }
+
     void testTranspose()
     {
         {
@@ -763,6 +889,214 @@ struct ArrayNDTest
         shouldEqualSequence(rowMean, rowMean + 3, am1.begin());
     }
 
+    void testPairwiseSummation()
+    {
+        View v1(s, &data1[0]);
+
+        shouldEqual(v1.sum(PairwiseSummation), 276);
+        shouldEqual(sum(v1, PairwiseSummation), 276);
+        shouldEqual(v1.sum(NaiveSummation), 276);
+        shouldEqual(norm(v1, 1, PairwiseSummation), 276.0);
+        shouldEqual(norm(v1, 2, PairwiseSummation), norm(v1));
+        shouldEqual(norm(v1, -1, PairwiseSummation), 23.0);
+
+        // pairwise summation is much more accurate than sequential summation in float
+        ArrayND<N, float> f(S{ 100, 101, 102 }, 0.1f);
+        double exact = 0.1f * (double)f.size();
+        float naive    = f.sum(),
+              pairwise = f.sum(PairwiseSummation);
+        should(std::abs(pairwise - exact) < 1e-6 * exact);
+        should(std::abs(naive - exact) > 100.0 * std::abs(pairwise - exact));
+
+        // the result doesn't depend on the number of threads
+        for(int k=0; k<f.size(); ++k)
+            f.data()[k] = (float)((k * 7919) % 1000) / 7.0f;
+        for(auto view : { f.view(), f.transpose(), f.subarray(S{ 1, 2, 3 }, S{ 99, 97, 95 }) })
+        {
+            float serial = view.sum(PairwiseSummation);
+            should(view.sum(PairwiseSummation, ParallelOptions(2)) == serial);
+            should(view.sum(PairwiseSummation, ParallelOptions(3)) == serial);
+            should(view.sum(PairwiseSummation, ParallelOptions(8)) == serial);
+            shouldEqualTolerance(serial, view.template sum<double>(), 1e-6);
+            should(norm(view, 2, PairwiseSummation, ParallelOptions(4)) == norm(view, 2, PairwiseSummation));
+        }
+
+        // just above the size where the summation is split between threads
+        ArrayND<1, float> line(Shape<1>{ array_detail::pairwiseParallelSize + 37 });
+        for(int k=0; k<line.size(); ++k)
+            line[k] = (float)((k * 7919) % 1000) / 7.0f;
+        float lineSerial = line.sum(PairwiseSummation);
+        for(int threads : { 2, 3, 4, 8 })
+        {
+            should(line.sum(PairwiseSummation, ParallelOptions(threads)) == lineSerial);
+            should(line.subarray(Shape<1>{ 1 }, Shape<1>{ line.size() - 1 }).sum(PairwiseSummation, ParallelOptions(threads)) ==
+                   line.subarray(Shape<1>{ 1 }, Shape<1>{ line.size() - 1 }).sum(PairwiseSummation));
+        }
+        ArrayND<N, float> block(S{ 2, 182, 181 });
+        for(int k=0; k<block.size(); ++k)
+            block.data()[k] = (float)((k * 7919) % 1000) / 7.0f;
+        should(block.size() > array_detail::pairwiseParallelSize);
+        for(auto view : { block.view(), block.transpose(), block.subarray(S{ 0, 1, 0 }, S{ 2, 182, 180 }) })
+        {
+            float serial = view.sum(PairwiseSummation);
+            for(int threads : { 2, 3, 4, 8 })
+                should(view.sum(PairwiseSummation, ParallelOptions(threads)) == serial);
+        }
+
+        // sums along an axis
+        ArrayND<N, float> g(S{ 300, 20, 30 }, 0.1f);
+        for(int axis=0; axis<3; ++axis)
+        {
+            auto ps = g.sum(tags::axis = axis, PairwiseSummation);
+            auto pm = g.mean(tags::axis = axis, PairwiseSummation);
+            auto ns = g.sum(tags::axis = axis);
+            S expected = g.shape();
+            expected[axis] = 1;
+            shouldEqual(ps.shape(), expected);
+            shouldEqual(pm.shape(), expected);
+            double exactSum = 0.1f * (double)g.shape(axis);
+            S origin{ 0, 0, 0 };
+            shouldEqualTolerance(ps[origin], exactSum, 1e-6);
+            shouldEqualTolerance(pm[origin], 0.1f, 1e-6);
+            should(std::abs(ps[origin] - exactSum) <= std::abs(ns[origin] - exactSum));
+            shouldEqualTolerance(ps.template sum<double>(), 0.1f * (double)g.size(), 1e-6);
+        }
+
+        double data[] = { 1.0, 5.0,
+                          3.0, 2.0,
+                          4.0, 7.0 };
+        ArrayND<2, double> a({ 3,2 }, data);
+        double columnSum[] = { 8.0, 14.0 };
+        double rowMean[] = { 3.0, 2.5, 5.5 };
+        auto as0 = a.sum(tags::axis = 0, PairwiseSummation);
+        auto am1 = a.mean(tags::axis = 1, PairwiseSummation);
+        shouldEqualSequence(columnSum, columnSum + 2, as0.begin());
+        shouldEqualSequence(rowMean, rowMean + 3, am1.begin());
+    }
+
+    void testAxesReductions()
+    {
+        ArrayND<N, int> a(S{ 6, 5, 7 });
+        for(int k=0; k<a.size(); ++k)
+            a.data()[k] = (k * 37) % 11;
+
+        // compare all axis subsets with a brute-force computation
+        for(auto view : { a.view(), a.transpose(), a.subarray(S{ 1, 0, 2 }, S{ 5, 5, 7 }) })
+        {
+            for(int mask=1; mask<8; ++mask)
+            {
+                std::vector<ArrayIndex> selected;
+                for(int d=0; d<3; ++d)
+                    if(mask & (1 << d))
+                        selected.push_back(d);
+                Shape<runtime_size> axes(selected.data(), selected.data() + selected.size());
+
+                S rshape = view.shape(), rstrides{ 0, 0, 0 };
+                ArrayIndex count = 1;
+                for(int d=2; d>=0; --d)
+                {
+                    if(mask & (1 << d))
+                    {
+                        rstrides[d] = count;
+                        count *= rshape[d];
+                        rshape[d] = 1;
+                    }
+                }
+                ArrayND<N, int> sums(rshape), mins(rshape, 100), maxs(rshape, -1);
+                ArrayND<N, ArrayIndex> argmins(rshape), argmaxs(rshape);
+                ArrayND<N, double> sums2(rshape);
+                for(int i=0; i<view.shape(0); ++i)
+                    for(int j=0; j<view.shape(1); ++j)
+                        for(int k=0; k<view.shape(2); ++k)
+                        {
+                            S c{ i, j, k }, r = c;
+                            for(int d=0; d<3; ++d)
+                                if(mask & (1 << d))
+                                    r[d] = 0;
+                            int v = view[c];
+                            ArrayIndex index = dot(c, rstrides);
+                            sums[r] += v;
+                            sums2[r] += (double)v*v;
+                            if(v < mins[r])
+                            {
+                                mins[r] = v;
+                                argmins[r] = index;
+                            }
+                            if(maxs[r] < v)
+                            {
+                                maxs[r] = v;
+                                argmaxs[r] = index;
+                            }
+                        }
+
+                auto s = view.sum(tags::axes = axes);
+                shouldEqual(s.shape(), rshape);
+                should(s == sums);
+                should(view.minimum(tags::axes = axes) == mins);
+                should(view.maximum(tags::axes = axes) == maxs);
+                should(view.argMin(tags::axes = axes) == argmins);
+                should(view.argMax(tags::axes = axes) == argmaxs);
+
+                auto m = view.mean(tags::axes = axes);
+                auto var = view.variance(tags::axes = axes);
+                for(int k=0; k<sums.size(); ++k)
+                {
+                    double mean = (double)sums.data()[k] / count;
+                    shouldEqualTolerance(m.data()[k], mean, 1e-12);
+                    shouldEqualTolerance(var.data()[k], sums2.data()[k] / count - mean*mean, 1e-12);
+                }
+            }
+        }
+
+        // squeezing the reduced axes
+        auto s1 = a.sum(tags::axes = { 0, 2 }, tags::squeeze);
+        auto s2 = a.sum(tags::axes(0, 2), tags::keepdims);
+        shouldEqual(s1.shape(), (Shape<runtime_size>{ 5 }));
+        shouldEqual(s2.shape(), (S{ 1, 5, 1 }));
+        shouldEqualSequence(s1.data(), s1.data() + 5, s2.data());
+        auto all = a.sum(tags::axes(0, 1, 2), tags::squeeze);
+        shouldEqual(all.shape(), (Shape<runtime_size>{ 1 }));
+        shouldEqual(all.data()[0], a.sum());
+
+        // maximum intensity projection along z
+        auto mip = a.maximum(tags::axis = 0, tags::squeeze);
+        shouldEqual(mip.shape(), (Shape<runtime_size>{ 5, 7 }));
+        shouldEqual(mip.ndim(), 2);
+
+        shouldEqual(a.sum(tags::axis = 1).shape(), (S{ 6, 1, 7 }));
+        shouldEqual(a.argMin(tags::axis = 1, tags::squeeze).ndim(), 2);
+
+        // mean of integers is computed in floating point
+        int data[] = { 1, 2, 4, 7 };
+        ArrayND<2, int> b({ 2, 2 }, data);
+        double rowMean[] = { 1.5, 5.5 };
+        auto bm = b.mean(tags::axis = 1);
+        shouldEqualSequence(rowMean, rowMean + 2, bm.data());
+
+        try
+        {
+            a.sum(tags::axes(0, 0));
+            failTest("no exception thrown");
+        }
+        catch(ContractViolation & c)
+        {
+            std::string expected("\nPrecondition violation!\nArrayViewND::sum(axes): axes must be unique.");
+            std::string message(c.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+        try
+        {
+            a.minimum(tags::axis = 3);
+            failTest("no exception thrown");
+        }
+        catch(ContractViolation & c)
+        {
+            std::string expected("\nPrecondition violation!\nArrayViewND::minimum(axes): axis out of range.");
+            std::string message(c.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+    }
+
     void testVectorValuetype()
     {
         Vector data[24];
@@ -1054,7 +1388,11 @@ struct ArrayNDTestSuite
         add(testCase(&ArrayNDTest<N>::testAssignment));
         add(testCase(&ArrayNDTest<N>::testOverlappingMemory));
         add(testCase(&ArrayNDTest<N>::testFunctions));
+        add(testCase(&ArrayNDTest<N>::testPairwiseSummation));
+        add(testCase(&ArrayNDTest<N>::testAxesReductions));
         add(testCase(&ArrayNDTest<N>::testSubarray));
+        add(testCase(&ArrayNDTest<N>::testStridedViews));
+        add(testCase(&ArrayNDTest<N>::testBroadcastTo));
         add(testCase(&ArrayNDTest<N>::testVectorValuetype));
         add(testCase(&ArrayNDTest<N>::testArray));
         add(testCase(&ArrayNDTest<N>::testIterators));
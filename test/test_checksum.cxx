@@ -0,0 +1,177 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014-2017 by Ullrich Koethe                  */
+/*                                                                      */
+/*    This file is part of the VIGRA2 computer vision library.          */
+/*    The VIGRA2 Website is                                             */
+/*        http://ukoethe.github.io/vigra2                               */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <vigra2/unittest.hxx>
+#include <vigra2/checksum.hxx>
+#include <vigra2/array_nd.hxx>
+
+using namespace vigra;
+
+struct ChecksumTest
+{
+    std::vector<char> data;
+
+    ChecksumTest()
+    : data(100000)
+    {
+        std::mt19937 random(42);
+        for(auto & c : data)
+            c = (char)random();
+    }
+
+    void testCrc32c()
+    {
+        // test vectors from RFC 3720 and the CRC catalogue
+        std::string s("123456789");
+        shouldEqual(crc32c(s.c_str(), s.size()), 0xE3069283u);
+        shouldEqual(checksum(s.c_str(), s.size()), 0xCBF43926u);
+        shouldEqual(crc32c(s.c_str(), 0), 0u);
+
+        std::vector<char> zeros(32, 0), ones(32, (char)0xFF), ascending(32);
+        for(int k = 0; k < 32; ++k)
+            ascending[k] = (char)k;
+        shouldEqual(crc32c(zeros.data(), 32), 0x8A9136AAu);
+        shouldEqual(crc32c(ones.data(), 32), 0x62A8AB43u);
+        shouldEqual(crc32c(ascending.data(), 32), 0x46DD794Eu);
+
+        // compare hardware (if available) and portable implementations for
+        // all alignments and sizes around the block boundaries
+        std::size_t sizes[] = { 0, 1, 7, 15, 16, 17, 255, 767, 768, 769, 3*256 + 100,
+                                24575, 24576, 24577, 3*8192 + 3*256 + 13, 99990 };
+        for(auto size : sizes)
+        {
+            for(int offset = 0; offset < 8; ++offset)
+            {
+                uint32_t portable = ~detail::crcSlicing16<detail::crc32cPolynomial>(
+                                         ~0u, data.data() + offset, size);
+                shouldEqual(crc32c(data.data() + offset, size), portable);
+            }
+        }
+    }
+
+    void testConcatenateAndCombine()
+    {
+        std::size_t size = data.size();
+        uint32_t crc  = crc32c(data.data(), size),
+                 crc2 = checksum(data.data(), size);
+        std::size_t splits[] = { 0, 1, 13, 4096, 50000, size - 1, size };
+        for(auto split : splits)
+        {
+            uint32_t a = crc32c(data.data(), split),
+                     b = crc32c(data.data() + split, size - split);
+            shouldEqual(concatenateCrc32c(a, data.data() + split, size - split), crc);
+            shouldEqual(combineCrc32c(a, b, size - split), crc);
+
+            a = checksum(data.data(), split);
+            b = checksum(data.data() + split, size - split);
+            shouldEqual(concatenateChecksum(a, data.data() + split, size - split), crc2);
+            shouldEqual(combineChecksums(a, b, size - split), crc2);
+        }
+    }
+
+    void testArrayChecksum()
+    {
+        typedef Shape<3> S;
+        ArrayND<3, std::uint16_t> a(S{ 20, 300, 200 });
+        std::mt19937 random(1);
+        for(auto & v : a)
+            v = (std::uint16_t)random();
+        std::size_t bytes = a.size()*sizeof(std::uint16_t);
+        uint32_t crc  = crc32c((char const *)a.data(), bytes),
+                 crc2 = checksum((char const *)a.data(), bytes);
+
+        for(int threads = 0; threads <= 4; ++threads)
+        {
+            ParallelOptions options(threads);
+            shouldEqual(crc32c(a, options), crc);
+            shouldEqual(checksum(a, options), crc2);
+
+            // non-consecutive arrays are hashed in C-order
+            ArrayND<3, std::uint16_t> f(a.shape(), F_ORDER);
+            f = a;
+            shouldEqual(crc32c(f, options), crc);
+            shouldEqual(checksum(f, options), crc2);
+
+            auto v = a.subarray(S{ 2, 10, 5 }, S{ 18, 290, 199 });
+            ArrayND<3, std::uint16_t> c(v);
+            should(c.isConsecutive());
+            shouldEqual(crc32c(v, options), crc32c((char const *)c.data(), c.size()*2));
+
+            auto t = a.transpose(S{ 1, 2, 0 });
+            ArrayND<3, std::uint16_t> ct(t.shape());
+            ct = t;
+            shouldEqual(crc32c(t, options), crc32c(ct, options));
+        }
+
+        ArrayND<2, TinyArray<float, 3>> rgb(Shape<2>{ 7, 9 });
+        int k = 0;
+        for(auto & v : rgb)
+            v = TinyArray<float, 3>(k, 2*k, 3*k), ++k;
+        shouldEqual(crc32c(rgb), crc32c((char const *)rgb.data(), rgb.size()*sizeof(rgb[0])));
+        shouldEqual(crc32c(ArrayND<2, float>()), 0u);
+    }
+};
+
+struct ChecksumTestSuite
+: public vigra::test_suite
+{
+    ChecksumTestSuite()
+    : vigra::test_suite("ChecksumTestSuite")
+    {
+        add( testCase(&ChecksumTest::testCrc32c));
+        add( testCase(&ChecksumTest::testConcatenateAndCombine));
+        add( testCase(&ChecksumTest::testArrayChecksum));
+    }
+};
+
+int main(int argc, char ** argv)
+{
+    ChecksumTestSuite test;
+
+    int failed = test.run(vigra::testsToBeExecuted(argc, argv));
+
+    std::cout << test.report() << std::endl;
+
+    return (failed != 0);
+}
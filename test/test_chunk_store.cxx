@@ -0,0 +1,367 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014-2017 by Ullrich Koethe                  */
+/*                                                                      */
+/*    This file is part of the VIGRA2 computer vision library.          */
+/*    The VIGRA2 Website is                                             */
+/*        http://ukoethe.github.io/vigra2                               */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <vigra2/unittest.hxx>
+#include <vigra2/chunk_store.hxx>
+#include <vigra2/array_nd.hxx>
+#include <vigra2/array_math.hxx>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace vigra;
+
+struct ChunkStoreTest
+{
+    typedef Shape<3> S;
+
+    std::string path;
+
+    ChunkStoreTest()
+    : path("test_chunk_store.tmp")
+    {}
+
+    ~ChunkStoreTest()
+    {
+        removeStore();
+    }
+
+    void removeStore()
+    {
+        if(DIR * dir = ::opendir(path.c_str()))
+        {
+            while(dirent * entry = ::readdir(dir))
+                ::unlink((path + "/" + entry->d_name).c_str());
+            ::closedir(dir);
+        }
+        ::rmdir(path.c_str());
+    }
+
+    int fileCount()
+    {
+        int res = 0;
+        if(DIR * dir = ::opendir(path.c_str()))
+        {
+            while(dirent * entry = ::readdir(dir))
+                if(entry->d_name[0] != '.')
+                    ++res;
+            ::closedir(dir);
+        }
+        return res;
+    }
+
+        // the values encode the coordinates, so that misplaced chunks are detected
+    template <class T>
+    ArrayND<3, T> makeArray(S const & shape)
+    {
+        ArrayND<3, T> a(shape);
+        for(ArrayIndex z = 0; z < shape[0]; ++z)
+            for(ArrayIndex y = 0; y < shape[1]; ++y)
+                for(ArrayIndex x = 0; x < shape[2]; ++x)
+                    a(z, y, x) = T(10000*z + 100*y + x);
+        return a;
+    }
+
+    void testWriteRead()
+    {
+        auto a = makeArray<float>(S{ 30, 40, 50 });
+        a.setAxistags(makeAxistags("zyx"));
+        {
+            ChunkStore<3, float> store(path, a.shape(), S{ 8, 16, 32 }, ChunkStore<3, float>::defaultCodecs(),
+                                       a.axistags());
+            should((store.chunkGridShape() == S{ 4, 3, 2 }));
+            should(!store.hasChunk(S{ 0, 0, 0 }));
+            store.write(a);
+            should(store.hasChunk(S{ 3, 2, 1 }));
+            should((store.chunkBox(S{ 3, 2, 1 }) == Box<3>(S{ 24, 32, 32 }, S{ 30, 40, 50 })));
+        }
+        shouldEqual(fileCount(), 4*3*2 + 1);
+
+        ChunkStore<3, float> store(path);
+        should(store.shape() == a.shape());
+        should((store.chunkShape() == S{ 8, 16, 32 }));
+        should(store.axistags() == a.axistags());
+        shouldEqual(store.codecs().size(), 2u);
+        shouldEqual(store.codecs()[1]->name(), "lz");
+
+        ArrayND<3, float> r = store.read();
+        should(r == a);
+        should(r.axistags() == a.axistags());
+
+        // partial reads across chunk borders, in parallel and sequentially
+        Box<3> box(S{ 5, 10, 20 }, S{ 25, 37, 45 });
+        should((store.read(box) == a.subarray(box.lower(), box.upper())));
+        should((store.read(box, ParallelOptions(0)) == a.subarray(box.lower(), box.upper())));
+        ArrayND<3, float> dest(S{ 20, 27, 25 });
+        store.read(box, dest.transpose(S{ 0, 1, 2 }), ParallelOptions(3));
+        should((dest == a.subarray(box.lower(), box.upper())));
+        Box<3> single(S{ 9, 17, 33 }, S{ 10, 18, 34 });
+        should((store.read(single) == a.subarray(single.lower(), single.upper())));
+
+        // partial writes update the intersected chunks only
+        ArrayND<3, float> patch(S{ 10, 10, 10 }, -1.0f);
+        store.write(patch, S{ 6, 14, 30 });
+        a.subarray(S{ 6, 14, 30 }, S{ 16, 24, 40 }) = -1.0f;
+        should(store.read() == a);
+        store.write(a.transpose().transpose(), ParallelOptions(0));
+        should(store.read() == a);
+    }
+
+    void testMissingChunks()
+    {
+        ChunkStore<2, std::int32_t> store(path, Shape<2>{ 100, 100 }, Shape<2>{ 32, 32 },
+                                          makeChunkCodecs({ "delta", "shuffle", "lz" }));
+        ArrayND<2, std::int32_t> ones(Shape<2>{ 10, 10 }, 1);
+        store.write(ones, Shape<2>{ 40, 40 });
+        shouldEqual(fileCount(), 2);
+
+        ArrayND<2, std::int32_t> expected(Shape<2>{ 100, 100 });
+        expected.subarray(Shape<2>{ 40, 40 }, Shape<2>{ 50, 50 }) = 1;
+        should(store.read() == expected);
+
+        // re-creating the store removes existing chunks
+        ChunkStore<2, std::int32_t> fresh(path, Shape<2>{ 100, 100 }, Shape<2>{ 32, 32 });
+        shouldEqual(fileCount(), 1);
+        should((fresh.read() == ArrayND<2, std::int32_t>(Shape<2>{ 100, 100 })));
+    }
+
+    void testElementTypes()
+    {
+        ArrayND<2, TinyArray<std::uint8_t, 3>> rgb(Shape<2>{ 37, 53 });
+        for(int y = 0; y < 37; ++y)
+            for(int x = 0; x < 53; ++x)
+                rgb(y, x) = TinyArray<std::uint8_t, 3>{ std::uint8_t(x), std::uint8_t(y), std::uint8_t(x*y) };
+        {
+            ChunkStore<2, TinyArray<std::uint8_t, 3>> store(path, rgb.shape(), Shape<2>{ 16, 16 });
+            store.write(rgb);
+        }
+        should((ChunkStore<2, TinyArray<std::uint8_t, 3>>(path).read() == rgb));
+
+        ChunkStore<runtime_size, double> store(path, Shape<>{ 5, 6, 7, 8 }, Shape<>{ 2, 3, 4, 5 },
+                                               ChunkCodecPipeline());
+        ArrayND<runtime_size, double> a(Shape<>{ 5, 6, 7, 8 });
+        int k = 0;
+        for(auto & v : a)
+            v = k++ * 0.5;
+        store.write(a);
+        ChunkStore<runtime_size, double> in(path);
+        shouldEqual(in.ndim(), 4);
+        shouldEqual(in.codecs().size(), 0u);
+        should(in.read() == a);
+    }
+
+    template <class T>
+    void checkCodecs(std::vector<std::string> const & names)
+    {
+        // edge chunks are smaller than the chunk shape
+        auto a = makeArray<T>(S{ 9, 11, 13 });
+        a.subarray(S{ 0, 0, 0 }, S{ 4, 11, 13 }) = T(7);
+        {
+            ChunkStore<3, T> store(path, a.shape(), S{ 4, 5, 6 }, makeChunkCodecs(names));
+            store.write(a);
+        }
+        ChunkStore<3, T> store(path);
+        shouldEqual(store.codecs().size(), names.size());
+        should(store.read() == a);
+        should((store.read(store.chunkBox(S{ 2, 2, 2 })) == a.subarray(S{ 8, 10, 12 }, S{ 9, 11, 13 })));
+        removeStore();
+    }
+
+    void testCodecs()
+    {
+        std::vector<std::vector<std::string>> pipelines = {
+            {}, { "shuffle" }, { "delta" }, { "lz" }, { "delta", "lz" }, { "shuffle", "lz" },
+            { "delta", "shuffle", "lz" } };
+        for(auto const & names : pipelines)
+        {
+            checkCodecs<std::uint8_t>(names);
+            checkCodecs<std::int16_t>(names);
+            checkCodecs<std::int32_t>(names);
+            checkCodecs<float>(names);
+            checkCodecs<double>(names);
+        }
+
+        // constant chunks compress well
+        ChunkStore<2, std::int32_t> store(path, Shape<2>{ 64, 64 }, Shape<2>{ 64, 64 });
+        store.write(ArrayND<2, std::int32_t>(Shape<2>{ 64, 64 }, 42));
+        std::ifstream chunk((path + "/0.0").c_str(), std::ios::binary | std::ios::ate);
+        should((int)chunk.tellg() < 64*64*4 / 10);
+    }
+
+    template <class F>
+    void checkException(F f, std::string const & expected)
+    {
+        try
+        {
+            f();
+            failTest("no exception thrown");
+        }
+        catch(std::exception & e)
+        {
+            std::string message(e.what());
+            shouldMsg(message.find(expected) != std::string::npos, message.c_str());
+        }
+    }
+
+    void testErrors()
+    {
+        std::string path = this->path;
+        ChunkStore<3, float> store(path, S{ 10, 10, 10 }, S{ 4, 4, 4 });
+        store.write(makeArray<float>(S{ 10, 10, 10 }));
+
+        checkException([path]() { ChunkStore<3, double> s(path); },
+                       "ChunkStore(): element type mismatch.");
+        checkException([path]() { ChunkStore<2, float> s(path); },
+                       "ChunkStore(): dimension mismatch.");
+        checkException([&store]() { store.write(ArrayND<3, float>(S{ 5, 5, 5 }), S{ 6, 0, 0 }); },
+                       "ChunkStore::write(): region outside of the array.");
+        checkException([&store]() { store.read(Box<3>(S{ 0, 0, 0 }, S{ 11, 1, 1 })); },
+                       "ChunkStore::read(): region outside of the array.");
+        checkException([path]() { ChunkStore<3, float> s(path + "_missing"); },
+                       "ChunkStore(): unable to open 'test_chunk_store.tmp_missing/store.json'.");
+
+        // corrupt chunk
+        {
+            std::ofstream f((path + "/1.1.1").c_str(), std::ios::binary | std::ios::trunc);
+            f << "garbage";
+        }
+        checkException([&store]() { store.read(); },
+                       "ChunkStore::read(): corrupt chunk 'test_chunk_store.tmp/1.1.1'.");
+        should((store.read(Box<3>(S{ 0, 0, 0 }, S{ 4, 4, 4 })) ==
+                makeArray<float>(S{ 10, 10, 10 }).subarray(S{ 0, 0, 0 }, S{ 4, 4, 4 })));
+
+        // unknown codec
+        {
+            std::ofstream f((path + "/store.json").c_str(), std::ios::trunc);
+            f << "{ \"format\": \"vigra2-chunk-store\", \"version\": 1, \"dtype\": \"<f4\", \"channels\": 1,\n"
+                 "  \"shape\": [10, 10, 10], \"chunks\": [4, 4, 4], \"axistags\": [0, 0, 0], \"codecs\": [\"zstd\"] }";
+        }
+        if(detail::isLittleEndian())
+            checkException([path]() { ChunkStore<3, float> s(path); },
+                           "makeChunkCodec(): unknown codec 'zstd'.");
+        {
+            std::ofstream f((path + "/store.json").c_str(), std::ios::trunc);
+            f << "{ \"format\": \"vigra2-chunk-store\", \"version\": 1, ";
+        }
+        checkException([path]() { ChunkStore<3, float> s(path); },
+                       "ChunkStore(): corrupt metadata file.");
+        {
+            std::ofstream f((path + "/store.json").c_str(), std::ios::trunc);
+            f << "{ \"format\": \"vigra2-chunk-store\", \"version\": 1, \"dtype\": \"<f4\", \"channels\": 1,\n"
+                 "  \"shape\": [10, 1x0, 10], \"chunks\": [4, 4, 4], \"axistags\": [0, 0, 0], \"codecs\": [] }";
+        }
+        if(detail::isLittleEndian())
+            checkException([path]() { ChunkStore<3, float> s(path); },
+                           "ChunkStore(): corrupt metadata file (invalid integer '1x0').");
+        {
+            std::ofstream f((path + "/store.json").c_str(), std::ios::trunc);
+            f << "{ \"format\": \"vigra2-chunk-store\", \"version\": 99999999999999999999 }";
+        }
+        checkException([path]() { ChunkStore<3, float> s(path); },
+                       "ChunkStore(): corrupt metadata file (invalid integer '99999999999999999999').");
+    }
+
+    void testCreateInExistingDirectory()
+    {
+        using chunk_store_detail::isChunkFileName;
+        should(isChunkFileName("0"));
+        should(isChunkFileName("12.0.3"));
+        should(isChunkFileName("12.0.3.tmp"));
+        should(!isChunkFileName(".tmp"));
+        should(!isChunkFileName("store.json"));
+        should(!isChunkFileName("store.json.tmp"));
+        should(!isChunkFileName("1.2.tmp.bak"));
+        should(!isChunkFileName("1a.2"));
+
+        // a directory without store metadata must be empty, and its files are never deleted
+        ::mkdir(path.c_str(), 0755);
+        {
+            std::ofstream f((path + "/2019.05").c_str());
+            f << "precious";
+        }
+        checkException([this]() { ChunkStore<2, float> s(path, Shape<2>{ 10, 10 }, Shape<2>{ 4, 4 }); },
+                       "ChunkStore(): directory 'test_chunk_store.tmp' is neither empty nor a chunk store.");
+        shouldEqual(fileCount(), 1);
+        removeStore();
+
+        // an existing store is cleaned up, including stale temporary chunk files
+        {
+            ChunkStore<2, float> store(path, Shape<2>{ 10, 10 }, Shape<2>{ 4, 4 });
+            store.write(ArrayND<2, float>(Shape<2>{ 10, 10 }, 1.0f));
+            std::ofstream f((path + "/0.0.tmp").c_str());
+            f << "partial";
+        }
+        shouldEqual(fileCount(), 11);
+        ChunkStore<2, float> fresh(path, Shape<2>{ 10, 10 }, Shape<2>{ 4, 4 });
+        shouldEqual(fileCount(), 1);
+    }
+};
+
+struct ChunkStoreTestSuite
+: public vigra::test_suite
+{
+    ChunkStoreTestSuite()
+    : vigra::test_suite("ChunkStoreTestSuite")
+    {
+        add( testCase(&ChunkStoreTest::testWriteRead));
+        add( testCase(&ChunkStoreTest::testMissingChunks));
+        add( testCase(&ChunkStoreTest::testElementTypes));
+        add( testCase(&ChunkStoreTest::testCodecs));
+        add( testCase(&ChunkStoreTest::testErrors));
+        add( testCase(&ChunkStoreTest::testCreateInExistingDirectory));
+    }
+};
+
+int main(int argc, char ** argv)
+{
+    ChunkStoreTestSuite test;
+
+    int failed = test.run(vigra::testsToBeExecuted(argc, argv));
+
+    std::cout << test.report() << std::endl;
+
+    return (failed != 0);
+}
@@ -0,0 +1,251 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014-2017 by Ullrich Koethe                  */
+/*                                                                      */
+/*    This file is part of the VIGRA2 computer vision library.          */
+/*    The VIGRA2 Website is                                             */
+/*        http://ukoethe.github.io/vigra2                               */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <vigra2/unittest.hxx>
+#include <vigra2/codecs.hxx>
+
+using namespace vigra;
+
+struct CodecsTest
+{
+    std::vector<std::string> testData()
+    {
+        std::vector<std::string> res;
+        res.push_back("");
+        res.push_back("a");
+        res.push_back("abcabcabcabcabcabcabcabcabcabcabcabcabc");
+        res.push_back(std::string(100000, 'x'));
+
+        std::mt19937 random(42);
+        std::string noise(70000, '\0');
+        for(auto & c : noise)
+            c = (char)random();
+        res.push_back(noise);
+
+        // smooth 16-bit data
+        std::vector<std::uint16_t> smooth(50001);
+        for(std::size_t k = 0; k < smooth.size(); ++k)
+            smooth[k] = (std::uint16_t)(1000.0 + 500.0*std::sin(k / 300.0));
+        res.push_back(std::string((char const *)smooth.data(), smooth.size()*2));
+
+        // floats with long repetitions at large distance
+        std::vector<float> f(40000);
+        for(std::size_t k = 0; k < f.size(); ++k)
+            f[k] = float(k % 1000) * 0.25f;
+        res.push_back(std::string((char const *)f.data(), f.size()*4));
+        return res;
+    }
+
+    void checkRoundTrip(ChunkCodecPipeline const & codecs, int itemsize, int channels)
+    {
+        for(auto const & data : testData())
+        {
+            std::string encoded, decoded;
+            encodeChunk(codecs, data.data(), data.size(), encoded, itemsize, channels);
+            decodeChunk(codecs, encoded.data(), encoded.size(), decoded, itemsize, channels);
+            shouldEqual(decoded.size(), data.size());
+            should(decoded == data);
+        }
+    }
+
+    void testRoundTrip()
+    {
+        std::vector<std::string> names = { "shuffle", "delta", "lz" };
+        for(int itemsize : { 1, 2, 3, 4, 8 })
+        {
+            for(int channels : { 1, 3 })
+            {
+                for(auto const & name : names)
+                    checkRoundTrip(makeChunkCodecs({ name }), itemsize, channels);
+                checkRoundTrip(makeChunkCodecs({ "shuffle", "lz" }), itemsize, channels);
+                checkRoundTrip(makeChunkCodecs({ "delta", "shuffle", "lz" }), itemsize, channels);
+            }
+        }
+        checkRoundTrip(ChunkCodecPipeline(), 4, 1);
+    }
+
+    void testTransforms()
+    {
+        std::string data("\x01\x02\x03\x04\x05\x06\x07\x08", 8), res;
+        ShuffleCodec().encode(data.data(), 8, res, 4, 1);
+        shouldEqual(res, std::string("\x01\x05\x02\x06\x03\x07\x04\x08", 8));
+        ShuffleCodec().encode(data.data(), 7, res, 2, 1);
+        shouldEqual(res, std::string("\x01\x03\x05\x02\x04\x06\x07", 7));
+
+        std::uint16_t values[] = { 10, 12, 20, 11, 9, 30 }, deltas[6];
+        DeltaCodec().encode((char const *)values, 12, res, 2, 1);
+        std::memcpy(deltas, res.data(), 12);
+        shouldEqual(deltas[0], 10);
+        shouldEqual(deltas[1], 2);
+        shouldEqual(deltas[3], (std::uint16_t)-9);
+        DeltaCodec().encode((char const *)values, 12, res, 2, 3);
+        std::memcpy(deltas, res.data(), 12);
+        shouldEqual(deltas[2], 20);
+        shouldEqual(deltas[3], 1);
+        shouldEqual(deltas[5], 10);
+    }
+
+    void testCompression()
+    {
+        std::string data(100000, 'x'), encoded;
+        LZCodec().encode(data.data(), data.size(), encoded, 1, 1);
+        should(encoded.size() < 1000);
+
+        // shuffle makes smooth data compressible
+        auto test = testData();
+        std::string const & smooth = test[5];
+        std::string plain, shuffled;
+        encodeChunk(makeChunkCodecs({ "lz" }), smooth.data(), smooth.size(), plain, 2, 1);
+        encodeChunk(makeChunkCodecs({ "delta", "shuffle", "lz" }), smooth.data(), smooth.size(), shuffled, 2, 1);
+        should(shuffled.size() < smooth.size() / 4);
+        should(shuffled.size() < plain.size());
+
+        // incompressible data are stored with 9 bytes overhead
+        std::string const & noise = test[4];
+        LZCodec().encode(noise.data(), noise.size(), encoded, 1, 1);
+        shouldEqual(encoded.size(), noise.size() + 9);
+    }
+
+    void testErrors()
+    {
+        std::string data(10000, 'x'), encoded, decoded;
+        for(std::size_t k = 0; k < data.size(); ++k)
+            data[k] = (char)(k % 97);
+        LZCodec codec;
+        codec.encode(data.data(), data.size(), encoded, 1, 1);
+
+        // truncated and corrupted data must be detected without crashing
+        for(std::size_t size : { std::size_t(0), std::size_t(5), std::size_t(12), encoded.size() - 1 })
+        {
+            try
+            {
+                codec.decode(encoded.data(), size, decoded, 1, 1);
+                failTest("no exception thrown");
+            }
+            catch(std::exception & e)
+            {
+                std::string message(e.what());
+                should(message.find("LZCodec::decode(): corrupt data.") != std::string::npos);
+            }
+        }
+        std::mt19937 random(1);
+        for(int k = 0; k < 200; ++k)
+        {
+            std::string corrupt(encoded);
+            corrupt[9 + random() % (corrupt.size() - 9)] ^= (char)(1 + random() % 255);
+            try
+            {
+                codec.decode(corrupt.data(), corrupt.size(), decoded, 1, 1);
+            }
+            catch(std::exception &) {}
+        }
+
+        try
+        {
+            makeChunkCodec("zstd");
+            failTest("no exception thrown");
+        }
+        catch(std::exception & e)
+        {
+            std::string message(e.what());
+            should(message.find("makeChunkCodec(): unknown codec 'zstd'.") != std::string::npos);
+        }
+    }
+
+    struct InvertCodec
+    : public ChunkCodec
+    {
+        std::string name() const
+        {
+            return "invert";
+        }
+
+        void encode(char const * data, std::size_t size, std::string & result, int, int) const
+        {
+            result.resize(size);
+            for(std::size_t k = 0; k < size; ++k)
+                result[k] = ~data[k];
+        }
+
+        void decode(char const * data, std::size_t size, std::string & result, int i, int c) const
+        {
+            encode(data, size, result, i, c);
+        }
+    };
+
+    void testRegistry()
+    {
+        registerChunkCodec("invert", []() { return std::make_shared<InvertCodec>(); });
+        auto codecs = makeChunkCodecs({ "invert", "lz" });
+        shouldEqual(codecs[0]->name(), "invert");
+        shouldEqual(codecs[1]->name(), "lz");
+        checkRoundTrip(codecs, 4, 1);
+    }
+};
+
+struct CodecsTestSuite
+: public vigra::test_suite
+{
+    CodecsTestSuite()
+    : vigra::test_suite("CodecsTestSuite")
+    {
+        add( testCase(&CodecsTest::testRoundTrip));
+        add( testCase(&CodecsTest::testTransforms));
+        add( testCase(&CodecsTest::testCompression));
+        add( testCase(&CodecsTest::testErrors));
+        add( testCase(&CodecsTest::testRegistry));
+    }
+};
+
+int main(int argc, char ** argv)
+{
+    CodecsTestSuite test;
+
+    int failed = test.run(vigra::testsToBeExecuted(argc, argv));
+
+    std::cout << test.report() << std::endl;
+
+    return (failed != 0);
+}
@@ -0,0 +1,239 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014-2017 by Ullrich Koethe                  */
+/*                                                                      */
+/*    This file is part of the VIGRA2 computer vision library.          */
+/*    The VIGRA2 Website is                                             */
+/*        http://ukoethe.github.io/vigra2                               */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+#include <vigra2/unittest.hxx>
+#include <vigra2/conversion.hxx>
+#include <vigra2/array_nd.hxx>
+#include <vigra2/array_math.hxx>
+
+using namespace vigra;
+using namespace vigra::array_math;
+
+struct ConversionTest
+{
+    typedef Shape<3> S;
+
+    std::vector<float> values;
+
+    ConversionTest()
+    {
+        // include ties, negative values, values beyond the range of all targets,
+        // and enough elements to exercise both SIMD loops and scalar tails
+        for(int k=0; k<101; ++k)
+            values.push_back(-700.0f + 13.25f*k);
+        float special[] = { -0.5f, 0.5f, 1.5f, 2.5f, 254.5f, 255.5f, 65535.4f, 65536.0f,
+                            -32768.6f, 32767.6f, 1e10f, -1e10f };
+        values.insert(values.end(), special, special + 12);
+    }
+
+    void testConvertValue()
+    {
+        typedef std::uint8_t UI8;
+
+        shouldEqual((ConvertValue<UI8, ConvertSaturate>::exec(300.7f)), 255);
+        shouldEqual((ConvertValue<UI8, ConvertSaturate>::exec(-3.0)), 0);
+        shouldEqual((ConvertValue<UI8, ConvertSaturate>::exec(254.6f)), 255);
+        shouldEqual((ConvertValue<UI8, ConvertSaturate>::exec(std::nan(""))), 0);
+        shouldEqual((ConvertValue<UI8, ConvertSaturate>::exec(300)), 255);
+        shouldEqual((ConvertValue<UI8, ConvertSaturate>::exec(-5)), 0);
+        shouldEqual((ConvertValue<std::int16_t, ConvertSaturate>::exec(-40000.0f)), -32768);
+        shouldEqual((ConvertValue<std::int16_t, ConvertSaturate>::exec(4000000000u)), 32767);
+        shouldEqual((ConvertValue<int, ConvertSaturate>::exec(1e20f)), std::numeric_limits<int>::max());
+        shouldEqual((ConvertValue<unsigned int, ConvertSaturate>::exec(-1)), 0u);
+        shouldEqual((ConvertValue<float, ConvertSaturate>::exec(1e300)), std::numeric_limits<float>::max());
+
+        // round to nearest with ties to even
+        shouldEqual((ConvertValue<int, ConvertRound>::exec(2.5f)), 2);
+        shouldEqual((ConvertValue<int, ConvertRound>::exec(3.5f)), 4);
+        shouldEqual((ConvertValue<int, ConvertRound>::exec(-2.7)), -3);
+        shouldEqual((ConvertValue<int, ConvertSaturate>::exec(2.5f)), 2);
+
+        shouldEqual((ConvertValue<int, ConvertTruncate>::exec(2.7f)), 2);
+        shouldEqual((ConvertValue<int, ConvertTruncate>::exec(-2.7)), -2);
+        shouldEqual((ConvertValue<float, ConvertTruncate>::exec(200)), 200.0f);
+
+        shouldEqual((ConvertValue<bool, ConvertSaturate>::exec(0.3f)), true);
+        shouldEqual((ConvertValue<bool, ConvertSaturate>::exec(0)), false);
+    }
+
+    template <class T>
+    void checkBlock(ConversionMode mode, float lower, float upper)
+    {
+        std::vector<float> src;
+        for(float v: values)
+            if(mode == ConvertSaturate || (lower <= v && v <= upper))
+                src.push_back(v);
+
+        // all lengths, so that every tail length is covered
+        for(std::size_t size = 0; size <= src.size(); size += 7)
+        {
+            std::vector<T> res(size);
+            convertBlock(res.data(), src.data(), size, mode);
+            for(std::size_t k=0; k<size; ++k)
+            {
+                T expected = mode == ConvertTruncate
+                                ? ConvertValue<T, ConvertTruncate>::exec(src[k])
+                                : mode == ConvertRound
+                                      ? ConvertValue<T, ConvertRound>::exec(src[k])
+                                      : ConvertValue<T, ConvertSaturate>::exec(src[k]);
+                shouldEqual(res[k], expected);
+            }
+
+            // and back
+            std::vector<float> back(size);
+            convertBlock(back.data(), res.data(), size);
+            for(std::size_t k=0; k<size; ++k)
+                shouldEqual(back[k], (float)res[k]);
+        }
+    }
+
+    void testConvertBlock()
+    {
+        ConversionMode modes[] = { ConvertTruncate, ConvertRound, ConvertSaturate };
+        for(auto mode: modes)
+        {
+            checkBlock<std::uint8_t>(mode, 0.0f, 255.0f);
+            checkBlock<std::uint16_t>(mode, 0.0f, 65535.0f);
+            checkBlock<std::int16_t>(mode, -32768.0f, 32767.0f);
+            checkBlock<int>(mode, -1e9f, 1e9f);
+        }
+
+        // NaN saturates to the minimum in the SIMD loop as well
+        std::vector<float> nans(32, std::numeric_limits<float>::quiet_NaN());
+        std::vector<std::uint8_t> r8(32, 1);
+        std::vector<std::int16_t> r16(32, 1);
+        convertBlock(r8.data(), nans.data(), 32);
+        convertBlock(r16.data(), nans.data(), 32);
+        for(int k=0; k<32; ++k)
+        {
+            shouldEqual(r8[k], 0);
+            shouldEqual(r16[k], -32768);
+        }
+    }
+
+    void testConvertArray()
+    {
+        S s{ 4, 5, 6 };
+        ArrayND<3, float> a(s);
+        for(int k=0; k<a.size(); ++k)
+            a[k] = 0.1f * k - 1.0f;
+
+        ArrayND<3, std::uint8_t> r(s), expected(s);
+
+        // consecutive array
+        convertArray(r, a * 20.0f);
+        for(int k=0; k<a.size(); ++k)
+            shouldEqual(r[k], (ConvertValue<std::uint8_t, ConvertSaturate>::exec(a[k] * 20.0f)));
+
+        convertArray(r, a, ConvertTruncate);
+        for(int k=0; k<a.size(); ++k)
+            if(a[k] >= 0.0f)
+                shouldEqual(r[k], (std::uint8_t)a[k]);
+
+        // strided source and target
+        ArrayND<3, float> at(a.transpose());
+        convertArray(r.transpose(), at * 20.0f);
+        for(int k=0; k<a.size(); ++k)
+            shouldEqual(r[k], (ConvertValue<std::uint8_t, ConvertSaturate>::exec(a[k] * 20.0f)));
+
+        // singleton expansion
+        ArrayND<3, float> row(S{ 1, 5, 1 });
+        for(int k=0; k<5; ++k)
+            row[k] = 100.25f * k;
+        convertArray(r, row, ConvertRound);
+        for(int k=0; k<a.size(); ++k)
+            shouldEqual(r[k], (ConvertValue<std::uint8_t, ConvertRound>::exec(row[(k / 6) % 5])));
+
+        // integer to float
+        ArrayND<3, float> b(s);
+        convertArray(b, r);
+        for(int k=0; k<a.size(); ++k)
+            shouldEqual(b[k], (float)r[k]);
+
+        // overlapping memory with a different element size
+        ArrayND<1, std::int16_t> o(Shape<1>{ 64 });
+        for(int k=0; k<64; ++k)
+            o[k] = k - 10;
+        ArrayViewND<1, std::uint8_t> bytes(Shape<1>{ 64 }, (std::uint8_t *)o.data());
+        convertArray(bytes, o);
+        for(int k=0; k<64; ++k)
+            shouldEqual(bytes[k], k < 10 ? 0 : k - 10);
+
+        try
+        {
+            convertArray(r, ArrayND<3, float>(S{ 4, 5, 5 }));
+            failTest("no exception thrown");
+        }
+        catch(std::exception & e)
+        {
+            std::string expected("\nPrecondition violation!\nconvertArray(): shape mismatch.");
+            std::string message(e.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+    }
+};
+
+struct ConversionTestSuite
+: public vigra::test_suite
+{
+    ConversionTestSuite()
+    : vigra::test_suite("ConversionTestSuite")
+    {
+        add( testCase(&ConversionTest::testConvertValue));
+        add( testCase(&ConversionTest::testConvertBlock));
+        add( testCase(&ConversionTest::testConvertArray));
+    }
+};
+
+int main(int argc, char ** argv)
+{
+    ConversionTestSuite test;
+
+    int failed = test.run(vigra::testsToBeExecuted(argc, argv));
+
+    std::cout << test.report() << std::endl;
+
+    return (failed != 0);
+}
@@ -0,0 +1,243 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014-2017 by Ullrich Koethe                  */
+/*                                                                      */
+/*    This file is part of the VIGRA2 computer vision library.          */
+/*    The VIGRA2 Website is                                             */
+/*        http://ukoethe.github.io/vigra2                               */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vigra2/unittest.hxx>
+#include <vigra2/gather.hxx>
+#include <vigra2/array_nd.hxx>
+
+using namespace vigra;
+
+struct GatherTest
+{
+    typedef Shape<3> S;
+
+    S s{ 4, 5, 6 };
+    ArrayND<3, int> a;
+
+    GatherTest()
+    : a(s)
+    {
+        for(int k=0; k<a.size(); ++k)
+            a[k] = k;
+    }
+
+    template <class FCT>
+    void checkError(FCT f, std::string const & msg)
+    {
+        try
+        {
+            f();
+            failTest("no exception thrown");
+        }
+        catch(std::exception & e)
+        {
+            std::string expected("\nPrecondition violation!\n" + msg);
+            std::string message(e.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+    }
+
+    void testGather()
+    {
+        ArrayND<1, S> points(Shape<1>{ 5 });
+        points[0] = S{ 0, 0, 0 };
+        points[1] = S{ 3, 4, 5 };
+        points[2] = S{ 1, 2, 3 };
+        points[3] = S{ 1, 2, 3 };
+        points[4] = S{ 2, 0, 1 };
+
+        auto r = gather(a, points);
+        shouldEqual(r.shape(), Shape<1>{ 5 });
+        for(int k=0; k<5; ++k)
+            shouldEqual(r[k], a[points[k]]);
+
+        // strided source
+        auto t = a.transpose();
+        for(int k=0; k<5; ++k)
+            points[k] = reversed(points[k]);
+        r = gather(t, points);
+        for(int k=0; k<5; ++k)
+            shouldEqual(r[k], t[points[k]]);
+
+        // scan-order indices into a strided source
+        ArrayND<1, int> idx(Shape<1>{ 4 });
+        idx[0] = 0; idx[1] = 7; idx[2] = 119; idx[3] = 50;
+        ArrayND<3, int> tc(t);
+        r = take(t, idx);
+        for(int k=0; k<4; ++k)
+            shouldEqual(r[k], tc[idx[k]]);
+
+        // table lookup with a multi-dimensional, non-consecutive index array
+        ArrayND<1, std::uint8_t> table(Shape<1>{ 10 });
+        for(int k=0; k<10; ++k)
+            table[k] = 100 + k;
+        ArrayND<2, std::uint32_t> labels(Shape<2>{ 7, 3 });
+        for(int k=0; k<labels.size(); ++k)
+            labels[k] = (k * 3) % 10;
+        auto classes = gather(table, labels.transpose());
+        shouldEqual(classes.shape(), (Shape<2>{ 3, 7 }));
+        for(int i=0; i<3; ++i)
+            for(int j=0; j<7; ++j)
+                shouldEqual((classes[Shape<2>{ i, j }]), (table[labels[Shape<2>{ j, i }]]));
+
+        // many indices, processed by several threads
+        ArrayND<1, std::int64_t> many(Shape<1>{ 100000 });
+        for(int k=0; k<many.size(); ++k)
+            many[k] = (k * 7919) % a.size();
+        auto rm = gather(a, many, ParallelOptions(4));
+        for(int k=0; k<many.size(); ++k)
+            shouldEqual(rm[k], a[many[k]]);
+
+        checkError([&]() { points[2] = S{ 0, 6, 0 }; gather(t, points); },
+                   "gather(): index out of range.");
+        checkError([&]() { idx[2] = 120; take(a, idx); },
+                   "gather(): index out of range.");
+        checkError([&]() { idx[2] = -1; take(a, idx); },
+                   "gather(): index out of range.");
+    }
+
+    void testScatter()
+    {
+        ArrayND<3, int> b(s);
+        ArrayND<1, S> points(Shape<1>{ 3 });
+        points[0] = S{ 0, 0, 0 };
+        points[1] = S{ 3, 4, 5 };
+        points[2] = S{ 1, 2, 3 };
+        ArrayND<1, double> values(Shape<1>{ 3 });
+        values[0] = 1.0; values[1] = 2.0; values[2] = 3.0;
+
+        scatter(b, points, values);
+        shouldEqual(b.sum(), 6);
+        for(int k=0; k<3; ++k)
+            shouldEqual(b[points[k]], k + 1);
+
+        // strided target
+        b = 0;
+        auto t = b.transpose();
+        scatter(t, points.subarray(Shape<1>{ 2 }, Shape<1>{ 3 }), 5);
+        shouldEqual((b[S{ 3, 2, 1 }]), 5);
+        shouldEqual(b.sum(), 5);
+
+        b = 0;
+        ArrayND<1, int> idx(Shape<1>{ 4 });
+        idx[0] = 0; idx[1] = 7; idx[2] = 119; idx[3] = 50;
+        put(t, idx, 1);
+        ArrayND<3, int> tc(t);
+        for(int k=0; k<4; ++k)
+            shouldEqual(tc[idx[k]], 1);
+        shouldEqual(b.sum(), 4);
+
+        checkError([&]() { scatter(b, points, ArrayND<1, int>(Shape<1>{ 2 })); },
+                   "scatter(): shape mismatch between indices and values.");
+        checkError([&]() { points[2] = S{ 4, 0, 0 }; scatter(b, points, 1); },
+                   "scatter(): index out of range.");
+    }
+
+    void testScatterAdd()
+    {
+        // label counting with repeated indices, serial and parallel
+        ArrayND<1, std::uint16_t> labels(Shape<1>{ 200000 });
+        for(int k=0; k<labels.size(); ++k)
+            labels[k] = (k * 31) % 17;
+        ArrayND<1, int> expected(Shape<1>{ 17 });
+        for(int k=0; k<labels.size(); ++k)
+            expected[labels[k]] += 1;
+
+        ArrayND<1, int> counts(Shape<1>{ 17 });
+        scatterAdd(counts, labels, 1, ParallelOptions(ParallelOptions::NoThreads));
+        should(counts == expected);
+
+        counts = 0;
+        scatterAdd(counts, labels, 1, ParallelOptions(4));
+        should(counts == expected);
+
+        // per-label sums into a strided target
+        ArrayND<1, double> values(labels.shape());
+        ArrayND<2, double> sums(Shape<2>{ 17, 2 }), sumsExpected(Shape<2>{ 17, 2 });
+        for(int k=0; k<labels.size(); ++k)
+        {
+            values[k] = 0.5 * (k % 5);
+            sumsExpected[Shape<2>{ labels[k], 1 }] += values[k];
+        }
+        scatterAdd(sums.bind(1, 1), labels, values, ParallelOptions(4));
+        should(sums == sumsExpected);
+
+        ArrayND<1, Shape<2>> points(Shape<1>{ 3 });
+        points[0] = Shape<2>{ 1, 0 };
+        points[1] = Shape<2>{ 1, 0 };
+        points[2] = Shape<2>{ 2, 1 };
+        sums = 0.0;
+        ArrayND<1, double> v(Shape<1>{ 3 }, 1.5);
+        scatterAdd(sums, points, v);
+        shouldEqual((sums[Shape<2>{ 1, 0 }]), 3.0);
+        shouldEqual((sums[Shape<2>{ 2, 1 }]), 1.5);
+        shouldEqual(sums.sum(), 4.5);
+
+        checkError([&]() { scatterAdd(sums, points, ArrayND<1, int>(Shape<1>{ 2 })); },
+                   "scatterAdd(): shape mismatch between indices and values.");
+        checkError([&]() { labels[7] = 17; scatterAdd(counts, labels, 1); },
+                   "scatterAdd(): index out of range.");
+    }
+};
+
+struct GatherTestSuite
+: public vigra::test_suite
+{
+    GatherTestSuite()
+    : vigra::test_suite("GatherTestSuite")
+    {
+        add( testCase(&GatherTest::testGather));
+        add( testCase(&GatherTest::testScatter));
+        add( testCase(&GatherTest::testScatterAdd));
+    }
+};
+
+int main(int argc, char ** argv)
+{
+    GatherTestSuite test;
+
+    int failed = test.run(vigra::testsToBeExecuted(argc, argv));
+
+    std::cout << test.report() << std::endl;
+
+    return (failed != 0);
+}
@@ -0,0 +1,257 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014-2017 by Ullrich Koethe                  */
+/*                                                                      */
+/*    This file is part of the VIGRA2 computer vision library.          */
+/*    The VIGRA2 Website is                                             */
+/*        http://ukoethe.github.io/vigra2                               */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+
+#include <typeinfo>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <vigra2/unittest.hxx>
+#include <vigra2/histogram.hxx>
+
+using namespace vigra;
+
+template <int N>
+struct HistogramTest
+{
+    typedef Shape<N> S;
+
+    ArrayND<N, unsigned char> bytes;
+    ArrayND<N, int> ints;
+    ArrayND<N, float> floats;
+
+    HistogramTest()
+    : bytes(S{100, 60, 40})
+    , ints(bytes.shape())
+    , floats(bytes.shape())
+    {
+        unsigned int state = 1;
+        for(int k=0; k<bytes.size(); ++k)
+        {
+            state = 1664525u*state + 1013904223u;
+            bytes.data()[k] = (unsigned char)((state >> 16) % 200 + 20);
+            ints.data()[k] = (int)(state >> 8) % 100000 - 50000;
+            floats.data()[k] = (float)((state >> 8) % 1000003) / 1000.0f - 100.0f;
+        }
+    }
+
+    template <class T>
+    static std::vector<double> reference(ArrayViewND<N, T> const & a, std::vector<double> const & q)
+    {
+        std::vector<T> v(a.data(), a.data()+a.size());
+        std::sort(v.data(), v.data()+v.size());
+        std::vector<double> res;
+        for(double p : q)
+        {
+            double r = p * (v.size() - 1);
+            ArrayIndex l = (ArrayIndex)std::floor(r), u = (ArrayIndex)std::ceil(r);
+            res.push_back(v[l] + (r - l) * ((double)v[u] - (double)v[l]));
+        }
+        return res;
+    }
+
+    void testHistogram()
+    {
+        for(int threads : { 1, 4 })
+        {
+            ParallelOptions options(threads);
+
+            Histogram<unsigned char> h = histogram(bytes, options);
+            shouldEqual(h.binCount(), 256);
+            should(h.isDirect());
+            shouldEqual(h.size(), bytes.size());
+            shouldEqual(h.underflow(), 0);
+            shouldEqual(h.overflow(), 0);
+            shouldEqual((int)h.minimum(), (int)bytes.minmax()[0]);
+            shouldEqual((int)h.maximum(), (int)bytes.minmax()[1]);
+            for(int k=0; k<256; ++k)
+                shouldEqual(h[k], std::count(bytes.data(), bytes.data()+bytes.size(), (unsigned char)k));
+
+            Histogram<int> hi = histogram(ints, options);
+            shouldEqual(hi.lower(), (double)ints.minmax()[0]);
+            shouldEqual(hi.binCount(), ints.minmax()[1] - ints.minmax()[0] + 1);
+            shouldEqual(hi[0], std::count(ints.data(), ints.data()+ints.size(), ints.minmax()[0]));
+            shouldEqual(hi.size(), ints.size());
+
+            Histogram<float> hf = histogram(floats, -50.0, 50.0, 100, options);
+            shouldEqual(hf.binCount(), 100);
+            shouldNot(hf.isDirect());
+            shouldEqual(hf.size(), floats.size());
+            shouldEqual(hf.underflow(), std::count_if(floats.data(), floats.data()+floats.size(),
+                                                      [](float v) { return v < -50.0f; }));
+            shouldEqual(hf.overflow(), std::count_if(floats.data(), floats.data()+floats.size(),
+                                                     [](float v) { return v > 50.0f; }));
+            shouldEqual(hf[10], std::count_if(floats.data(), floats.data()+floats.size(),
+                                              [](float v) { return v >= -40.0f && v < -39.0f; }));
+            shouldEqual(hf.minimum(), floats.minmax()[0]);
+            shouldEqual(hf.maximum(), floats.minmax()[1]);
+
+            Histogram<float> hr = histogram(floats, 64, options);
+            shouldEqual(hr.binCount(), 64);
+            shouldEqual(hr.lower(), (double)floats.minmax()[0]);
+            shouldEqual(hr.upper(), (double)floats.minmax()[1]);
+            shouldEqual(hr.underflow() + hr.overflow(), 0);
+            shouldEqual(hr.size(), floats.size());
+        }
+    }
+
+    void testQuantiles()
+    {
+        std::vector<double> q = { 0.0, 0.01, 0.25, 0.5, 0.77, 0.99, 1.0 };
+        for(int threads : { 1, 4 })
+        {
+            ParallelOptions options(threads);
+
+            auto rb = reference(bytes.view(), q),
+                 ri = reference(ints.view(), q),
+                 rf = reference(floats.view(), q);
+            auto b = quantiles(bytes, q, options),
+                 i = quantiles(ints, q, options),
+                 f = quantiles(floats, q, options);
+            shouldEqualSequence(b.begin(), b.end(), rb.begin());
+            shouldEqualSequence(i.begin(), i.end(), ri.begin());
+            shouldEqualSequence(f.begin(), f.end(), rf.begin());
+
+            shouldEqual(median(floats, options), reference(floats.view(), {0.5})[0]);
+            shouldEqual(quantile(ints, 0.25, options), ri[2]);
+
+            auto mm = minmax(floats, options);
+            shouldEqual(mm, floats.minmax());
+        }
+
+        // skewed data, where a single coarse bin holds almost all values
+        ArrayND<N, double> outlier(S{100, 60, 40});
+        ArrayND<N, double> geometric(outlier.shape());
+        ArrayND<N, int> duplicates(outlier.shape());
+        for(int k=0; k<outlier.size(); ++k)
+        {
+            outlier.data()[k] = floats.data()[k];
+            geometric.data()[k] = std::ldexp(1.0 + (k % 7) / 8.0, -(k % 900));
+            duplicates.data()[k] = (k % 100 == 0) ? k * 1000 : 7;
+        }
+        outlier.data()[1234] = 1.0e30;
+        for(int threads : { 1, 4 })
+        {
+            ParallelOptions options(threads);
+            auto o = quantiles(outlier, q, options),
+                 g = quantiles(geometric, q, options),
+                 d = quantiles(duplicates, q, options);
+            auto ro = reference(outlier.view(), q),
+                 rg = reference(geometric.view(), q),
+                 rd = reference(duplicates.view(), q);
+            shouldEqualSequence(o.begin(), o.end(), ro.begin());
+            shouldEqualSequence(g.begin(), g.end(), rg.begin());
+            shouldEqualSequence(d.begin(), d.end(), rd.begin());
+        }
+
+        ArrayND<N, float> constant(S{3, 4, 5}, 2.5f);
+        shouldEqual(median(constant), 2.5);
+
+        // NaNs are ignored
+        ArrayND<N, float> withNaN(S{3, 4, 5}, 0.0f);
+        for(int k=0; k<withNaN.size(); ++k)
+            withNaN.data()[k] = (k % 3 == 0)
+                                   ? std::numeric_limits<float>::quiet_NaN()
+                                   : (float)k;
+        std::vector<float> valid;
+        for(int k=0; k<withNaN.size(); ++k)
+            if(k % 3 != 0)
+                valid.push_back((float)k);
+        ArrayND<1, float> validArray(Shape<1>((ArrayIndex)valid.size()), valid.data());
+        auto qn = quantiles(withNaN, {0.0, 0.25, 0.5, 1.0}),
+             qv = quantiles(validArray, {0.0, 0.25, 0.5, 1.0});
+        shouldEqualSequence(qn.begin(), qn.end(), qv.begin());
+        shouldEqual(median(withNaN), median(validArray));
+
+        ArrayND<N, float> allNaN(S{3, 4, 5}, std::numeric_limits<float>::quiet_NaN());
+        try
+        {
+            median(allNaN);
+            failTest("no exception thrown");
+        }
+        catch(ContractViolation & c)
+        {
+            std::string expected("\nPrecondition violation!\nquantiles(): array must contain at least one valid (non-NaN) value.");
+            std::string message(c.what());
+            shouldMsg(0 == expected.compare(message.substr(0,expected.size())), message.c_str());
+        }
+
+        try
+        {
+            quantile(floats, 1.5);
+            failTest("no exception thrown");
+        }
+        catch(ContractViolation & c)
+        {
+            std::string expected("\nPrecondition violation!\nquantiles(): quantiles must be in the range [0, 1].");
+            std::string message(c.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+    }
+};
+
+struct HistogramTestSuite
+: public vigra::test_suite
+{
+    HistogramTestSuite()
+    : vigra::test_suite("HistogramTestSuite")
+    {
+        addTests<3>();
+        addTests<runtime_size>();
+    }
+
+    template <int N>
+    void addTests()
+    {
+        add( testCase(&HistogramTest<N>::testHistogram));
+        add( testCase(&HistogramTest<N>::testQuantiles));
+    }
+};
+
+int main(int argc, char ** argv)
+{
+    HistogramTestSuite test;
+
+    int failed = test.run(vigra::testsToBeExecuted(argc, argv));
+
+    std::cout << test.report() << std::endl;
+
+    return (failed != 0);
+}
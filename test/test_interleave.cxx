@@ -0,0 +1,184 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014-2017 by Ullrich Koethe                  */
+/*                                                                      */
+/*    This file is part of the VIGRA2 computer vision library.          */
+/*    The VIGRA2 Website is                                             */
+/*        http://ukoethe.github.io/vigra2                               */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vigra2/unittest.hxx>
+#include <vigra2/interleave.hxx>
+#include <vigra2/array_nd.hxx>
+#include <vigra2/array_math.hxx>
+
+using namespace vigra;
+
+struct InterleaveTest
+{
+    typedef Shape<2> S2;
+    typedef Shape<3> S3;
+
+    template <class T, int C>
+    void testRoundTrip()
+    {
+        // 7*5 pixels: not a multiple of the SIMD width
+        ArrayND<2, TinyArray<T, C>> pixels(S2{ 7, 5 }), back(S2{ 7, 5 });
+        int k = 0;
+        for(auto & v : pixels)
+            for(int c = 0; c < C; ++c)
+                v[c] = T(k++ % 120);
+
+        ArrayND<3, T> planes(S3{ C, 7, 5 });
+        deinterleave(pixels, planes);
+        for(int c = 0; c < C; ++c)
+            should(planes.bind(0, c) == pixels.bindChannel(c));
+
+        interleave(planes, back);
+        should(back == pixels);
+
+        // channel-last destination
+        ArrayND<3, T> last(S3{ 7, 5, C });
+        last.setChannelAxis(2);
+        deinterleave(pixels, last);
+        for(int c = 0; c < C; ++c)
+            should(last.bind(2, c) == pixels.bindChannel(c));
+
+        // planar array in Fortran order, i.e. different pixel order
+        // => generic fallback
+        ArrayND<3, T> fplanes(S3{ 5, 7, C });
+        ArrayViewND<3, T> fview = fplanes.transpose();
+        fview.setChannelAxis(0);
+        deinterleave(pixels, fview);
+        should(fview == planes);
+        back = TinyArray<T, C>();
+        interleave(fview, back);
+        should(back == pixels);
+    }
+
+    void testInterleave()
+    {
+        testRoundTrip<float, 2>();
+        testRoundTrip<float, 3>();
+        testRoundTrip<float, 4>();
+        testRoundTrip<std::int32_t, 3>();
+        testRoundTrip<std::uint8_t, 3>();
+        testRoundTrip<std::uint8_t, 4>();
+        testRoundTrip<double, 2>();
+        testRoundTrip<float, 5>();
+
+        try
+        {
+            ArrayND<2, TinyArray<float, 3>> pixels(S2{ 4, 5 });
+            ArrayND<3, float> planes(S3{ 3, 5, 4 });
+            deinterleave(pixels, planes);
+            failTest("no exception thrown");
+        }
+        catch(std::exception & e)
+        {
+            std::string expected("\nPrecondition violation!\ncopyChannels(): shape mismatch.");
+            std::string message(e.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+    }
+
+    void testCopyChannels()
+    {
+        using namespace array_math;
+
+        ArrayND<3, float> rgb(S3{ 9, 11, 3 }), planes(S3{ 3, 9, 11 }), back(S3{ 9, 11, 3 });
+        rgb.setChannelAxis(2);
+        planes.setChannelAxis(0);
+        back.setChannelAxis(2);
+        int k = 0;
+        for(auto & v : rgb)
+            v = float(k++);
+
+        copyChannels(rgb, planes);
+        for(int c = 0; c < 3; ++c)
+            should(planes.bind(0, c) == rgb.bind(2, c));
+        copyChannels(planes, back);
+        should(back == rgb);
+
+        // same layout: plain copy
+        ArrayND<3, float> same(S3{ 9, 11, 3 });
+        same.setChannelAxis(2);
+        copyChannels(rgb, same);
+        should(same == rgb);
+
+        // strided views use the fallback
+        ArrayND<3, float> big(S3{ 3, 18, 11 });
+        ArrayViewND<3, float> sub = big.subarray(S3{ 0, 0, 0 }, S3{ 3, 18, 11 }, S3{ 1, 2, 1 });
+        sub.setChannelAxis(0);
+        copyChannels(rgb, sub);
+        should(sub == planes);
+
+        try
+        {
+            ArrayND<3, float> untagged(S3{ 3, 9, 11 });
+            copyChannels(rgb, untagged);
+            failTest("no exception thrown");
+        }
+        catch(std::exception & e)
+        {
+            std::string expected("\nPrecondition violation!\ncopyChannels(): source and destination must have a channel axis.");
+            std::string message(e.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+    }
+};
+
+struct InterleaveTestSuite
+: public vigra::test_suite
+{
+    InterleaveTestSuite()
+    : vigra::test_suite("InterleaveTestSuite")
+    {
+        add( testCase(&InterleaveTest::testInterleave));
+        add( testCase(&InterleaveTest::testCopyChannels));
+    }
+};
+
+int main(int argc, char ** argv)
+{
+    InterleaveTestSuite test;
+
+    int failed = test.run(vigra::testsToBeExecuted(argc, argv));
+
+    std::cout << test.report() << std::endl;
+
+    return (failed != 0);
+}
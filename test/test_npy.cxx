@@ -0,0 +1,456 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014-2017 by Ullrich Koethe                  */
+/*                                                                      */
+/*    This file is part of the VIGRA2 computer vision library.          */
+/*    The VIGRA2 Website is                                             */
+/*        http://ukoethe.github.io/vigra2                               */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+
+#include <complex>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vigra2/unittest.hxx>
+#include <vigra2/npy.hxx>
+#include <vigra2/array_nd.hxx>
+#include <vigra2/array_math.hxx>
+
+using namespace vigra;
+
+struct NpyTest
+{
+    typedef Shape<3> S;
+
+    std::string filename, npzname;
+
+    NpyTest()
+    : filename("test_npy.npy")
+    , npzname("test_npy.npz")
+    {}
+
+    ~NpyTest()
+    {
+        std::remove(filename.c_str());
+        std::remove(npzname.c_str());
+    }
+
+        // the values count in C-order regardless of the memory order, so that
+        // C- and Fortran-order files of the same shape hold equal arrays
+    template <class T>
+    ArrayND<3, T> makeArray(S const & shape, MemoryOrder order = C_ORDER)
+    {
+        ArrayND<3, T> a(shape, order);
+        int k = 0;
+        for(auto i = a.begin(C_ORDER), end = a.end(C_ORDER); i != end; ++i, ++k)
+            *i = T(k);
+        return a;
+    }
+
+    std::string fileContents(std::string const & name)
+    {
+        std::ifstream f(name.c_str(), std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+    }
+
+        // write a .npy file with the given header dict and raw data
+    void writeRaw(int version, std::string dict, std::string const & data)
+    {
+        std::size_t prefixSize = version == 1 ? 10 : 12;
+        dict.resize((prefixSize + dict.size() + 64) / 64 * 64 - prefixSize - 1, ' ');
+        dict += '\n';
+        std::string header("\x93NUMPY", 6);
+        header += (char)version;
+        header += '\0';
+        for(std::size_t k = 0; k < prefixSize - 8; ++k)
+            header += (char)((dict.size() >> (8*k)) & 0xFF);
+        std::ofstream f(filename.c_str(), std::ios::binary);
+        f << header << dict << data;
+    }
+
+    template <class ARRAY>
+    void checkRoundTrip(ARRAY const & a)
+    {
+        typedef typename ARRAY::value_type T;
+        static const int N = ARRAY::actual_dimension;
+
+        writeNpy(filename, a);
+        shouldEqual(readNpyInfo(filename).dataOffset % 64, 0u);
+
+        ArrayND<N, T> r = readNpy<N, T>(filename);
+        should(r == a);
+
+        MappedNpyArrayND<N, T> m(filename);
+        should(m == a);
+        shouldEqual((std::size_t)m.data() % 64, 0u);
+    }
+
+    void testRoundTrip()
+    {
+        auto a = makeArray<float>(S{ 4, 5, 6 });
+        checkRoundTrip(a);
+        checkRoundTrip(makeArray<double>(S{ 0, 3, 2 }));
+        checkRoundTrip(makeArray<std::uint8_t>(S{ 1, 7, 1 }));
+        checkRoundTrip(makeArray<std::int64_t>(S{ 3, 1, 2 }));
+        checkRoundTrip(a.subarray(S{ 1, 0, 1 }, S{ 4, 5, 6 }));
+        checkRoundTrip(a.transpose(S{ 1, 2, 0 }));
+
+        // F-order arrays are stored with fortran_order and read as F-order arrays
+        auto f = makeArray<float>(S{ 4, 5, 6 }, F_ORDER);
+        should(f == a);
+        checkRoundTrip(f);
+        should(readNpyInfo(filename).fortranOrder);
+        should((readNpy<3, float>(filename).byte_strides() == f.byte_strides()));
+        ArrayND<runtime_size, float> fr = readNpy<runtime_size, float>(filename);
+        shouldEqual(fr.ndim(), 3);
+        should(fr == a);
+        should(fr.byte_strides() == f.byte_strides());
+        checkRoundTrip(a.transpose());
+        should(readNpyInfo(filename).fortranOrder);
+
+        // complex numbers have their own type code
+        ArrayND<1, std::complex<double>> c(Shape<1>{ 17 });
+        for(int i = 0; i < 17; ++i)
+            c(i) = std::complex<double>(i, -i);
+        checkRoundTrip(c);
+        shouldEqual(readNpyInfo(filename).descr.substr(1), "c16");
+
+        // vector elements become the last axis
+        ArrayND<2, TinyArray<std::uint16_t, 3>> rgb(Shape<2>{ 20, 30 });
+        for(int y = 0; y < 20; ++y)
+            for(int x = 0; x < 30; ++x)
+                rgb(y, x) = TinyArray<std::uint16_t, 3>{ std::uint16_t(x), std::uint16_t(y), std::uint16_t(x*y) };
+        checkRoundTrip(rgb);
+        should((readNpyInfo(filename).shape == Shape<>{ 20, 30, 3 }));
+        should((readNpy<3, std::uint16_t>(filename) == rgb.expandElements(2)));
+        checkRoundTrip(rgb.transpose());
+    }
+
+    void testHeader()
+    {
+        char order = detail::isLittleEndian() ? '<' : '>';
+
+        writeNpy(filename, ArrayND<2, float>(Shape<2>{ 3, 4 }));
+        std::string contents = fileContents(filename);
+        shouldEqual(contents.substr(0, 8), std::string("\x93NUMPY\x01\x00", 8));
+        shouldEqual(contents.size(), 128u + 48u);
+        shouldEqual(contents[8] + 256*contents[9], 118);
+        shouldEqual(contents.substr(10, 59),
+            std::string("{'descr': '") + order + "f4', 'fortran_order': False, 'shape': (3, 4), }");
+        shouldEqual(contents[127], '\n');
+
+        writeNpy(filename, ArrayND<1, std::uint8_t>(Shape<1>{ 5 }));
+        contents = fileContents(filename);
+        shouldEqual(contents.substr(10, 57),
+            std::string("{'descr': '|u1', 'fortran_order': False, 'shape': (5,), }"));
+
+        NpyInfo info = readNpyInfo(filename);
+        shouldEqual(info.version, 1);
+        shouldEqual(info.descr, "|u1");
+        shouldEqual(info.kind, 'u');
+        shouldEqual(info.itemsize, 1);
+        should(info.isNativeByteOrder());
+        should(info.hasElementType<std::uint8_t>());
+        should(!info.hasElementType<std::int8_t>());
+        shouldEqual(info.dataOffset, 128u);
+        shouldEqual(info.dataSize, 5u);
+
+        // big-endian data are swapped
+        writeRaw(1, "{'descr': '>i2', 'fortran_order': False, 'shape': (2, 3), }",
+                 std::string("\0\1\0\2\0\3\0\4\1\0\xff\xff", 12));
+        ArrayND<2, std::int16_t> expected(Shape<2>{ 2, 3 }, { 1, 2, 3, 4, 256, -1 });
+        info = readNpyInfo(filename);
+        should(info.isNativeByteOrder() == !detail::isLittleEndian());
+        should((readNpy<2, std::int16_t>(filename) == expected));
+        should((MappedNpyArrayND<2, std::int16_t>(filename) == expected));
+
+        // version 2, Fortran order, double-quoted keys, no trailing comma
+        double d[] = { 1.0, 2.0, 3.0, 4.0 };
+        writeRaw(2, std::string("{\"descr\": \"") + order + "f8\", \"shape\": (2, 2), \"fortran_order\": True}",
+                 std::string((char const *)d, sizeof(d)));
+        ArrayND<2, double> e(Shape<2>{ 2, 2 }, { 1.0, 3.0, 2.0, 4.0 });
+        shouldEqual(readNpyInfo(filename).version, 2);
+        should((readNpy<2, double>(filename) == e));
+        should((MappedNpyArrayND<2, double>(filename) == e));
+
+        // Fortran order with vector elements: channels are the outermost axis
+        writeRaw(3, "{'descr': '|u1', 'fortran_order': True, 'shape': (2, 3), }",
+                 std::string("\1\2\3\4\5\6", 6));
+        auto v = readNpy<1, TinyArray<std::uint8_t, 3>>(filename);
+        shouldEqual(v.shape(0), 2);
+        shouldEqual(v(0), (TinyArray<std::uint8_t, 3>{ 1, 3, 5 }));
+        shouldEqual(v(1), (TinyArray<std::uint8_t, 3>{ 2, 4, 6 }));
+
+        // zero-dimensional arrays have shape (1,)
+        std::int32_t i = -7;
+        writeRaw(1, std::string("{'descr': '") + order + "i4', 'fortran_order': False, 'shape': (), }",
+                 std::string((char const *)&i, 4));
+        auto z = readNpy<1, std::int32_t>(filename);
+        shouldEqual(z.shape(0), 1);
+        shouldEqual(z(0), -7);
+    }
+
+    void testNpz()
+    {
+        auto a = makeArray<float>(S{ 4, 5, 6 });
+        ArrayND<1, std::int16_t> b(Shape<1>{ 7 }, { 1, -2, 3, -4, 5, -6, 7 });
+        auto c = makeArray<double>(S{ 3, 4, 5 }, F_ORDER);
+        {
+            NpzWriter npz(npzname);
+            npz.add("a", a);
+            npz.add("long name with spaces", b);
+            npz.add("c", c.subarray(S{ 0, 1, 0 }, S{ 3, 4, 5 }));
+        }
+
+        NpzFile npz(npzname);
+        shouldEqual(npz.names().size(), 3u);
+        shouldEqual(npz.names()[1], "long name with spaces");
+        should(npz.contains("c"));
+        should(!npz.contains("d"));
+        should((npz.info("a").shape == Shape<>{ 4, 5, 6 }));
+        should((npz.read<3, float>("a") == a));
+        should((npz.read<1, std::int16_t>("long name with spaces") == b));
+        should((npz.read<runtime_size, double>("c") == c.subarray(S{ 0, 1, 0 }, S{ 3, 4, 5 })));
+
+        for(auto const & name : npz.names())
+            shouldEqual(npz.info(name).dataOffset % 64, 0u);
+        MappedNpyArrayND<3, float> m(npz, "a");
+        should(m == a);
+        shouldEqual((std::size_t)m.data() % 64, 0u);
+        MappedNpyArrayND<1, std::int16_t> mb(npz, "long name with spaces");
+        should(mb == b);
+
+        // the members are valid .npy files with correct checksums
+        std::string contents = fileContents(npzname);
+        shouldEqual(contents.substr(0, 4), std::string("PK\3\4", 4));
+        std::size_t size = npy_detail::getLE(contents.data() + 18, 4),
+                    start = contents.find(std::string("\x93NUMPY", 6));
+        shouldEqual(start % 64, 0u);
+        shouldEqual(size, 128 + a.size()*sizeof(float));
+        shouldEqual((std::uint32_t)npy_detail::getLE(contents.data() + 14, 4),
+                    checksum(contents.data() + start, size));
+
+        // an empty archive
+        {
+            NpzWriter empty(npzname);
+            empty.close();
+        }
+        shouldEqual(NpzFile(npzname).names().size(), 0u);
+    }
+
+    template <class F>
+    void checkException(F f, std::string const & expected)
+    {
+        try
+        {
+            f();
+            failTest("no exception thrown");
+        }
+        catch(std::exception & e)
+        {
+            std::string message(e.what());
+            shouldMsg(message.find(expected) != std::string::npos, message.c_str());
+        }
+    }
+
+    void testErrors()
+    {
+        std::string filename = this->filename, npzname = this->npzname;
+        writeNpy(filename, makeArray<float>(S{ 4, 5, 6 }));
+
+        checkException([filename]() { readNpy<3, double>(filename); },
+                       "readNpy(): element type mismatch.");
+        checkException([filename]() { MappedNpyArrayND<2, float> m(filename); },
+                       "MappedNpyArrayND(): dimension mismatch.");
+        checkException([filename]() { readNpy<2, TinyArray<float, 5>>(filename); },
+                       "readNpy(): element type mismatch.");
+        checkException([npzname]() { NpzFile npz(npzname); },
+                       "NpzFile(): unable to open 'test_npy.npz'.");
+        checkException([filename]() { NpzFile npz(filename); },
+                       "NpzFile(): not a zip file.");
+
+        {
+            NpzWriter npz(npzname);
+            npz.add("a", makeArray<float>(S{ 2, 2, 2 }));
+            checkException([&npz]() { npz.add("a", ArrayND<1, int>(Shape<1>{ 2 })); },
+                           "NpzWriter::add(): duplicate member 'a'.");
+        }
+        NpzFile npz(npzname);
+        checkException([&npz]() { npz.read<3, float>("b"); },
+                       "NpzFile::read(): no member 'b'");
+
+        checkException([npzname]() { readNpy<3, float>(npzname); },
+                       "readNpy(): not a .npy file.");
+
+        writeRaw(1, "{'descr': '<U8', 'fortran_order': False, 'shape': (2,), }", std::string(64, 'x'));
+        checkException([filename]() { readNpyInfo(filename); },
+                       "readNpyInfo(): unsupported dtype '<U8'.");
+        writeRaw(1, "{'descr': [('x', '<f4')], 'fortran_order': False, 'shape': (2,), }", std::string(8, 'x'));
+        checkException([filename]() { readNpyInfo(filename); },
+                       "readNpyInfo(): structured dtypes are not supported.");
+        writeRaw(1, "{'descr': '<f4', 'fortran_order': False, 'shape': (2, 3)", std::string(24, 'x'));
+        checkException([filename]() { readNpyInfo(filename); },
+                       "readNpyInfo(): corrupt header.");
+        writeRaw(1, "{'descr': '<f4', 'fortran_order': False, 'shape': (2, 3), }", std::string(20, 'x'));
+        checkException([filename]() { readNpy<2, float>(filename); },
+                       "readNpy(): file is truncated.");
+        // the product of these extents overflows 64 bits
+        writeRaw(1, "{'descr': '<f8', 'fortran_order': False, 'shape': (4294967296, 4294967296, 16), }",
+                 std::string(64, 'x'));
+        checkException([filename]() { MappedNpyArrayND<3, double> m(filename); },
+                       "MappedNpyArrayND(): file is truncated.");
+        writeRaw(1, "{'descr': '<f0', 'fortran_order': False, 'shape': (2,), }", std::string(8, 'x'));
+        checkException([filename]() { readNpyInfo(filename); },
+                       "readNpyInfo(): unsupported dtype '<f0'.");
+    }
+
+    void writeContents(std::string const & name, std::string const & contents)
+    {
+        std::ofstream f(name.c_str(), std::ios::binary);
+        f << contents;
+    }
+
+        // a zip archive holding 'member' as 'a.npy' at offset 0, where the
+        // central directory stores 'offset' in a ZIP64 extra field
+    std::string zip64Archive(std::string const & member, std::uint64_t offset)
+    {
+        using npy_detail::putLE;
+        std::string local;
+        putLE(local, 0x04034b50, 4);
+        putLE(local, 45, 2);
+        local.append(8, '\0');
+        putLE(local, checksum(member.data(), member.size()), 4);
+        putLE(local, member.size(), 4);
+        putLE(local, member.size(), 4);
+        putLE(local, 5, 2);
+        putLE(local, 0, 2);
+        local += "a.npy" + member;
+
+        std::string directory;
+        putLE(directory, 0x02014b50, 4);
+        putLE(directory, 45, 2);
+        putLE(directory, 45, 2);
+        directory.append(8, '\0');
+        putLE(directory, checksum(member.data(), member.size()), 4);
+        putLE(directory, member.size(), 4);
+        putLE(directory, member.size(), 4);
+        putLE(directory, 5, 2);
+        putLE(directory, 12, 2);
+        directory.append(10, '\0');
+        putLE(directory, 0xFFFFFFFF, 4);
+        directory += "a.npy";
+        putLE(directory, 1, 2);
+        putLE(directory, 8, 2);
+        putLE(directory, offset, 8);
+
+        std::string end;
+        putLE(end, 0x06054b50, 4);
+        end.append(4, '\0');
+        putLE(end, 1, 2);
+        putLE(end, 1, 2);
+        putLE(end, directory.size(), 4);
+        putLE(end, local.size(), 4);
+        putLE(end, 0, 2);
+        return local + directory + end;
+    }
+
+    void testCorruptNpz()
+    {
+        std::string npzname = this->npzname;
+        {
+            NpzWriter npz(npzname);
+            npz.add("a", makeArray<float>(S{ 4, 5, 6 }));
+        }
+        std::string contents = fileContents(npzname);
+        std::size_t entry = contents.find(std::string("PK\1\2", 4));
+        auto patch = [](std::string & s, std::size_t pos, std::uint64_t v, int bytes)
+        {
+            std::string le;
+            npy_detail::putLE(le, v, bytes);
+            s.replace(pos, bytes, le);
+        };
+
+        // the member size covers the rest of the file, so that the data extend
+        // past the end of the file behind the local header
+        std::string truncated(contents);
+        patch(truncated, entry + 20, contents.size(), 4);
+        writeContents(npzname, truncated);
+        checkException([npzname]() { MappedNpyArrayND<3, float> m(NpzFile(npzname), "a"); },
+                       "NpzFile(): corrupt zip file");
+        checkException([npzname]() { NpzFile(npzname).read<3, float>("a"); },
+                       "NpzFile(): corrupt zip file");
+
+        // the local header's extra field reaches past the end of the file
+        std::string shifted(contents);
+        patch(shifted, 28, 0xFFFF, 2);
+        writeContents(npzname, shifted);
+        checkException([npzname]() { NpzFile(npzname).info("a"); },
+                       "NpzFile(): corrupt zip file");
+
+        // a ZIP64 offset such that offset + size overflows
+        writeNpy(filename, makeArray<float>(S{ 2, 3, 4 }));
+        std::string member = fileContents(filename);
+        writeContents(npzname, zip64Archive(member, 0));
+        should((NpzFile(npzname).read<3, float>("a") == makeArray<float>(S{ 2, 3, 4 })));
+        writeContents(npzname, zip64Archive(member, ~std::uint64_t(0) - 16));
+        checkException([npzname]() { NpzFile npz(npzname); },
+                       "NpzFile(): corrupt zip file");
+    }
+};
+
+struct NpyTestSuite
+: public vigra::test_suite
+{
+    NpyTestSuite()
+    : vigra::test_suite("NpyTestSuite")
+    {
+        add( testCase(&NpyTest::testRoundTrip));
+        add( testCase(&NpyTest::testHeader));
+        add( testCase(&NpyTest::testNpz));
+        add( testCase(&NpyTest::testCorruptNpz));
+        add( testCase(&NpyTest::testErrors));
+    }
+};
+
+int main(int argc, char ** argv)
+{
+    NpyTestSuite test;
+
+    int failed = test.run(vigra::testsToBeExecuted(argc, argv));
+
+    std::cout << test.report() << std::endl;
+
+    return (failed != 0);
+}
@@ -0,0 +1,137 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014-2017 by Ullrich Koethe                  */
+/*                                                                      */
+/*    This file is part of the VIGRA2 computer vision library.          */
+/*    The VIGRA2 Website is                                             */
+/*        http://ukoethe.github.io/vigra2                               */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+
+#include <iostream>
+#include <string>
+#include <vigra2/unittest.hxx>
+#include <vigra2/numa.hxx>
+#include <vigra2/array_nd.hxx>
+#include <vigra2/array_math.hxx>
+
+using namespace vigra;
+
+struct NumaTest
+{
+    typedef Shape<3> S;
+
+    void testFirstTouchAllocator()
+    {
+        typedef FirstTouchAllocator<float> Alloc;
+
+        // large enough for mapped memory and several chunks
+        ArrayND<3, float, Alloc> a(S{ 40, 64, 64 }, 2.5f, C_ORDER, Alloc(ParallelOptions(4)));
+        shouldEqual(a.size(), 40*64*64);
+        should(a.isConsecutive());
+        should(a.all());
+        should((a == ArrayND<3, float>(S{ 40, 64, 64 }, 2.5f)));
+
+        ArrayND<3, float, Alloc> z(S{ 40, 64, 64 }, F_ORDER, Alloc(ParallelOptions(3)));
+        should(!z.any());
+        z += 1.0f;
+        should((z == ArrayND<3, float>(S{ 40, 64, 64 }, 1.0f)));
+
+        ArrayND<3, float, Alloc> i(S{ 40, 64, 64 }, 7.0f, C_ORDER,
+                                   Alloc(ParallelOptions(4), PlaceInterleaved));
+        should((i == ArrayND<3, float>(S{ 40, 64, 64 }, 7.0f)));
+
+        // small arrays use operator new
+        ArrayND<runtime_size, float, Alloc> r(Shape<>{ 3, 4 }, -1.0f, C_ORDER, Alloc(ParallelOptions(2)));
+        shouldEqual(r.ndim(), 2);
+        should((r == ArrayND<2, float>(Shape<2>{ 3, 4 }, -1.0f)));
+
+        ArrayND<2, TinyArray<int, 3>, FirstTouchAllocator<TinyArray<int, 3>>>
+            t(Shape<2>{ 300, 300 }, TinyArray<int, 3>{ 1, 2, 3 });
+        for(auto const & v : t)
+            shouldEqual(v, (TinyArray<int, 3>{ 1, 2, 3 }));
+
+        // non-trivial types are default-constructed first
+        ArrayND<2, std::string, FirstTouchAllocator<std::string>>
+            s(Shape<2>{ 100, 100 }, std::string("vigra"), C_ORDER,
+              FirstTouchAllocator<std::string>(ParallelOptions(4)));
+        for(auto const & v : s)
+            shouldEqual(v, "vigra");
+
+        // copies and moves keep working
+        ArrayND<3, float, Alloc> c(a);
+        should(c == a);
+        ArrayND<3, float, Alloc> m(std::move(c));
+        should(m == a);
+
+        ArrayND<3, float, Alloc> e(S{ 0, 4, 4 });
+        shouldEqual(e.size(), 0);
+    }
+
+    void testNodeList()
+    {
+        using numa_detail::nodeListSize;
+        shouldEqual(nodeListSize("0\n"), 1);
+        shouldEqual(nodeListSize("0-3"), 4);
+        shouldEqual(nodeListSize("0,2-5\n"), 6);
+        shouldEqual(nodeListSize("0-1,8"), 9);
+        shouldEqual(nodeListSize(""), 0);
+        shouldEqual(nodeListSize("0-x"), 0);
+        shouldEqual(nodeListSize("99999999999"), 0);
+
+        // a single node has nothing to interleave
+        if(numa_detail::possibleNodeCount() <= 1)
+            should(!numa_detail::interleavePages(0, 0));
+    }
+};
+
+struct NumaTestSuite
+: public vigra::test_suite
+{
+    NumaTestSuite()
+    : vigra::test_suite("NumaTestSuite")
+    {
+        add( testCase(&NumaTest::testFirstTouchAllocator));
+        add( testCase(&NumaTest::testNodeList));
+    }
+};
+
+int main(int argc, char ** argv)
+{
+    NumaTestSuite test;
+
+    int failed = test.run(vigra::testsToBeExecuted(argc, argv));
+
+    std::cout << test.report() << std::endl;
+
+    return (failed != 0);
+}
@@ -39,6 +39,7 @@
 #include <string>
 #include <vigra2/unittest.hxx>
 #include <vigra2/numeric_traits.hxx>
+#include <vigra2/tinyarray.hxx>
 
 using namespace vigra;
 
@@ -193,6 +194,36 @@ struct NumericTraitsTest
         should(!greaterEqualAtTolerance(c, d));
         should(greaterEqualAtTolerance(c, d, 0.01));
     }
+
+    void testElementTypeCode()
+    {
+        shouldEqual(ElementTypeCode<bool>::kind, 'b');
+        shouldEqual(ElementTypeCode<unsigned char>::kind, 'u');
+        shouldEqual(ElementTypeCode<unsigned char>::itemsize, 1);
+        shouldEqual(ElementTypeCode<short>::kind, 'i');
+        shouldEqual(ElementTypeCode<short>::itemsize, 2);
+        shouldEqual(ElementTypeCode<unsigned long long>::kind, 'u');
+        shouldEqual(ElementTypeCode<unsigned long long>::itemsize, 8);
+        shouldEqual(ElementTypeCode<float>::kind, 'f');
+        shouldEqual(ElementTypeCode<float>::channels, 1);
+        shouldEqual(ElementTypeCode<double>::itemsize, 8);
+
+        typedef std::complex<float> C;
+        shouldEqual(ElementTypeCode<C>::kind, 'c');
+        shouldEqual(ElementTypeCode<C>::itemsize, 8);
+        shouldEqual(ElementTypeCode<C>::channels, 1);
+
+        typedef TinyArray<unsigned short, 3> V;
+        shouldEqual(ElementTypeCode<V>::kind, 'u');
+        shouldEqual(ElementTypeCode<V>::itemsize, 2);
+        shouldEqual(ElementTypeCode<V>::channels, 3);
+
+        typedef TinyArray<C, 2> CV;
+        shouldEqual(ElementTypeCode<CV>::kind, 'c');
+        shouldEqual(ElementTypeCode<CV>::channels, 2);
+
+        shouldEqual(ElementTypeCode<std::string>::kind, 0);
+    }
 };
 
 struct NumericTraitsTestSuite
@@ -204,6 +235,7 @@ struct NumericTraitsTestSuite
         add( testCase(&NumericTraitsTest::testPromote));
         add( testCase(&NumericTraitsTest::testNumericTraits));
         add( testCase(&NumericTraitsTest::testCloseAtTolerance));
+        add( testCase(&NumericTraitsTest::testElementTypeCode));
     }
 };
 
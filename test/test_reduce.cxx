@@ -0,0 +1,204 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014-2017 by Ullrich Koethe                  */
+/*                                                                      */
+/*    This file is part of the VIGRA2 computer vision library.          */
+/*    The VIGRA2 Website is                                             */
+/*        http://ukoethe.github.io/vigra2                               */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+
+#include <typeinfo>
+#include <iostream>
+#include <string>
+#include <cmath>
+#include <limits>
+#include <vigra2/unittest.hxx>
+#include <vigra2/reduce.hxx>
+
+using namespace vigra;
+
+template <int N>
+struct ReduceTest
+{
+    typedef Shape<N> S;
+
+    ArrayND<N, float> floats;
+    ArrayND<N, int> ints;
+
+    ReduceTest()
+    : floats(S{70, 50, 33})
+    , ints(floats.shape())
+    {
+        unsigned int state = 1;
+        for(int k=0; k<floats.size(); ++k)
+        {
+            state = 1664525u*state + 1013904223u;
+            floats.data()[k] = (float)((state >> 8) % 100003) / 1000.0f + 1000.0f;
+            ints.data()[k] = (int)((state >> 12) % 201) - 100;
+        }
+    }
+
+    template <class T>
+    static void referenceStatistics(ArrayViewND<N, T> const & a, double & mean, double & variance)
+    {
+        double sum = 0.0;
+        universalArrayNDFunction(a, [&sum](T v) { sum += v; }, "test");
+        mean = sum / a.size();
+        double ssd = 0.0;
+        universalArrayNDFunction(a, [&ssd, mean](T v) { ssd += (v - mean)*(v - mean); }, "test");
+        variance = ssd / a.size();
+    }
+
+    void testReduce()
+    {
+        using namespace vigra::reducers;
+
+        double mean, variance;
+        referenceStatistics(floats.view(), mean, variance);
+
+        auto r = reduce(floats, Count(), Mean(), Variance(), Minimum(), Maximum(),
+                                L2Norm(), SquaredNorm(), StdDev());
+        shouldEqual(std::get<0>(r), floats.size());
+        shouldEqualTolerance(std::get<1>(r), mean, 1e-12);
+        shouldEqualTolerance(std::get<2>(r), variance, 1e-10);
+        shouldEqual(std::get<3>(r), floats.minmax()[0]);
+        shouldEqual(std::get<4>(r), floats.minmax()[1]);
+        shouldEqualTolerance(std::get<5>(r), norm(floats), 1e-4);
+        shouldEqualTolerance(std::get<6>(r), squaredNorm(floats), 1e-4*squaredNorm(floats));
+        shouldEqualTolerance(std::get<7>(r), std::sqrt(variance), 1e-10);
+
+        auto i = reduce(ints, Sum(), Prod(), L1Norm(), LInfNorm(), All(), Any(), AllFinite());
+        shouldEqual(std::get<0>(i), ints.sum());
+        shouldEqual(std::get<2>(i), norm(ints, 1));
+        shouldEqual(std::get<3>(i), norm(ints, -1));
+        shouldEqual(std::get<4>(i), ints.all());
+        shouldEqual(std::get<5>(i), ints.any());
+        should(std::get<6>(i));
+
+        ArrayND<N, int> ones(S{3, 4, 5}, 1);
+        ones(1, 2, 3) = 2;
+        auto o = reduce(ones, Prod(), All(), Any(), Sum());
+        shouldEqual(std::get<0>(o), 2);
+        should(std::get<1>(o));
+        should(std::get<2>(o));
+        shouldEqual(std::get<3>(o), 61);
+
+        ones(2, 2, 2) = 0;
+        ArrayND<N, int> zeros(S{3, 4, 5}, 0);
+        shouldNot(std::get<0>(reduce(ones, All())));
+        shouldNot(std::get<0>(reduce(zeros, Any())));
+
+        ArrayND<N, double> nonfinite(S{3, 4, 5}, 1.0);
+        should(std::get<0>(reduce(nonfinite, AllFinite())));
+        nonfinite(1, 1, 1) = std::numeric_limits<double>::infinity();
+        shouldNot(std::get<0>(reduce(nonfinite, AllFinite())));
+        nonfinite(1, 1, 1) = std::numeric_limits<double>::quiet_NaN();
+        shouldNot(std::get<0>(reduce(nonfinite, AllFinite())));
+    }
+
+    void testStrided()
+    {
+        using namespace vigra::reducers;
+
+        ArrayViewND<N, float> sub = floats.subarray(S{3, 1, 2}, S{60, 49, 31});
+        ArrayND<N, float> copy(sub);
+        for(auto view : { sub, sub.transpose() })
+        {
+            auto r  = reduce(view, Sum(), Mean(), Variance(), Minimum(), Maximum()),
+                 rc = reduce(copy, Sum(), Mean(), Variance(), Minimum(), Maximum());
+            shouldEqualTolerance(std::get<0>(r), std::get<0>(rc), 1e-5*std::get<0>(rc));
+            shouldEqualTolerance(std::get<1>(r), std::get<1>(rc), 1e-12);
+            shouldEqualTolerance(std::get<2>(r), std::get<2>(rc), 1e-9);
+            shouldEqual(std::get<3>(r), std::get<3>(rc));
+            shouldEqual(std::get<4>(r), std::get<4>(rc));
+        }
+
+        ArrayViewND<N, int> bound = ints.subarray(S{0, 0, 5}, S{70, 50, 6});
+        shouldEqual(std::get<0>(reduce(bound, Sum())), bound.sum());
+    }
+
+    void testParallel()
+    {
+        using namespace vigra::reducers;
+
+        double mean, variance;
+        referenceStatistics(floats.view(), mean, variance);
+
+        for(auto view : { floats.view(), floats.transpose() })
+        {
+            auto serial = reduce(view, Mean(), Variance(), Minimum(), Maximum());
+            auto first  = reduce(view, ParallelOptions(4), Mean(), Variance(), Minimum(), Maximum());
+            for(int k=0; k<3; ++k)
+            {
+                // ordered combination: identical results for every run
+                auto again = reduce(view, ParallelOptions(4), Mean(), Variance(), Minimum(), Maximum());
+                should(again == first);
+            }
+            shouldEqualTolerance(std::get<0>(first), mean, 1e-12);
+            shouldEqualTolerance(std::get<1>(first), variance, 1e-10);
+            shouldEqual(std::get<2>(first), std::get<2>(serial));
+            shouldEqual(std::get<3>(first), std::get<3>(serial));
+        }
+        shouldEqual(std::get<0>(reduce(ints, ParallelOptions(3), Sum())), ints.sum());
+    }
+};
+
+struct ReduceTestSuite
+: public vigra::test_suite
+{
+    ReduceTestSuite()
+    : vigra::test_suite("ReduceTestSuite")
+    {
+        addTests<3>();
+        addTests<runtime_size>();
+    }
+
+    template <int N>
+    void addTests()
+    {
+        add( testCase(&ReduceTest<N>::testReduce));
+        add( testCase(&ReduceTest<N>::testStrided));
+        add( testCase(&ReduceTest<N>::testParallel));
+    }
+};
+
+int main(int argc, char ** argv)
+{
+    ReduceTestSuite test;
+
+    int failed = test.run(vigra::testsToBeExecuted(argc, argv));
+
+    std::cout << test.report() << std::endl;
+
+    return (failed != 0);
+}
@@ -0,0 +1,365 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014-2017 by Ullrich Koethe                  */
+/*                                                                      */
+/*    This file is part of the VIGRA2 computer vision library.          */
+/*    The VIGRA2 Website is                                             */
+/*        http://ukoethe.github.io/vigra2                               */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <vigra2/unittest.hxx>
+#include <vigra2/result_cache.hxx>
+#include <vigra2/array_nd.hxx>
+#include <vigra2/array_math.hxx>
+
+#include <dirent.h>
+#include <unistd.h>
+
+using namespace vigra;
+using namespace vigra::array_math;
+
+struct ResultCacheTest
+{
+    typedef Shape<2> S;
+
+    int computations;
+
+    ResultCacheTest()
+    : computations(0)
+    {}
+
+    ArrayND<2, float> makeArray(float offset)
+    {
+        ArrayND<2, float> a(S{ 30, 40 });
+        int k = 0;
+        for(auto & v : a)
+            v = offset + k++;
+        return a;
+    }
+
+        // stands in for an expensive filter
+    SharedArrayND<2, float> cachedFilter(ResultCache & cache, ArrayViewND<2, float> const & in,
+                                         double scale)
+    {
+        CacheKey key = CacheKey("scale").add(in).add(scale);
+        return cache.get<2, float>(key, [&]()
+        {
+            ++computations;
+            ArrayND<2, float> res(in.shape());
+            res = in * scale;
+            return res;
+        });
+    }
+
+    int fileCount(std::string const & path)
+    {
+        int res = 0;
+        if(DIR * dir = ::opendir(path.c_str()))
+        {
+            while(dirent * entry = ::readdir(dir))
+                if(entry->d_name[0] != '.')
+                    ++res;
+            ::closedir(dir);
+        }
+        return res;
+    }
+
+    void testCacheKey()
+    {
+        auto a = makeArray(0.0f);
+        ArrayND<2, float> f(a.shape(), F_ORDER);
+        f = a;
+        should(CacheKey("op").add(a) == CacheKey("op").add(f));
+        should(CacheKey("op").add(a) != CacheKey("op2").add(a));
+        should(CacheKey("op").add(a) != CacheKey("op").add(makeArray(1.0f)));
+        should(CacheKey("op").add(a) != CacheKey("op").add(ArrayND<2, double>(a)));
+        should(CacheKey("op").add(a.subarray(S{ 0, 0 }, S{ 30, 20 })) !=
+               CacheKey("op").add(a.subarray(S{ 0, 20 }, S{ 30, 40 })));
+
+        should(CacheKey("op").add(1.0) != CacheKey("op").add(1.0 + 1e-15));
+        should(CacheKey("op").add(1.5) == CacheKey("op").add(1.5f));
+        should(CacheKey("op").add(2) != CacheKey("op").add(2.0));
+        should(CacheKey("op").add("a|s1:b") != CacheKey("op").add("a").add("b"));
+        should(CacheKey("op").add(BORDER_TREATMENT_REFLECT) != CacheKey("op").add(BORDER_TREATMENT_WRAP));
+        should(CacheKey("op").add(TinyArray<double, 2>(1.0, 2.0)) !=
+               CacheKey("op").add(1.0).add(2.0));
+    }
+
+    void testMemoization()
+    {
+        auto a = makeArray(0.0f);
+        ResultCache cache(1 << 20);
+        auto r1 = cachedFilter(cache, a, 2.0);
+        auto r2 = cachedFilter(cache, a, 2.0);
+        shouldEqual(computations, 1);
+        should(r1 == a*2.0);
+        should(r2.data() == r1.data());
+        shouldEqual(cache.size(), 1u);
+        shouldEqual(cache.memoryUsage(), a.size()*sizeof(float));
+
+        cachedFilter(cache, a, 3.0);
+        cachedFilter(cache, makeArray(1.0f), 2.0);
+        shouldEqual(computations, 3);
+        shouldEqual(cache.statistics().hits, 1u);
+        shouldEqual(cache.statistics().misses, 3u);
+
+        // copy-on-write protects the cached result
+        r2 += 1.0f;
+        should(cachedFilter(cache, a, 2.0) == a*2.0);
+        shouldEqual(computations, 3);
+
+        cache.erase(CacheKey("scale").add(a).add(2.0));
+        should(!cache.contains(CacheKey("scale").add(a).add(2.0)));
+        cachedFilter(cache, a, 2.0);
+        shouldEqual(computations, 4);
+
+        cache.clear();
+        shouldEqual(cache.size(), 0u);
+        shouldEqual(cache.memoryUsage(), 0u);
+    }
+
+    void testEviction()
+    {
+        std::size_t bytes = 30*40*sizeof(float);
+        ResultCache cache(2*bytes);
+        auto a = makeArray(0.0f);
+        cachedFilter(cache, a, 1.0);
+        cachedFilter(cache, a, 2.0);
+        cachedFilter(cache, a, 1.0);   // now 2.0 is least recently used
+        cachedFilter(cache, a, 3.0);
+        shouldEqual(computations, 3);
+        shouldEqual(cache.size(), 2u);
+        should(cache.contains(CacheKey("scale").add(a).add(1.0)));
+        should(!cache.contains(CacheKey("scale").add(a).add(2.0)));
+        shouldEqual(cache.statistics().evictions, 1u);
+        shouldEqual(cache.memoryUsage(), 2*bytes);
+
+        // results exceeding the budget are not kept
+        ResultCache tiny(bytes / 2);
+        cachedFilter(tiny, a, 1.0);
+        shouldEqual(tiny.size(), 0u);
+    }
+
+    void testSpill()
+    {
+        std::size_t bytes = 30*40*sizeof(float);
+        auto a = makeArray(0.0f);
+        std::string directory;
+        {
+            ResultCache cache(2*bytes, ".", 2*bytes);
+            directory = cache.spillDirectory();
+            should(directory.find("./vigra2-cache-") == 0);
+
+            for(int k = 1; k <= 4; ++k)
+                cachedFilter(cache, a, k);
+            shouldEqual(computations, 4);
+            shouldEqual(cache.size(), 4u);
+            shouldEqual(cache.statistics().spills, 2u);
+            shouldEqual(cache.memoryUsage(), 2*bytes);
+            shouldEqual(cache.diskUsage(), 2*bytes);
+            shouldEqual(fileCount(directory), 2);
+
+            // reload a spilled result, which spills the least recently used one
+            auto r = cachedFilter(cache, a, 1.0);
+            shouldEqual(computations, 4);
+            should(r == a*1.0);
+            shouldEqual(cache.statistics().reloads, 1u);
+            shouldEqual(cache.statistics().spills, 3u);
+
+            // the disk budget is exceeded, so that the oldest file is deleted
+            shouldEqual(cache.statistics().evictions, 1u);
+            shouldEqual(cache.size(), 3u);
+            should(!cache.contains(CacheKey("scale").add(a).add(2.0)));
+            shouldEqual(fileCount(directory), 2);
+
+            // spilled arrays keep their axistags
+            ArrayND<2, float> tagged(a);
+            tagged.setAxistags(makeAxistags("yx"));
+            CacheKey key("tagged");
+            cache.insert(key, SharedArrayND<2, float>(tagged));
+            cachedFilter(cache, a, 5.0);
+            cachedFilter(cache, a, 6.0);
+            SharedArrayND<2, float> t;
+            should(cache.lookup(key, t));
+            should(t == a);
+            should(t.axistags() == tagged.axistags());
+        }
+        shouldEqual(fileCount(directory), 0);
+        should(::opendir(directory.c_str()) == 0);
+    }
+
+    void testSpillFailure()
+    {
+        std::size_t bytes = 30*40*sizeof(float);
+        auto a = makeArray(0.0f);
+        ResultCache cache(2*bytes, ".");
+        // results that can't be written are evicted
+        ::rmdir(cache.spillDirectory().c_str());
+        for(int k = 1; k <= 3; ++k)
+            cachedFilter(cache, a, k);
+        shouldEqual(cache.size(), 2u);
+        shouldEqual(cache.statistics().spills, 0u);
+        shouldEqual(cache.statistics().evictions, 1u);
+        shouldEqual(cache.memoryUsage(), 2*bytes);
+        shouldEqual(cache.diskUsage(), 0u);
+        should(!cache.contains(CacheKey("scale").add(a).add(1.0)));
+    }
+
+    void testDamagedSpillFile()
+    {
+        std::size_t bytes = 30*40*sizeof(float);
+        auto a = makeArray(0.0f);
+        ResultCache cache(bytes, ".");
+        std::string directory = cache.spillDirectory();
+        cachedFilter(cache, a, 1.0);
+        cachedFilter(cache, a, 2.0);
+        shouldEqual(cache.statistics().spills, 1u);
+
+        // a deleted file is treated like a missing result
+        ::unlink((directory + "/0.v2a").c_str());
+        auto r = cachedFilter(cache, a, 1.0);
+        should(r == a*1.0);
+        shouldEqual(computations, 3);
+        shouldEqual(cache.statistics().misses, 3u);
+        shouldEqual(cache.statistics().reloads, 0u);
+        shouldEqual(cache.size(), 2u);
+        should(cache.contains(CacheKey("scale").add(a).add(1.0)));
+
+        // likewise a truncated file
+        shouldEqual(::truncate((directory + "/1.v2a").c_str(), 10), 0);
+        r = cachedFilter(cache, a, 2.0);
+        should(r == a*2.0);
+        shouldEqual(computations, 4);
+        r = cachedFilter(cache, a, 2.0);
+        shouldEqual(computations, 4);
+        shouldEqual(cache.statistics().hits, 1u);
+        shouldEqual(cache.size(), 2u);
+        shouldEqual(cache.diskUsage(), bytes);
+        shouldEqual(fileCount(directory), 1);
+    }
+
+    void testConcurrentSpill()
+    {
+        std::size_t bytes = 30*40*sizeof(float);
+        auto a = makeArray(0.0f);
+        ResultCache cache(3*bytes, ".", 6*bytes);
+        std::vector<std::thread> threads;
+        std::vector<int> failures(4, 0);
+        for(int t = 0; t < 4; ++t)
+        {
+            threads.emplace_back([&, t]()
+            {
+                for(int k = 0; k < 50; ++k)
+                {
+                    double scale = (k * 7 + t) % 10;
+                    CacheKey key = CacheKey("scale").add(a).add(scale);
+                    auto r = cache.get<2, float>(key, [&]()
+                    {
+                        ArrayND<2, float> res(a.shape());
+                        res = a * scale;
+                        return res;
+                    });
+                    if(!(r == a * scale))
+                        ++failures[t];
+                }
+            });
+        }
+        for(auto & t : threads)
+            t.join();
+        should(failures == std::vector<int>(4, 0));
+        should(cache.memoryUsage() <= 3*bytes);
+        should(cache.diskUsage() <= 6*bytes);
+        shouldEqual(fileCount(cache.spillDirectory()), (int)(cache.diskUsage() / bytes));
+    }
+
+    void testErrors()
+    {
+        ResultCache cache(1 << 20);
+        auto a = makeArray(0.0f);
+        cachedFilter(cache, a, 1.0);
+        try
+        {
+            SharedArrayND<2, double> r;
+            cache.lookup(CacheKey("scale").add(a).add(1.0), r);
+            failTest("no exception thrown");
+        }
+        catch(ContractViolation & e)
+        {
+            std::string message(e.what());
+            should(message.find("ResultCache::lookup(): element type or dimension mismatch") != std::string::npos);
+        }
+
+        try
+        {
+            ResultCache c(1 << 20, "/nonexistent/directory");
+            failTest("no exception thrown");
+        }
+        catch(std::exception & e)
+        {
+            std::string message(e.what());
+            should(message.find("ResultCache(): unable to create a directory in '/nonexistent/directory'.") != std::string::npos);
+        }
+    }
+};
+
+struct ResultCacheTestSuite
+: public vigra::test_suite
+{
+    ResultCacheTestSuite()
+    : vigra::test_suite("ResultCacheTestSuite")
+    {
+        add( testCase(&ResultCacheTest::testCacheKey));
+        add( testCase(&ResultCacheTest::testMemoization));
+        add( testCase(&ResultCacheTest::testEviction));
+        add( testCase(&ResultCacheTest::testSpill));
+        add( testCase(&ResultCacheTest::testSpillFailure));
+        add( testCase(&ResultCacheTest::testDamagedSpillFile));
+        add( testCase(&ResultCacheTest::testConcurrentSpill));
+        add( testCase(&ResultCacheTest::testErrors));
+    }
+};
+
+int main(int argc, char ** argv)
+{
+    ResultCacheTestSuite test;
+
+    int failed = test.run(vigra::testsToBeExecuted(argc, argv));
+
+    std::cout << test.report() << std::endl;
+
+    return (failed != 0);
+}
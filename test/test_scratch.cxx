@@ -0,0 +1,198 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014-2017 by Ullrich Koethe                  */
+/*                                                                      */
+/*    This file is part of the VIGRA2 computer vision library.          */
+/*    The VIGRA2 Website is                                             */
+/*        http://ukoethe.github.io/vigra2                               */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <vigra2/unittest.hxx>
+#include <vigra2/scratch.hxx>
+#include <vigra2/array_nd.hxx>
+#include <vigra2/array_math.hxx>
+
+using namespace vigra;
+
+struct ScratchTest
+{
+    void testArena()
+    {
+        ScratchArena arena;
+        shouldEqual(arena.capacity(), 0u);
+        shouldEqual(arena.used(), 0u);
+
+        auto start = arena.mark();
+        char * p1 = static_cast<char *>(arena.allocate(100));
+        char * p2 = static_cast<char *>(arena.allocate(10, 16));
+        should(reinterpret_cast<std::uintptr_t>(p1) % ScratchArena::default_alignment == 0);
+        should(reinterpret_cast<std::uintptr_t>(p2) % 16 == 0);
+        should(p2 >= p1 + 100);
+        shouldEqual(arena.capacity(), ScratchArena::min_block_size + 0);
+
+        // only the most recent allocation can be released individually
+        auto used = arena.used();
+        arena.deallocate(p1, 100);
+        shouldEqual(arena.used(), used);
+        arena.deallocate(p2, 10);
+        should(arena.used() < used);
+
+        // rewinding keeps the memory for reuse
+        arena.rewind(start);
+        shouldEqual(arena.used(), 0u);
+        char * p3 = static_cast<char *>(arena.allocate(100));
+        should(p3 == p1);
+
+        // big requests get a new block, which is reused after rewinding
+        auto middle = arena.mark();
+        char * big = static_cast<char *>(arena.allocate(3*ScratchArena::min_block_size));
+        should(arena.capacity() > 3*ScratchArena::min_block_size);
+        arena.rewind(middle);
+        auto capacity = arena.capacity();
+        char * big2 = static_cast<char *>(arena.allocate(2*ScratchArena::min_block_size));
+        should(big2 == big);
+        shouldEqual(arena.capacity(), capacity);
+
+        arena.rewind(start);
+        arena.trim();
+        shouldEqual(arena.capacity(), 0u);
+
+        // blocks above the retained capacity are released when the arena becomes empty
+        arena.setRetainedCapacity(2*ScratchArena::min_block_size);
+        arena.allocate(100);
+        auto second = arena.mark();
+        auto firstUsed = arena.used();
+        arena.allocate(ScratchArena::min_block_size);
+        arena.allocate(4*ScratchArena::min_block_size);
+        should(arena.capacity() > 4*ScratchArena::min_block_size);
+        arena.rewind(second);
+        should(arena.capacity() > 4*ScratchArena::min_block_size);
+        {
+            ScratchScope outer(arena);
+            ScratchScope inner(arena);
+            arena.allocate(8*ScratchArena::min_block_size);
+        }
+        shouldEqual(arena.used(), firstUsed);
+        should(arena.capacity() > 8*ScratchArena::min_block_size);
+        arena.rewind(start);
+        shouldEqual(arena.capacity(), ScratchArena::min_block_size + 0);
+        arena.setRetainedCapacity(0);
+        shouldEqual(arena.capacity(), 0u);
+
+        try
+        {
+            arena.allocate(10, 3);
+            failTest("no exception thrown");
+        }
+        catch(ContractViolation & c)
+        {
+            std::string expected("\nPrecondition violation!\nScratchArena::allocate(): alignment must be a power of two.");
+            std::string message(c.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+    }
+
+    void testScope()
+    {
+        ScratchArena & arena = ScratchArena::local();
+        auto used = arena.used();
+        {
+            ScratchScope scope;
+            std::vector<int, ScratchAllocator<int>> v(1000, 1);
+            should(arena.used() >= used + 1000*sizeof(int));
+            {
+                ScratchScope inner;
+                ArrayND<2, double, ScratchAllocator<double>> a(Shape<2>{ 30, 40 }, 2.0);
+                shouldEqual(a.sum(), 2400.0);
+            }
+            shouldEqual(v[999], 1);
+        }
+        shouldEqual(arena.used(), used);
+
+        // every thread has its own arena
+        ScratchArena * other = 0;
+        std::thread t([&other]() { other = &ScratchArena::local(); });
+        t.join();
+        should(other != &arena);
+        should(ScratchAllocator<int>() == ScratchAllocator<float>());
+        should(ScratchAllocator<int>() != ScratchAllocator<int>(*other));
+    }
+
+    void testOverlapTemporary()
+    {
+        using namespace array_math;
+
+        // assignment with hopelessly overlapping memory uses a scratch temporary
+        ScratchArena & arena = ScratchArena::local();
+        auto used = arena.used();
+        ArrayND<2, int> a(Shape<2>{ 5, 5 });
+        for(int k=0; k<25; ++k)
+            a.data()[k] = k;
+        ArrayND<2, int> expected(transpose(a));
+        a = a.transpose();
+        should(a == expected);
+        a += a.transpose() + 1;
+        for(int i=0; i<5; ++i)
+            for(int j=0; j<5; ++j)
+                shouldEqual((a[Shape<2>{ i, j }]), (expected[Shape<2>{ i, j }] + expected[Shape<2>{ j, i }] + 1));
+        shouldEqual(arena.used(), used);
+    }
+};
+
+struct ScratchTestSuite
+: public vigra::test_suite
+{
+    ScratchTestSuite()
+    : vigra::test_suite("ScratchTestSuite")
+    {
+        add( testCase(&ScratchTest::testArena));
+        add( testCase(&ScratchTest::testScope));
+        add( testCase(&ScratchTest::testOverlapTemporary));
+    }
+};
+
+int main(int argc, char ** argv)
+{
+    ScratchTestSuite test;
+
+    int failed = test.run(vigra::testsToBeExecuted(argc, argv));
+
+    std::cout << test.report() << std::endl;
+
+    return (failed != 0);
+}
@@ -0,0 +1,271 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014-2017 by Ullrich Koethe                  */
+/*                                                                      */
+/*    This file is part of the VIGRA2 computer vision library.          */
+/*    The VIGRA2 Website is                                             */
+/*        http://ukoethe.github.io/vigra2                               */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vigra2/unittest.hxx>
+#include <vigra2/shared_array_nd.hxx>
+#include <vigra2/array_math.hxx>
+
+using namespace vigra;
+using namespace vigra::array_math;
+
+struct SharedArrayNDTest
+{
+    typedef SharedArrayND<2, int> A;
+    typedef Shape<2> S;
+
+    void testConstruction()
+    {
+        A empty;
+        should(!empty.hasData());
+        shouldEqual(empty.useCount(), 0);
+        should(empty.isUnique());
+
+        A a(S{ 3, 4 }, 1);
+        shouldEqual(a.shape(), (S{ 3, 4 }));
+        shouldEqual(a.useCount(), 1);
+        should(a.isConsecutive());
+        should(a.all());
+
+        ArrayND<2, int> b(S{ 3, 4 });
+        for(int k=0; k<b.size(); ++k)
+            b.data()[k] = k;
+        int const * p = b.data();
+
+        // adopting an rvalue ArrayND doesn't copy
+        A c(std::move(b));
+        shouldEqual(c.data(), p);
+        shouldEqual((c[S{ 2, 3 }]), 11);
+
+        // construction from a view copies
+        A d(c.transpose());
+        should(d.data() != c.data());
+        shouldEqual(d.shape(), (S{ 4, 3 }));
+        shouldEqual((d[S{ 3, 2 }]), 11);
+
+        A e(c + 1);
+        shouldEqual((e[S{ 2, 3 }]), 12);
+
+        // wrap external memory
+        std::shared_ptr<int> mem(new int[12](), std::default_delete<int[]>());
+        {
+            A f(ArrayViewND<2, int>(S{ 3, 4 }, mem.get()), mem);
+            shouldEqual(mem.use_count(), 2);
+            shouldEqual(f.useCount(), 2);
+            f = 5;  // 'mem' is another owner => copy-on-write
+            shouldEqual(mem.get()[11], 0);
+            shouldEqual((f[S{ 2, 3 }]), 5);
+            shouldEqual(mem.use_count(), 1);
+        }
+        shouldEqual(mem.use_count(), 1);
+
+        try
+        {
+            A g(ArrayViewND<2, int>(S{ 3, 4 }, mem.get()), std::shared_ptr<void>());
+            failTest("no exception thrown");
+        }
+        catch(std::exception & e)
+        {
+            std::string expected("\nPrecondition violation!\nSharedArrayND(view, owner): owner must not be empty.");
+            std::string message(e.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+    }
+
+    void testSharing()
+    {
+        A a(S{ 3, 4 }, 1);
+        int const * p = a.data();
+        {
+            A b = a;
+            shouldEqual(b.data(), p);
+            shouldEqual(a.useCount(), 2);
+            should(!a.isUnique());
+
+            A c;
+            c = b;
+            shouldEqual(c.data(), p);
+            shouldEqual(a.useCount(), 3);
+
+            A d(std::move(c));
+            shouldEqual(d.data(), p);
+            should(!c.hasData());
+            shouldEqual(a.useCount(), 3);
+        }
+        shouldEqual(a.useCount(), 1);
+
+        // shared views keep the buffer alive
+        SharedArrayND<2, int> t;
+        SharedArrayND<1, int> row;
+        {
+            A b(S{ 3, 4 });
+            for(int k=0; k<b.size(); ++k)
+                b.data()[k] = k;
+            t = b.share(b.transpose());
+            row = b.share(b.bind(0, 1));
+            shouldEqual(b.useCount(), 3);
+        }
+        shouldEqual(t.useCount(), 2);
+        shouldEqual(t.shape(), (S{ 4, 3 }));
+        shouldEqual((t[S{ 3, 2 }]), 11);
+        shouldEqual(row.shape(), (Shape<1>{ 4 }));
+        shouldEqual(row[2], 6);
+
+        SharedArrayND<2, int> sub = t.share(t.subarray(S{ 1, 1 }, S{ 3, 3 }));
+        shouldEqual((sub[S{ 0, 0 }]), 5);
+        shouldEqual(t.useCount(), 3);
+
+        try
+        {
+            a.share(t.view());
+            failTest("no exception thrown");
+        }
+        catch(std::exception & e)
+        {
+            std::string expected("\nPrecondition violation!\nSharedArrayND::share(): view must refer to the array's buffer.");
+            std::string message(e.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+    }
+
+    void testCopyOnWrite()
+    {
+        A a(S{ 3, 4 });
+        for(int k=0; k<a.size(); ++k)
+            a.data()[k] = k;
+        int const * p = a.data();
+
+        A b = a;
+        SharedArrayND<2, int> t = a.share(a.transpose());
+
+        b += 1;
+        should(b.data() != p);
+        shouldEqual(a.data(), p);
+        shouldEqual((a[S{ 2, 3 }]), 11);
+        shouldEqual((b[S{ 2, 3 }]), 12);
+        shouldEqual(a.useCount(), 2);
+        should(b.isUnique());
+
+        // unique arrays are modified in place
+        int const * q = b.data();
+        b *= 2;
+        shouldEqual(b.data(), q);
+        shouldEqual((b[S{ 2, 3 }]), 24);
+
+        // copy-on-write of a strided view creates a consecutive copy
+        t = a.transpose() + b.transpose();
+        should(t.isUnique());
+        should(t.isConsecutive());
+        shouldEqual(t.shape(), (S{ 4, 3 }));
+        shouldEqual((t[S{ 3, 2 }]), 35);
+        shouldEqual((a[S{ 2, 3 }]), 11);
+
+        // explicit copy-on-write for element access
+        A c = a;
+        c.makeUnique()[S{ 0, 0 }] = 42;
+        shouldEqual((a[S{ 0, 0 }]), 0);
+        shouldEqual((c[S{ 0, 0 }]), 42);
+        q = c.data();
+        c.makeUnique();
+        shouldEqual(c.data(), q);
+
+        // assignment to an empty array allocates
+        A d;
+        d = a + 1;
+        shouldEqual((d[S{ 2, 3 }]), 12);
+        A e;
+        e = a.transpose();
+        shouldEqual((e[S{ 3, 2 }]), 11);
+    }
+
+    void testAlgorithms()
+    {
+        A a(S{ 3, 4 });
+        for(int k=0; k<a.size(); ++k)
+            a.data()[k] = k;
+
+        // SharedArrayND is an ArrayViewND
+        ArrayViewND<2, int> const & v = a;
+        shouldEqual(v.sum(), 66);
+        shouldEqual(a.sum(), 66);
+        shouldEqual((a.minimum(tags::axes = {0})[S{ 0, 3 }]), 3);
+
+        ArrayND<2, int> c(a * 2);
+        shouldEqual((c[S{ 2, 3 }]), 22);
+
+        // hand the array over to another thread
+        A b = a;
+        int sum = 0;
+        std::thread worker([b, &sum]() mutable
+        {
+            b += 1;
+            sum = b.sum();
+        });
+        worker.join();
+        shouldEqual(sum, 78);
+        shouldEqual(a.sum(), 66);
+    }
+};
+
+struct SharedArrayNDTestSuite
+: public vigra::test_suite
+{
+    SharedArrayNDTestSuite()
+    : vigra::test_suite("SharedArrayNDTestSuite")
+    {
+        add( testCase(&SharedArrayNDTest::testConstruction));
+        add( testCase(&SharedArrayNDTest::testSharing));
+        add( testCase(&SharedArrayNDTest::testCopyOnWrite));
+        add( testCase(&SharedArrayNDTest::testAlgorithms));
+    }
+};
+
+int main(int argc, char ** argv)
+{
+    SharedArrayNDTestSuite test;
+
+    int failed = test.run(vigra::testsToBeExecuted(argc, argv));
+
+    std::cout << test.report() << std::endl;
+
+    return (failed != 0);
+}
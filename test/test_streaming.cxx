@@ -0,0 +1,255 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014-2017 by Ullrich Koethe                  */
+/*                                                                      */
+/*    This file is part of the VIGRA2 computer vision library.          */
+/*    The VIGRA2 Website is                                             */
+/*        http://ukoethe.github.io/vigra2                               */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+
+#include <atomic>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vigra2/unittest.hxx>
+#include <vigra2/streaming.hxx>
+#include <vigra2/array_nd.hxx>
+#include <vigra2/array_math.hxx>
+
+#include <dirent.h>
+#include <unistd.h>
+
+using namespace vigra;
+
+struct StreamingTest
+{
+    typedef Shape<3> S;
+
+    ArrayND<3, int> makeArray(S const & shape)
+    {
+        ArrayND<3, int> a(shape);
+        int k = 0;
+        for(auto & v : a)
+            v = k++;
+        return a;
+    }
+
+    void checkReader(ArrayND<3, int> const & a, int axis, ArrayIndex slabSize, ArrayIndex halo,
+                     StreamingOptions const & options)
+    {
+        SlabReader<3, int> reader(a, axis, slabSize, halo, options);
+        ArrayIndex count = 0;
+        while(reader.next())
+        {
+            shouldEqual(reader.index(), count);
+            Box<3> core = reader.coreBox(), box = reader.box();
+            shouldEqual(core.lower()[axis], count*slabSize);
+            should((box.lower()[axis] == std::max<ArrayIndex>(0, count*slabSize - halo)));
+            shouldEqual(reader.haloBefore(), core.lower()[axis] - box.lower()[axis]);
+            shouldEqual(reader.haloAfter(), box.upper()[axis] - core.upper()[axis]);
+            should(reader.slab() == a.subarray(box.lower(), box.upper()));
+            should(reader.core() == a.subarray(core.lower(), core.upper()));
+            ++count;
+        }
+        shouldEqual(count, reader.slabCount());
+        shouldEqual(count, (a.shape(axis) + slabSize - 1) / slabSize);
+        should(!reader.next());
+    }
+
+    void testReader()
+    {
+        auto a = makeArray(S{ 23, 17, 31 });
+        checkReader(a, 0, 5, 0, StreamingOptions());
+        checkReader(a, 0, 5, 2, StreamingOptions());
+        checkReader(a, 1, 4, 3, StreamingOptions().buffers(2));
+        checkReader(a, 2, 7, 1, StreamingOptions().buffers(4).threads(3));
+        checkReader(a, 2, 40, 5, StreamingOptions().buffers(1));
+
+        // slabs are consecutive in memory
+        SlabReader<3, int> reader(a, 2, 4, 1);
+        reader.next();
+        should(reader.slab().isConsecutive());
+    }
+
+    void testEarlyExit()
+    {
+        auto a = makeArray(S{ 40, 5, 5 });
+        std::atomic<int> reads(0);
+        {
+            SlabReader<3, int> reader(a.shape(),
+                [&a, &reads](Box<3> const & box, ArrayViewND<3, int> dest)
+                {
+                    ++reads;
+                    dest = a.subarray(box.lower(), box.upper());
+                },
+                0, 2, 0, StreamingOptions().buffers(3).threads(2));
+            reader.next();
+            should(reader.core() == a.subarray(S{ 0, 0, 0 }, S{ 2, 5, 5 }));
+        }
+        // read-ahead is bounded by the number of buffers
+        should(reads.load() <= 3);
+    }
+
+    void testWriter()
+    {
+        auto a = makeArray(S{ 23, 17, 31 });
+        for(int threads = 1; threads <= 3; ++threads)
+        {
+            ArrayND<3, int> b(a.shape());
+            SlabReader<3, int> reader(a, 1, 4, 2);
+            SlabWriter<3, int> writer(b, 1, 4, StreamingOptions().threads(threads));
+            shouldEqual(writer.slabCount(), reader.slabCount());
+            while(reader.next() && writer.next())
+            {
+                should(writer.box() == reader.coreBox());
+                writer.slab() = reader.core();
+            }
+            should(!writer.next());
+            writer.finish();
+            should(b == a);
+        }
+    }
+
+    void testChunkStore()
+    {
+        std::string path("test_streaming.tmp");
+        auto a = makeArray(S{ 20, 18, 16 });
+        {
+            ChunkStore<3, int> store(path, a.shape(), S{ 4, 8, 8 });
+            SlabWriter<3, int> writer(store, 0, 4, StreamingOptions().threads(2));
+            for(int k = 0; writer.next(); ++k)
+                writer.slab() = a.subarray(writer.box().lower(), writer.box().upper());
+            writer.finish();
+        }
+        {
+            ChunkStore<3, int> store(path);
+            should(store.read() == a);
+
+            SlabReader<3, int> reader(store, 0, 8, 2, StreamingOptions().threads(2));
+            while(reader.next())
+                should(reader.slab() == a.subarray(reader.box().lower(), reader.box().upper()));
+        }
+
+        if(DIR * dir = ::opendir(path.c_str()))
+        {
+            while(dirent * entry = ::readdir(dir))
+                ::unlink((path + "/" + entry->d_name).c_str());
+            ::closedir(dir);
+        }
+        ::rmdir(path.c_str());
+    }
+
+    void testErrors()
+    {
+        auto source = [](Box<3> const & box, ArrayViewND<3, int> dest)
+        {
+            if(box.lower()[0] >= 4)
+                throw std::runtime_error("source failed");
+            dest.init(1);
+        };
+        SlabReader<3, int> reader(S{ 10, 3, 3 }, source, 0, 4);
+        should(reader.next());
+        try
+        {
+            reader.next();
+            failTest("no exception thrown");
+        }
+        catch(std::runtime_error & e)
+        {
+            shouldEqual(std::string(e.what()), "source failed");
+        }
+
+        auto sink = [](Box<3> const & box, ArrayViewND<3, int> const &)
+        {
+            if(box.lower()[0] == 4)
+                throw std::runtime_error("sink failed");
+        };
+        {
+            SlabWriter<3, int> writer(S{ 10, 3, 3 }, sink, 0, 4);
+            while(writer.next())
+                writer.slab().init(0);
+            try
+            {
+                writer.finish();
+                failTest("no exception thrown");
+            }
+            catch(std::runtime_error & e)
+            {
+                shouldEqual(std::string(e.what()), "sink failed");
+            }
+        }
+        {
+            // the destructor swallows errors
+            SlabWriter<3, int> writer(S{ 10, 3, 3 }, sink, 0, 4);
+            while(writer.next())
+                writer.slab().init(0);
+        }
+
+        try
+        {
+            SlabReader<3, int> r(S{ 10, 3, 3 }, source, 3, 4);
+            failTest("no exception thrown");
+        }
+        catch(ContractViolation & e)
+        {
+            std::string expected("\nPrecondition violation!\nSlabReader(): axis out of range.");
+            std::string message(e.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+    }
+};
+
+struct StreamingTestSuite
+: public vigra::test_suite
+{
+    StreamingTestSuite()
+    : vigra::test_suite("StreamingTestSuite")
+    {
+        add( testCase(&StreamingTest::testReader));
+        add( testCase(&StreamingTest::testEarlyExit));
+        add( testCase(&StreamingTest::testWriter));
+        add( testCase(&StreamingTest::testChunkStore));
+        add( testCase(&StreamingTest::testErrors));
+    }
+};
+
+int main(int argc, char ** argv)
+{
+    StreamingTestSuite test;
+
+    int failed = test.run(vigra::testsToBeExecuted(argc, argv));
+
+    std::cout << test.report() << std::endl;
+
+    return (failed != 0);
+}
@@ -0,0 +1,289 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014-2017 by Ullrich Koethe                  */
+/*                                                                      */
+/*    This file is part of the VIGRA2 computer vision library.          */
+/*    The VIGRA2 Website is                                             */
+/*        http://ukoethe.github.io/vigra2                               */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vigra2/unittest.hxx>
+#include <vigra2/tiff.hxx>
+#include <vigra2/array_nd.hxx>
+#include <vigra2/array_math.hxx>
+
+using namespace vigra;
+
+struct TiffTest
+{
+    typedef Shape<3> S;
+
+    std::string filename;
+
+    TiffTest()
+    : filename("test_tiff.tmp.tif")
+    {}
+
+    ~TiffTest()
+    {
+        std::remove(filename.c_str());
+    }
+
+    template <class T>
+    ArrayND<3, T> makeArray(S const & shape)
+    {
+        ArrayND<3, T> a(shape);
+        int k = 0;
+        for(auto & v : a)
+            v = T(k++ % 1000);
+        return a;
+    }
+
+    template <class T>
+    void checkRoundTrip(ArrayViewND<3, T> const & a, TiffWriteOptions const & options)
+    {
+        writeTiff(filename, a, options);
+        TiffFile tiff(filename);
+        should(tiff.shape() == a.shape());
+        shouldEqual(tiff.pageCount(), a.shape(0));
+        should(tiff.page(0).hasElementType<T>());
+
+        ArrayND<3, T> r = tiff.read<T>();
+        should(r == a);
+        should(r.axistags() == makeAxistags("zyx"));
+
+        Box<3> box(S{ 1, 3, 5 }, a.shape() - S{ 0, 2, 3 });
+        should(tiff.read<T>(box) == a.subarray(box.lower(), box.upper()));
+
+        // read into a strided destination
+        ArrayND<3, T> t(box.shape().transpose(S{ 2, 1, 0 }));
+        tiff.read(box, t.transpose(S{ 2, 1, 0 }), ParallelOptions(2));
+        should(t.transpose(S{ 2, 1, 0 }) == a.subarray(box.lower(), box.upper()));
+    }
+
+    void testStrips()
+    {
+        auto a = makeArray<std::uint16_t>(S{ 4, 37, 53 });
+        checkRoundTrip<std::uint16_t>(a, TiffWriteOptions());
+        TiffFile tiff(filename);
+        should(!tiff.isBigTiff());
+        should(!tiff.page(0).tiled);
+        shouldEqual(tiff.page(0).offsets.size(), 1u);
+
+        checkRoundTrip<std::uint16_t>(a, TiffWriteOptions().rowsPerStrip(5));
+        shouldEqual(TiffFile(filename).page(3).offsets.size(), 8u);
+        shouldEqual(TiffFile(filename).page(3).tileHeight, 5);
+
+        // non-consecutive source
+        checkRoundTrip<std::uint16_t>(a.transpose(S{ 0, 2, 1 }), TiffWriteOptions().rowsPerStrip(7));
+
+        checkRoundTrip<std::uint8_t>(makeArray<std::uint8_t>(S{ 2, 10, 11 }), TiffWriteOptions());
+        auto b = makeArray<std::int16_t>(S{ 2, 10, 11 });
+        for(auto & v : b)
+            v -= 500;
+        checkRoundTrip<std::int16_t>(b, TiffWriteOptions());
+    }
+
+    void testTiles()
+    {
+        auto a = makeArray<float>(S{ 3, 40, 70 });
+        checkRoundTrip<float>(a, TiffWriteOptions().tileSize(16));
+        TiffFile tiff(filename);
+        should(tiff.page(0).tiled);
+        shouldEqual(tiff.page(0).tileWidth, 16);
+        shouldEqual(tiff.page(0).offsets.size(), 3u*5u);
+
+        checkRoundTrip<float>(a, TiffWriteOptions().tileSize(32).bigTiff());
+        should(TiffFile(filename).isBigTiff());
+        checkRoundTrip<float>(a, TiffWriteOptions().bigTiff());
+
+        ArrayND<3, TinyArray<std::uint8_t, 3>> rgb(S{ 2, 20, 30 });
+        int k = 0;
+        for(auto & v : rgb)
+            v = TinyArray<std::uint8_t, 3>(k % 256, (k + 1) % 256, (k * 7) % 256), ++k;
+        checkRoundTrip<TinyArray<std::uint8_t, 3>>(rgb, TiffWriteOptions().tileSize(16));
+        shouldEqual(TiffFile(filename).page(0).samplesPerPixel, 3);
+    }
+
+    void writeBytes(std::string const & data)
+    {
+        std::ofstream f(filename.c_str(), std::ios::binary);
+        f.write(data.data(), data.size());
+    }
+
+        // big-endian classic TIFF with two 3x4 uint16 pages in strips of two rows
+    std::string bigEndianTiff()
+    {
+        auto be = [](std::string & s, std::uint64_t v, int bytes)
+        {
+            for(int k = bytes-1; k >= 0; --k)
+                s += char((v >> (8*k)) & 0xff);
+        };
+        std::string res("MM");
+        be(res, 42, 2);
+        be(res, 8, 4);
+        std::uint64_t ifdSize = 2 + 8*12 + 4;
+        for(int p = 0; p < 2; ++p)
+        {
+            std::uint64_t ifd = res.size(),
+                          arrays = ifd + ifdSize,
+                          data = arrays + 16;
+            auto entry = [&](int tag, int type, int count, std::uint64_t value)
+            {
+                be(res, tag, 2);
+                be(res, type, 2);
+                be(res, count, 4);
+                if(type == 3 && count == 1)
+                {
+                    be(res, value, 2);
+                    be(res, 0, 2);
+                }
+                else
+                    be(res, value, 4);
+            };
+            be(res, 8, 2);
+            entry(256, 4, 1, 4);         // width
+            entry(257, 4, 1, 3);         // height
+            entry(258, 3, 1, 16);        // bits per sample
+            entry(259, 3, 1, 1);         // compression
+            entry(273, 4, 2, arrays);    // strip offsets
+            entry(278, 3, 1, 2);         // rows per strip
+            entry(279, 4, 2, arrays+8);  // strip byte counts
+            entry(339, 3, 1, 1);         // sample format
+            be(res, p == 0 ? data + 24 : 0, 4);
+            be(res, data, 4);
+            be(res, data + 16, 4);
+            be(res, 16, 4);
+            be(res, 8, 4);
+            for(int k = 0; k < 12; ++k)
+                be(res, 1000*p + 256*k + k, 2);
+        }
+        return res;
+    }
+
+    void testForeignByteOrder()
+    {
+        writeBytes(bigEndianTiff());
+        TiffFile tiff(filename);
+        should(tiff.isBigEndian());
+        should((tiff.shape() == S{ 2, 3, 4 }));
+        shouldEqual(tiff.page(1).offsets.size(), 2u);
+        shouldEqual(tiff.page(1).tileHeight, 2);
+
+        ArrayND<3, std::uint16_t> a = tiff.read<std::uint16_t>();
+        for(int p = 0; p < 2; ++p)
+            for(int k = 0; k < 12; ++k)
+                shouldEqual(a(p, k / 4, k % 4), 1000*p + 256*k + k);
+
+        Box<3> box(S{ 1, 1, 1 }, S{ 2, 3, 3 });
+        should(tiff.read<std::uint16_t>(box) == a.subarray(box.lower(), box.upper()));
+    }
+
+    template <class FCT>
+    void checkFailure(FCT f, std::string const & expected)
+    {
+        try
+        {
+            f();
+            failTest("no exception thrown");
+        }
+        catch(std::exception & e)
+        {
+            std::string message(e.what());
+            shouldMsg(message.find(expected) != std::string::npos, message.c_str());
+        }
+    }
+
+    void testErrors()
+    {
+        writeBytes("P5\n4 3\n255\n000000000000");
+        checkFailure([this]() { TiffFile t(filename); }, "TiffFile(): not a TIFF file.");
+
+        std::string tiff = bigEndianTiff();
+        writeTiff(filename, makeArray<float>(S{ 2, 5, 6 }));
+        checkFailure([this]() { TiffFile(filename).read<std::uint16_t>(); },
+                     "TiffFile::read(): element type mismatch.");
+        checkFailure([this]() { TiffFile(filename).read<float>(Box<3>(S{ 0, 0, 0 }, S{ 3, 5, 6 })); },
+                     "TiffFile::read(): region outside of the volume.");
+
+        // set compression of the second page to LZW
+        std::string compressed = tiff;
+        compressed[150 + 2 + 3*12 + 9] = 5;
+        writeBytes(compressed);
+        checkFailure([this]() { TiffFile(filename).read<std::uint16_t>(); },
+                     "TiffFile::read(): compressed pages are not supported (compression = 5).");
+        should(TiffFile(filename).read<std::uint16_t>(Box<3>(S{ 0, 0, 0 }, S{ 1, 3, 4 })).size() == 12);
+
+        writeBytes(tiff.substr(0, tiff.size() - 4));
+        checkFailure([this]() { TiffFile(filename).read<std::uint16_t>(); },
+                     "TiffFile::read(): file is truncated.");
+
+        writeBytes(tiff.substr(0, 60));
+        checkFailure([this]() { TiffFile t(filename); }, "TiffFile(): file is truncated.");
+
+        // IFD pointing to itself
+        std::string loop = tiff;
+        loop[150 + 2 + 8*12 + 3] = 8;
+        writeBytes(loop);
+        checkFailure([this]() { TiffFile t(filename); }, "TiffFile(): corrupt image file directory.");
+    }
+};
+
+struct TiffTestSuite
+: public vigra::test_suite
+{
+    TiffTestSuite()
+    : vigra::test_suite("TiffTestSuite")
+    {
+        add( testCase(&TiffTest::testStrips));
+        add( testCase(&TiffTest::testTiles));
+        add( testCase(&TiffTest::testForeignByteOrder));
+        add( testCase(&TiffTest::testErrors));
+    }
+};
+
+int main(int argc, char ** argv)
+{
+    TiffTestSuite test;
+
+    int failed = test.run(vigra::testsToBeExecuted(argc, argv));
+
+    std::cout << test.report() << std::endl;
+
+    return (failed != 0);
+}
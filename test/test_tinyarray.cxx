@@ -629,6 +629,36 @@ struct TinyArrayTest
         a = a.insert(3, 4);
         shouldEqual(a, (A{ 1,2,3,4 }));
 
+        // small arrays use the internal buffer, big ones the heap
+        A small{ 1,2,3 }, big = A::range(0, 20), small2(small), big2(big);
+        shouldEqual(small2, small);
+        shouldEqual(big2, big);
+        should(small2.data() != small.data());
+        should(big2.data() != big.data());
+        swap(small2, big2);
+        shouldEqual(small2, big);
+        shouldEqual(big2, small);
+        swap(small2, big2);
+        shouldEqual(small2, small);
+        shouldEqual(big2, big);
+        A other{ 4,5,6,7,8,9,10,11 };
+        small2.swap(other);
+        shouldEqual(small2, (A{ 4,5,6,7,8,9,10,11 }));
+        shouldEqual(other, small);
+        A big3 = A::range(20, 40);
+        big2.swap(big3);
+        shouldEqual(big2, A::range(20, 40));
+        shouldEqual(big3, big);
+        A moved_small(std::move(other)), moved_big(std::move(big3));
+        shouldEqual(moved_small, small);
+        shouldEqual(moved_big, big);
+        shouldEqual(other.size(), 0);
+        shouldEqual(big3.size(), 0);
+        moved_small = big;
+        shouldEqual(moved_small, big);
+        moved_big = A{ 1,2,3 };
+        shouldEqual(moved_big, small);
+
         A r = A::range(2,6);
         shouldEqual(r, (A{2,3,4,5}));
         shouldEqual(r.subarray(1, 3).size(), 2);
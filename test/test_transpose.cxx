@@ -0,0 +1,234 @@
+/************************************************************************/
+/*                                                                      */
+/*               Copyright 2014-2017 by Ullrich Koethe                  */
+/*                                                                      */
+/*    This file is part of the VIGRA2 computer vision library.          */
+/*    The VIGRA2 Website is                                             */
+/*        http://ukoethe.github.io/vigra2                               */
+/*    Please direct questions, bug reports, and contributions to        */
+/*        ullrich.koethe@iwr.uni-heidelberg.de    or                    */
+/*        vigra@informatik.uni-hamburg.de                               */
+/*                                                                      */
+/*    Permission is hereby granted, free of charge, to any person       */
+/*    obtaining a copy of this software and associated documentation    */
+/*    files (the "Software"), to deal in the Software without           */
+/*    restriction, including without limitation the rights to use,      */
+/*    copy, modify, merge, publish, distribute, sublicense, and/or      */
+/*    sell copies of the Software, and to permit persons to whom the    */
+/*    Software is furnished to do so, subject to the following          */
+/*    conditions:                                                       */
+/*                                                                      */
+/*    The above copyright notice and this permission notice shall be    */
+/*    included in all copies or substantial portions of the             */
+/*    Software.                                                         */
+/*                                                                      */
+/*    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND    */
+/*    EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES   */
+/*    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND          */
+/*    NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT       */
+/*    HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,      */
+/*    WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING      */
+/*    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR     */
+/*    OTHER DEALINGS IN THE SOFTWARE.                                   */
+/*                                                                      */
+/************************************************************************/
+
+#ifdef NDEBUG
+#undef NDEBUG
+#endif
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vigra2/unittest.hxx>
+#include <vigra2/transpose.hxx>
+#include <vigra2/array_nd.hxx>
+#include <vigra2/array_math.hxx>
+
+using namespace vigra;
+
+struct TransposeTest
+{
+    typedef Shape<3> S;
+    typedef Shape<2> S2;
+
+    template <class T>
+    void fill(ArrayViewND<3, T> a)
+    {
+        int k = 0;
+        for(auto & v : a)
+            v = T(k++ % 101);
+    }
+
+    template <class T>
+    void testTransposeCopyImpl()
+    {
+        // odd sizes exercise the scalar tails of the tile kernels,
+        // sizes beyond the leaf size exercise the recursion
+        ArrayND<3, T> src(S{ 5, 70, 37 });
+        fill<T>(src);
+
+        S permutations[] = { S{ 0, 1, 2 }, S{ 0, 2, 1 }, S{ 1, 0, 2 },
+                             S{ 1, 2, 0 }, S{ 2, 0, 1 }, S{ 2, 1, 0 } };
+        for(auto const & p : permutations)
+        {
+            ArrayND<3, T> dest(src.shape().transpose(p));
+            transposeCopy(src, dest, p);
+            should(dest == src.transpose(p));
+        }
+
+        // reversed axes, i.e. conversion to Fortran order
+        ArrayND<3, T> fdest(reversed(src.shape()));
+        transposeCopy(src, fdest);
+        should(fdest == src.transpose());
+        should(fdest.transpose() == src);
+
+        // strided source and destination
+        ArrayViewND<3, T> csrc = src.subarray(S{ 1, 3, 2 }, S{ 4, 69, 35 }, S{ 1, 1, 2 }).flip(1);
+        ArrayND<3, T> big(S{ 17, 66, 4 }, T(0));
+        ArrayViewND<3, T> sdest = big.subarray(S{ 0, 0, 1 }, S{ 17, 66, 4 });
+        transposeCopy(csrc, sdest, S{ 2, 1, 0 });
+        should(sdest == csrc.transpose());
+        shouldEqual(big(3, 4, 0), T(0));
+
+        // 2D matrix into the transposed view of another matrix
+        ArrayND<2, T> m(S2{ 45, 67 }), t(S2{ 45, 67 });
+        int k = 0;
+        for(auto & v : m)
+            v = T(k++ % 97);
+        transposeCopy(m, t.transpose(), S2{ 1, 0 });
+        should(t == m);
+    }
+
+    void testTransposeCopy()
+    {
+        testTransposeCopyImpl<float>();
+        testTransposeCopyImpl<double>();
+        testTransposeCopyImpl<std::uint8_t>();
+        testTransposeCopyImpl<std::int16_t>();
+        testTransposeCopyImpl<std::int32_t>();
+
+        // overlapping memory falls back to plain assignment
+        ArrayND<2, float> a(S2{ 4, 4 });
+        int k = 0;
+        for(auto & v : a)
+            v = float(k++);
+        ArrayND<2, float> ref(a.transpose());
+        transposeCopy(a, a);
+        should(a == ref);
+
+        try
+        {
+            ArrayND<2, float> b(S2{ 3, 5 });
+            transposeCopy(b, b);
+            failTest("no exception thrown");
+        }
+        catch(std::exception & e)
+        {
+            std::string expected("\nPrecondition violation!\ntransposeCopy(): shape mismatch.");
+            std::string message(e.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+    }
+
+    template <class T>
+    void testTransposeInPlaceImpl()
+    {
+        for(int n : { 1, 3, 8, 33, 70 })
+        {
+            ArrayND<2, T> m(S2{ n, n });
+            int k = 0;
+            for(auto & v : m)
+                v = T(k++ % 113);
+            ArrayND<2, T> ref(m.transpose());
+            transposeInPlace(m);
+            should(m == ref);
+        }
+
+        ArrayND<3, T> cube(S{ 37, 5, 37 });
+        fill<T>(cube);
+        ArrayND<3, T> ref(cube.transpose(S{ 2, 1, 0 }));
+        transposeInPlace(cube, 0, 2);
+        should(cube == ref);
+        transposeInPlace(cube, 2, 0);
+        should(cube == ref.transpose(S{ 2, 1, 0 }));
+
+        ArrayND<3, T> planes(S{ 3, 40, 40 });
+        fill<T>(planes);
+        ArrayND<3, T> pref(planes.transpose(S{ 0, 2, 1 }));
+        transposeInPlace(planes, 1, 2);
+        should(planes == pref);
+
+        // transposed view: the consecutive axis is axis 0
+        ArrayND<3, T> fplanes(S{ 40, 40, 3 });
+        fill<T>(fplanes);
+        ArrayViewND<3, T> fview = fplanes.transpose();
+        ArrayND<3, T> fref(fview.transpose(S{ 0, 2, 1 }));
+        transposeInPlace(fview, 1, 2);
+        should(fview == fref);
+    }
+
+    void testTransposeInPlace()
+    {
+        testTransposeInPlaceImpl<float>();
+        testTransposeInPlaceImpl<double>();
+        testTransposeInPlaceImpl<std::uint8_t>();
+
+        ArrayND<3, float> a(S{ 4, 5, 4 });
+        try
+        {
+            transposeInPlace(a, 0, 1);
+            failTest("no exception thrown");
+        }
+        catch(std::exception & e)
+        {
+            std::string expected("\nPrecondition violation!\ntransposeInPlace(): axes must have the same length.");
+            std::string message(e.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+        try
+        {
+            transposeInPlace(a, 0, 3);
+            failTest("no exception thrown");
+        }
+        catch(std::exception & e)
+        {
+            std::string expected("\nPrecondition violation!\ntransposeInPlace(): invalid axes.");
+            std::string message(e.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+        try
+        {
+            transposeInPlace(a);
+            failTest("no exception thrown");
+        }
+        catch(std::exception & e)
+        {
+            std::string expected("\nPrecondition violation!\ntransposeInPlace(): array must be 2-dimensional.");
+            std::string message(e.what());
+            should(0 == expected.compare(message.substr(0,expected.size())));
+        }
+    }
+};
+
+struct TransposeTestSuite
+: public vigra::test_suite
+{
+    TransposeTestSuite()
+    : vigra::test_suite("TransposeTestSuite")
+    {
+        add( testCase(&TransposeTest::testTransposeCopy));
+        add( testCase(&TransposeTest::testTransposeInPlace));
+    }
+};
+
+int main(int argc, char ** argv)
+{
+    TransposeTestSuite test;
+
+    int failed = test.run(vigra::testsToBeExecuted(argc, argv));
+
+    std::cout << test.report() << std::endl;
+
+    return (failed != 0);
+}